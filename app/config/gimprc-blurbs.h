@@ -445,6 +445,11 @@ N_("When enabled, GIMP will not save an image if it has not been changed " \
 N_("Sets the minimal number of operations that can be undone. More undo " \
    "levels are kept available until the undo-size limit is reached.")
 
+#define UNDO_LEVELS_MAX_BLURB \
+N_("Sets the maximal number of operations that can be undone, even if " \
+   "the undo-size limit is not reached yet. This never removes more undo " \
+   "levels than the minimal number configured in undo-levels.")
+
 #define UNDO_SIZE_BLURB \
 N_("Sets an upper limit to the memory that is used per image to keep " \
    "operations on the undo stack. Regardless of this setting, at least " \
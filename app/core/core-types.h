@@ -199,8 +199,10 @@ typedef struct _GimpTagged          GimpTagged;      /* dummy typedef */
 
 typedef struct _GimpArea            GimpArea;
 typedef struct _GimpBoundSeg        GimpBoundSeg;
+typedef struct _GimpBoundaryCache   GimpBoundaryCache;
 typedef struct _GimpCoords          GimpCoords;
 typedef struct _GimpGradientSegment GimpGradientSegment;
+typedef struct _GimpHistogramCache  GimpHistogramCache;
 typedef struct _GimpPaletteEntry    GimpPaletteEntry;
 typedef struct _GimpSamplePoint     GimpSamplePoint;
 typedef struct _GimpScanConvert     GimpScanConvert;
@@ -0,0 +1,546 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995-2002 Spencer Kimball, Peter Mattis, and others
+ *
+ * gimp-parallel.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "gimp.h"
+#include "gimp-parallel.h"
+
+
+#define GIMP_PARALLEL_MAX_THREADS 64
+
+
+typedef struct
+{
+  GimpParallelDistributeFunc  func;
+  gint                        n;
+  gpointer                    user_data;
+
+  gint                        remaining;
+  GMutex                      mutex;
+  GCond                       cond;
+} GimpParallelDistributeTask;
+
+typedef struct
+{
+  GThread                    *thread;
+  GMutex                      mutex;
+  GCond                       cond;
+
+  gboolean                    quit;
+  GimpParallelDistributeTask *task;
+  gint                        i;
+} GimpParallelWorker;
+
+typedef struct
+{
+  GimpParallelDistributeRangeFunc  func;
+  gsize                            size;
+  gpointer                         user_data;
+} GimpParallelDistributeRangeData;
+
+typedef struct
+{
+  GimpParallelDistributeAreaFunc  func;
+  const GeglRectangle            *area;
+  gint                            tile_height;
+  gint                            row1;
+  gint                            n_rows;
+  gpointer                        user_data;
+} GimpParallelDistributeAreaData;
+
+
+/*  local function prototypes  */
+
+static void       gimp_parallel_notify_num_processors (GimpGeglConfig     *config);
+
+static void       gimp_parallel_set_n_threads         (gint                n_threads);
+static gpointer   gimp_parallel_worker_func           (GimpParallelWorker *worker);
+
+static void       gimp_parallel_distribute_range_func (gint                i,
+                                                       gint                n,
+                                                       gpointer            user_data);
+static void       gimp_parallel_distribute_area_func  (gint                i,
+                                                       gint                n,
+                                                       gpointer            user_data);
+static void       gimp_parallel_distribute_tiles_func (gint                i,
+                                                       gint                n,
+                                                       gpointer            user_data);
+
+
+/*  local variables  */
+
+static gint               gimp_parallel_n_threads = 1;
+static GimpParallelWorker gimp_parallel_workers[GIMP_PARALLEL_MAX_THREADS];
+static GMutex             gimp_parallel_distribute_mutex;
+static GPrivate           gimp_parallel_is_worker;
+
+
+/*  public functions  */
+
+void
+gimp_parallel_init (Gimp *gimp)
+{
+  GimpGeglConfig *config;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  config = GIMP_GEGL_CONFIG (gimp->config);
+
+  g_signal_connect (config, "notify::num-processors",
+                    G_CALLBACK (gimp_parallel_notify_num_processors),
+                    NULL);
+
+  gimp_parallel_notify_num_processors (config);
+}
+
+void
+gimp_parallel_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_signal_handlers_disconnect_by_func (gimp->config,
+                                        gimp_parallel_notify_num_processors,
+                                        NULL);
+
+  /* stop all worker threads */
+  gimp_parallel_set_n_threads (1);
+}
+
+gint
+gimp_parallel_get_n_threads (void)
+{
+  return g_atomic_int_get (&gimp_parallel_n_threads);
+}
+
+/**
+ * gimp_parallel_distribute:
+ * @max_n:     the maximal number of parts to split the work into
+ * @func:      the function to call for each part
+ * @user_data: user data to pass to @func
+ *
+ * Calls @func (i, n, @user_data) for each i in [0, n), where n is
+ * the smaller of @max_n and the number of threads configured by
+ * GimpGeglConfig::num-processors.  All the calls but the last are
+ * made on worker threads, the last one is made on the calling
+ * thread.  The function returns once all the calls are finished.
+ *
+ * Nested or concurrent calls don't block, they call @func (0, 1,
+ * @user_data) on the calling thread instead.
+ **/
+void
+gimp_parallel_distribute (gint                       max_n,
+                          GimpParallelDistributeFunc func,
+                          gpointer                   user_data)
+{
+  GimpParallelDistributeTask task;
+  gint                       i;
+
+  g_return_if_fail (func != NULL);
+
+  if (max_n == 0)
+    return;
+
+  if (max_n < 0)
+    max_n = gimp_parallel_n_threads;
+  else
+    max_n = MIN (max_n, gimp_parallel_n_threads);
+
+  if (max_n == 1                                 ||
+      g_private_get (&gimp_parallel_is_worker)   ||
+      ! g_mutex_trylock (&gimp_parallel_distribute_mutex))
+    {
+      func (0, 1, user_data);
+      return;
+    }
+
+  /*  the number of threads may have changed while we were waiting */
+  max_n = MIN (max_n, gimp_parallel_n_threads);
+
+  task.func      = func;
+  task.n         = max_n;
+  task.user_data = user_data;
+  task.remaining = max_n - 1;
+
+  g_mutex_init (&task.mutex);
+  g_cond_init (&task.cond);
+
+  for (i = 0; i < max_n - 1; i++)
+    {
+      GimpParallelWorker *worker = &gimp_parallel_workers[i];
+
+      g_mutex_lock (&worker->mutex);
+
+      worker->task = &task;
+      worker->i    = i;
+
+      g_cond_signal (&worker->cond);
+
+      g_mutex_unlock (&worker->mutex);
+    }
+
+  func (max_n - 1, max_n, user_data);
+
+  g_mutex_lock (&task.mutex);
+
+  while (task.remaining > 0)
+    g_cond_wait (&task.cond, &task.mutex);
+
+  g_mutex_unlock (&task.mutex);
+
+  g_cond_clear (&task.cond);
+  g_mutex_clear (&task.mutex);
+
+  g_mutex_unlock (&gimp_parallel_distribute_mutex);
+}
+
+/**
+ * gimp_parallel_distribute_range:
+ * @size:         the size of the range
+ * @min_sub_size: the minimal size of each sub-range
+ * @func:         the function to call for each sub-range
+ * @user_data:    user data to pass to @func
+ *
+ * Splits [0, @size) into contiguous sub-ranges of at least
+ * @min_sub_size elements, and processes them in parallel using
+ * gimp_parallel_distribute().
+ **/
+void
+gimp_parallel_distribute_range (gsize                           size,
+                                gsize                           min_sub_size,
+                                GimpParallelDistributeRangeFunc func,
+                                gpointer                        user_data)
+{
+  GimpParallelDistributeRangeData data;
+  gint                            n;
+
+  g_return_if_fail (func != NULL);
+
+  if (size == 0)
+    return;
+
+  if (min_sub_size > 1)
+    n = MIN (size / min_sub_size, G_MAXINT);
+  else
+    n = MIN (size, G_MAXINT);
+
+  n = CLAMP (n, 1, gimp_parallel_n_threads);
+
+  if (n == 1)
+    {
+      func (0, size, user_data);
+      return;
+    }
+
+  data.func      = func;
+  data.size      = size;
+  data.user_data = user_data;
+
+  gimp_parallel_distribute (n, gimp_parallel_distribute_range_func, &data);
+}
+
+/**
+ * gimp_parallel_distribute_area:
+ * @area:         the area to process
+ * @min_sub_area: the minimal number of pixels in each sub-area
+ * @func:         the function to call for each sub-area
+ * @user_data:    user data to pass to @func
+ *
+ * Splits @area into horizontal strips of at least @min_sub_area
+ * pixels, and processes them in parallel using
+ * gimp_parallel_distribute().
+ **/
+void
+gimp_parallel_distribute_area (const GeglRectangle            *area,
+                               gsize                           min_sub_area,
+                               GimpParallelDistributeAreaFunc  func,
+                               gpointer                        user_data)
+{
+  GimpParallelDistributeAreaData data;
+  gsize                          n_pixels;
+  gint                           n;
+
+  g_return_if_fail (area != NULL);
+  g_return_if_fail (func != NULL);
+
+  if (area->width <= 0 || area->height <= 0)
+    return;
+
+  n_pixels = (gsize) area->width * (gsize) area->height;
+
+  if (min_sub_area > 1)
+    n = MIN (n_pixels / min_sub_area, G_MAXINT);
+  else
+    n = MIN (n_pixels, G_MAXINT);
+
+  n = CLAMP (n, 1, MIN (area->height, gimp_parallel_n_threads));
+
+  if (n == 1)
+    {
+      func (area, user_data);
+      return;
+    }
+
+  data.func      = func;
+  data.area      = area;
+  data.user_data = user_data;
+
+  gimp_parallel_distribute (n, gimp_parallel_distribute_area_func, &data);
+}
+
+/**
+ * gimp_parallel_distribute_tiles:
+ * @area:         the area to process
+ * @tile_height:  the tile height of the buffer written to
+ * @min_sub_area: the minimal number of pixels in each sub-area
+ * @func:         the function to call for each sub-area
+ * @user_data:    user data to pass to @func
+ *
+ * Like gimp_parallel_distribute_area(), but the strips start and end
+ * at multiples of @tile_height.  Use it when @func writes to a buffer
+ * with that tile height, so that no two threads write to the same
+ * tile.
+ **/
+void
+gimp_parallel_distribute_tiles (const GeglRectangle            *area,
+                                gint                            tile_height,
+                                gsize                           min_sub_area,
+                                GimpParallelDistributeAreaFunc  func,
+                                gpointer                        user_data)
+{
+  GimpParallelDistributeAreaData data;
+  gsize                          n_pixels;
+  gint                           row1;
+  gint                           row2;
+  gint                           n;
+
+  g_return_if_fail (area != NULL);
+  g_return_if_fail (tile_height > 0);
+  g_return_if_fail (func != NULL);
+
+  if (area->width <= 0 || area->height <= 0)
+    return;
+
+  /*  round towards negative infinity  */
+  row1 = (area->y >= 0 ?
+          area->y / tile_height :
+          -((tile_height - 1 - area->y) / tile_height));
+  row2 = (area->y + area->height - 1 >= 0 ?
+          (area->y + area->height - 1) / tile_height :
+          -((tile_height - area->y - area->height) / tile_height)) + 1;
+
+  n_pixels = (gsize) area->width * (gsize) area->height;
+
+  if (min_sub_area > 1)
+    n = MIN (n_pixels / min_sub_area, G_MAXINT);
+  else
+    n = MIN (n_pixels, G_MAXINT);
+
+  n = CLAMP (n, 1, MIN (row2 - row1, gimp_parallel_n_threads));
+
+  if (n == 1)
+    {
+      func (area, user_data);
+      return;
+    }
+
+  data.func        = func;
+  data.area        = area;
+  data.tile_height = tile_height;
+  data.row1        = row1;
+  data.n_rows      = row2 - row1;
+  data.user_data   = user_data;
+
+  gimp_parallel_distribute (n, gimp_parallel_distribute_tiles_func, &data);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_parallel_notify_num_processors (GimpGeglConfig *config)
+{
+  gimp_parallel_set_n_threads (config->num_processors);
+}
+
+static void
+gimp_parallel_set_n_threads (gint n_threads)
+{
+  gint i;
+
+  n_threads = CLAMP (n_threads, 1, GIMP_PARALLEL_MAX_THREADS);
+
+  /*  wait for any running gimp_parallel_distribute() call to finish  */
+  g_mutex_lock (&gimp_parallel_distribute_mutex);
+
+  /*  the calling thread participates in each distribution, so we
+   *  need one worker thread less than the number of threads
+   */
+  for (i = gimp_parallel_n_threads - 1; i < n_threads - 1; i++)
+    {
+      GimpParallelWorker *worker = &gimp_parallel_workers[i];
+
+      worker->quit = FALSE;
+      worker->task = NULL;
+
+      g_mutex_init (&worker->mutex);
+      g_cond_init (&worker->cond);
+
+      worker->thread = g_thread_new ("worker",
+                                     (GThreadFunc) gimp_parallel_worker_func,
+                                     worker);
+    }
+
+  for (i = n_threads - 1; i < gimp_parallel_n_threads - 1; i++)
+    {
+      GimpParallelWorker *worker = &gimp_parallel_workers[i];
+
+      g_mutex_lock (&worker->mutex);
+
+      worker->quit = TRUE;
+      g_cond_signal (&worker->cond);
+
+      g_mutex_unlock (&worker->mutex);
+
+      g_thread_join (worker->thread);
+      worker->thread = NULL;
+
+      g_cond_clear (&worker->cond);
+      g_mutex_clear (&worker->mutex);
+    }
+
+  g_atomic_int_set (&gimp_parallel_n_threads, n_threads);
+
+  g_mutex_unlock (&gimp_parallel_distribute_mutex);
+}
+
+static gpointer
+gimp_parallel_worker_func (GimpParallelWorker *worker)
+{
+  g_private_set (&gimp_parallel_is_worker, worker);
+
+  g_mutex_lock (&worker->mutex);
+
+  while (! worker->quit)
+    {
+      GimpParallelDistributeTask *task = worker->task;
+
+      if (task)
+        {
+          g_mutex_unlock (&worker->mutex);
+
+          task->func (worker->i, task->n, task->user_data);
+
+          /*  clear the task before signaling completion, the next
+           *  gimp_parallel_distribute() call may assign a new one
+           *  right away
+           */
+          g_mutex_lock (&worker->mutex);
+          worker->task = NULL;
+          g_mutex_unlock (&worker->mutex);
+
+          g_mutex_lock (&task->mutex);
+
+          if (--task->remaining == 0)
+            g_cond_signal (&task->cond);
+
+          g_mutex_unlock (&task->mutex);
+
+          g_mutex_lock (&worker->mutex);
+        }
+      else
+        {
+          g_cond_wait (&worker->cond, &worker->mutex);
+        }
+    }
+
+  g_mutex_unlock (&worker->mutex);
+
+  return NULL;
+}
+
+static void
+gimp_parallel_distribute_range_func (gint     i,
+                                     gint     n,
+                                     gpointer user_data)
+{
+  GimpParallelDistributeRangeData *data = user_data;
+  gsize                            offset;
+  gsize                            size;
+
+  offset = (2 * i       * data->size + n) / (2 * n);
+  size   = (2 * (i + 1) * data->size + n) / (2 * n) - offset;
+
+  data->func (offset, size, data->user_data);
+}
+
+static void
+gimp_parallel_distribute_area_func (gint     i,
+                                    gint     n,
+                                    gpointer user_data)
+{
+  GimpParallelDistributeAreaData *data = user_data;
+  GeglRectangle                   area;
+  gint                            y1;
+  gint                            y2;
+
+  y1 = (2 * i       * data->area->height + n) / (2 * n);
+  y2 = (2 * (i + 1) * data->area->height + n) / (2 * n);
+
+  area.x      = data->area->x;
+  area.y      = data->area->y + y1;
+  area.width  = data->area->width;
+  area.height = y2 - y1;
+
+  data->func (&area, data->user_data);
+}
+
+static void
+gimp_parallel_distribute_tiles_func (gint     i,
+                                     gint     n,
+                                     gpointer user_data)
+{
+  GimpParallelDistributeAreaData *data = user_data;
+  GeglRectangle                   area;
+  gint                            y1;
+  gint                            y2;
+
+  y1 = data->row1 + (2 * i       * data->n_rows + n) / (2 * n);
+  y2 = data->row1 + (2 * (i + 1) * data->n_rows + n) / (2 * n);
+
+  y1 = MAX (y1 * data->tile_height, data->area->y);
+  y2 = MIN (y2 * data->tile_height, data->area->y + data->area->height);
+
+  if (y2 <= y1)
+    return;
+
+  area.x      = data->area->x;
+  area.y      = y1;
+  area.width  = data->area->width;
+  area.height = y2 - y1;
+
+  data->func (&area, data->user_data);
+}
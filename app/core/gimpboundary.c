@@ -26,12 +26,16 @@
 
 #include "core-types.h"
 
+#include "gimp-parallel.h"
 #include "gimpboundary.h"
 
 
 /* GimpBoundSeg array growth parameter */
 #define MAX_SEGS_INC  2048
 
+/* size of the tiles the boundary cache traces separately */
+#define CACHE_TILE_SIZE  128
+
 
 typedef struct _GimpBoundary GimpBoundary;
 
@@ -52,6 +56,37 @@ struct _GimpBoundary
   gint          max_empty_segs;
 };
 
+typedef struct
+{
+  GimpBoundSeg *segs;
+  gint          num_segs;
+  gboolean      valid;
+} GimpBoundaryTile;
+
+struct _GimpBoundaryCache
+{
+  GeglBuffer       *buffer;
+  const Babl       *format;
+  gfloat            threshold;
+  GeglRectangle     extent;
+
+  gint              n_tiles_x;
+  gint              n_tiles_y;
+  GimpBoundaryTile *tiles;
+
+  /*  protects the tiles' valid flags, the buffer's "changed" signal
+   *  can be emitted from any thread
+   */
+  GMutex            mutex;
+  gulong            changed_handler;
+};
+
+typedef struct
+{
+  GimpBoundaryCache *cache;
+  const gint        *tiles;
+} TraceTilesData;
+
 
 /*  local function prototypes  */
 
@@ -101,6 +136,18 @@ static GimpBoundary * generate_boundary        (GeglBuffer          *buffer,
                                                 gint                 y2,
                                                 gfloat               threshold);
 
+static void       gimp_boundary_cache_buffer_changed
+                                          (GeglBuffer          *buffer,
+                                           const GeglRectangle *rect,
+                                           GimpBoundaryCache   *cache);
+static void       gimp_boundary_cache_trace_tile
+                                          (GimpBoundaryCache   *cache,
+                                           gint                 index);
+static void       gimp_boundary_cache_trace_tiles
+                                          (gsize                offset,
+                                           gsize                size,
+                                           TraceTilesData      *data);
+
 static gint       cmp_segptr_xy1_addr     (const GimpBoundSeg **seg_ptr_a,
                                            const GimpBoundSeg **seg_ptr_b);
 static gint       cmp_segptr_xy2_addr     (const GimpBoundSeg **seg_ptr_a,
@@ -404,6 +451,286 @@ gimp_boundary_offset (GimpBoundSeg *segs,
 }
 
 
+/**
+ * gimp_boundary_cache_new:
+ * @buffer:    the #GeglBuffer to trace
+ * @format:    a #Babl float format representing the component to analyze
+ * @threshold: pixel value of boundary line
+ *
+ * Creates a cache of the outlines of @buffer, which is split into
+ * tiles that are traced separately. The cache watches @buffer's
+ * "changed" signal, so that gimp_boundary_cache_find() only needs to
+ * trace the tiles again which changed since it was last called.
+ *
+ * Return value: the new #GimpBoundaryCache.
+ **/
+GimpBoundaryCache *
+gimp_boundary_cache_new (GeglBuffer *buffer,
+                         const Babl *format,
+                         gfloat      threshold)
+{
+  GimpBoundaryCache *cache;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (format != NULL, NULL);
+  g_return_val_if_fail (babl_format_get_bytes_per_pixel (format) ==
+                        sizeof (gfloat), NULL);
+
+  cache = g_slice_new0 (GimpBoundaryCache);
+
+  cache->buffer    = g_object_ref (buffer);
+  cache->format    = format;
+  cache->threshold = threshold;
+  cache->extent    = *gegl_buffer_get_extent (buffer);
+
+  cache->n_tiles_x = (cache->extent.width  + CACHE_TILE_SIZE - 1) /
+                     CACHE_TILE_SIZE;
+  cache->n_tiles_y = (cache->extent.height + CACHE_TILE_SIZE - 1) /
+                     CACHE_TILE_SIZE;
+
+  cache->tiles = g_new0 (GimpBoundaryTile,
+                         cache->n_tiles_x * cache->n_tiles_y);
+
+  g_mutex_init (&cache->mutex);
+
+  cache->changed_handler =
+    gegl_buffer_signal_connect (buffer, "changed",
+                                G_CALLBACK (gimp_boundary_cache_buffer_changed),
+                                cache);
+
+  return cache;
+}
+
+void
+gimp_boundary_cache_free (GimpBoundaryCache *cache)
+{
+  gint i;
+
+  g_return_if_fail (cache != NULL);
+
+  g_signal_handler_disconnect (cache->buffer, cache->changed_handler);
+  g_object_unref (cache->buffer);
+
+  for (i = 0; i < cache->n_tiles_x * cache->n_tiles_y; i++)
+    g_free (cache->tiles[i].segs);
+
+  g_free (cache->tiles);
+
+  g_mutex_clear (&cache->mutex);
+
+  g_slice_free (GimpBoundaryCache, cache);
+}
+
+/**
+ * gimp_boundary_cache_invalidate:
+ * @cache: a #GimpBoundaryCache
+ * @rect:  the changed area of the buffer, or %NULL
+ *
+ * Makes the next gimp_boundary_cache_find() trace the tiles again
+ * whose outlines depend on the pixels in @rect, or all tiles if @rect
+ * is %NULL. This happens automatically when the buffer emits
+ * "changed".
+ **/
+void
+gimp_boundary_cache_invalidate (GimpBoundaryCache   *cache,
+                                const GeglRectangle *rect)
+{
+  gint tile_x1, tile_y1;
+  gint tile_x2, tile_y2;
+  gint x, y;
+
+  g_return_if_fail (cache != NULL);
+
+  if (rect)
+    {
+      GeglRectangle area;
+
+      /*  a pixel also changes the edges to its right and below it,
+       *  which can belong to the next tiles
+       */
+      area.x      = rect->x;
+      area.y      = rect->y;
+      area.width  = rect->width  + 1;
+      area.height = rect->height + 1;
+
+      if (! gegl_rectangle_intersect (&area, &area, &cache->extent))
+        return;
+
+      tile_x1 = (area.x - cache->extent.x) / CACHE_TILE_SIZE;
+      tile_y1 = (area.y - cache->extent.y) / CACHE_TILE_SIZE;
+      tile_x2 = (area.x + area.width  - 1 - cache->extent.x) / CACHE_TILE_SIZE;
+      tile_y2 = (area.y + area.height - 1 - cache->extent.y) / CACHE_TILE_SIZE;
+    }
+  else
+    {
+      tile_x1 = 0;
+      tile_y1 = 0;
+      tile_x2 = cache->n_tiles_x - 1;
+      tile_y2 = cache->n_tiles_y - 1;
+    }
+
+  g_mutex_lock (&cache->mutex);
+
+  for (y = tile_y1; y <= tile_y2; y++)
+    for (x = tile_x1; x <= tile_x2; x++)
+      cache->tiles[y * cache->n_tiles_x + x].valid = FALSE;
+
+  g_mutex_unlock (&cache->mutex);
+}
+
+/**
+ * gimp_boundary_cache_find:
+ * @cache:    a #GimpBoundaryCache
+ * @num_segs: number of returned #GimpBoundSeg's
+ *
+ * Traces the tiles which changed in parallel, and joins the segments
+ * of all tiles. The result is the same set of segments which
+ * gimp_boundary_find() returns for the whole buffer with
+ * %GIMP_BOUNDARY_WITHIN_BOUNDS, though not in the same order.
+ *
+ * Return value: the boundary array, free it with g_free().
+ **/
+GimpBoundSeg *
+gimp_boundary_cache_find (GimpBoundaryCache *cache,
+                          gint              *num_segs)
+{
+  GimpBoundary   *boundary;
+  TraceTilesData  data;
+  gint           *dirty;
+  gint            n_dirty = 0;
+  gint           *pending_h;
+  gint           *pending_v;
+  gint            n_tiles;
+  gint            i;
+
+  g_return_val_if_fail (cache != NULL, NULL);
+  g_return_val_if_fail (num_segs != NULL, NULL);
+
+  n_tiles = cache->n_tiles_x * cache->n_tiles_y;
+
+  /*  mark the tiles valid before tracing them, so that changes which
+   *  happen meanwhile are not lost
+   */
+  dirty = g_new (gint, n_tiles);
+
+  g_mutex_lock (&cache->mutex);
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      if (! cache->tiles[i].valid)
+        {
+          cache->tiles[i].valid = TRUE;
+          dirty[n_dirty++] = i;
+        }
+    }
+
+  g_mutex_unlock (&cache->mutex);
+
+  data.cache = cache;
+  data.tiles = dirty;
+
+  gimp_parallel_distribute_range (n_dirty, 1,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_boundary_cache_trace_tiles,
+                                  &data);
+
+  g_free (dirty);
+
+  /*  join the segments which the tile borders split, segments that
+   *  continue across a border always start in the next tile exactly
+   *  where they ended, with the same orientation
+   */
+  boundary = gimp_boundary_new (NULL);
+
+  pending_h = g_new (gint, CACHE_TILE_SIZE + 1);
+  pending_v = g_new (gint, cache->extent.width + 1);
+
+  for (i = 0; i <= cache->extent.width; i++)
+    pending_v[i] = -1;
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      const GimpBoundaryTile *tile = &cache->tiles[i];
+      gint                    x0;
+      gint                    y0;
+      gint                    j;
+
+      x0 = cache->extent.x + (i % cache->n_tiles_x) * CACHE_TILE_SIZE;
+      y0 = cache->extent.y + (i / cache->n_tiles_x) * CACHE_TILE_SIZE;
+
+      if (i % cache->n_tiles_x == 0)
+        {
+          for (j = 0; j <= CACHE_TILE_SIZE; j++)
+            pending_h[j] = -1;
+        }
+
+      for (j = 0; j < tile->num_segs; j++)
+        {
+          const GimpBoundSeg *seg = &tile->segs[j];
+          gint               *pending;
+          gint                end;
+
+          if (seg->y1 == seg->y2)
+            {
+              pending = &pending_h[seg->y1 - y0];
+              end     = x0 + CACHE_TILE_SIZE;
+            }
+          else
+            {
+              pending = &pending_v[seg->x1 - cache->extent.x];
+              end     = y0 + CACHE_TILE_SIZE;
+            }
+
+          if (*pending >= 0                         &&
+              boundary->segs[*pending].x2   == seg->x1 &&
+              boundary->segs[*pending].y2   == seg->y1 &&
+              boundary->segs[*pending].open == seg->open)
+            {
+              boundary->segs[*pending].x2 = seg->x2;
+              boundary->segs[*pending].y2 = seg->y2;
+            }
+          else
+            {
+              gimp_boundary_add_seg (boundary,
+                                     seg->x1, seg->y1,
+                                     seg->x2, seg->y2,
+                                     seg->open);
+
+              *pending = boundary->num_segs - 1;
+            }
+
+          /*  only segments reaching the next tile can continue there  */
+          if ((seg->y1 == seg->y2 ? seg->x2 : seg->y2) != end)
+            *pending = -1;
+        }
+    }
+
+  g_free (pending_h);
+  g_free (pending_v);
+
+  *num_segs = boundary->num_segs;
+
+  return gimp_boundary_free (boundary, FALSE);
+}
+
+gint64
+gimp_boundary_cache_get_memsize (GimpBoundaryCache *cache)
+{
+  gint64 memsize;
+  gint   i;
+
+  g_return_val_if_fail (cache != NULL, 0);
+
+  memsize = (sizeof (GimpBoundaryCache) +
+             cache->n_tiles_x * cache->n_tiles_y * sizeof (GimpBoundaryTile));
+
+  for (i = 0; i < cache->n_tiles_x * cache->n_tiles_y; i++)
+    memsize += cache->tiles[i].num_segs * sizeof (GimpBoundSeg);
+
+  return memsize;
+}
+
+
 /*  private functions  */
 
 static GimpBoundary *
@@ -764,6 +1091,144 @@ generate_boundary (GeglBuffer          *buffer,
   return boundary;
 }
 
+static void
+gimp_boundary_cache_buffer_changed (GeglBuffer          *buffer,
+                                    const GeglRectangle *rect,
+                                    GimpBoundaryCache   *cache)
+{
+  gimp_boundary_cache_invalidate (cache, rect);
+}
+
+/*  Traces the edges which belong to a tile: the horizontal edges at the
+ *  tile's scanlines, and the vertical edges at its columns, plus the
+ *  buffer's bottom and right edges for the last tiles. Outside the
+ *  buffer counts as empty, just like in generate_boundary(). Each run
+ *  of edges with the same orientation becomes a segment, like
+ *  process_horiz_seg() produces them.
+ */
+static void
+gimp_boundary_cache_trace_tile (GimpBoundaryCache *cache,
+                                gint               index)
+{
+  GimpBoundaryTile *tile = &cache->tiles[index];
+  GimpBoundary     *boundary;
+  GeglRectangle     rect;
+  gfloat           *data;
+  guchar           *mask;
+  gint              x0, y0;
+  gint              width, height;
+  gint              n_cols, n_rows;
+  gint              stride;
+  gint              x, y;
+  gint              i;
+
+  x0 = cache->extent.x + (index % cache->n_tiles_x) * CACHE_TILE_SIZE;
+  y0 = cache->extent.y + (index / cache->n_tiles_x) * CACHE_TILE_SIZE;
+
+  width  = MIN (CACHE_TILE_SIZE, cache->extent.x + cache->extent.width  - x0);
+  height = MIN (CACHE_TILE_SIZE, cache->extent.y + cache->extent.height - y0);
+
+  n_cols = width;
+  n_rows = height;
+
+  if (x0 + width == cache->extent.x + cache->extent.width)
+    n_cols++;
+
+  if (y0 + height == cache->extent.y + cache->extent.height)
+    n_rows++;
+
+  /*  the tile plus a border of one pixel  */
+  rect.x      = x0 - 1;
+  rect.y      = y0 - 1;
+  rect.width  = width  + 2;
+  rect.height = height + 2;
+
+  stride = rect.width;
+
+  data = g_new (gfloat, rect.width * rect.height);
+  mask = g_new (guchar, rect.width * rect.height);
+
+  gegl_buffer_get (cache->buffer, &rect, 1.0, cache->format,
+                   data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < rect.width * rect.height; i++)
+    mask[i] = (data[i] > cache->threshold);
+
+  g_free (data);
+
+#define SELECTED(px,py) (mask[((py) - rect.y) * stride + (px) - rect.x])
+
+  boundary = gimp_boundary_new (NULL);
+
+  /*  horizontal segments, top edges of selected pixels are open  */
+  for (y = y0; y < y0 + n_rows; y++)
+    {
+      gint start = x0;
+      gint last  = -1;
+
+      for (x = x0; x <= x0 + width; x++)
+        {
+          gint edge = -1;
+
+          if (x < x0 + width && SELECTED (x, y - 1) != SELECTED (x, y))
+            edge = SELECTED (x, y);
+
+          if (edge != last)
+            {
+              if (last >= 0)
+                gimp_boundary_add_seg (boundary, start, y, x, y, last);
+
+              start = x;
+              last  = edge;
+            }
+        }
+    }
+
+  /*  vertical segments, left edges of selected pixels are open  */
+  for (x = x0; x < x0 + n_cols; x++)
+    {
+      gint start = y0;
+      gint last  = -1;
+
+      for (y = y0; y <= y0 + height; y++)
+        {
+          gint edge = -1;
+
+          if (y < y0 + height && SELECTED (x - 1, y) != SELECTED (x, y))
+            edge = SELECTED (x, y);
+
+          if (edge != last)
+            {
+              if (last >= 0)
+                gimp_boundary_add_seg (boundary, x, start, x, y, last);
+
+              start = y;
+              last  = edge;
+            }
+        }
+    }
+
+#undef SELECTED
+
+  g_free (mask);
+
+  g_free (tile->segs);
+
+  tile->num_segs = boundary->num_segs;
+  tile->segs     = gimp_boundary_free (boundary, FALSE);
+}
+
+static void
+gimp_boundary_cache_trace_tiles (gsize           offset,
+                                 gsize           size,
+                                 TraceTilesData *data)
+{
+  gsize i;
+
+  for (i = offset; i < offset + size; i++)
+    gimp_boundary_cache_trace_tile (data->cache, data->tiles[i]);
+}
+
 /*  sorting utility functions  */
 
 static inline gint
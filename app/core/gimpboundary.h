@@ -65,4 +65,20 @@ void       gimp_boundary_offset        (GimpBoundSeg        *segs,
                                         gint                 off_y);
 
 
+/*  keeps the boundary of a whole buffer, and only traces the tiles
+ *  again that changed since the last gimp_boundary_cache_find()
+ */
+GimpBoundaryCache * gimp_boundary_cache_new         (GeglBuffer          *buffer,
+                                                     const Babl          *format,
+                                                     gfloat               threshold);
+void                gimp_boundary_cache_free        (GimpBoundaryCache   *cache);
+
+void                gimp_boundary_cache_invalidate  (GimpBoundaryCache   *cache,
+                                                     const GeglRectangle *rect);
+GimpBoundSeg      * gimp_boundary_cache_find        (GimpBoundaryCache   *cache,
+                                                     gint                *num_segs);
+
+gint64              gimp_boundary_cache_get_memsize (GimpBoundaryCache   *cache);
+
+
 #endif  /*  __GIMP_BOUNDARY_H__  */
@@ -92,6 +92,9 @@ static gboolean      gimp_brush_real_want_null_motion (GimpBrush            *bru
 
 static gchar       * gimp_brush_get_checksum          (GimpTagged           *tagged);
 
+static gsize         gimp_brush_mask_get_memsize      (gconstpointer         mask);
+static gsize         gimp_brush_boundary_get_memsize  (gconstpointer         boundary);
+
 
 G_DEFINE_TYPE_WITH_CODE (GimpBrush, gimp_brush, GIMP_TYPE_DATA,
                          G_IMPLEMENT_INTERFACE (GIMP_TYPE_TAGGED,
@@ -258,6 +261,18 @@ gimp_brush_get_memsize (GimpObject *object,
   memsize += gimp_temp_buf_get_memsize (brush->mask);
   memsize += gimp_temp_buf_get_memsize (brush->pixmap);
 
+  if (brush->mask_cache)
+    memsize += gimp_object_get_memsize (GIMP_OBJECT (brush->mask_cache),
+                                        gui_size);
+
+  if (brush->pixmap_cache)
+    memsize += gimp_object_get_memsize (GIMP_OBJECT (brush->pixmap_cache),
+                                        gui_size);
+
+  if (brush->boundary_cache)
+    memsize += gimp_object_get_memsize (GIMP_OBJECT (brush->boundary_cache),
+                                        gui_size);
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -417,13 +432,19 @@ static void
 gimp_brush_real_begin_use (GimpBrush *brush)
 {
   brush->mask_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref, 'M', 'm');
+    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref,
+                          gimp_brush_mask_get_memsize,
+                          'M', 'm');
 
   brush->pixmap_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref, 'P', 'p');
+    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref,
+                          gimp_brush_mask_get_memsize,
+                          'P', 'p');
 
   brush->boundary_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_bezier_desc_free, 'B', 'b');
+    gimp_brush_cache_new ((GDestroyNotify) gimp_bezier_desc_free,
+                          gimp_brush_boundary_get_memsize,
+                          'B', 'b');
 }
 
 static void
@@ -482,6 +503,22 @@ gimp_brush_get_checksum (GimpTagged *tagged)
   return checksum_string;
 }
 
+/*  the cache's memsize functions, which take any data  */
+static gsize
+gimp_brush_mask_get_memsize (gconstpointer mask)
+{
+  return gimp_temp_buf_get_memsize (mask);
+}
+
+static gsize
+gimp_brush_boundary_get_memsize (gconstpointer boundary)
+{
+  const GimpBezierDesc *desc = boundary;
+
+  return sizeof (GimpBezierDesc) + desc->num_data * sizeof (cairo_path_data_t);
+}
+
+
 /*  public functions  */
 
 GimpData *
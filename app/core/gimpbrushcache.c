@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <math.h>
+
 #include <gegl.h>
 
 #include "core-types.h"
@@ -27,26 +29,65 @@
 #include "gimpbrushcache.h"
 
 #include "gimp-log.h"
+#include "gimp-utils.h"
 #include "gimp-intl.h"
 
 
+/*  dynamics change the brush transform on almost every dab, keep a
+ *  bunch of recently used transforms around instead of just the last one
+ */
+#define MAX_CACHED_UNITS    64
+#define MAX_CACHED_MEMSIZE  (32 * 1024 * 1024)
+
+
 enum
 {
   PROP_0,
-  PROP_DATA_DESTROY
+  PROP_DATA_DESTROY,
+  PROP_DATA_MEMSIZE
+};
+
+
+typedef struct _GimpBrushCacheUnit GimpBrushCacheUnit;
+
+struct _GimpBrushCacheUnit
+{
+  gpointer data;
+  gsize    memsize;
+
+  gint     width;
+  gint     height;
+  gint64   scale;
+  gint64   aspect_ratio;
+  gint64   angle;
+  gint64   hardness;
 };
 
 
-static void   gimp_brush_cache_constructed  (GObject      *object);
-static void   gimp_brush_cache_finalize     (GObject      *object);
-static void   gimp_brush_cache_set_property (GObject      *object,
-                                             guint         property_id,
-                                             const GValue *value,
-                                             GParamSpec   *pspec);
-static void   gimp_brush_cache_get_property (GObject      *object,
-                                             guint         property_id,
-                                             GValue       *value,
-                                             GParamSpec   *pspec);
+static void     gimp_brush_cache_constructed  (GObject            *object);
+static void     gimp_brush_cache_finalize     (GObject            *object);
+static void     gimp_brush_cache_set_property (GObject            *object,
+                                               guint               property_id,
+                                               const GValue       *value,
+                                               GParamSpec         *pspec);
+static void     gimp_brush_cache_get_property (GObject            *object,
+                                               guint               property_id,
+                                               GValue             *value,
+                                               GParamSpec         *pspec);
+
+static gint64   gimp_brush_cache_get_memsize  (GimpObject         *object,
+                                               gint64             *gui_size);
+
+static void     gimp_brush_cache_unit_init    (GimpBrushCacheUnit *unit,
+                                               gint                width,
+                                               gint                height,
+                                               gdouble             scale,
+                                               gdouble             aspect_ratio,
+                                               gdouble             angle,
+                                               gdouble             hardness);
+static void     gimp_brush_cache_unit_free    (GimpBrushCache     *cache,
+                                               GimpBrushCacheUnit *unit);
+static void     gimp_brush_cache_log_stats    (GimpBrushCache     *cache);
 
 
 G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
@@ -57,18 +98,27 @@ G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
 static void
 gimp_brush_cache_class_init (GimpBrushCacheClass *klass)
 {
-  GObjectClass  *object_class = G_OBJECT_CLASS (klass);
+  GObjectClass    *object_class      = G_OBJECT_CLASS (klass);
+  GimpObjectClass *gimp_object_class = GIMP_OBJECT_CLASS (klass);
+
+  object_class->constructed     = gimp_brush_cache_constructed;
+  object_class->finalize        = gimp_brush_cache_finalize;
+  object_class->set_property    = gimp_brush_cache_set_property;
+  object_class->get_property    = gimp_brush_cache_get_property;
 
-  object_class->constructed  = gimp_brush_cache_constructed;
-  object_class->finalize     = gimp_brush_cache_finalize;
-  object_class->set_property = gimp_brush_cache_set_property;
-  object_class->get_property = gimp_brush_cache_get_property;
+  gimp_object_class->get_memsize = gimp_brush_cache_get_memsize;
 
   g_object_class_install_property (object_class, PROP_DATA_DESTROY,
                                    g_param_spec_pointer ("data-destroy",
                                                          NULL, NULL,
                                                          GIMP_PARAM_READWRITE |
                                                          G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class, PROP_DATA_MEMSIZE,
+                                   g_param_spec_pointer ("data-memsize",
+                                                         NULL, NULL,
+                                                         GIMP_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY));
 }
 
 static void
@@ -91,11 +141,7 @@ gimp_brush_cache_finalize (GObject *object)
 {
   GimpBrushCache *cache = GIMP_BRUSH_CACHE (object);
 
-  if (cache->last_data)
-    {
-      cache->data_destroy (cache->last_data);
-      cache->last_data = NULL;
-    }
+  gimp_brush_cache_clear (cache);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -113,6 +159,9 @@ gimp_brush_cache_set_property (GObject      *object,
     case PROP_DATA_DESTROY:
       cache->data_destroy = g_value_get_pointer (value);
       break;
+    case PROP_DATA_MEMSIZE:
+      cache->data_memsize = g_value_get_pointer (value);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -133,6 +182,9 @@ gimp_brush_cache_get_property (GObject    *object,
     case PROP_DATA_DESTROY:
       g_value_set_pointer (value, cache->data_destroy);
       break;
+    case PROP_DATA_MEMSIZE:
+      g_value_set_pointer (value, cache->data_memsize);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -141,12 +193,29 @@ gimp_brush_cache_get_property (GObject    *object,
 }
 
 
+static gint64
+gimp_brush_cache_get_memsize (GimpObject *object,
+                              gint64     *gui_size)
+{
+  GimpBrushCache *cache   = GIMP_BRUSH_CACHE (object);
+  gint64          memsize = 0;
+
+  memsize += gimp_g_list_get_memsize (cache->cached_units,
+                                      sizeof (GimpBrushCacheUnit));
+  memsize += cache->units_memsize;
+
+  return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
+                                                                  gui_size);
+}
+
+
 /*  public functions  */
 
 GimpBrushCache *
-gimp_brush_cache_new (GDestroyNotify  data_destroy,
-                      gchar           debug_hit,
-                      gchar           debug_miss)
+gimp_brush_cache_new (GDestroyNotify             data_destroy,
+                      GimpBrushCacheMemsizeFunc  data_memsize,
+                      gchar                      debug_hit,
+                      gchar                      debug_miss)
 {
   GimpBrushCache *cache;
 
@@ -154,6 +223,7 @@ gimp_brush_cache_new (GDestroyNotify  data_destroy,
 
   cache =  g_object_new (GIMP_TYPE_BRUSH_CACHE,
                          "data-destroy", data_destroy,
+                         "data-memsize", data_memsize,
                          NULL);
 
   cache->debug_hit  = debug_hit;
@@ -167,11 +237,20 @@ gimp_brush_cache_clear (GimpBrushCache *cache)
 {
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
 
-  if (cache->last_data)
+  gimp_brush_cache_log_stats (cache);
+
+  while (cache->cached_units)
     {
-      cache->data_destroy (cache->last_data);
-      cache->last_data = NULL;
+      gimp_brush_cache_unit_free (cache, cache->cached_units->data);
+
+      cache->cached_units = g_list_delete_link (cache->cached_units,
+                                                cache->cached_units);
     }
+
+  cache->n_units       = 0;
+  cache->units_memsize = 0;
+  cache->n_hits        = 0;
+  cache->n_misses      = 0;
 }
 
 gconstpointer
@@ -183,22 +262,45 @@ gimp_brush_cache_get (GimpBrushCache *cache,
                       gdouble         angle,
                       gdouble         hardness)
 {
+  GimpBrushCacheUnit  key;
+  GList              *list;
+
   g_return_val_if_fail (GIMP_IS_BRUSH_CACHE (cache), NULL);
 
-  if (cache->last_data                         &&
-      cache->last_width        == width        &&
-      cache->last_height       == height       &&
-      cache->last_scale        == scale        &&
-      cache->last_aspect_ratio == aspect_ratio &&
-      cache->last_angle        == angle        &&
-      cache->last_hardness     == hardness)
-    {
-      if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
-        g_printerr ("%c", cache->debug_hit);
+  gimp_brush_cache_unit_init (&key,
+                              width, height,
+                              scale, aspect_ratio, angle, hardness);
 
-      return (gconstpointer) cache->last_data;
+  for (list = cache->cached_units; list; list = g_list_next (list))
+    {
+      GimpBrushCacheUnit *unit = list->data;
+
+      if (unit->width        == key.width        &&
+          unit->height       == key.height       &&
+          unit->scale        == key.scale        &&
+          unit->aspect_ratio == key.aspect_ratio &&
+          unit->angle        == key.angle        &&
+          unit->hardness     == key.hardness)
+        {
+          /*  move the unit to the front of the list  */
+          if (list != cache->cached_units)
+            {
+              cache->cached_units = g_list_remove_link (cache->cached_units,
+                                                        list);
+              cache->cached_units = g_list_concat (list, cache->cached_units);
+            }
+
+          cache->n_hits++;
+
+          if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
+            g_printerr ("%c", cache->debug_hit);
+
+          return (gconstpointer) unit->data;
+        }
     }
 
+  cache->n_misses++;
+
   if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
     g_printerr ("%c", cache->debug_miss);
 
@@ -215,20 +317,105 @@ gimp_brush_cache_add (GimpBrushCache *cache,
                       gdouble         angle,
                       gdouble         hardness)
 {
+  GimpBrushCacheUnit *unit;
+  GList              *list;
+
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
   g_return_if_fail (data != NULL);
 
-  if (data == cache->last_data)
-    return;
+  for (list = cache->cached_units; list; list = g_list_next (list))
+    {
+      unit = list->data;
+
+      if (unit->data == data)
+        return;
+    }
+
+  unit = g_slice_new (GimpBrushCacheUnit);
+
+  gimp_brush_cache_unit_init (unit,
+                              width, height,
+                              scale, aspect_ratio, angle, hardness);
+
+  unit->data    = data;
+  unit->memsize = cache->data_memsize ? cache->data_memsize (data) : 0;
+
+  cache->cached_units   = g_list_prepend (cache->cached_units, unit);
+  cache->n_units       += 1;
+  cache->units_memsize += unit->memsize;
+
+  /*  drop the least recently used units, but always keep the new one
+   *  even if it alone exceeds the budget
+   */
+  while (cache->n_units > 1 &&
+         (cache->n_units       > MAX_CACHED_UNITS ||
+          cache->units_memsize > MAX_CACHED_MEMSIZE))
+    {
+      GList *last = g_list_last (cache->cached_units);
+
+      unit = last->data;
+
+      cache->cached_units   = g_list_delete_link (cache->cached_units, last);
+      cache->n_units       -= 1;
+      cache->units_memsize -= unit->memsize;
+
+      gimp_brush_cache_unit_free (cache, unit);
+    }
+}
+
+
+/*  private functions  */
 
-  if (cache->last_data)
-    cache->data_destroy (cache->last_data);
+/*  the keys are quantized so that dabs whose transform differs by less
+ *  than about a quarter pixel at the brush's outline share a unit,
+ *  width and height are always matched exactly.  a zero scale has no
+ *  logarithm and gets a key of its own
+ */
+static void
+gimp_brush_cache_unit_init (GimpBrushCacheUnit *unit,
+                            gint                width,
+                            gint                height,
+                            gdouble             scale,
+                            gdouble             aspect_ratio,
+                            gdouble             angle,
+                            gdouble             hardness)
+{
+  gdouble extent = 4.0 * MAX (width, height);
+
+  angle = fmod (angle, 1.0);
+  if (angle < 0.0)
+    angle += 1.0;
+
+  unit->data         = NULL;
+  unit->memsize      = 0;
+  unit->width        = width;
+  unit->height       = height;
+  unit->scale        = (scale > 0.0 ?
+                        floor (log (scale) * extent + 0.5) : G_MININT64);
+  unit->aspect_ratio = floor (aspect_ratio * 1000.0 + 0.5);
+  unit->angle        = floor (angle * G_PI * extent + 0.5);
+  unit->hardness     = floor (hardness * 1000.0 + 0.5);
+}
 
-  cache->last_data         = data;
-  cache->last_width        = width;
-  cache->last_height       = height;
-  cache->last_scale        = scale;
-  cache->last_aspect_ratio = aspect_ratio;
-  cache->last_angle        = angle;
-  cache->last_hardness     = hardness;
+static void
+gimp_brush_cache_unit_free (GimpBrushCache     *cache,
+                            GimpBrushCacheUnit *unit)
+{
+  cache->data_destroy (unit->data);
+
+  g_slice_free (GimpBrushCacheUnit, unit);
+}
+
+static void
+gimp_brush_cache_log_stats (GimpBrushCache *cache)
+{
+  if (cache->n_hits || cache->n_misses)
+    {
+      GIMP_LOG (BRUSH_CACHE,
+                "'%c' cache: %d hits, %d misses, %d units, %" G_GINT64_FORMAT
+                " bytes",
+                cache->debug_hit,
+                cache->n_hits, cache->n_misses,
+                cache->n_units, cache->units_memsize);
+    }
 }
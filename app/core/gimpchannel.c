@@ -333,6 +333,7 @@ gimp_channel_init (GimpChannel *channel)
   channel->segs_out       = NULL;
   channel->num_segs_in    = 0;
   channel->num_segs_out   = 0;
+  channel->boundary_cache = NULL;
   channel->empty          = FALSE;
   channel->bounds_known   = FALSE;
   channel->x1             = 0;
@@ -364,6 +365,12 @@ gimp_channel_finalize (GObject *object)
       channel->segs_out = NULL;
     }
 
+  if (channel->boundary_cache)
+    {
+      gimp_boundary_cache_free (channel->boundary_cache);
+      channel->boundary_cache = NULL;
+    }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -376,6 +383,9 @@ gimp_channel_get_memsize (GimpObject *object,
   *gui_size += channel->num_segs_in  * sizeof (GimpBoundSeg);
   *gui_size += channel->num_segs_out * sizeof (GimpBoundSeg);
 
+  if (channel->boundary_cache)
+    *gui_size += gimp_boundary_cache_get_memsize (channel->boundary_cache);
+
   return GIMP_OBJECT_CLASS (parent_class)->get_memsize (object, gui_size);
 }
 
@@ -981,6 +991,13 @@ gimp_channel_set_buffer (GimpDrawable *drawable,
 
   channel->bounds_known = FALSE;
 
+  /*  the cache watches the old buffer  */
+  if (channel->boundary_cache)
+    {
+      gimp_boundary_cache_free (channel->boundary_cache);
+      channel->boundary_cache = NULL;
+    }
+
   if (gimp_filter_peek_node (GIMP_FILTER (channel)))
     {
       const Babl *color_format;
@@ -1062,30 +1079,52 @@ gimp_channel_real_boundary (GimpChannel         *channel,
 
           buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
 
-          channel->segs_out = gimp_boundary_find (buffer, &rect,
-                                                  babl_format ("Y float"),
-                                                  GIMP_BOUNDARY_IGNORE_BOUNDS,
-                                                  x1, y1, x2, y2,
-                                                  GIMP_BOUNDARY_HALF_WAY,
-                                                  &channel->num_segs_out);
-          x1 = MAX (x1, x3);
-          y1 = MAX (y1, y3);
-          x2 = MIN (x2, x4);
-          y2 = MIN (y2, y4);
-
-          if (x2 > x1 && y2 > y1)
+          if (x1 <= 0 && x2 >= gimp_item_get_width  (GIMP_ITEM (channel)) &&
+              y1 <= 0 && y2 >= gimp_item_get_height (GIMP_ITEM (channel)))
             {
-              channel->segs_in = gimp_boundary_find (buffer, NULL,
-                                                     babl_format ("Y float"),
-                                                     GIMP_BOUNDARY_WITHIN_BOUNDS,
-                                                     x1, y1, x2, y2,
-                                                     GIMP_BOUNDARY_HALF_WAY,
-                                                     &channel->num_segs_in);
+              /*  the bounds cover the whole channel, like for the
+               *  image's selection, so there is no outline outside of
+               *  them, and the one inside only needs the tiles which
+               *  changed traced again
+               */
+              if (! channel->boundary_cache)
+                channel->boundary_cache =
+                  gimp_boundary_cache_new (buffer, babl_format ("Y float"),
+                                           GIMP_BOUNDARY_HALF_WAY);
+
+              channel->segs_in = gimp_boundary_cache_find (channel->boundary_cache,
+                                                           &channel->num_segs_in);
+
+              channel->segs_out     = NULL;
+              channel->num_segs_out = 0;
             }
           else
             {
-              channel->segs_in     = NULL;
-              channel->num_segs_in = 0;
+              channel->segs_out = gimp_boundary_find (buffer, &rect,
+                                                      babl_format ("Y float"),
+                                                      GIMP_BOUNDARY_IGNORE_BOUNDS,
+                                                      x1, y1, x2, y2,
+                                                      GIMP_BOUNDARY_HALF_WAY,
+                                                      &channel->num_segs_out);
+              x1 = MAX (x1, x3);
+              y1 = MAX (y1, y3);
+              x2 = MIN (x2, x4);
+              y2 = MIN (y2, y4);
+
+              if (x2 > x1 && y2 > y1)
+                {
+                  channel->segs_in = gimp_boundary_find (buffer, NULL,
+                                                         babl_format ("Y float"),
+                                                         GIMP_BOUNDARY_WITHIN_BOUNDS,
+                                                         x1, y1, x2, y2,
+                                                         GIMP_BOUNDARY_HALF_WAY,
+                                                         &channel->num_segs_in);
+                }
+              else
+                {
+                  channel->segs_in     = NULL;
+                  channel->num_segs_in = 0;
+                }
             }
         }
       else
@@ -92,7 +92,8 @@ gimp_curve_map_pixels (GimpCurve *curve_colors,
                                      curve_alpha))
     {
     case CURVE_NONE:
-      memcpy (dest, src, samples * 4 * sizeof (gfloat));
+      if (dest != src)
+        memcpy (dest, src, samples * 4 * sizeof (gfloat));
       break;
 
     case CURVE_COLORS:
@@ -23,6 +23,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <glib/gstdio.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
@@ -33,6 +35,7 @@
 #include "core-types.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimpcontext.h"
 #include "gimpdata.h"
 #include "gimpdatafactory.h"
@@ -48,11 +51,28 @@
  */
 #define GIMP_OBSOLETE_DATA_DIR_NAME "gimp-obsolete-files"
 
+#define GIMP_DATA_INDEX_FILE_VERSION 1
+
 
 typedef void (* GimpDataForeachFunc) (GimpDataFactory *factory,
                                       GimpData        *data,
                                       gpointer         user_data);
 
+typedef struct
+{
+  gchar  *dirname;
+  gint64  mtime;
+} GimpDataIndexFolder;
+
+typedef struct
+{
+  gchar  *filename;
+  gchar  *dirname;
+  gchar  *top_directory;
+  gint64  mtime;
+  gint    loader;
+} GimpDataIndexFile;
+
 
 struct _GimpDataFactoryPriv
 {
@@ -69,6 +89,12 @@ struct _GimpDataFactoryPriv
 
   GimpDataNewFunc                   data_new_func;
   GimpDataGetStandardFunc           data_get_standard_func;
+
+  /*  the folders and files found by the last scan of the data path  */
+  gchar                            *index_path;
+  GPtrArray                        *index_folders;
+  GPtrArray                        *index_files;
+  gboolean                          index_dirty;
 };
 
 
@@ -89,6 +115,16 @@ static void    gimp_data_factory_load_data  (const GimpDatafileData *file_data,
 
 static void    gimp_data_factory_load_data_recursive (const GimpDatafileData *file_data,
                                                       gpointer                data);
+static void    gimp_data_factory_load_items (gpointer                data);
+
+static void     gimp_data_factory_index_new        (GimpDataFactory *factory,
+                                                    gchar           *path);
+static void     gimp_data_factory_index_clear      (GimpDataFactory *factory);
+static void     gimp_data_factory_index_add_folder (GimpDataFactory *factory,
+                                                    const gchar     *dirname,
+                                                    gint64           mtime);
+static gboolean gimp_data_factory_index_load       (GimpDataFactory *factory,
+                                                    const gchar     *path);
 
 G_DEFINE_TYPE (GimpDataFactory, gimp_data_factory, GIMP_TYPE_OBJECT)
 
@@ -124,6 +160,10 @@ gimp_data_factory_init (GimpDataFactory *factory)
   factory->priv->n_loader_entries       = 0;
   factory->priv->data_new_func          = NULL;
   factory->priv->data_get_standard_func = NULL;
+  factory->priv->index_path             = NULL;
+  factory->priv->index_folders          = NULL;
+  factory->priv->index_files            = NULL;
+  factory->priv->index_dirty            = FALSE;
 }
 
 static void
@@ -155,6 +195,8 @@ gimp_data_factory_finalize (GObject *object)
       factory->priv->writable_property_name = NULL;
     }
 
+  gimp_data_factory_index_clear (factory);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -305,12 +347,28 @@ gimp_data_factory_data_foreach (GimpDataFactory     *factory,
     }
 }
 
+typedef struct
+{
+  const GimpDataFactoryLoaderEntry *loader;
+  gchar                            *filename;
+  gchar                            *dirname;
+  gchar                            *top_directory;
+  time_t                            mtime;
+
+  GList                            *data_list;
+  GError                           *error;
+} GimpDataLoadItem;
+
 typedef struct
 {
   GimpDataFactory *factory;
   GimpContext     *context;
   GHashTable      *cache;
   const gchar     *top_directory;
+
+  /*  the files to load, in directory order  */
+  GPtrArray       *items;
+  gint             next_item;
 } GimpDataLoadContext;
 
 static void
@@ -335,6 +393,7 @@ gimp_data_factory_data_load (GimpDataFactory *factory,
       load_context.factory = factory;
       load_context.context = context;
       load_context.cache   = cache;
+      load_context.items   = g_ptr_array_new ();
 
       tmp = gimp_config_path_expand (path, TRUE, NULL);
       g_free (path);
@@ -352,13 +411,68 @@ gimp_data_factory_data_load (GimpDataFactory *factory,
                              WRITABLE_PATH_KEY, writable_list);
         }
 
-      gimp_datafiles_read_directories (path, G_FILE_TEST_IS_REGULAR,
-                                       gimp_data_factory_load_data,
-                                       &load_context);
+      /*  a refresh always looks at the disk, a plain load can take
+       *  the files from the index if none of its folders changed
+       */
+      if (! cache && gimp_data_factory_index_load (factory, path))
+        {
+          gint i;
+
+          for (i = 0; i < factory->priv->index_files->len; i++)
+            {
+              GimpDataIndexFile *file;
+              GimpDataLoadItem  *item;
+
+              file = g_ptr_array_index (factory->priv->index_files, i);
+              item = g_slice_new0 (GimpDataLoadItem);
+
+              item->loader        = &factory->priv->loader_entries[file->loader];
+              item->filename      = g_strdup (file->filename);
+              item->dirname       = g_strdup (file->dirname);
+              item->top_directory = g_strdup (file->top_directory);
+              item->mtime         = file->mtime;
+
+              g_ptr_array_add (load_context.items, item);
+            }
+        }
+      else
+        {
+          GList *folders;
+          GList *list;
+
+          gimp_data_factory_index_clear (factory);
+          gimp_data_factory_index_new (factory, g_strdup (path));
+
+          factory->priv->index_dirty = TRUE;
+
+          /*  missing folders are remembered too, so the index is
+           *  rebuilt once they get created
+           */
+          folders = gimp_path_parse (path, 256, FALSE, NULL);
+
+          for (list = folders; list; list = g_list_next (list))
+            {
+              GStatBuf st;
+
+              gimp_data_factory_index_add_folder (factory, list->data,
+                                                  g_stat (list->data, &st) ?
+                                                  0 : st.st_mtime);
+            }
+
+          gimp_path_free (folders);
+
+          gimp_datafiles_read_directories (path, G_FILE_TEST_IS_REGULAR,
+                                           gimp_data_factory_load_data,
+                                           &load_context);
+
+          gimp_datafiles_read_directories (path, G_FILE_TEST_IS_DIR,
+                                           gimp_data_factory_load_data_recursive,
+                                           &load_context);
+        }
+
+      gimp_data_factory_load_items (&load_context);
 
-      gimp_datafiles_read_directories (path, G_FILE_TEST_IS_DIR,
-                                       gimp_data_factory_load_data_recursive,
-                                       &load_context);
+      g_ptr_array_free (load_context.items, TRUE);
 
       if (writable_path)
         {
@@ -822,6 +936,10 @@ gimp_data_factory_load_data_recursive (const GimpDatafileData *file_data,
       top_set = TRUE;
     }
 
+  gimp_data_factory_index_add_folder (context->factory,
+                                      file_data->filename,
+                                      file_data->mtime);
+
   gimp_datafiles_read_directories (file_data->filename, G_FILE_TEST_IS_REGULAR,
                                    gimp_data_factory_load_data, context);
 
@@ -844,8 +962,8 @@ gimp_data_factory_load_data (const GimpDatafileData *file_data,
   GimpDataFactory                  *factory = context->factory;
   GHashTable                       *cache   = context->cache;
   const GimpDataFactoryLoaderEntry *loader  = NULL;
-  GError                           *error   = NULL;
-  GList                            *data_list;
+  GimpDataIndexFile                *file;
+  GimpDataLoadItem                 *item;
   gint                              i;
 
   for (i = 0; i < factory->priv->n_loader_entries; i++)
@@ -865,6 +983,16 @@ gimp_data_factory_load_data (const GimpDatafileData *file_data,
   return;
 
  insert:
+  file = g_slice_new (GimpDataIndexFile);
+
+  file->filename      = g_strdup (file_data->filename);
+  file->dirname       = g_strdup (file_data->dirname);
+  file->top_directory = g_strdup (context->top_directory);
+  file->mtime         = file_data->mtime;
+  file->loader        = loader - factory->priv->loader_entries;
+
+  g_ptr_array_add (factory->priv->index_files, file);
+
   if (cache)
     {
       GList *cached_data;
@@ -884,16 +1012,59 @@ gimp_data_factory_load_data (const GimpDatafileData *file_data,
         }
     }
 
-  data_list = loader->load_func (context->context, file_data->filename, &error);
+  item = g_slice_new0 (GimpDataLoadItem);
+
+  item->loader        = loader;
+  item->filename      = g_strdup (file_data->filename);
+  item->dirname       = g_strdup (file_data->dirname);
+  item->top_directory = g_strdup (context->top_directory);
+  item->mtime         = file_data->mtime;
+
+  g_ptr_array_add (context->items, item);
+}
+
+static void
+gimp_data_factory_load_item (GimpDataLoadContext *context,
+                             GimpDataLoadItem    *item)
+{
+  item->data_list = item->loader->load_func (context->context,
+                                             item->filename,
+                                             &item->error);
+}
+
+static void
+gimp_data_factory_load_items_func (gint     i,
+                                   gint     n,
+                                   gpointer data)
+{
+  GimpDataLoadContext *context = data;
+  gint                 index;
 
-  if (G_LIKELY (data_list))
+  /*  hand out the files one by one, their sizes vary wildly  */
+  while ((index = g_atomic_int_add (&context->next_item, 1)) <
+         (gint) context->items->len)
+    {
+      GimpDataLoadItem *item = g_ptr_array_index (context->items, index);
+
+      if (item->loader->thread_safe)
+        gimp_data_factory_load_item (context, item);
+    }
+}
+
+static void
+gimp_data_factory_add_item (GimpDataLoadContext *context,
+                            GimpDataLoadItem    *item)
+{
+  GimpDataFactory *factory = context->factory;
+
+  if (G_LIKELY (item->data_list))
     {
       GList    *list;
       gboolean  obsolete;
       gboolean  writable  = FALSE;
       gboolean  deletable = FALSE;
 
-      obsolete = (strstr (file_data->dirname,
+      obsolete = (strstr (item->dirname,
                           GIMP_OBSOLETE_DATA_DIR_NAME) != 0);
 
       /* obsolete files are immutable, don't check their writability */
@@ -904,20 +1075,20 @@ gimp_data_factory_load_data (const GimpDatafileData *file_data,
           writable_list = g_object_get_data (G_OBJECT (factory),
                                              WRITABLE_PATH_KEY);
 
-          deletable = (g_list_length (data_list) == 1 &&
-                       gimp_data_factory_is_dir_writable (file_data->dirname,
+          deletable = (g_list_length (item->data_list) == 1 &&
+                       gimp_data_factory_is_dir_writable (item->dirname,
                                                           writable_list));
 
-          writable = (deletable && loader->writable);
+          writable = (deletable && item->loader->writable);
         }
 
-      for (list = data_list; list; list = g_list_next (list))
+      for (list = item->data_list; list; list = g_list_next (list))
         {
           GimpData *data = list->data;
 
-          gimp_data_set_filename (data, file_data->filename,
+          gimp_data_set_filename (data, item->filename,
                                   writable, deletable);
-          gimp_data_set_mtime (data, file_data->mtime);
+          gimp_data_set_mtime (data, item->mtime);
 
           gimp_data_clean (data);
 
@@ -928,7 +1099,7 @@ gimp_data_factory_load_data (const GimpDatafileData *file_data,
             }
           else
             {
-              gimp_data_set_folder_tags (data, context->top_directory);
+              gimp_data_set_folder_tags (data, item->top_directory);
 
               gimp_container_add (factory->priv->container,
                                   GIMP_OBJECT (data));
@@ -937,13 +1108,422 @@ gimp_data_factory_load_data (const GimpDatafileData *file_data,
           g_object_unref (data);
         }
 
-      g_list_free (data_list);
+      g_list_free (item->data_list);
     }
 
-  if (G_UNLIKELY (error))
+  if (G_UNLIKELY (item->error))
     {
       gimp_message (factory->priv->gimp, NULL, GIMP_MESSAGE_ERROR,
-                    _("Failed to load data:\n\n%s"), error->message);
+                    _("Failed to load data:\n\n%s"), item->error->message);
+      g_clear_error (&item->error);
+    }
+}
+
+/*  Decode the collected files, the loaders which can run outside the
+ *  main thread do so on all threads, then add everything to the
+ *  containers in the order the files were found.
+ */
+static void
+gimp_data_factory_load_items (gpointer data)
+{
+  GimpDataLoadContext *context = data;
+  gint                 i;
+
+  context->next_item = 0;
+
+  gimp_parallel_distribute (context->items->len,
+                            gimp_data_factory_load_items_func,
+                            context);
+
+  for (i = 0; i < context->items->len; i++)
+    {
+      GimpDataLoadItem *item = g_ptr_array_index (context->items, i);
+
+      if (! item->loader->thread_safe)
+        gimp_data_factory_load_item (context, item);
+
+      gimp_data_factory_add_item (context, item);
+
+      g_free (item->filename);
+      g_free (item->dirname);
+      g_free (item->top_directory);
+
+      g_slice_free (GimpDataLoadItem, item);
+    }
+}
+
+
+/*  the index  */
+
+enum
+{
+  INDEX_FILE_VERSION = 1,
+  INDEX_PATH,
+  INDEX_FOLDER,
+  INDEX_FILE
+};
+
+static void
+gimp_data_factory_index_folder_free (GimpDataIndexFolder *folder)
+{
+  g_free (folder->dirname);
+
+  g_slice_free (GimpDataIndexFolder, folder);
+}
+
+static void
+gimp_data_factory_index_file_free (GimpDataIndexFile *file)
+{
+  g_free (file->filename);
+  g_free (file->dirname);
+  g_free (file->top_directory);
+
+  g_slice_free (GimpDataIndexFile, file);
+}
+
+/*  takes ownership of @path  */
+static void
+gimp_data_factory_index_new (GimpDataFactory *factory,
+                             gchar           *path)
+{
+  factory->priv->index_path    = path;
+  factory->priv->index_folders =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) gimp_data_factory_index_folder_free);
+  factory->priv->index_files   =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) gimp_data_factory_index_file_free);
+}
+
+static void
+gimp_data_factory_index_clear (GimpDataFactory *factory)
+{
+  if (factory->priv->index_path)
+    {
+      g_free (factory->priv->index_path);
+      factory->priv->index_path = NULL;
+    }
+
+  if (factory->priv->index_folders)
+    {
+      g_ptr_array_free (factory->priv->index_folders, TRUE);
+      factory->priv->index_folders = NULL;
+    }
+
+  if (factory->priv->index_files)
+    {
+      g_ptr_array_free (factory->priv->index_files, TRUE);
+      factory->priv->index_files = NULL;
+    }
+
+  factory->priv->index_dirty = FALSE;
+}
+
+static void
+gimp_data_factory_index_add_folder (GimpDataFactory *factory,
+                                    const gchar     *dirname,
+                                    gint64           mtime)
+{
+  GimpDataIndexFolder *folder = g_slice_new (GimpDataIndexFolder);
+
+  folder->dirname = g_strdup (dirname);
+  folder->mtime   = mtime;
+
+  g_ptr_array_add (factory->priv->index_folders, folder);
+}
+
+static gchar *
+gimp_data_factory_index_get_filename (GimpDataFactory *factory)
+{
+  gchar *basename;
+  gchar *filename;
+
+  basename = g_strconcat (factory->priv->path_property_name, "-index", NULL);
+  filename = gimp_personal_rc_file (basename);
+  g_free (basename);
+
+  return filename;
+}
+
+static GTokenType
+gimp_data_factory_index_parse_folder (GimpDataFactory *factory,
+                                      GScanner        *scanner)
+{
+  gchar  *dirname;
+  gint64  mtime;
+
+  if (! gimp_scanner_parse_string_no_validate (scanner, &dirname) ||
+      ! dirname)
+    return G_TOKEN_STRING;
+
+  if (! gimp_scanner_parse_int64 (scanner, &mtime))
+    {
+      g_free (dirname);
+      return G_TOKEN_INT;
+    }
+
+  gimp_data_factory_index_add_folder (factory, dirname, mtime);
+  g_free (dirname);
+
+  return G_TOKEN_RIGHT_PAREN;
+}
+
+static GTokenType
+gimp_data_factory_index_parse_file (GimpDataFactory *factory,
+                                    GScanner        *scanner)
+{
+  GimpDataIndexFile *file;
+  GTokenType         token = G_TOKEN_STRING;
+
+  file = g_slice_new0 (GimpDataIndexFile);
+
+  if (! gimp_scanner_parse_string_no_validate (scanner, &file->filename) ||
+      ! file->filename)
+    goto error;
+
+  if (! gimp_scanner_parse_string_no_validate (scanner, &file->dirname) ||
+      ! file->dirname)
+    goto error;
+
+  /*  the empty string stands for the toplevel directory  */
+  if (! gimp_scanner_parse_string_no_validate (scanner, &file->top_directory))
+    goto error;
+
+  token = G_TOKEN_INT;
+
+  if (! gimp_scanner_parse_int64 (scanner, &file->mtime))
+    goto error;
+
+  if (! gimp_scanner_parse_int (scanner, &file->loader) ||
+      file->loader < 0                                  ||
+      file->loader >= factory->priv->n_loader_entries)
+    goto error;
+
+  g_ptr_array_add (factory->priv->index_files, file);
+
+  return G_TOKEN_RIGHT_PAREN;
+
+ error:
+  gimp_data_factory_index_file_free (file);
+
+  return token;
+}
+
+static void
+gimp_data_factory_index_read (GimpDataFactory *factory)
+{
+  GScanner   *scanner;
+  gchar      *filename;
+  gchar      *path         = NULL;
+  gint        file_version = GIMP_DATA_INDEX_FILE_VERSION;
+  GTokenType  token;
+
+  filename = gimp_data_factory_index_get_filename (factory);
+
+  if (factory->priv->gimp->be_verbose)
+    g_print ("Parsing '%s'\n", gimp_filename_to_utf8 (filename));
+
+  scanner = gimp_scanner_new_file (filename, NULL);
+  g_free (filename);
+
+  if (! scanner)
+    return;
+
+  gimp_data_factory_index_new (factory, NULL);
+
+  g_scanner_scope_add_symbol (scanner, 0,
+                              "file-version",
+                              GINT_TO_POINTER (INDEX_FILE_VERSION));
+  g_scanner_scope_add_symbol (scanner, 0,
+                              "path", GINT_TO_POINTER (INDEX_PATH));
+  g_scanner_scope_add_symbol (scanner, 0,
+                              "folder", GINT_TO_POINTER (INDEX_FOLDER));
+  g_scanner_scope_add_symbol (scanner, 0,
+                              "file", GINT_TO_POINTER (INDEX_FILE));
+
+  token = G_TOKEN_LEFT_PAREN;
+
+  while (file_version == GIMP_DATA_INDEX_FILE_VERSION &&
+         g_scanner_peek_next_token (scanner) == token)
+    {
+      token = g_scanner_get_next_token (scanner);
+
+      switch (token)
+        {
+        case G_TOKEN_LEFT_PAREN:
+          token = G_TOKEN_SYMBOL;
+          break;
+
+        case G_TOKEN_SYMBOL:
+          switch (GPOINTER_TO_INT (scanner->value.v_symbol))
+            {
+            case INDEX_FILE_VERSION:
+              token = G_TOKEN_INT;
+              if (gimp_scanner_parse_int (scanner, &file_version))
+                token = G_TOKEN_RIGHT_PAREN;
+              break;
+
+            case INDEX_PATH:
+              token = G_TOKEN_STRING;
+              g_free (path);
+              if (gimp_scanner_parse_string_no_validate (scanner, &path))
+                token = G_TOKEN_RIGHT_PAREN;
+              break;
+
+            case INDEX_FOLDER:
+              token = gimp_data_factory_index_parse_folder (factory, scanner);
+              break;
+
+            case INDEX_FILE:
+              token = gimp_data_factory_index_parse_file (factory, scanner);
+              break;
+
+            default:
+              break;
+            }
+          break;
+
+        case G_TOKEN_RIGHT_PAREN:
+          token = G_TOKEN_LEFT_PAREN;
+          break;
+
+        default: /* do nothing */
+          break;
+        }
+    }
+
+  gimp_scanner_destroy (scanner);
+
+  /*  an outdated or broken index is simply rebuilt by the next scan  */
+  if (file_version == GIMP_DATA_INDEX_FILE_VERSION &&
+      token        == G_TOKEN_LEFT_PAREN           &&
+      path)
+    {
+      factory->priv->index_path = path;
+    }
+  else
+    {
+      g_free (path);
+      gimp_data_factory_index_clear (factory);
+    }
+}
+
+/*  Returns TRUE if the index, either the one of the last scan or the
+ *  one saved by the last session, lists the files of @path. Adding,
+ *  removing or renaming a file changes its folder's mtime, editing a
+ *  file in place doesn't, such a file keeps its old mtime until the
+ *  next refresh loads it again.
+ */
+static gboolean
+gimp_data_factory_index_load (GimpDataFactory *factory,
+                              const gchar     *path)
+{
+  gint i;
+
+  if (! factory->priv->index_path)
+    gimp_data_factory_index_read (factory);
+
+  if (! factory->priv->index_path ||
+      strcmp (factory->priv->index_path, path))
+    {
+      gimp_data_factory_index_clear (factory);
+
+      return FALSE;
+    }
+
+  for (i = 0; i < factory->priv->index_folders->len; i++)
+    {
+      GimpDataIndexFolder *folder;
+      GStatBuf             st;
+      gint64               mtime = 0;
+
+      folder = g_ptr_array_index (factory->priv->index_folders, i);
+
+      if (! g_stat (folder->dirname, &st))
+        mtime = st.st_mtime;
+
+      if (mtime != folder->mtime)
+        {
+          gimp_data_factory_index_clear (factory);
+
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+void
+gimp_data_factory_index_save (GimpDataFactory *factory)
+{
+  GimpConfigWriter *writer;
+  gchar            *filename;
+  GError           *error = NULL;
+
+  g_return_if_fail (GIMP_IS_DATA_FACTORY (factory));
+
+  if (! factory->priv->index_dirty)
+    return;
+
+  filename = gimp_data_factory_index_get_filename (factory);
+
+  if (factory->priv->gimp->be_verbose)
+    g_print ("Writing '%s'\n", gimp_filename_to_utf8 (filename));
+
+  writer = gimp_config_writer_new_file (filename, TRUE,
+                                        "GIMP data index\n\n"
+                                        "This file is rebuilt whenever one "
+                                        "of the data folders changes.",
+                                        &error);
+  g_free (filename);
+
+  if (writer)
+    {
+      gint i;
+
+      gimp_config_writer_open (writer, "file-version");
+      gimp_config_writer_printf (writer, "%d", GIMP_DATA_INDEX_FILE_VERSION);
+      gimp_config_writer_close (writer);
+
+      gimp_config_writer_open (writer, "path");
+      gimp_config_writer_string (writer, factory->priv->index_path);
+      gimp_config_writer_close (writer);
+
+      for (i = 0; i < factory->priv->index_folders->len; i++)
+        {
+          GimpDataIndexFolder *folder;
+
+          folder = g_ptr_array_index (factory->priv->index_folders, i);
+
+          gimp_config_writer_open (writer, "folder");
+          gimp_config_writer_string (writer, folder->dirname);
+          gimp_config_writer_printf (writer, "%" G_GINT64_FORMAT,
+                                     folder->mtime);
+          gimp_config_writer_close (writer);
+        }
+
+      for (i = 0; i < factory->priv->index_files->len; i++)
+        {
+          GimpDataIndexFile *file;
+
+          file = g_ptr_array_index (factory->priv->index_files, i);
+
+          gimp_config_writer_open (writer, "file");
+          gimp_config_writer_string (writer, file->filename);
+          gimp_config_writer_string (writer, file->dirname);
+          gimp_config_writer_string (writer, file->top_directory ?
+                                     file->top_directory : "");
+          gimp_config_writer_printf (writer, "%" G_GINT64_FORMAT " %d",
+                                     file->mtime, file->loader);
+          gimp_config_writer_close (writer);
+        }
+
+      if (gimp_config_writer_finish (writer, "end of data index", &error))
+        factory->priv->index_dirty = FALSE;
+    }
+
+  if (error)
+    {
+      gimp_message_literal (factory->priv->gimp, NULL, GIMP_MESSAGE_ERROR,
+                            error->message);
       g_clear_error (&error);
     }
 }
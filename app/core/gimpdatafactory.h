@@ -40,6 +40,7 @@ struct _GimpDataFactoryLoaderEntry
   GimpDataLoadFunc  load_func;
   const gchar      *extension;
   gboolean          writable;
+  gboolean          thread_safe;
 };
 
 
@@ -85,6 +86,7 @@ void            gimp_data_factory_data_refresh      (GimpDataFactory  *factory,
                                                      GimpContext      *context);
 void            gimp_data_factory_data_save         (GimpDataFactory  *factory);
 void            gimp_data_factory_data_free         (GimpDataFactory  *factory);
+void            gimp_data_factory_index_save        (GimpDataFactory  *factory);
 
 GimpData      * gimp_data_factory_data_new          (GimpDataFactory  *factory,
                                                      GimpContext      *context,
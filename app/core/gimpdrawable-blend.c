@@ -34,6 +34,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimp-utils.h"
 #include "gimpchannel.h"
 #include "gimpcontext.h"
@@ -45,7 +46,13 @@
 #include "gimp-intl.h"
 
 
-//#define USE_GRADIENT_CACHE 1
+/*  the number of RGBA entries the gradient is sampled at  */
+#define GRADIENT_CACHE_SIZE   16384
+
+/*  rows rendered per thread between two progress updates  */
+#define GRADIENT_BAND_HEIGHT  64
+
+#define GRADIENT_MIN_AREA     (64 * 64)
 
 
 typedef struct
@@ -53,10 +60,7 @@ typedef struct
   GimpGradient     *gradient;
   GimpContext      *context;
   gboolean          reverse;
-#ifdef USE_GRADIENT_CACHE
-  GimpRGB          *gradient_cache;
-  gint              gradient_cache_size;
-#endif
+  gfloat           *gradient_cache;
   gdouble           offset;
   gdouble           sx, sy;
   GimpBlendMode     blend_mode;
@@ -65,10 +69,17 @@ typedef struct
   gdouble           dist;
   gdouble           vec[2];
   GimpRepeatMode    repeat;
-  GRand            *seed;
+  gboolean          dither;
+  guint32           seed;
   GeglBuffer       *dist_buffer;
 } RenderBlendData;
 
+typedef struct
+{
+  RenderBlendData  *rbd;
+  GeglBuffer       *buffer;
+} RenderAreaData;
+
 typedef struct
 {
   GeglBuffer    *buffer;
@@ -131,10 +142,23 @@ static GeglBuffer * gradient_precalc_shapeburst (GimpImage           *image,
                                                  gdouble              dist,
                                                  GimpProgress        *progress);
 
+static void     gradient_calc_color         (RenderBlendData     *rbd,
+                                             gdouble              factor,
+                                             GimpRGB             *color);
+static void     gradient_cache_init         (RenderBlendData     *rbd);
+
 static void     gradient_render_pixel       (gdouble              x,
                                              gdouble              y,
                                              GimpRGB             *color,
                                              gpointer             render_data);
+static void     gradient_render_row         (RenderBlendData     *rbd,
+                                             gint                 x,
+                                             gint                 y,
+                                             gint                 width,
+                                             const gfloat        *dist,
+                                             gdouble             *factors);
+static void     gradient_render_area        (const GeglRectangle *area,
+                                             gpointer             data);
 static void     gradient_put_pixel          (gint                 x,
                                              gint                 y,
                                              GimpRGB             *color,
@@ -643,6 +667,113 @@ gradient_precalc_shapeburst (GimpImage           *image,
 }
 
 
+static inline gdouble
+gradient_repeat_factor (GimpRepeatMode repeat,
+                        gdouble        factor)
+{
+  switch (repeat)
+    {
+    case GIMP_REPEAT_NONE:
+      factor = CLAMP (factor, 0.0, 1.0);
+      break;
+
+    case GIMP_REPEAT_SAWTOOTH:
+      factor = factor - floor (factor);
+      break;
+
+    case GIMP_REPEAT_TRIANGULAR:
+      {
+        guint ifactor;
+
+        if (factor < 0.0)
+          factor = -factor;
+
+        ifactor = (guint) factor;
+        factor = factor - floor (factor);
+
+        if (ifactor & 1)
+          factor = 1.0 - factor;
+      }
+      break;
+    }
+
+  return factor;
+}
+
+static void
+gradient_calc_color (RenderBlendData *rbd,
+                     gdouble          factor,
+                     GimpRGB         *color)
+{
+  if (rbd->blend_mode == GIMP_CUSTOM_MODE)
+    {
+      gimp_gradient_get_color_at (rbd->gradient, rbd->context, NULL,
+                                  factor, rbd->reverse, color);
+    }
+  else
+    {
+      /* Blend values */
+
+      if (rbd->reverse)
+        factor = 1.0 - factor;
+
+      color->r = rbd->fg.r + (rbd->bg.r - rbd->fg.r) * factor;
+      color->g = rbd->fg.g + (rbd->bg.g - rbd->fg.g) * factor;
+      color->b = rbd->fg.b + (rbd->bg.b - rbd->fg.b) * factor;
+      color->a = rbd->fg.a + (rbd->bg.a - rbd->fg.a) * factor;
+
+      if (rbd->blend_mode == GIMP_FG_BG_HSV_MODE)
+        {
+          GimpHSV hsv = *((GimpHSV *) color);
+
+          gimp_hsv_to_rgb (&hsv, color);
+        }
+    }
+}
+
+/*  Sample the colors of the whole blend once, rendering then only
+ *  needs to interpolate between two neighboring entries. This is also
+ *  what makes rendering thread-safe, the gradient and context are
+ *  only used here.
+ */
+static void
+gradient_cache_init (RenderBlendData *rbd)
+{
+  gint i;
+
+  rbd->gradient_cache = g_new (gfloat, 4 * GRADIENT_CACHE_SIZE);
+
+  for (i = 0; i < GRADIENT_CACHE_SIZE; i++)
+    {
+      GimpRGB color;
+      gfloat *entry = rbd->gradient_cache + 4 * i;
+
+      gradient_calc_color (rbd, (gdouble) i / (GRADIENT_CACHE_SIZE - 1),
+                           &color);
+
+      entry[0] = color.r;
+      entry[1] = color.g;
+      entry[2] = color.b;
+      entry[3] = color.a;
+    }
+}
+
+static inline void
+gradient_cache_lookup (const RenderBlendData *rbd,
+                       gdouble                factor,
+                       gfloat                *color)
+{
+  gdouble       pos   = factor * (GRADIENT_CACHE_SIZE - 1);
+  gint          index = CLAMP ((gint) pos, 0, GRADIENT_CACHE_SIZE - 2);
+  gfloat        frac  = CLAMP (pos - index, 0.0, 1.0);
+  const gfloat *entry = rbd->gradient_cache + 4 * index;
+
+  color[0] = entry[0] + (entry[4] - entry[0]) * frac;
+  color[1] = entry[1] + (entry[5] - entry[1]) * frac;
+  color[2] = entry[2] + (entry[6] - entry[2]) * frac;
+  color[3] = entry[3] + (entry[7] - entry[3]) * frac;
+}
+
 static void
 gradient_render_pixel (gdouble   x,
                        gdouble   y,
@@ -651,6 +782,7 @@ gradient_render_pixel (gdouble   x,
 {
   RenderBlendData *rbd = render_data;
   gdouble          factor;
+  gfloat           rgba[4];
 
   /* Calculate blending factor */
 
@@ -720,64 +852,176 @@ gradient_render_pixel (gdouble   x,
       return;
     }
 
-  /* Adjust for repeat */
+  factor = gradient_repeat_factor (rbd->repeat, factor);
+
+  gradient_cache_lookup (rbd, factor, rgba);
+
+  color->r = rgba[0];
+  color->g = rgba[1];
+  color->b = rgba[2];
+  color->a = rgba[3];
+}
+
+/*  Calculate the blending factors of a row of pixels, the shape
+ *  functions are inlined into one loop per gradient type, so that the
+ *  compiler can vectorize the simple ones.
+ */
+static void
+gradient_render_row (RenderBlendData *rbd,
+                     gint             x,
+                     gint             y,
+                     gint             width,
+                     const gfloat    *dist,
+                     gdouble         *factors)
+{
+  gdouble dx = x - rbd->sx;
+  gdouble dy = y - rbd->sy;
+  gint    i;
 
-  switch (rbd->repeat)
+  switch (rbd->gradient_type)
     {
-    case GIMP_REPEAT_NONE:
-      factor = CLAMP (factor, 0.0, 1.0);
+    case GIMP_GRADIENT_LINEAR:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_linear_factor (rbd->dist,
+                                                  rbd->vec, rbd->offset,
+                                                  dx + i, dy);
       break;
 
-    case GIMP_REPEAT_SAWTOOTH:
-      factor = factor - floor (factor);
+    case GIMP_GRADIENT_BILINEAR:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_bilinear_factor (rbd->dist,
+                                                    rbd->vec, rbd->offset,
+                                                    dx + i, dy);
       break;
 
-    case GIMP_REPEAT_TRIANGULAR:
-      {
-        guint ifactor;
+    case GIMP_GRADIENT_RADIAL:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_radial_factor (rbd->dist, rbd->offset,
+                                                  dx + i, dy);
+      break;
 
-        if (factor < 0.0)
-          factor = -factor;
+    case GIMP_GRADIENT_SQUARE:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_square_factor (rbd->dist, rbd->offset,
+                                                  dx + i, dy);
+      break;
 
-        ifactor = (guint) factor;
-        factor = factor - floor (factor);
+    case GIMP_GRADIENT_CONICAL_SYMMETRIC:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_conical_sym_factor (rbd->dist,
+                                                       rbd->vec, rbd->offset,
+                                                       dx + i, dy);
+      break;
 
-        if (ifactor & 1)
-          factor = 1.0 - factor;
-      }
+    case GIMP_GRADIENT_CONICAL_ASYMMETRIC:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_conical_asym_factor (rbd->dist,
+                                                        rbd->vec, rbd->offset,
+                                                        dx + i, dy);
       break;
-    }
 
-  /* Blend the colors */
+    case GIMP_GRADIENT_SHAPEBURST_ANGULAR:
+      for (i = 0; i < width; i++)
+        factors[i] = 1.0 - dist[i];
+      break;
 
-  if (rbd->blend_mode == GIMP_CUSTOM_MODE)
-    {
-#ifdef USE_GRADIENT_CACHE
-      *color = rbd->gradient_cache[(gint) (factor * (rbd->gradient_cache_size - 1))];
-#else
-      gimp_gradient_get_color_at (rbd->gradient, rbd->context, NULL,
-                                  factor, rbd->reverse, color);
-#endif
+    case GIMP_GRADIENT_SHAPEBURST_SPHERICAL:
+      for (i = 0; i < width; i++)
+        factors[i] = 1.0 - sin (0.5 * G_PI * dist[i]);
+      break;
+
+    case GIMP_GRADIENT_SHAPEBURST_DIMPLED:
+      for (i = 0; i < width; i++)
+        factors[i] = cos (0.5 * G_PI * dist[i]);
+      break;
+
+    case GIMP_GRADIENT_SPIRAL_CLOCKWISE:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_spiral_factor (rbd->dist,
+                                                  rbd->vec, rbd->offset,
+                                                  dx + i, dy, TRUE);
+      break;
+
+    case GIMP_GRADIENT_SPIRAL_ANTICLOCKWISE:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_spiral_factor (rbd->dist,
+                                                  rbd->vec, rbd->offset,
+                                                  dx + i, dy, FALSE);
+      break;
+
+    default:
+      g_assert_not_reached ();
+      return;
     }
-  else
-    {
-      /* Blend values */
 
-      if (rbd->reverse)
-        factor = 1.0 - factor;
+  for (i = 0; i < width; i++)
+    factors[i] = gradient_repeat_factor (rbd->repeat, factors[i]);
+}
 
-      color->r = rbd->fg.r + (rbd->bg.r - rbd->fg.r) * factor;
-      color->g = rbd->fg.g + (rbd->bg.g - rbd->fg.g) * factor;
-      color->b = rbd->fg.b + (rbd->bg.b - rbd->fg.b) * factor;
-      color->a = rbd->fg.a + (rbd->bg.a - rbd->fg.a) * factor;
+static void
+gradient_render_area (const GeglRectangle *area,
+                      gpointer             data)
+{
+  RenderAreaData     *rad         = data;
+  RenderBlendData    *rbd         = rad->rbd;
+  GeglBufferIterator *iter;
+  GeglRectangle      *roi;
+  GRand              *dither_rand = NULL;
+  gdouble            *factors;
 
-      if (rbd->blend_mode == GIMP_FG_BG_HSV_MODE)
+  iter = gegl_buffer_iterator_new (rad->buffer, area, 0,
+                                   babl_format ("R'G'B'A float"),
+                                   GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
+  roi = &iter->roi[0];
+
+  if (rbd->dist_buffer)
+    gegl_buffer_iterator_add (iter, rbd->dist_buffer, area, 0,
+                              babl_format ("Y float"),
+                              GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  if (rbd->dither)
+    dither_rand = g_rand_new_with_seed (rbd->seed + area->y);
+
+  factors = g_new (gdouble, area->width);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat       *dest = iter->data[0];
+      const gfloat *dist = rbd->dist_buffer ? iter->data[1] : NULL;
+      gint          y;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
         {
-          GimpHSV hsv = *((GimpHSV *) color);
+          gint x;
 
-          gimp_hsv_to_rgb (&hsv, color);
+          gradient_render_row (rbd, roi->x, y, roi->width, dist, factors);
+
+          for (x = 0; x < roi->width; x++)
+            {
+              gradient_cache_lookup (rbd, factors[x], dest);
+
+              if (dither_rand)
+                {
+                  gint i = g_rand_int (dither_rand);
+
+                  dest[0] += (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
+                  dest[1] += (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
+                  dest[2] += (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
+                  dest[3] += (gdouble) (i & 0xff) / 256.0 / 256.0;
+                }
+
+              dest += 4;
+            }
+
+          if (dist)
+            dist += roi->width;
         }
     }
+
+  g_free (factors);
+
+  if (dither_rand)
+    g_rand_free (dither_rand);
 }
 
 static void
@@ -843,24 +1087,6 @@ gradient_fill_region (GimpImage           *image,
   rbd.context  = context;
   rbd.reverse  = reverse;
 
-#ifdef USE_GRADIENT_CACHE
-  {
-    gint i;
-
-    rbd.gradient_cache_size = ceil (sqrt (SQR (sx - ex) + SQR (sy - ey)));
-    rbd.gradient_cache      = g_new0 (GimpRGB, rbd.gradient_cache_size);
-
-    for (i = 0; i < rbd.gradient_cache_size; i++)
-      {
-        gdouble factor = (gdouble) i / (gdouble) (rbd.gradient_cache_size - 1);
-
-        gimp_gradient_get_color_at (rbd.gradient, rbd.context, NULL,
-                                    factor, rbd.reverse,
-                                    rbd.gradient_cache + i);
-      }
-  }
-#endif
-
   if (gimp_gradient_has_fg_bg_segments (rbd.gradient))
     rbd.gradient = gimp_gradient_flatten (rbd.gradient, context);
   else
@@ -955,6 +1181,8 @@ gradient_fill_region (GimpImage           *image,
   rbd.gradient_type = gradient_type;
   rbd.repeat        = repeat;
 
+  gradient_cache_init (&rbd);
+
   /* Render the gradient! */
 
   if (supersample)
@@ -981,76 +1209,48 @@ gradient_fill_region (GimpImage           *image,
     }
   else
     {
-      GeglBufferIterator *iter;
-      GeglRectangle      *roi;
-      gint                total = buffer_region->width * buffer_region->height;
-      gint                done  = 0;
-
-      iter = gegl_buffer_iterator_new (buffer, buffer_region, 0,
-                                       babl_format ("R'G'B'A float"),
-                                       GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
-      roi = &iter->roi[0];
-
-      if (dither)
-        rbd.seed = g_rand_new ();
+      RenderAreaData rad;
+      GeglRectangle  band;
+      gint           band_height;
+      gint           tile_height;
 
-      while (gegl_buffer_iterator_next (iter))
-        {
-          gfloat *dest = iter->data[0];
-          gint    endx  = roi->x + roi->width;
-          gint    endy  = roi->y + roi->height;
-          gint    x, y;
+      rad.rbd    = &rbd;
+      rad.buffer = buffer;
 
-          if (rbd.seed)
-            {
-              GRand *dither_rand = g_rand_new_with_seed (g_rand_int (rbd.seed));
+      rbd.dither = dither;
+      rbd.seed   = g_random_int ();
 
-              for (y = roi->y; y < endy; y++)
-                for (x = roi->x; x < endx; x++)
-                  {
-                    GimpRGB  color = { 0.0, 0.0, 0.0, 1.0 };
-                    gint     i = g_rand_int (dither_rand);
+      /*  render bands of rows in parallel, and update the progress
+       *  in between.  the bands are split at tile rows, so threads
+       *  never write to the same tile
+       */
+      g_object_get (buffer, "tile-height", &tile_height, NULL);
 
-                    gradient_render_pixel (x, y, &color, &rbd);
+      band_height = GRADIENT_BAND_HEIGHT * gimp_parallel_get_n_threads ();
 
-                    *dest++ = color.r + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
-                    *dest++ = color.g + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
-                    *dest++ = color.b + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
-                    *dest++ = color.a + (gdouble) (i & 0xff) / 256.0 / 256.0;
-                  }
+      band = *buffer_region;
 
-              g_rand_free (dither_rand);
-            }
-          else
-            {
-              for (y = roi->y; y < endy; y++)
-                for (x = roi->x; x < endx; x++)
-                  {
-                    GimpRGB  color = { 0.0, 0.0, 0.0, 1.0 };
-
-                    gradient_render_pixel (x, y, &color, &rbd);
-
-                    *dest++ = color.r;
-                    *dest++ = color.g;
-                    *dest++ = color.b;
-                    *dest++ = color.a;
-                  }
-            }
+      for (band.y = buffer_region->y;
+           band.y < buffer_region->y + buffer_region->height;
+           band.y += band_height)
+        {
+          band.height = MIN (band_height,
+                             buffer_region->y + buffer_region->height -
+                             band.y);
 
-          done += roi->width * roi->height;
+          gimp_parallel_distribute_tiles (&band, tile_height,
+                                          GRADIENT_MIN_AREA,
+                                          gradient_render_area, &rad);
 
           if (progress)
             gimp_progress_set_value (progress,
-                                     (gdouble) done / (gdouble) total);
+                                     (gdouble) (band.y + band.height -
+                                                buffer_region->y) /
+                                     (gdouble) buffer_region->height);
         }
-
-      if (dither)
-        g_rand_free (rbd.seed);
     }
 
-#ifdef USE_GRADIENT_CACHE
   g_free (rbd.gradient_cache);
-#endif
 
   g_object_unref (rbd.gradient);
 
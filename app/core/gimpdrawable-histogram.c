@@ -28,6 +28,7 @@
 
 #include "gimpchannel.h"
 #include "gimpdrawable-histogram.h"
+#include "gimpdrawable-private.h"
 #include "gimphistogram.h"
 #include "gimpimage.h"
 
@@ -112,6 +113,22 @@ gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
                                     GEGL_RECTANGLE (x + off_x, y + off_y,
                                                     width, height));
         }
+      else if (x == 0 && width  == gimp_item_get_width  (GIMP_ITEM (drawable)) &&
+               y == 0 && height == gimp_item_get_height (GIMP_ITEM (drawable)) &&
+               ! gimp_viewable_get_children (GIMP_VIEWABLE (drawable)))
+        {
+          /*  without a selection, keep the histograms of the drawable's
+           *  tiles, so that only the tiles which changed since the last
+           *  time need to be binned again.  not for groups, whose
+           *  projection buffer is rendered without emitting "changed"
+           */
+          if (! drawable->private->histogram_cache)
+            drawable->private->histogram_cache =
+              gimp_histogram_cache_new (gimp_drawable_get_buffer (drawable));
+
+          gimp_histogram_calculate_cached (histogram,
+                                           drawable->private->histogram_cache);
+        }
       else
         {
           gimp_histogram_calculate (histogram,
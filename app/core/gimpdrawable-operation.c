@@ -29,9 +29,11 @@
 
 #include "gegl/gimp-gegl-apply-operation.h"
 
+#include "gimp.h"
 #include "gimpdrawable.h"
 #include "gimpdrawable-operation.h"
 #include "gimpdrawable-shadow.h"
+#include "gimpimage.h"
 #include "gimpprogress.h"
 #include "gimpsettings.h"
 
@@ -44,6 +46,7 @@ gimp_drawable_apply_operation (GimpDrawable *drawable,
                                const gchar  *undo_desc,
                                GeglNode     *operation)
 {
+  GimpImage     *image;
   GeglBuffer    *dest_buffer;
   GeglRectangle  rect;
 
@@ -53,22 +56,35 @@ gimp_drawable_apply_operation (GimpDrawable *drawable,
   g_return_if_fail (undo_desc != NULL);
   g_return_if_fail (GEGL_IS_NODE (operation));
 
+  image = gimp_item_get_image (GIMP_ITEM (drawable));
+
   if (! gimp_item_mask_intersect (GIMP_ITEM (drawable),
                                   &rect.x,     &rect.y,
                                   &rect.width, &rect.height))
     return;
 
+  /*  keeps the image's displays from being closed while the
+   *  operation waits for its worker
+   */
+  gimp_set_busy (image->gimp);
+
   dest_buffer = gimp_drawable_get_shadow_buffer (drawable);
 
-  gimp_gegl_apply_operation (gimp_drawable_get_buffer (drawable),
-                             progress, undo_desc,
-                             operation,
-                             dest_buffer, &rect);
+  /*  only merge the shadow, and push undo, if it wasn't canceled  */
+  if (gimp_gegl_apply_operation_cancelable (gimp_drawable_get_buffer (drawable),
+                                            progress, undo_desc,
+                                            operation,
+                                            dest_buffer, &rect,
+                                            TRUE))
+    {
+      gimp_drawable_merge_shadow_buffer (drawable, TRUE, undo_desc);
+      gimp_drawable_update (drawable,
+                            rect.x, rect.y, rect.width, rect.height);
+    }
 
-  gimp_drawable_merge_shadow_buffer (drawable, TRUE, undo_desc);
   gimp_drawable_free_shadow_buffer (drawable);
 
-  gimp_drawable_update (drawable, rect.x, rect.y, rect.width, rect.height);
+  gimp_unset_busy (image->gimp);
 
   if (progress)
     gimp_progress_end (progress);
@@ -103,3 +119,54 @@ gimp_drawable_apply_operation_by_name (GimpDrawable *drawable,
 
   g_object_unref (node);
 }
+
+/*  applies all of @filters, which are GimpOperationPointFilter
+ *  instances, in one pass and one undo step
+ */
+gboolean
+gimp_drawable_apply_point_filters (GimpDrawable *drawable,
+                                   GimpProgress *progress,
+                                   const gchar  *undo_desc,
+                                   GPtrArray    *filters,
+                                   gboolean      use_lut)
+{
+  GimpImage     *image;
+  GeglRectangle  rect;
+  gboolean       success;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)), FALSE);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), FALSE);
+  g_return_val_if_fail (undo_desc != NULL, FALSE);
+  g_return_val_if_fail (filters != NULL, FALSE);
+
+  image = gimp_item_get_image (GIMP_ITEM (drawable));
+
+  if (! gimp_item_mask_intersect (GIMP_ITEM (drawable),
+                                  &rect.x,     &rect.y,
+                                  &rect.width, &rect.height))
+    return TRUE;
+
+  gimp_set_busy (image->gimp);
+
+  success = gimp_gegl_apply_point_filters (gimp_drawable_get_buffer (drawable),
+                                           progress, undo_desc,
+                                           gimp_drawable_get_shadow_buffer (drawable),
+                                           &rect, filters, use_lut);
+
+  if (success)
+    {
+      gimp_drawable_merge_shadow_buffer (drawable, TRUE, undo_desc);
+      gimp_drawable_update (drawable,
+                            rect.x, rect.y, rect.width, rect.height);
+    }
+
+  gimp_drawable_free_shadow_buffer (drawable);
+
+  gimp_unset_busy (image->gimp);
+
+  if (progress)
+    gimp_progress_end (progress);
+
+  return success;
+}
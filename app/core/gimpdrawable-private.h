@@ -33,6 +33,8 @@ struct _GimpDrawablePrivate
   GimpApplicator *fs_applicator;
 
   GeglNode       *mode_node;
+
+  GimpHistogramCache *histogram_cache; /* per-tile histograms */
 };
 
 #endif /* __GIMP_DRAWABLE_PRIVATE_H__ */
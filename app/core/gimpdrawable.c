@@ -42,6 +42,7 @@
 #include "gimpdrawable-shadow.h"
 #include "gimpdrawable-transform.h"
 #include "gimpfilterstack.h"
+#include "gimphistogram.h"
 #include "gimpimage.h"
 #include "gimpimage-colormap.h"
 #include "gimpimage-undo-push.h"
@@ -318,6 +319,12 @@ gimp_drawable_finalize (GObject *object)
 
   gimp_drawable_free_shadow_buffer (drawable);
 
+  if (drawable->private->histogram_cache)
+    {
+      gimp_histogram_cache_free (drawable->private->histogram_cache);
+      drawable->private->histogram_cache = NULL;
+    }
+
   if (drawable->private->source_node)
     {
       g_object_unref (drawable->private->source_node);
@@ -378,6 +385,9 @@ gimp_drawable_get_memsize (GimpObject *object,
   memsize += gimp_gegl_buffer_get_memsize (gimp_drawable_get_buffer (drawable));
   memsize += gimp_gegl_buffer_get_memsize (drawable->private->shadow);
 
+  if (drawable->private->histogram_cache)
+    memsize += gimp_histogram_cache_get_memsize (drawable->private->histogram_cache);
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -827,6 +837,14 @@ gimp_drawable_real_set_buffer (GimpDrawable *drawable,
     gimp_image_undo_push_drawable_mod (gimp_item_get_image (item), undo_desc,
                                        drawable, FALSE);
 
+  /*  the histogram cache watches the old buffer  */
+  if (drawable->private->histogram_cache &&
+      buffer != drawable->private->buffer)
+    {
+      gimp_histogram_cache_free (drawable->private->histogram_cache);
+      drawable->private->histogram_cache = NULL;
+    }
+
   /*  ref new before unrefing old, they might be the same  */
   g_object_ref (buffer);
 
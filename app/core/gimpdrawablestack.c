@@ -201,6 +201,11 @@ gimp_drawable_stack_drawable_update (GimpItem          *item,
 
       gimp_item_get_offset (item, &offset_x, &offset_y);
 
+      gimp_filter_stack_invalidate_below (GIMP_FILTER_STACK (stack),
+                                          GIMP_FILTER (item),
+                                          x + offset_x, y + offset_y,
+                                          width, height);
+
       gimp_drawable_stack_update (stack,
                                   x + offset_x, y + offset_y,
                                   width, height);
@@ -216,6 +221,12 @@ gimp_drawable_stack_drawable_visible (GimpItem          *item,
 
   gimp_item_get_offset (item, &offset_x, &offset_y);
 
+  gimp_filter_stack_invalidate_below (GIMP_FILTER_STACK (stack),
+                                      GIMP_FILTER (item),
+                                      offset_x, offset_y,
+                                      gimp_item_get_width  (item),
+                                      gimp_item_get_height (item));
+
   gimp_drawable_stack_update (stack,
                               offset_x, offset_y,
                               gimp_item_get_width  (item),
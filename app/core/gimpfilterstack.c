@@ -20,32 +20,42 @@
 
 #include "config.h"
 
+#include <cairo.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
 #include "core-types.h"
 
+#include "gegl/gimptilehandlerprojection.h"
+
+#include "gimp-utils.h"
 #include "gimpfilter.h"
 #include "gimpfilterstack.h"
 
 
 /*  local function prototypes  */
 
-static void   gimp_filter_stack_constructed (GObject         *object);
-static void   gimp_filter_stack_finalize    (GObject         *object);
+static void       gimp_filter_stack_constructed    (GObject         *object);
+static void       gimp_filter_stack_finalize       (GObject         *object);
+
+static gint64     gimp_filter_stack_get_memsize    (GimpObject      *object,
+                                                    gint64          *gui_size);
 
-static void   gimp_filter_stack_add         (GimpContainer   *container,
-                                             GimpObject      *object);
-static void   gimp_filter_stack_remove      (GimpContainer   *container,
-                                             GimpObject      *object);
-static void   gimp_filter_stack_reorder     (GimpContainer   *container,
-                                             GimpObject      *object,
-                                             gint             new_index);
+static void       gimp_filter_stack_add            (GimpContainer   *container,
+                                                    GimpObject      *object);
+static void       gimp_filter_stack_remove         (GimpContainer   *container,
+                                                    GimpObject      *object);
+static void       gimp_filter_stack_reorder        (GimpContainer   *container,
+                                                    GimpObject      *object,
+                                                    gint             new_index);
 
-static void   gimp_filter_stack_add_node    (GimpFilterStack *stack,
-                                             GimpFilter      *filter);
-static void   gimp_filter_stack_remove_node (GimpFilterStack *stack,
-                                             GimpFilter      *filter);
+static void       gimp_filter_stack_add_node       (GimpFilterStack *stack,
+                                                    GimpFilter      *filter);
+static void       gimp_filter_stack_remove_node    (GimpFilterStack *stack,
+                                                    GimpFilter      *filter);
+static GeglNode * gimp_filter_stack_get_node_below (GimpFilterStack *stack,
+                                                    GimpFilter      *filter);
+static void       gimp_filter_stack_uncache        (GimpFilterStack *stack);
 
 
 G_DEFINE_TYPE (GimpFilterStack, gimp_filter_stack, GIMP_TYPE_LIST);
@@ -56,11 +66,14 @@ G_DEFINE_TYPE (GimpFilterStack, gimp_filter_stack, GIMP_TYPE_LIST);
 static void
 gimp_filter_stack_class_init (GimpFilterStackClass *klass)
 {
-  GObjectClass       *object_class    = G_OBJECT_CLASS (klass);
-  GimpContainerClass *container_class = GIMP_CONTAINER_CLASS (klass);
+  GObjectClass       *object_class      = G_OBJECT_CLASS (klass);
+  GimpObjectClass    *gimp_object_class = GIMP_OBJECT_CLASS (klass);
+  GimpContainerClass *container_class   = GIMP_CONTAINER_CLASS (klass);
+
+  object_class->constructed      = gimp_filter_stack_constructed;
+  object_class->finalize         = gimp_filter_stack_finalize;
 
-  object_class->constructed = gimp_filter_stack_constructed;
-  object_class->finalize    = gimp_filter_stack_finalize;
+  gimp_object_class->get_memsize = gimp_filter_stack_get_memsize;
 
   container_class->add      = gimp_filter_stack_add;
   container_class->remove   = gimp_filter_stack_remove;
@@ -88,6 +101,8 @@ gimp_filter_stack_finalize (GObject *object)
 {
   GimpFilterStack *stack = GIMP_FILTER_STACK (object);
 
+  gimp_filter_stack_uncache (stack);
+
   if (stack->graph)
     {
       g_object_unref (stack->graph);
@@ -97,6 +112,19 @@ gimp_filter_stack_finalize (GObject *object)
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static gint64
+gimp_filter_stack_get_memsize (GimpObject *object,
+                               gint64     *gui_size)
+{
+  GimpFilterStack *stack   = GIMP_FILTER_STACK (object);
+  gint64           memsize = 0;
+
+  memsize += gimp_gegl_buffer_get_memsize (stack->cache_buffer);
+
+  return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
+                                                                  gui_size);
+}
+
 static void
 gimp_filter_stack_add (GimpContainer *container,
                        GimpObject    *object)
@@ -105,6 +133,8 @@ gimp_filter_stack_add (GimpContainer *container,
   GimpFilter      *filter = GIMP_FILTER (object);
   gint             n_children;
 
+  gimp_filter_stack_uncache (stack);
+
   n_children = gimp_container_get_n_children (container);
 
   if (n_children == 0)
@@ -127,9 +157,10 @@ gimp_filter_stack_remove (GimpContainer *container,
   GimpFilter      *filter = GIMP_FILTER (object);
   gint             n_children;
 
+  gimp_filter_stack_uncache (stack);
+
   if (stack->graph)
     {
-
       gimp_filter_stack_remove_node (stack, filter);
       gegl_node_remove_child (stack->graph, gimp_filter_get_node (filter));
     }
@@ -159,6 +190,8 @@ gimp_filter_stack_reorder (GimpContainer *container,
   gint             n_children;
   gint             old_index;
 
+  gimp_filter_stack_uncache (stack);
+
   n_children = gimp_container_get_n_children (container);
   old_index  = gimp_container_get_child_index (container, object);
 
@@ -274,6 +307,122 @@ gimp_filter_stack_get_graph (GimpFilterStack *stack)
   return stack->graph;
 }
 
+/**
+ * gimp_filter_stack_cache_below:
+ * @stack:  a #GimpFilterStack
+ * @filter: a filter in @stack, or %NULL
+ * @extent: the area of the cache
+ *
+ * Makes @filter read its input from a buffer that holds the
+ * composite of all filters below it, instead of recomposing them
+ * every time the graph is processed. The buffer renders lazily, and
+ * only the areas passed to gimp_filter_stack_invalidate_below() are
+ * rendered again, so that updating @filter or anything above it
+ * costs the same regardless of how many filters are below. Like the
+ * projection, the buffer renders one tile at a time, so the graph can
+ * read it from several threads.
+ *
+ * The cache is dropped when @stack's children change, or when this
+ * function is called with a %NULL @filter.
+ **/
+void
+gimp_filter_stack_cache_below (GimpFilterStack     *stack,
+                               GimpFilter          *filter,
+                               const GeglRectangle *extent)
+{
+  GimpTileHandlerProjection *handler;
+  GeglNode                  *node_below;
+
+  g_return_if_fail (GIMP_IS_FILTER_STACK (stack));
+  g_return_if_fail (filter == NULL || GIMP_IS_FILTER (filter));
+  g_return_if_fail (filter == NULL || extent != NULL);
+
+  gimp_filter_stack_uncache (stack);
+
+  if (! filter || ! stack->graph)
+    return;
+
+  g_return_if_fail (gimp_container_have (GIMP_CONTAINER (stack),
+                                         GIMP_OBJECT (filter)));
+
+  node_below = gimp_filter_stack_get_node_below (stack, filter);
+
+  stack->cache_buffer  = gegl_buffer_new (extent, babl_format ("RGBA float"));
+  stack->cache_handler = gimp_tile_handler_projection_new (node_below,
+                                                           extent->x +
+                                                           extent->width,
+                                                           extent->y +
+                                                           extent->height);
+
+  handler = GIMP_TILE_HANDLER_PROJECTION (stack->cache_handler);
+
+  gimp_tile_handler_projection_assign (handler, stack->cache_buffer);
+  gimp_tile_handler_projection_invalidate (handler,
+                                           extent->x,     extent->y,
+                                           extent->width, extent->height);
+
+  stack->cache_node = gegl_node_new_child (stack->graph,
+                                           "operation", "gegl:buffer-source",
+                                           "buffer",    stack->cache_buffer,
+                                           NULL);
+
+  gegl_node_connect_to (stack->cache_node,            "output",
+                        gimp_filter_get_node (filter), "input");
+
+  stack->cache_filter = filter;
+}
+
+/**
+ * gimp_filter_stack_invalidate_below:
+ * @stack:  a #GimpFilterStack
+ * @filter: the filter in @stack that changed
+ * @x:      the changed area
+ * @y:
+ * @width:
+ * @height:
+ *
+ * Marks the changed area of @stack's cache as dirty if @filter is
+ * below the cached filter. Changes of the cached filter itself and of
+ * anything above it leave the cache alone.
+ **/
+void
+gimp_filter_stack_invalidate_below (GimpFilterStack *stack,
+                                    GimpFilter      *filter,
+                                    gint             x,
+                                    gint             y,
+                                    gint             width,
+                                    gint             height)
+{
+  GimpContainer *container;
+  GeglRectangle  rect;
+
+  g_return_if_fail (GIMP_IS_FILTER_STACK (stack));
+  g_return_if_fail (GIMP_IS_FILTER (filter));
+
+  if (! stack->cache_filter)
+    return;
+
+  container = GIMP_CONTAINER (stack);
+
+  if (gimp_container_get_child_index (container, GIMP_OBJECT (filter)) <=
+      gimp_container_get_child_index (container,
+                                      GIMP_OBJECT (stack->cache_filter)))
+    return;
+
+  if (gegl_rectangle_intersect (&rect,
+                                GEGL_RECTANGLE (x, y, width, height),
+                                gegl_buffer_get_extent (stack->cache_buffer)))
+    {
+      GimpTileHandlerProjection *handler;
+
+      handler = GIMP_TILE_HANDLER_PROJECTION (stack->cache_handler);
+
+      gimp_tile_handler_projection_invalidate (handler,
+                                               rect.x,     rect.y,
+                                               rect.width, rect.height);
+    }
+}
+
 
 /*  private functions  */
 
@@ -367,3 +516,57 @@ gimp_filter_stack_remove_node (GimpFilterStack *stack,
   gegl_node_connect_to (node_below, "output",
                         node_above, "input");
 }
+
+static GeglNode *
+gimp_filter_stack_get_node_below (GimpFilterStack *stack,
+                                  GimpFilter      *filter)
+{
+  GimpFilter *filter_below;
+  gint        index;
+
+  index = gimp_container_get_child_index (GIMP_CONTAINER (stack),
+                                          GIMP_OBJECT (filter));
+
+  filter_below = (GimpFilter *)
+    gimp_container_get_child_by_index (GIMP_CONTAINER (stack), index + 1);
+
+  if (filter_below)
+    return gimp_filter_get_node (filter_below);
+
+  return gegl_node_get_input_proxy (stack->graph, "input");
+}
+
+static void
+gimp_filter_stack_uncache (GimpFilterStack *stack)
+{
+  if (stack->cache_filter)
+    {
+      gegl_node_connect_to (gimp_filter_stack_get_node_below (stack,
+                                                              stack->cache_filter),
+                            "output",
+                            gimp_filter_get_node (stack->cache_filter),
+                            "input");
+
+      stack->cache_filter = NULL;
+    }
+
+  if (stack->cache_node)
+    {
+      gegl_node_remove_child (stack->graph, stack->cache_node);
+      stack->cache_node = NULL;
+    }
+
+  if (stack->cache_buffer)
+    {
+      gegl_buffer_remove_handler (stack->cache_buffer, stack->cache_handler);
+
+      g_object_unref (stack->cache_buffer);
+      stack->cache_buffer = NULL;
+    }
+
+  if (stack->cache_handler)
+    {
+      g_object_unref (stack->cache_handler);
+      stack->cache_handler = NULL;
+    }
+}
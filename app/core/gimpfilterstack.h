@@ -35,9 +35,15 @@ typedef struct _GimpFilterStackClass GimpFilterStackClass;
 
 struct _GimpFilterStack
 {
-  GimpList  parent_instance;
+  GimpList         parent_instance;
 
-  GeglNode *graph;
+  GeglNode        *graph;
+
+  /*  the composite below cache_filter, see gimp_filter_stack_cache_below()  */
+  GimpFilter      *cache_filter;
+  GeglNode        *cache_node;
+  GeglBuffer      *cache_buffer;
+  GeglTileHandler *cache_handler;
 };
 
 struct _GimpFilterStackClass
@@ -46,10 +52,20 @@ struct _GimpFilterStackClass
 };
 
 
-GType           gimp_filter_stack_get_type  (void) G_GNUC_CONST;
-GimpContainer * gimp_filter_stack_new       (GType            filter_type);
+GType           gimp_filter_stack_get_type         (void) G_GNUC_CONST;
+GimpContainer * gimp_filter_stack_new              (GType                filter_type);
+
+GeglNode *      gimp_filter_stack_get_graph        (GimpFilterStack     *stack);
 
-GeglNode *      gimp_filter_stack_get_graph (GimpFilterStack *stack);
+void            gimp_filter_stack_cache_below      (GimpFilterStack     *stack,
+                                                    GimpFilter          *filter,
+                                                    const GeglRectangle *extent);
+void            gimp_filter_stack_invalidate_below (GimpFilterStack     *stack,
+                                                    GimpFilter          *filter,
+                                                    gint                 x,
+                                                    gint                 y,
+                                                    gint                 width,
+                                                    gint                 height);
 
 
 #endif  /*  __GIMP_FILTER_STACK_H__  */
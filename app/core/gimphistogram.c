@@ -29,9 +29,16 @@
 
 #include "gegl/gimp-babl.h"
 
+#include "gimp-parallel.h"
 #include "gimphistogram.h"
 
 
+/*  size of the tiles GimpHistogramCache bins separately  */
+#define CACHE_TILE_SIZE  512
+
+#define MIN_PARALLEL_SUB_AREA  (64 * 64)
+
+
 enum
 {
   PROP_0,
@@ -48,6 +55,47 @@ struct _GimpHistogramPrivate
   gdouble *values;
 };
 
+struct _GimpHistogramCache
+{
+  GeglBuffer     *buffer;
+  GeglRectangle   extent;
+
+  /*  the format and size the tiles are binned with  */
+  const Babl     *format;
+  gint            n_components;
+  gint            n_bins;
+
+  gint            n_tiles_x;
+  gint            n_tiles_y;
+  gdouble       **tiles;
+  gboolean       *valid;
+
+  /*  protects the valid flags, the buffer's "changed" signal can be
+   *  emitted from any thread
+   */
+  GMutex          mutex;
+  gulong          changed_handler;
+};
+
+typedef struct
+{
+  GeglBuffer          *buffer;
+  const GeglRectangle *buffer_rect;
+  GeglBuffer          *mask;
+  const GeglRectangle *mask_rect;
+  const Babl          *format;
+  gint                 n_components;
+  gint                 n_bins;
+  gdouble             *values;
+  GMutex               mutex;
+} CalculateData;
+
+typedef struct
+{
+  GimpHistogramCache *cache;
+  const gint         *tiles;
+} CacheData;
+
 
 /*  local function prototypes  */
 
@@ -68,6 +116,28 @@ static void     gimp_histogram_alloc_values (GimpHistogram *histogram,
                                              gint           n_components,
                                              gint           n_bins);
 
+static gboolean gimp_histogram_get_format   (GimpHistogram *histogram,
+                                             const Babl    *buffer_format,
+                                             const Babl   **format,
+                                             gint          *n_bins);
+
+static void     gimp_histogram_calculate_area
+                                            (const GeglRectangle *area,
+                                             CalculateData       *data,
+                                             gdouble             *values);
+static void     gimp_histogram_calculate_parallel
+                                            (const GeglRectangle *area,
+                                             CalculateData       *data);
+
+static void     gimp_histogram_cache_buffer_changed
+                                            (GeglBuffer          *buffer,
+                                             const GeglRectangle *rect,
+                                             GimpHistogramCache  *cache);
+static void     gimp_histogram_cache_calculate_tiles
+                                            (gsize                offset,
+                                             gsize                size,
+                                             CacheData           *data);
+
 
 G_DEFINE_TYPE (GimpHistogram, gimp_histogram, GIMP_TYPE_OBJECT)
 
@@ -231,9 +301,8 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
                           const GeglRectangle *mask_rect)
 {
   GimpHistogramPrivate *priv;
-  GeglBufferIterator   *iter;
+  CalculateData         data;
   const Babl           *format;
-  gint                  n_components;
   gint                  n_bins;
 
   g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
@@ -242,239 +311,274 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
 
   priv = histogram->priv;
 
-  format = gegl_buffer_get_format (buffer);
+  if (! gimp_histogram_get_format (histogram, gegl_buffer_get_format (buffer),
+                                   &format, &n_bins))
+    g_return_if_reached ();
 
-  if (babl_format_get_type (format, 0) == babl_type ("u8"))
-    n_bins = 256;
-  else
-    n_bins = 1024;
+  g_object_freeze_notify (G_OBJECT (histogram));
 
-  if (babl_format_is_palette (format))
-    {
-      if (babl_format_has_alpha (format))
-        format = babl_format ("R'G'B'A float");
-      else
-        format = babl_format ("R'G'B' float");
-    }
-  else
-    {
-      const Babl *model = babl_format_get_model (format);
+  gimp_histogram_alloc_values (histogram,
+                               babl_format_get_n_components (format),
+                               n_bins);
 
-      if (model == babl_model ("Y"))
-        {
-          if (priv->gamma_correct)
-            format = babl_format ("Y' float");
-          else
-            format = babl_format ("Y float");
-        }
-      else if (model == babl_model ("Y'"))
-        {
-          format = babl_format ("Y' float");
-        }
-      else if (model == babl_model ("YA"))
-        {
-          if (priv->gamma_correct)
-            format = babl_format ("Y'A float");
-          else
-            format = babl_format ("YA float");
-        }
-      else if (model == babl_model ("Y'A"))
-        {
-          format = babl_format ("Y'A float");
-        }
-      else if (model == babl_model ("RGB"))
-        {
-          if (priv->gamma_correct)
-            format = babl_format ("R'G'B' float");
-          else
-            format = babl_format ("RGB float");
-        }
-      else if (model == babl_model ("R'G'B'"))
-        {
-          format = babl_format ("R'G'B' float");
-        }
-      else if (model == babl_model ("RGBA"))
-        {
-          if (priv->gamma_correct)
-            format = babl_format ("R'G'B'A float");
-          else
-            format = babl_format ("RGBA float");
-        }
-      else if (model == babl_model ("R'G'B'A"))
-        {
-          format = babl_format ("R'G'B'A float");
-        }
-      else
-        {
-          g_return_if_reached ();
-        }
-    }
+  data.buffer       = buffer;
+  data.buffer_rect  = buffer_rect;
+  data.mask         = mask;
+  data.mask_rect    = mask_rect;
+  data.format       = format;
+  data.n_components = babl_format_get_n_components (format);
+  data.n_bins       = n_bins;
+  data.values       = priv->values;
 
-  n_components = babl_format_get_n_components (format);
+  g_mutex_init (&data.mutex);
 
-  g_object_freeze_notify (G_OBJECT (histogram));
+  gimp_parallel_distribute_area (buffer_rect, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_histogram_calculate_parallel,
+                                 &data);
 
-  gimp_histogram_alloc_values (histogram, n_components, n_bins);
+  g_mutex_clear (&data.mutex);
 
-  iter = gegl_buffer_iterator_new (buffer, buffer_rect, 0, format,
-                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+  g_object_notify (G_OBJECT (histogram), "values");
 
-  if (mask)
-    gegl_buffer_iterator_add (iter, mask, mask_rect, 0,
-                              babl_format ("Y float"),
-                              GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+  g_object_thaw_notify (G_OBJECT (histogram));
+}
 
-#define VALUE(c,i) (priv->values[(c) * priv->n_bins + \
-                                 (gint) (CLAMP ((i), 0.0, 1.0) * \
-                                         (priv->n_bins - 0.0001))])
+/**
+ * gimp_histogram_cache_new:
+ * @buffer: the #GeglBuffer to calculate histograms of
+ *
+ * Creates a cache for calculating histograms of all of @buffer. The
+ * cache keeps a partial histogram of each tile, and watches @buffer's
+ * "changed" signal, so that gimp_histogram_calculate_cached() only
+ * needs to bin the tiles again which changed since it was last called.
+ *
+ * Return value: the new #GimpHistogramCache.
+ **/
+GimpHistogramCache *
+gimp_histogram_cache_new (GeglBuffer *buffer)
+{
+  GimpHistogramCache *cache;
+  gint                n_tiles;
 
-  while (gegl_buffer_iterator_next (iter))
-    {
-      const gfloat *data   = iter->data[0];
-      gint          length = iter->length;
-      gfloat        max;
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
 
-      if (mask)
-        {
-          const gfloat *mask_data = iter->data[1];
+  cache = g_slice_new0 (GimpHistogramCache);
 
-          switch (n_components)
-            {
-            case 1:
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
+  cache->buffer = g_object_ref (buffer);
+  cache->extent = *gegl_buffer_get_extent (buffer);
 
-                  VALUE (0, data[0]) += masked;
+  cache->n_tiles_x = (cache->extent.width  + CACHE_TILE_SIZE - 1) /
+                     CACHE_TILE_SIZE;
+  cache->n_tiles_y = (cache->extent.height + CACHE_TILE_SIZE - 1) /
+                     CACHE_TILE_SIZE;
 
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
+  n_tiles = cache->n_tiles_x * cache->n_tiles_y;
 
-            case 2:
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[1];
+  cache->tiles = g_new0 (gdouble *, n_tiles);
+  cache->valid = g_new0 (gboolean, n_tiles);
 
-                  VALUE (0, data[0]) += weight * masked;
-                  VALUE (1, data[1]) += masked;
+  g_mutex_init (&cache->mutex);
 
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
+  cache->changed_handler =
+    gegl_buffer_signal_connect (buffer, "changed",
+                                G_CALLBACK (gimp_histogram_cache_buffer_changed),
+                                cache);
 
-            case 3: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
+  return cache;
+}
 
-                  VALUE (1, data[0]) += masked;
-                  VALUE (2, data[1]) += masked;
-                  VALUE (3, data[2]) += masked;
+void
+gimp_histogram_cache_free (GimpHistogramCache *cache)
+{
+  gint i;
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
+  g_return_if_fail (cache != NULL);
 
-                  VALUE (0, max) += masked;
+  g_signal_handler_disconnect (cache->buffer, cache->changed_handler);
+  g_object_unref (cache->buffer);
 
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
+  for (i = 0; i < cache->n_tiles_x * cache->n_tiles_y; i++)
+    g_free (cache->tiles[i]);
 
-            case 4: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[3];
+  g_free (cache->tiles);
+  g_free (cache->valid);
 
-                  VALUE (1, data[0]) += weight * masked;
-                  VALUE (2, data[1]) += weight * masked;
-                  VALUE (3, data[2]) += weight * masked;
-                  VALUE (4, data[3]) += masked;
+  g_mutex_clear (&cache->mutex);
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
+  g_slice_free (GimpHistogramCache, cache);
+}
 
-                  VALUE (0, max) += weight * masked;
+gint64
+gimp_histogram_cache_get_memsize (GimpHistogramCache *cache)
+{
+  gint64 memsize;
+  gint   n_tiles;
+  gint   i;
 
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-            }
-        }
-      else /* no mask */
-        {
-          switch (n_components)
-            {
-            case 1:
-              while (length--)
-                {
-                  VALUE (0, data[0]) += 1.0;
+  g_return_val_if_fail (cache != NULL, 0);
 
-                  data += n_components;
-                }
-              break;
+  n_tiles = cache->n_tiles_x * cache->n_tiles_y;
 
-            case 2:
-              while (length--)
-                {
-                  const gdouble weight = data[1];
+  memsize = (sizeof (GimpHistogramCache) +
+             n_tiles * (sizeof (gdouble *) + sizeof (gboolean)));
 
-                  VALUE (0, data[0]) += weight;
-                  VALUE (1, data[1]) += 1.0;
+  for (i = 0; i < n_tiles; i++)
+    {
+      if (cache->tiles[i])
+        memsize += ((cache->n_components + 1) * cache->n_bins *
+                    sizeof (gdouble));
+    }
 
-                  data += n_components;
-                }
-              break;
+  return memsize;
+}
 
-            case 3: /* calculate separate value values */
-              while (length--)
-                {
-                  VALUE (1, data[0]) += 1.0;
-                  VALUE (2, data[1]) += 1.0;
-                  VALUE (3, data[2]) += 1.0;
+/**
+ * gimp_histogram_calculate_cached:
+ * @histogram: a #GimpHistogram
+ * @cache:     a #GimpHistogramCache
+ *
+ * Calculates the histogram of the whole buffer of @cache, like
+ * gimp_histogram_calculate() without a mask would, but only bins the
+ * tiles which changed since the last call, in parallel.
+ **/
+void
+gimp_histogram_calculate_cached (GimpHistogram      *histogram,
+                                 GimpHistogramCache *cache)
+{
+  GimpHistogramPrivate *priv;
+  CacheData             data;
+  const Babl           *format;
+  gint                  n_bins;
+  gint                  n_tiles;
+  gint                  n_values;
+  gint                 *dirty;
+  gint                  n_dirty = 0;
+  gint                  i, j;
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
+  g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
+  g_return_if_fail (cache != NULL);
 
-                  VALUE (0, max) += 1.0;
+  priv = histogram->priv;
 
-                  data += n_components;
-                }
-              break;
+  if (! gimp_histogram_get_format (histogram,
+                                   gegl_buffer_get_format (cache->buffer),
+                                   &format, &n_bins))
+    g_return_if_reached ();
 
-            case 4: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble weight = data[3];
+  n_tiles = cache->n_tiles_x * cache->n_tiles_y;
+
+  /*  the tiles can only be reused for the same format, histograms
+   *  with and without gamma correction need different ones
+   */
+  if (format != cache->format || n_bins != cache->n_bins)
+    {
+      for (i = 0; i < n_tiles; i++)
+        {
+          g_free (cache->tiles[i]);
+          cache->tiles[i] = NULL;
+        }
 
-                  VALUE (1, data[0]) += weight;
-                  VALUE (2, data[1]) += weight;
-                  VALUE (3, data[2]) += weight;
-                  VALUE (4, data[3]) += 1.0;
+      cache->format       = format;
+      cache->n_components = babl_format_get_n_components (format);
+      cache->n_bins       = n_bins;
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
+      gimp_histogram_cache_invalidate (cache, NULL);
+    }
 
-                  VALUE (0, max) += weight;
+  /*  mark the tiles valid before binning them, so that changes which
+   *  happen meanwhile are not lost
+   */
+  dirty = g_new (gint, n_tiles);
 
-                  data += n_components;
-                }
-              break;
-            }
+  g_mutex_lock (&cache->mutex);
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      if (! cache->valid[i])
+        {
+          cache->valid[i] = TRUE;
+          dirty[n_dirty++] = i;
         }
     }
 
+  g_mutex_unlock (&cache->mutex);
+
+  data.cache = cache;
+  data.tiles = dirty;
+
+  gimp_parallel_distribute_range (n_dirty, 1,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_histogram_cache_calculate_tiles,
+                                  &data);
+
+  g_free (dirty);
+
+  g_object_freeze_notify (G_OBJECT (histogram));
+
+  gimp_histogram_alloc_values (histogram, cache->n_components, n_bins);
+
+  n_values = priv->n_channels * priv->n_bins;
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      const gdouble *tile = cache->tiles[i];
+
+      for (j = 0; j < n_values; j++)
+        priv->values[j] += tile[j];
+    }
+
   g_object_notify (G_OBJECT (histogram), "values");
 
   g_object_thaw_notify (G_OBJECT (histogram));
+}
 
-#undef VALUE
+/**
+ * gimp_histogram_cache_invalidate:
+ * @cache: a #GimpHistogramCache
+ * @rect:  the changed area of the buffer, or %NULL
+ *
+ * Makes the next gimp_histogram_calculate_cached() bin the tiles
+ * again which intersect @rect, or all tiles if @rect is %NULL. This
+ * happens automatically when the buffer emits "changed".
+ **/
+void
+gimp_histogram_cache_invalidate (GimpHistogramCache  *cache,
+                                 const GeglRectangle *rect)
+{
+  gint tile_x1, tile_y1;
+  gint tile_x2, tile_y2;
+  gint x, y;
+
+  g_return_if_fail (cache != NULL);
+
+  if (rect)
+    {
+      GeglRectangle area;
+
+      if (! gegl_rectangle_intersect (&area, rect, &cache->extent))
+        return;
+
+      tile_x1 = (area.x - cache->extent.x) / CACHE_TILE_SIZE;
+      tile_y1 = (area.y - cache->extent.y) / CACHE_TILE_SIZE;
+      tile_x2 = (area.x + area.width  - 1 - cache->extent.x) / CACHE_TILE_SIZE;
+      tile_y2 = (area.y + area.height - 1 - cache->extent.y) / CACHE_TILE_SIZE;
+    }
+  else
+    {
+      tile_x1 = 0;
+      tile_y1 = 0;
+      tile_x2 = cache->n_tiles_x - 1;
+      tile_y2 = cache->n_tiles_y - 1;
+    }
+
+  g_mutex_lock (&cache->mutex);
+
+  for (y = tile_y1; y <= tile_y2; y++)
+    for (x = tile_x1; x <= tile_x2; x++)
+      cache->valid[y * cache->n_tiles_x + x] = FALSE;
+
+  g_mutex_unlock (&cache->mutex);
 }
 
 void
@@ -949,3 +1053,345 @@ gimp_histogram_alloc_values (GimpHistogram *histogram,
               priv->n_channels * priv->n_bins * sizeof (gdouble));
     }
 }
+
+static gboolean
+gimp_histogram_get_format (GimpHistogram  *histogram,
+                           const Babl     *buffer_format,
+                           const Babl    **format,
+                           gint           *n_bins)
+{
+  GimpHistogramPrivate *priv = histogram->priv;
+  const Babl           *u8_format;
+
+  if (babl_format_get_type (buffer_format, 0) == babl_type ("u8"))
+    *n_bins = 256;
+  else
+    *n_bins = 1024;
+
+  if (babl_format_is_palette (buffer_format))
+    {
+      if (babl_format_has_alpha (buffer_format))
+        *format = babl_format ("R'G'B'A float");
+      else
+        *format = babl_format ("R'G'B' float");
+    }
+  else
+    {
+      const Babl *model = babl_format_get_model (buffer_format);
+
+      if (model == babl_model ("Y"))
+        {
+          if (priv->gamma_correct)
+            *format = babl_format ("Y' float");
+          else
+            *format = babl_format ("Y float");
+        }
+      else if (model == babl_model ("Y'"))
+        {
+          *format = babl_format ("Y' float");
+        }
+      else if (model == babl_model ("YA"))
+        {
+          if (priv->gamma_correct)
+            *format = babl_format ("Y'A float");
+          else
+            *format = babl_format ("YA float");
+        }
+      else if (model == babl_model ("Y'A"))
+        {
+          *format = babl_format ("Y'A float");
+        }
+      else if (model == babl_model ("RGB"))
+        {
+          if (priv->gamma_correct)
+            *format = babl_format ("R'G'B' float");
+          else
+            *format = babl_format ("RGB float");
+        }
+      else if (model == babl_model ("R'G'B'"))
+        {
+          *format = babl_format ("R'G'B' float");
+        }
+      else if (model == babl_model ("RGBA"))
+        {
+          if (priv->gamma_correct)
+            *format = babl_format ("R'G'B'A float");
+          else
+            *format = babl_format ("RGBA float");
+        }
+      else if (model == babl_model ("R'G'B'A"))
+        {
+          *format = babl_format ("R'G'B'A float");
+        }
+      else
+        {
+          return FALSE;
+        }
+    }
+
+  if (*n_bins != 256)
+    return TRUE;
+
+  /*  8-bit buffers which need no conversion other than to float, or
+   *  only their palette looked up, can be binned directly, there are
+   *  exactly as many bins as values
+   */
+  u8_format = gimp_babl_format (gimp_babl_format_get_base_type (*format),
+                                gimp_babl_precision (GIMP_COMPONENT_TYPE_U8,
+                                                     gimp_babl_format_get_linear (*format)),
+                                babl_format_has_alpha (*format));
+
+  if (babl_format_is_palette (buffer_format) ||
+      babl_format_get_model (u8_format) == babl_format_get_model (buffer_format))
+    {
+      *format = u8_format;
+    }
+
+  return TRUE;
+}
+
+#define VALUE(c,i) (values[(c) * n_bins + (i)])
+
+#define FLOAT_BIN(v) ((gint) (CLAMP ((v), 0.0, 1.0) * (n_bins - 0.0001)))
+
+static void
+gimp_histogram_calculate_area (const GeglRectangle *area,
+                               CalculateData       *data,
+                               gdouble             *values)
+{
+  GeglBufferIterator *iter;
+  const gint          n_components = data->n_components;
+  const gint          n_bins       = data->n_bins;
+  gboolean            u8;
+
+  u8 = (babl_format_get_type (data->format, 0) == babl_type ("u8"));
+
+  iter = gegl_buffer_iterator_new (data->buffer, area, 0, data->format,
+                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  if (data->mask)
+    {
+      GeglRectangle mask_area = *area;
+
+      mask_area.x += data->mask_rect->x - data->buffer_rect->x;
+      mask_area.y += data->mask_rect->y - data->buffer_rect->y;
+
+      gegl_buffer_iterator_add (iter, data->mask, &mask_area, 0,
+                                babl_format ("Y float"),
+                                GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+    }
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *mask_data = data->mask ? iter->data[1] : NULL;
+      gint          length    = iter->length;
+
+      if (u8)
+        {
+          /*  the bin of an 8-bit value is the value itself  */
+          const guchar *src = iter->data[0];
+
+          switch (n_components)
+            {
+            case 1:
+              while (length--)
+                {
+                  const gdouble masked = mask_data ? *mask_data++ : 1.0;
+
+                  VALUE (0, src[0]) += masked;
+
+                  src += n_components;
+                }
+              break;
+
+            case 2:
+              while (length--)
+                {
+                  const gdouble masked = mask_data ? *mask_data++ : 1.0;
+                  const gdouble weight = src[1] / 255.0;
+
+                  VALUE (0, src[0]) += weight * masked;
+                  VALUE (1, src[1]) += masked;
+
+                  src += n_components;
+                }
+              break;
+
+            case 3: /* calculate separate value values */
+              while (length--)
+                {
+                  const gdouble masked = mask_data ? *mask_data++ : 1.0;
+
+                  VALUE (1, src[0]) += masked;
+                  VALUE (2, src[1]) += masked;
+                  VALUE (3, src[2]) += masked;
+
+                  VALUE (0, MAX (MAX (src[0], src[1]), src[2])) += masked;
+
+                  src += n_components;
+                }
+              break;
+
+            case 4: /* calculate separate value values */
+              while (length--)
+                {
+                  const gdouble masked = mask_data ? *mask_data++ : 1.0;
+                  const gdouble weight = src[3] / 255.0;
+
+                  VALUE (1, src[0]) += weight * masked;
+                  VALUE (2, src[1]) += weight * masked;
+                  VALUE (3, src[2]) += weight * masked;
+                  VALUE (4, src[3]) += masked;
+
+                  VALUE (0, MAX (MAX (src[0], src[1]), src[2])) += weight * masked;
+
+                  src += n_components;
+                }
+              break;
+            }
+        }
+      else
+        {
+          const gfloat *src = iter->data[0];
+          gfloat        max;
+
+          switch (n_components)
+            {
+            case 1:
+              while (length--)
+                {
+                  const gdouble masked = mask_data ? *mask_data++ : 1.0;
+
+                  VALUE (0, FLOAT_BIN (src[0])) += masked;
+
+                  src += n_components;
+                }
+              break;
+
+            case 2:
+              while (length--)
+                {
+                  const gdouble masked = mask_data ? *mask_data++ : 1.0;
+                  const gdouble weight = src[1];
+
+                  VALUE (0, FLOAT_BIN (src[0])) += weight * masked;
+                  VALUE (1, FLOAT_BIN (src[1])) += masked;
+
+                  src += n_components;
+                }
+              break;
+
+            case 3: /* calculate separate value values */
+              while (length--)
+                {
+                  const gdouble masked = mask_data ? *mask_data++ : 1.0;
+
+                  VALUE (1, FLOAT_BIN (src[0])) += masked;
+                  VALUE (2, FLOAT_BIN (src[1])) += masked;
+                  VALUE (3, FLOAT_BIN (src[2])) += masked;
+
+                  max = MAX (src[0], src[1]);
+                  max = MAX (src[2], max);
+
+                  VALUE (0, FLOAT_BIN (max)) += masked;
+
+                  src += n_components;
+                }
+              break;
+
+            case 4: /* calculate separate value values */
+              while (length--)
+                {
+                  const gdouble masked = mask_data ? *mask_data++ : 1.0;
+                  const gdouble weight = src[3];
+
+                  VALUE (1, FLOAT_BIN (src[0])) += weight * masked;
+                  VALUE (2, FLOAT_BIN (src[1])) += weight * masked;
+                  VALUE (3, FLOAT_BIN (src[2])) += weight * masked;
+                  VALUE (4, FLOAT_BIN (src[3])) += masked;
+
+                  max = MAX (src[0], src[1]);
+                  max = MAX (src[2], max);
+
+                  VALUE (0, FLOAT_BIN (max)) += weight * masked;
+
+                  src += n_components;
+                }
+              break;
+            }
+        }
+    }
+}
+
+#undef FLOAT_BIN
+#undef VALUE
+
+/*  every thread bins its area separately, and adds its bins to the
+ *  histogram at the end
+ */
+static void
+gimp_histogram_calculate_parallel (const GeglRectangle *area,
+                                   CalculateData       *data)
+{
+  gint     n_values = (data->n_components + 1) * data->n_bins;
+  gdouble *values   = g_new0 (gdouble, n_values);
+  gint     i;
+
+  gimp_histogram_calculate_area (area, data, values);
+
+  g_mutex_lock (&data->mutex);
+
+  for (i = 0; i < n_values; i++)
+    data->values[i] += values[i];
+
+  g_mutex_unlock (&data->mutex);
+
+  g_free (values);
+}
+
+static void
+gimp_histogram_cache_buffer_changed (GeglBuffer          *buffer,
+                                     const GeglRectangle *rect,
+                                     GimpHistogramCache  *cache)
+{
+  gimp_histogram_cache_invalidate (cache, rect);
+}
+
+static void
+gimp_histogram_cache_calculate_tiles (gsize      offset,
+                                      gsize      size,
+                                      CacheData *data)
+{
+  GimpHistogramCache *cache = data->cache;
+  CalculateData       calc  = { 0, };
+  gint                n_values;
+  gsize               i;
+
+  n_values = (cache->n_components + 1) * cache->n_bins;
+
+  calc.buffer       = cache->buffer;
+  calc.buffer_rect  = &cache->extent;
+  calc.format       = cache->format;
+  calc.n_components = cache->n_components;
+  calc.n_bins       = cache->n_bins;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      gint           index = data->tiles[i];
+      GeglRectangle  tile;
+
+      tile.x      = cache->extent.x + (index % cache->n_tiles_x) * CACHE_TILE_SIZE;
+      tile.y      = cache->extent.y + (index / cache->n_tiles_x) * CACHE_TILE_SIZE;
+      tile.width  = MIN (CACHE_TILE_SIZE,
+                         cache->extent.x + cache->extent.width  - tile.x);
+      tile.height = MIN (CACHE_TILE_SIZE,
+                         cache->extent.y + cache->extent.height - tile.y);
+
+      if (cache->tiles[index])
+        memset (cache->tiles[index], 0, n_values * sizeof (gdouble));
+      else
+        cache->tiles[index] = g_new0 (gdouble, n_values);
+
+      gimp_histogram_calculate_area (&tile, &calc, cache->tiles[index]);
+    }
+}
@@ -62,6 +62,15 @@ void            gimp_histogram_calculate     (GimpHistogram        *histogram,
 
 void            gimp_histogram_clear_values  (GimpHistogram        *histogram);
 
+GimpHistogramCache * gimp_histogram_cache_new         (GeglBuffer          *buffer);
+void                 gimp_histogram_cache_free        (GimpHistogramCache  *cache);
+gint64               gimp_histogram_cache_get_memsize (GimpHistogramCache  *cache);
+void                 gimp_histogram_cache_invalidate  (GimpHistogramCache  *cache,
+                                                       const GeglRectangle *rect);
+
+void            gimp_histogram_calculate_cached (GimpHistogram      *histogram,
+                                                 GimpHistogramCache *cache);
+
 gdouble         gimp_histogram_get_maximum   (GimpHistogram        *histogram,
                                               GimpHistogramChannel  channel);
 gdouble         gimp_histogram_get_count     (GimpHistogram        *histogram,
@@ -36,6 +36,38 @@
 #include "gimppickable.h"
 
 
+typedef struct
+{
+  gint y;
+  gint x1;
+  gint x2;
+} ContiguousSpan;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  const Babl          *format;
+  gint                 n_components;
+  gboolean             has_alpha;
+  gboolean             select_transparent;
+  GimpSelectCriterion  select_criterion;
+  gboolean             antialias;
+  gfloat               threshold;
+  const gfloat        *col;
+
+  gint                 width;
+  gint                 height;
+
+  /*  the pixel differences of the source, in bands of one tile row
+   *  each, computed when first needed.  pixels which have been added
+   *  to the region are marked by negating their difference.
+   */
+  gint                 band_height;
+  gint                 n_bands;
+  gfloat             **bands;
+} ContiguousRegion;
+
+
 /*  local function prototypes  */
 
 static const Babl * choose_format         (GeglBuffer          *buffer,
@@ -50,33 +82,14 @@ static gfloat   pixel_difference          (const gfloat        *col1,
                                            gboolean             has_alpha,
                                            gboolean             select_transparent,
                                            GimpSelectCriterion  select_criterion);
-static gboolean find_contiguous_segment   (const gfloat        *col,
-                                           GeglBuffer          *src_buffer,
-                                           GeglBuffer          *mask_buffer,
-                                           const Babl          *src_format,
-                                           gint                 n_components,
-                                           gboolean             has_alpha,
-                                           gint                 width,
-                                           gboolean             select_transparent,
-                                           GimpSelectCriterion  select_criterion,
-                                           gboolean             antialias,
-                                           gfloat               threshold,
-                                           gint                 initial_x,
-                                           gint                 initial_y,
-                                           gint                *start,
-                                           gint                *end);
-static void find_contiguous_region_helper (GeglBuffer          *src_buffer,
-                                           GeglBuffer          *mask_buffer,
-                                           const Babl          *format,
-                                           gint                 n_components,
-                                           gboolean             has_alpha,
-                                           gboolean             select_transparent,
-                                           GimpSelectCriterion  select_criterion,
-                                           gboolean             antialias,
-                                           gfloat               threshold,
+static gfloat * contiguous_region_get_row (ContiguousRegion    *region,
+                                           gint                 y);
+static void     find_contiguous_region    (ContiguousRegion    *region,
                                            gint                 x,
-                                           gint                 y,
-                                           const gfloat        *col);
+                                           gint                 y);
+static void     contiguous_region_write_mask
+                                          (ContiguousRegion    *region,
+                                           GeglBuffer          *mask_buffer);
 
 
 /*  public functions  */
@@ -92,13 +105,14 @@ gimp_image_contiguous_region_by_seed (GimpImage           *image,
                                       gint                 x,
                                       gint                 y)
 {
-  GimpPickable *pickable;
-  GeglBuffer   *src_buffer;
-  GeglBuffer   *mask_buffer;
-  const Babl   *format;
-  gint          n_components;
-  gboolean      has_alpha;
-  gfloat        start_col[MAX_CHANNELS];
+  GimpPickable     *pickable;
+  GeglBuffer       *src_buffer;
+  GeglBuffer       *mask_buffer;
+  const Babl       *format;
+  gint              n_components;
+  gboolean          has_alpha;
+  gfloat            start_col[MAX_CHANNELS];
+  ContiguousRegion  region;
 
   g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
   g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
@@ -137,11 +151,35 @@ gimp_image_contiguous_region_by_seed (GimpImage           *image,
   mask_buffer = gegl_buffer_new (gegl_buffer_get_extent (src_buffer),
                                  babl_format ("Y float"));
 
-  find_contiguous_region_helper (src_buffer, mask_buffer,
-                                 format, n_components, has_alpha,
-                                 select_transparent, select_criterion,
-                                 antialias, threshold,
-                                 x, y, start_col);
+  region.src_buffer         = src_buffer;
+  region.format             = format;
+  region.n_components       = n_components;
+  region.has_alpha          = has_alpha;
+  region.select_transparent = select_transparent;
+  region.select_criterion   = select_criterion;
+  region.antialias          = antialias;
+  region.threshold          = threshold;
+  region.col                = start_col;
+  region.width              = gegl_buffer_get_width  (src_buffer);
+  region.height             = gegl_buffer_get_height (src_buffer);
+
+  g_object_get (src_buffer,
+                "tile-height", &region.band_height,
+                NULL);
+
+  region.n_bands = (region.height + region.band_height - 1) /
+                   region.band_height;
+  region.bands   = g_new0 (gfloat *, region.n_bands);
+
+  if (x >= 0 && x < region.width &&
+      y >= 0 && y < region.height)
+    {
+      find_contiguous_region (&region, x, y);
+    }
+
+  contiguous_region_write_mask (&region, mask_buffer);
+
+  g_free (region.bands);
 
   return mask_buffer;
 }
@@ -380,154 +418,147 @@ pixel_difference (const gfloat        *col1,
     }
 }
 
-static gboolean
-find_contiguous_segment (const gfloat        *col,
-                         GeglBuffer          *src_buffer,
-                         GeglBuffer          *mask_buffer,
-                         const Babl          *format,
-                         gint                 n_components,
-                         gboolean             has_alpha,
-                         gint                 width,
-                         gboolean             select_transparent,
-                         GimpSelectCriterion  select_criterion,
-                         gboolean             antialias,
-                         gfloat               threshold,
-                         gint                 initial_x,
-                         gint                 initial_y,
-                         gint                *start,
-                         gint                *end)
+static gfloat *
+contiguous_region_get_row (ContiguousRegion *region,
+                           gint              y)
 {
-  gfloat s[MAX_CHANNELS];
-  gfloat mask_row[width];
-  gfloat diff;
+  gint    band = y / region->band_height;
+  gfloat *diff = region->bands[band];
 
-  gegl_buffer_sample (src_buffer, initial_x, initial_y, NULL, s, format,
-                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-
-  diff = pixel_difference (col, s, antialias, threshold,
-                           n_components, has_alpha, select_transparent,
-                           select_criterion);
-
-  /* check the starting pixel */
   if (! diff)
-    return FALSE;
-
-  mask_row[initial_x] = diff;
-
-  *start = initial_x - 1;
-
-  while (*start >= 0 && diff)
-    {
-      gegl_buffer_sample (src_buffer, *start, initial_y, NULL, s, format,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-
-      diff = pixel_difference (col, s, antialias, threshold,
-                               n_components, has_alpha, select_transparent,
-                               select_criterion);
-
-      mask_row[*start] = diff;
-
-      if (diff)
-        (*start)--;
-    }
-
-  diff = 1;
-  *end = initial_x + 1;
-
-  while (*end < width && diff)
     {
-      gegl_buffer_sample (src_buffer, *end, initial_y, NULL, s, format,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-
-      diff = pixel_difference (col, s, antialias, threshold,
-                               n_components, has_alpha, select_transparent,
-                               select_criterion);
+      GeglRectangle  rect;
+      gfloat        *src;
+      gfloat        *s;
+      gint           n_pixels;
+      gint           i;
+
+      gegl_rectangle_set (&rect,
+                          0, band * region->band_height,
+                          region->width,
+                          MIN (region->band_height,
+                               region->height - band * region->band_height));
+
+      n_pixels = rect.width * rect.height;
+
+      src  = g_new (gfloat, n_pixels * region->n_components);
+      diff = g_new (gfloat, n_pixels);
+
+      /*  read the whole tile row at once, instead of sampling the
+       *  buffer pixel by pixel
+       */
+      gegl_buffer_get (region->src_buffer, &rect, 1.0,
+                       region->format, src,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (i = 0, s = src; i < n_pixels; i++, s += region->n_components)
+        {
+          diff[i] = pixel_difference (region->col, s,
+                                      region->antialias,
+                                      region->threshold,
+                                      region->n_components,
+                                      region->has_alpha,
+                                      region->select_transparent,
+                                      region->select_criterion);
+        }
 
-      mask_row[*end] = diff;
+      g_free (src);
 
-      if (diff)
-        (*end)++;
+      region->bands[band] = diff;
     }
 
-  gegl_buffer_set (mask_buffer, GEGL_RECTANGLE (*start, initial_y,
-                                                *end - *start, 1),
-                   0, babl_format ("Y float"), &mask_row[*start],
-                   GEGL_AUTO_ROWSTRIDE);
-
-  return TRUE;
+  return diff + (y - band * region->band_height) * region->width;
 }
 
 static void
-find_contiguous_region_helper (GeglBuffer          *src_buffer,
-                               GeglBuffer          *mask_buffer,
-                               const Babl          *format,
-                               gint                 n_components,
-                               gboolean             has_alpha,
-                               gboolean             select_transparent,
-                               GimpSelectCriterion  select_criterion,
-                               gboolean             antialias,
-                               gfloat               threshold,
-                               gint                 x,
-                               gint                 y,
-                               const gfloat        *col)
+find_contiguous_region (ContiguousRegion *region,
+                        gint              x,
+                        gint              y)
 {
-  gint    start, end;
-  gint    new_start, new_end;
-  GQueue *coord_stack;
+  GArray         *stack;
+  ContiguousSpan  span = { y, x, x };
 
-  coord_stack = g_queue_new ();
+  stack = g_array_new (FALSE, FALSE, sizeof (ContiguousSpan));
 
-  /* To avoid excessive memory allocation (y, start, end) tuples are
-   * stored in interleaved format:
-   *
-   * [y1] [start1] [end1] [y2] [start2] [end2]
-   */
-  g_queue_push_tail (coord_stack, GINT_TO_POINTER (y));
-  g_queue_push_tail (coord_stack, GINT_TO_POINTER (x - 1));
-  g_queue_push_tail (coord_stack, GINT_TO_POINTER (x + 1));
+  g_array_append_val (stack, span);
 
-  do
+  while (stack->len > 0)
     {
-      y     = GPOINTER_TO_INT (g_queue_pop_head (coord_stack));
-      start = GPOINTER_TO_INT (g_queue_pop_head (coord_stack));
-      end   = GPOINTER_TO_INT (g_queue_pop_head (coord_stack));
+      gfloat *row;
+
+      span = g_array_index (stack, ContiguousSpan, stack->len - 1);
+      g_array_set_size (stack, stack->len - 1);
+
+      row = contiguous_region_get_row (region, span.y);
 
-      for (x = start + 1; x < end; x++)
+      for (x = span.x1; x <= span.x2; x++)
         {
-          gfloat val;
+          gint x1, x2;
+          gint i;
 
-          gegl_buffer_sample (mask_buffer, x, y, NULL, &val,
-                              babl_format ("Y float"),
-                              GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-          if (val != 0.0)
+          /*  skip pixels which don't match or are already selected  */
+          if (row[x] <= 0.0)
             continue;
 
-          if (! find_contiguous_segment (col, src_buffer, mask_buffer,
-                                         format,
-                                         n_components,
-                                         has_alpha,
-                                         gegl_buffer_get_width (src_buffer),
-                                         select_transparent, select_criterion,
-                                         antialias, threshold, x, y,
-                                         &new_start, &new_end))
-            continue;
+          for (x1 = x; x1 > 0 && row[x1 - 1] > 0.0; x1--);
+          for (x2 = x; x2 + 1 < region->width && row[x2 + 1] > 0.0; x2++);
+
+          for (i = x1; i <= x2; i++)
+            row[i] = -row[i];
 
-          if (y + 1 < gegl_buffer_get_height (src_buffer))
+          if (span.y > 0)
             {
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (y + 1));
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_start));
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_end));
+              ContiguousSpan above = { span.y - 1, x1, x2 };
+
+              g_array_append_val (stack, above);
             }
 
-          if (y - 1 >= 0)
+          if (span.y + 1 < region->height)
             {
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (y - 1));
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_start));
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_end));
+              ContiguousSpan below = { span.y + 1, x1, x2 };
+
+              g_array_append_val (stack, below);
             }
+
+          x = x2;
         }
     }
-  while (! g_queue_is_empty (coord_stack));
 
-  g_queue_free (coord_stack);
+  g_array_free (stack, TRUE);
+}
+
+static void
+contiguous_region_write_mask (ContiguousRegion *region,
+                              GeglBuffer       *mask_buffer)
+{
+  gint band;
+
+  for (band = 0; band < region->n_bands; band++)
+    {
+      gfloat        *diff = region->bands[band];
+      GeglRectangle  rect;
+      gint           n_pixels;
+      gint           i;
+
+      if (! diff)
+        continue;
+
+      gegl_rectangle_set (&rect,
+                          0, band * region->band_height,
+                          region->width,
+                          MIN (region->band_height,
+                               region->height - band * region->band_height));
+
+      n_pixels = rect.width * rect.height;
+
+      /*  selected pixels keep their difference as mask value  */
+      for (i = 0; i < n_pixels; i++)
+        diff[i] = diff[i] < 0.0 ? -diff[i] : 0.0;
+
+      gegl_buffer_set (mask_buffer, &rect, 0, babl_format ("Y float"),
+                       diff, GEGL_AUTO_ROWSTRIDE);
+
+      g_free (diff);
+      region->bands[band] = NULL;
+    }
 }
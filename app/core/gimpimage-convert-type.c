@@ -144,6 +144,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimpcontainer.h"
 #include "gimpdrawable.h"
 #include "gimperror.h"
@@ -187,6 +188,12 @@
 #define G_SCALE 24              /*  scale G (a*) distances by this much  */
 #define B_SCALE 26              /*  and B (b*) by this much              */
 
+/* layers are processed in bands of rows, which are split among the
+   threads; the progress is updated between the bands.
+*/
+#define QUANTIZE_BAND_HEIGHT 64
+#define QUANTIZE_MIN_AREA    (64 * 64)
+
 
 typedef struct _Color Color;
 typedef struct _QuantizeObj QuantizeObj;
@@ -196,7 +203,8 @@ typedef void (* Pass2_Func)   (QuantizeObj *quantize_obj,
                                GimpLayer   *layer,
                                GeglBuffer  *new_buffer);
 typedef void (* Cleanup_Func) (QuantizeObj *quantize_obj);
-typedef unsigned long ColorFreq;
+/* pointer sized, so the inverse colormap cache can be read atomically */
+typedef gsize ColorFreq;
 typedef ColorFreq *CFHistogram;
 
 typedef enum {AXIS_UNDEF, AXIS_RED, AXIS_BLUE, AXIS_GREEN} axisType;
@@ -307,9 +315,26 @@ ColorFreq* HIST_LIN(ColorFreq *hist_ptr,
 #define BRAT (1.0F)
 #endif
 
+/* set up once by init_lab_fishes(), read-only afterwards */
 static const Babl *rgb_to_lab_fish = NULL;
 static const Babl *lab_to_rgb_fish = NULL;
 
+static void
+init_lab_fishes (void)
+{
+  static gsize fishes_initialized = 0;
+
+  if (g_once_init_enter (&fishes_initialized))
+    {
+      rgb_to_lab_fish = babl_fish (babl_format ("R'G'B' float"),
+                                   babl_format ("CIE Lab float"));
+      lab_to_rgb_fish = babl_fish (babl_format ("CIE Lab float"),
+                                   babl_format ("R'G'B' float"));
+
+      g_once_init_leave (&fishes_initialized, 1);
+    }
+}
+
 static inline
 void rgb_to_unshifted_lin(const unsigned char r,
                           const unsigned char g,
@@ -472,6 +497,14 @@ struct _QuantizeObj
   gboolean want_alpha_dither;
   int      error_freedom;           /* 0=much bleed, 1=controlled bleed */
 
+  guchar   found_cols[MAXNUMCOLORS][3]; /* distinct colors seen so far   */
+  gint     num_found_cols;
+  gboolean needs_quantize;          /* more colors than desired         */
+
+  GimpPalette *custom_palette;      /* for GIMP_CUSTOM_PALETTE          */
+
+  GMutex   cache_mutex;             /* serializes inverse cmap fills    */
+
   GimpProgress *progress;
   gint          nth_layer;
   gint          n_layers;
@@ -508,7 +541,7 @@ static void zero_histogram_rgb      (CFHistogram   histogram);
 static void generate_histogram_gray (CFHistogram   hostogram,
                                      GimpLayer    *layer,
                                      gboolean      alpha_dither);
-static void generate_histogram_rgb  (CFHistogram   histogram,
+static void generate_histogram_rgb  (QuantizeObj  *quantobj,
                                      GimpLayer    *layer,
                                      gint          col_limit,
                                      gboolean      alpha_dither,
@@ -521,6 +554,7 @@ static QuantizeObj * initialize_median_cut (GimpImageBaseType      old_type,
                                             GimpConvertDitherType  dither_type,
                                             GimpConvertPaletteType palette_type,
                                             gboolean               alpha_dither,
+                                            GimpPalette           *custom_palette,
                                             GimpProgress          *progress);
 
 static void          compute_color_lin8    (QuantizeObj           *quantobj,
@@ -529,12 +563,6 @@ static void          compute_color_lin8    (QuantizeObj           *quantobj,
                                             const int              icolor);
 
 
-static guchar    found_cols[MAXNUMCOLORS][3];
-static gint      num_found_cols;
-static gboolean  needs_quantize;
-
-static GimpPalette *theCustomPalette = NULL;
-
 
 /**********************************************************/
 typedef struct
@@ -780,8 +808,6 @@ gimp_image_convert_type (GimpImage               *image,
         }
     }
 
-  theCustomPalette = custom_palette;
-
   gimp_set_busy (image->gimp);
 
   all_layers = gimp_image_get_layer_list (image);
@@ -821,10 +847,7 @@ gimp_image_convert_type (GimpImage               *image,
     {
       gint i;
 
-      rgb_to_lab_fish = babl_fish (babl_format ("R'G'B' float"),
-                                   babl_format ("CIE Lab float"));
-      lab_to_rgb_fish = babl_fish (babl_format ("CIE Lab float"),
-                                   babl_format ("R'G'B' float"));
+      init_lab_fishes ();
 
       /* fprintf(stderr, " TO INDEXED(%d) ", num_cols); */
 
@@ -840,7 +863,7 @@ gimp_image_convert_type (GimpImage               *image,
 
       quantobj = initialize_median_cut (old_type, num_cols, dither,
                                         palette_type, alpha_dither,
-                                        progress);
+                                        custom_palette, progress);
 
       if (palette_type == GIMP_MAKE_PALETTE)
         {
@@ -853,8 +876,8 @@ gimp_image_convert_type (GimpImage               *image,
            *  the image than the user actually asked for.  In that
            *  case, we don't need to quantize or color-dither.
            */
-          needs_quantize = FALSE;
-          num_found_cols = 0;
+          quantobj->needs_quantize = FALSE;
+          quantobj->num_found_cols = 0;
 
           /*  Build the histogram  */
           for (list = all_layers, nth_layer = 0;
@@ -867,7 +890,7 @@ gimp_image_convert_type (GimpImage               *image,
                 generate_histogram_gray (quantobj->histogram,
                                          layer, alpha_dither);
               else
-                generate_histogram_rgb (quantobj->histogram,
+                generate_histogram_rgb (quantobj,
                                         layer, num_cols, alpha_dither,
                                         progress, nth_layer, n_layers);
 
@@ -882,8 +905,8 @@ gimp_image_convert_type (GimpImage               *image,
         gimp_progress_set_text (progress,
                                 _("Converting to indexed colors (stage 2)"));
 
-      if (old_type == GIMP_RGB &&
-          ! needs_quantize     &&
+      if (old_type == GIMP_RGB           &&
+          ! quantobj->needs_quantize &&
           palette_type == GIMP_MAKE_PALETTE)
         {
           /* If this is an RGB image, and the user wanted a custom-built
@@ -896,21 +919,25 @@ gimp_image_convert_type (GimpImage               *image,
            *  no-dither remapper.
            */
 
-          quantobj->delete_func (quantobj);
+          QuantizeObj *old_quantobj = quantobj;
+
           quantobj = initialize_median_cut (old_type, num_cols,
                                             GIMP_NODESTRUCT_DITHER,
                                             palette_type,
                                             alpha_dither,
+                                            custom_palette,
                                             progress);
           /* We can skip the first pass (palette creation) */
 
-          quantobj->actual_number_of_colors = num_found_cols;
-          for (i = 0; i < num_found_cols; i++)
+          quantobj->actual_number_of_colors = old_quantobj->num_found_cols;
+          for (i = 0; i < old_quantobj->num_found_cols; i++)
             {
-              quantobj->cmap[i].red = found_cols[i][0];
-              quantobj->cmap[i].green = found_cols[i][1];
-              quantobj->cmap[i].blue = found_cols[i][2];
+              quantobj->cmap[i].red   = old_quantobj->found_cols[i][0];
+              quantobj->cmap[i].green = old_quantobj->found_cols[i][1];
+              quantobj->cmap[i].blue  = old_quantobj->found_cols[i][2];
             }
+
+          old_quantobj->delete_func (old_quantobj);
         }
       else
         {
@@ -1179,210 +1206,269 @@ generate_histogram_gray (CFHistogram  histogram,
 }
 
 
+typedef struct
+{
+  QuantizeObj *quantobj;
+  GeglBuffer  *buffer;
+  const Babl  *format;
+  gint         bpp;
+  gboolean     has_alpha;
+  gboolean     alpha_dither;
+  gint         col_limit;
+  gint         offsetx;
+  gint         offsety;
+
+  GMutex       mutex;
+  GSList      *idle_histograms; /* histograms no area is filling right now */
+  GSList      *histograms;      /* all histograms besides quantobj's own   */
+} HistogramData;
+
 static void
-generate_histogram_rgb (CFHistogram   histogram,
-                        GimpLayer    *layer,
-                        gint          col_limit,
-                        gboolean      alpha_dither,
-                        GimpProgress *progress,
-                        gint          nth_layer,
-                        gint          n_layers)
+generate_histogram_rgb_area (const GeglRectangle *area,
+                             gpointer             user_data)
 {
+  HistogramData      *data     = user_data;
+  QuantizeObj        *quantobj = data->quantobj;
   GeglBufferIterator *iter;
-  const Babl         *format;
   GeglRectangle      *roi;
-  ColorFreq          *colfreq;
-  gint                nfc_iter;
-  gint                row, col, coledge;
-  gint                offsetx, offsety;
-  glong               layer_size;
-  glong               total_size = 0;
-  gint                count      = 0;
-  gint                bpp;
-  gboolean            has_alpha;
+  CFHistogram         histogram;
+  guchar              found_cols[MAXNUMCOLORS][3];
+  gint                num_found_cols = 0;
+  gboolean            needs_quantize;
+  gint                i;
 
-  format = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
+  /*  fill whichever histogram is idle, so each thread has its own  */
+  g_mutex_lock (&data->mutex);
 
-  g_return_if_fail (format == babl_format ("R'G'B' u8") ||
-                    format == babl_format ("R'G'B'A u8"));
+  if (data->idle_histograms)
+    {
+      histogram = data->idle_histograms->data;
 
-  bpp       = babl_format_get_bytes_per_pixel (format);
-  has_alpha = babl_format_has_alpha (format);
+      data->idle_histograms = g_slist_delete_link (data->idle_histograms,
+                                                   data->idle_histograms);
+    }
+  else
+    {
+      histogram = g_new0 (ColorFreq,
+                          HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS);
 
-  gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
+      data->histograms = g_slist_prepend (data->histograms, histogram);
+    }
 
-  layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
-                gimp_item_get_height (GIMP_ITEM (layer)));
+  needs_quantize = quantobj->needs_quantize;
 
-  /*  g_printerr ("col_limit = %d, nfc = %d\n", col_limit, num_found_cols); */
+  g_mutex_unlock (&data->mutex);
 
-  iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, format,
+  iter = gegl_buffer_iterator_new (data->buffer, area, 0, data->format,
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   roi = &iter->roi[0];
 
-  if (progress)
-    gimp_progress_set_value (progress, 0.0);
-
   while (gegl_buffer_iterator_next (iter))
     {
-      const guchar *data   = iter->data[0];
+      const guchar *src    = iter->data[0];
       gint          length = iter->length;
+      gint          col, coledge, row;
 
-      total_size += length;
+      /* if alpha-dithering, we need to be deterministic w.r.t. offsets */
+      col     = roi->x + data->offsetx;
+      coledge = col + roi->width;
+      row     = roi->y + data->offsety;
 
-      /* g_printerr (" [%d,%d - %d,%d]", srcPR.x, src_roi->y, offsetx, offsety); */
-
-      if (needs_quantize)
+      while (length--)
         {
-          if (alpha_dither)
-            {
-              /* if alpha-dithering,
-                 we need to be deterministic w.r.t. offsets */
-
-              col = roi->x + offsetx;
-              coledge = col + roi->width;
-              row = roi->y + offsety;
+          gboolean transparent = FALSE;
 
-              while (length--)
+          if (data->has_alpha)
+            {
+              if (data->alpha_dither)
                 {
-                  gboolean transparent = FALSE;
-
-                  if (has_alpha &&
-                      data[ALPHA] <
+                  if (src[ALPHA] <
                       DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK])
                     transparent = TRUE;
+                }
+              else
+                {
+                  if (src[ALPHA] <= 127)
+                    transparent = TRUE;
+                }
+            }
+
+          if (! transparent)
+            {
+              ColorFreq *colfreq = HIST_RGB (histogram,
+                                             src[RED],
+                                             src[GREEN],
+                                             src[BLUE]);
+              (*colfreq)++;
 
-                  if (! transparent)
+              if (! needs_quantize)
+                {
+                  for (i = 0; i < num_found_cols; i++)
                     {
-                      colfreq = HIST_RGB (histogram,
-                                          data[RED],
-                                          data[GREEN],
-                                          data[BLUE]);
-                      (*colfreq)++;
+                      if ((src[RED]   == found_cols[i][0]) &&
+                          (src[GREEN] == found_cols[i][1]) &&
+                          (src[BLUE]  == found_cols[i][2]))
+                        goto already_found;
                     }
 
-                  col++;
-                  if (col == coledge)
+                  /* Color was not in the table of
+                   * existing colors
+                   */
+
+                  if (num_found_cols == data->col_limit)
                     {
-                      col = roi->x + offsetx;
-                      row++;
+                      /* There are more colors in the image
+                       *  than were allowed.  We switch to plain
+                       *  histogram calculation with a view to
+                       *  quantizing at a later stage.
+                       */
+                      needs_quantize = TRUE;
                     }
+                  else
+                    {
+                      /* Remember the new color we just found.
+                       */
+                      found_cols[num_found_cols][0] = src[RED];
+                      found_cols[num_found_cols][1] = src[GREEN];
+                      found_cols[num_found_cols][2] = src[BLUE];
 
-                  data += bpp;
+                      num_found_cols++;
+                    }
                 }
             }
-          else
-            {
-              while (length--)
-                {
-                  if ((has_alpha && ((data[ALPHA] > 127)))
-                      || (!has_alpha))
-                    {
-                      colfreq = HIST_RGB (histogram,
-                                          data[RED],
-                                          data[GREEN],
-                                          data[BLUE]);
-                      (*colfreq)++;
-                    }
 
-                  data += bpp;
-                }
+        already_found:
+
+          col++;
+          if (col == coledge)
+            {
+              col = roi->x + data->offsetx;
+              row++;
             }
+
+          src += data->bpp;
+        }
+    }
+
+  /*  add the colors this area found to the ones found so far  */
+  g_mutex_lock (&data->mutex);
+
+  if (needs_quantize)
+    quantobj->needs_quantize = TRUE;
+
+  for (i = 0; i < num_found_cols && ! quantobj->needs_quantize; i++)
+    {
+      gint j;
+
+      for (j = 0; j < quantobj->num_found_cols; j++)
+        {
+          if ((found_cols[i][0] == quantobj->found_cols[j][0]) &&
+              (found_cols[i][1] == quantobj->found_cols[j][1]) &&
+              (found_cols[i][2] == quantobj->found_cols[j][2]))
+            break;
+        }
+
+      if (j < quantobj->num_found_cols)
+        continue;
+
+      if (quantobj->num_found_cols == data->col_limit)
+        {
+          quantobj->needs_quantize = TRUE;
         }
       else
         {
-          /* if alpha-dithering, we need to be deterministic w.r.t. offsets */
-          col = roi->x + offsetx;
-          coledge = col + roi->width;
-          row = roi->y + offsety;
+          quantobj->found_cols[j][0] = found_cols[i][0];
+          quantobj->found_cols[j][1] = found_cols[i][1];
+          quantobj->found_cols[j][2] = found_cols[i][2];
 
-          while (length--)
-            {
-	      gboolean transparent = FALSE;
-
-	      if (has_alpha)
-	        {
-		  if (alpha_dither)
-		    {
-		      if (data[ALPHA] <
-                          DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK])
-		  	transparent = TRUE;
-		    }
-		  else
-		    {
-		      if (data[ALPHA] <= 127)
-			transparent = TRUE;
-		    }
-		}
-
-	      if (! transparent)
-                {
-                  colfreq = HIST_RGB (histogram,
-                                      data[RED],
-                                      data[GREEN],
-                                      data[BLUE]);
-                  (*colfreq)++;
+          quantobj->num_found_cols++;
+        }
+    }
 
-                  if (!needs_quantize)
-                    {
-                      for (nfc_iter = 0;
-                           nfc_iter < num_found_cols;
-                           nfc_iter++)
-                        {
-                          if ((data[RED]   == found_cols[nfc_iter][0]) &&
-                              (data[GREEN] == found_cols[nfc_iter][1]) &&
-                              (data[BLUE]  == found_cols[nfc_iter][2]))
-                            goto already_found;
-                        }
+  data->idle_histograms = g_slist_prepend (data->idle_histograms, histogram);
 
-                      /* Color was not in the table of
-                       * existing colors
-                       */
+  g_mutex_unlock (&data->mutex);
+}
 
-                      num_found_cols++;
+static void
+generate_histogram_rgb (QuantizeObj  *quantobj,
+                        GimpLayer    *layer,
+                        gint          col_limit,
+                        gboolean      alpha_dither,
+                        GimpProgress *progress,
+                        gint          nth_layer,
+                        gint          n_layers)
+{
+  HistogramData        data;
+  const GeglRectangle *extent;
+  GeglRectangle        band;
+  gint                 band_height;
+  GSList              *list;
 
-                      if (num_found_cols > col_limit)
-                        {
-                          /* There are more colors in the image
-                           *  than were allowed.  We switch to plain
-                           *  histogram calculation with a view to
-                           *  quantizing at a later stage.
-                           */
-                          needs_quantize = TRUE;
-                          /* g_print ("\nmax colors exceeded - needs quantize.\n");*/
-                          goto already_found;
-                        }
-                      else
-                        {
-                          /* Remember the new color we just found.
-                           */
-                          found_cols[num_found_cols-1][0] = data[RED];
-                          found_cols[num_found_cols-1][1] = data[GREEN];
-                          found_cols[num_found_cols-1][2] = data[BLUE];
-                        }
-                    }
-                }
-            already_found:
+  data.format = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
 
-              col++;
-              if (col == coledge)
-                {
-                  col = roi->x + offsetx;
-                  row++;
-                }
+  g_return_if_fail (data.format == babl_format ("R'G'B' u8") ||
+                    data.format == babl_format ("R'G'B'A u8"));
 
-              data += bpp;
-            }
-        }
+  data.quantobj     = quantobj;
+  data.buffer       = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  data.bpp          = babl_format_get_bytes_per_pixel (data.format);
+  data.has_alpha    = babl_format_has_alpha (data.format);
+  data.alpha_dither = alpha_dither;
+  data.col_limit    = MIN (col_limit, MAXNUMCOLORS);
 
-      if (progress && (count % 16 == 0))
+  gimp_item_get_offset (GIMP_ITEM (layer), &data.offsetx, &data.offsety);
+
+  /*  the first area fills quantobj's histogram directly, concurrent
+   *  ones get their own, which are added to it at the end
+   */
+  g_mutex_init (&data.mutex);
+  data.idle_histograms = g_slist_prepend (NULL, quantobj->histogram);
+  data.histograms      = NULL;
+
+  if (progress)
+    gimp_progress_set_value (progress, 0.0);
+
+  extent = gegl_buffer_get_extent (data.buffer);
+
+  band_height = QUANTIZE_BAND_HEIGHT * gimp_parallel_get_n_threads ();
+
+  band = *extent;
+
+  for (band.y = extent->y;
+       band.y < extent->y + extent->height;
+       band.y += band_height)
+    {
+      band.height = MIN (band_height, extent->y + extent->height - band.y);
+
+      gimp_parallel_distribute_area (&band, QUANTIZE_MIN_AREA,
+                                     generate_histogram_rgb_area, &data);
+
+      if (progress)
         gimp_progress_set_value (progress,
-                                 (nth_layer + ((gdouble) total_size)/
-                                  layer_size) / (gdouble) n_layers);
+                                 (nth_layer +
+                                  (gdouble) (band.y + band.height -
+                                             extent->y) /
+                                  extent->height) / (gdouble) n_layers);
     }
 
-/*  g_print ("O: col_limit = %d, nfc = %d\n", col_limit, num_found_cols);*/
+  for (list = data.histograms; list; list = g_slist_next (list))
+    {
+      CFHistogram histogram = list->data;
+      gint        i;
+
+      for (i = 0; i < HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS; i++)
+        quantobj->histogram[i] += histogram[i];
+
+      g_free (histogram);
+    }
+
+  g_slist_free (data.histograms);
+  g_slist_free (data.idle_histograms);
+  g_mutex_clear (&data.mutex);
+
+/*  g_print ("O: col_limit = %d, nfc = %d\n", col_limit,
+             quantobj->num_found_cols);*/
 }
 
 
@@ -2689,7 +2775,7 @@ fill_inverse_cmap_gray (QuantizeObj *quantobj,
     }
 
   if (i >= 0)
-    histogram[pixel] = mindisti + 1;
+    g_atomic_pointer_set (&histogram[pixel], mindisti + 1);
 }
 
 
@@ -2745,7 +2831,8 @@ fill_inverse_cmap_rgb (QuantizeObj *quantobj,
         {
           for (iB = 0; iB < BOX_B_ELEMS; iB++)
             {
-              *HIST_LIN (histogram, R + iR, G + iG, B + iB) = (*cptr++) + 1;
+              g_atomic_pointer_set (HIST_LIN (histogram, R + iR, G + iG, B + iB),
+                                    (*cptr++) + 1);
             }
         }
     }
@@ -2803,10 +2890,11 @@ custompal_pass1 (QuantizeObj *quantobj)
   GList *list;
 
   /* fprintf(stderr,
-             "custompal_pass1: using (theCustomPalette %s) from (file %s)\n",
-             theCustomPalette->name, theCustomPalette->filename); */
+             "custompal_pass1: using (custom_palette %s) from (file %s)\n",
+             quantobj->custom_palette->name,
+             quantobj->custom_palette->filename); */
 
-  for (i = 0, list = gimp_palette_get_colors (theCustomPalette);
+  for (i = 0, list = gimp_palette_get_colors (quantobj->custom_palette);
        list;
        i++, list = g_list_next (list))
     {
@@ -2827,41 +2915,192 @@ custompal_pass1 (QuantizeObj *quantobj)
  * Map some rows of pixels to the output colormapped representation.
  */
 
+typedef struct _RemapData RemapData;
+
+typedef void (* RemapAreaFunc) (RemapData           *data,
+                                const GeglRectangle *area,
+                                gulong              *index_used_count);
+
+struct _RemapData
+{
+  QuantizeObj   *quantobj;
+  GeglBuffer    *src_buffer;
+  GeglBuffer    *dest_buffer;
+  gint           src_bpp;
+  gint           dest_bpp;
+  gboolean       has_alpha;
+  gint           red_pix;
+  gint           green_pix;
+  gint           blue_pix;
+  gint           alpha_pix;
+  gint           offsetx;
+  gint           offsety;
+  RemapAreaFunc  func;
+  GMutex         mutex;
+};
+
 static void
-median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
-                                 GimpLayer   *layer,
-                                 GeglBuffer  *new_buffer)
+remap_area (const GeglRectangle *area,
+            gpointer             user_data)
 {
-  GeglBufferIterator *iter;
-  CFHistogram         histogram = quantobj->histogram;
-  ColorFreq          *cachep;
-  const Babl         *src_format;
-  const Babl         *dest_format;
-  GeglRectangle      *src_roi;
-  gint                src_bpp;
-  gint                dest_bpp;
-  gint                has_alpha;
-  gulong             *index_used_count = quantobj->index_used_count;
-  gboolean            alpha_dither     = quantobj->want_alpha_dither;
-  gint                offsetx, offsety;
+  RemapData *data                  = user_data;
+  gulong     index_used_count[256] = { 0, };
+  gint       i;
 
-  gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
+  data->func (data, area, index_used_count);
 
-  src_format  = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
-  dest_format = gegl_buffer_get_format (new_buffer);
+  g_mutex_lock (&data->mutex);
 
-  src_bpp  = babl_format_get_bytes_per_pixel (src_format);
-  dest_bpp = babl_format_get_bytes_per_pixel (dest_format);
+  for (i = 0; i < 256; i++)
+    data->quantobj->index_used_count[i] += index_used_count[i];
 
-  has_alpha = babl_format_has_alpha (src_format);
+  g_mutex_unlock (&data->mutex);
+}
 
-  iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+/*  Runs @func on areas of @layer in parallel.  Only for the
+ *  non-dithering remappers, the results of which don't depend on the
+ *  order the pixels are visited in.
+ */
+static void
+remap_layer (QuantizeObj   *quantobj,
+             GimpLayer     *layer,
+             GeglBuffer    *new_buffer,
+             RemapAreaFunc  func)
+{
+  RemapData            data;
+  const Babl          *src_format;
+  const GeglRectangle *extent;
+  GeglRectangle        band;
+  gint                 band_height;
+  gint                 tile_height;
+
+  src_format = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
+
+  data.quantobj    = quantobj;
+  data.src_buffer  = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  data.dest_buffer = new_buffer;
+  data.src_bpp     = babl_format_get_bytes_per_pixel (src_format);
+  data.dest_bpp    = babl_format_get_bytes_per_pixel (gegl_buffer_get_format (new_buffer));
+  data.has_alpha   = babl_format_has_alpha (src_format);
+  data.red_pix     = RED;
+  data.green_pix   = GREEN;
+  data.blue_pix    = BLUE;
+  data.alpha_pix   = ALPHA;
+  data.func        = func;
+
+  /*  In the case of web/mono palettes, we actually force
+   *   grayscale drawables through the rgb pass2 functions
+   */
+  if (gimp_drawable_is_gray (GIMP_DRAWABLE (layer)))
+    {
+      data.red_pix = data.green_pix = data.blue_pix = GRAY;
+      data.alpha_pix = ALPHA_G;
+    }
+
+  gimp_item_get_offset (GIMP_ITEM (layer), &data.offsetx, &data.offsety);
+
+  g_mutex_init (&data.mutex);
+
+  extent = gegl_buffer_get_extent (data.src_buffer);
+
+  /*  split at the new buffer's tile rows, so threads never write to
+   *  the same tile
+   */
+  g_object_get (new_buffer, "tile-height", &tile_height, NULL);
+
+  band_height = QUANTIZE_BAND_HEIGHT * gimp_parallel_get_n_threads ();
+
+  band = *extent;
+
+  for (band.y = extent->y;
+       band.y < extent->y + extent->height;
+       band.y += band_height)
+    {
+      band.height = MIN (band_height, extent->y + extent->height - band.y);
+
+      gimp_parallel_distribute_tiles (&band, tile_height, QUANTIZE_MIN_AREA,
+                                      remap_area, &data);
+
+      if (quantobj->progress)
+        gimp_progress_set_value (quantobj->progress,
+                                 (quantobj->nth_layer +
+                                  (gdouble) (band.y + band.height -
+                                             extent->y) /
+                                  extent->height) /
+                                 (gdouble) quantobj->n_layers);
+    }
+
+  g_mutex_clear (&data.mutex);
+}
+
+/*  The inverse colormap cache is shared by all threads.  A cell only
+ *  ever changes from 0 to its final value.  It is filled with the lock
+ *  held, and the fill functions store it atomically, so an atomic read
+ *  outside of the lock sees either 0 or the final value.
+ */
+static inline ColorFreq *
+lookup_inverse_cmap_gray (QuantizeObj *quantobj,
+                          gint         pixel)
+{
+  ColorFreq *cachep = &quantobj->histogram[pixel];
+
+  if (g_atomic_pointer_get (cachep) == 0)
+    {
+      g_mutex_lock (&quantobj->cache_mutex);
+
+      if (*cachep == 0)
+        fill_inverse_cmap_gray (quantobj, quantobj->histogram, pixel);
+
+      g_mutex_unlock (&quantobj->cache_mutex);
+    }
+
+  return cachep;
+}
+
+static inline ColorFreq *
+lookup_inverse_cmap_rgb (QuantizeObj *quantobj,
+                         gint         R,
+                         gint         G,
+                         gint         B)
+{
+  ColorFreq *cachep = HIST_LIN (quantobj->histogram, R, G, B);
+
+  if (g_atomic_pointer_get (cachep) == 0)
+    {
+      g_mutex_lock (&quantobj->cache_mutex);
+
+      if (*cachep == 0)
+        fill_inverse_cmap_rgb (quantobj, quantobj->histogram, R, G, B);
+
+      g_mutex_unlock (&quantobj->cache_mutex);
+    }
+
+  return cachep;
+}
+
+static void
+median_cut_pass2_no_dither_gray_area (RemapData           *data,
+                                      const GeglRectangle *area,
+                                      gulong              *index_used_count)
+{
+  QuantizeObj        *quantobj     = data->quantobj;
+  GeglBufferIterator *iter;
+  GeglRectangle      *src_roi;
+  ColorFreq          *cachep;
+  gint                src_bpp      = data->src_bpp;
+  gint                dest_bpp     = data->dest_bpp;
+  gboolean            has_alpha    = data->has_alpha;
+  gboolean            alpha_dither = quantobj->want_alpha_dither;
+  gint                offsetx      = data->offsetx;
+  gint                offsety      = data->offsety;
+
+  iter = gegl_buffer_iterator_new (data->src_buffer,
+                                   area, 0, NULL,
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
-  gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+  gegl_buffer_iterator_add (iter, data->dest_buffer,
+                            area, 0, NULL,
                             GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
@@ -2876,15 +3115,11 @@ median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
 
           for (col = 0; col < src_roi->width; col++)
             {
-              gint pixel;
-
-              /* get pixel value and index into the cache */
-              pixel = src[GRAY];
-              cachep = &histogram[pixel];
-              /* If we have not seen this color before, find nearest colormap entry */
-              /* and update the cache */
-              if (*cachep == 0)
-                fill_inverse_cmap_gray (quantobj, histogram, pixel);
+              /* get pixel value and index into the cache.  If we have
+               * not seen this color before, find nearest colormap
+               * entry and update the cache
+               */
+              cachep = lookup_inverse_cmap_gray (quantobj, src[GRAY]);
 
               if (has_alpha)
                 {
@@ -2927,6 +3162,15 @@ median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
     }
 }
 
+static void
+median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
+                                 GimpLayer   *layer,
+                                 GeglBuffer  *new_buffer)
+{
+  remap_layer (quantobj, layer, new_buffer,
+               median_cut_pass2_no_dither_gray_area);
+}
+
 static void
 median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
                                     GimpLayer   *layer,
@@ -3092,72 +3336,41 @@ median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
 }
 
 static void
-median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
-                                GimpLayer   *layer,
-                                GeglBuffer  *new_buffer)
+median_cut_pass2_no_dither_rgb_area (RemapData           *data,
+                                     const GeglRectangle *area,
+                                     gulong              *index_used_count)
 {
+  QuantizeObj        *quantobj     = data->quantobj;
   GeglBufferIterator *iter;
-  CFHistogram         histogram = quantobj->histogram;
-  ColorFreq          *cachep;
-  const Babl         *src_format;
-  const Babl         *dest_format;
   GeglRectangle      *src_roi;
-  gint                src_bpp;
-  gint                dest_bpp;
-  gint                has_alpha;
+  ColorFreq          *cachep;
+  gint                src_bpp      = data->src_bpp;
+  gint                dest_bpp     = data->dest_bpp;
+  gboolean            has_alpha    = data->has_alpha;
   gint                R, G, B;
-  gint                red_pix          = RED;
-  gint                green_pix        = GREEN;
-  gint                blue_pix         = BLUE;
-  gint                alpha_pix        = ALPHA;
-  gboolean            alpha_dither     = quantobj->want_alpha_dither;
-  gint                offsetx, offsety;
-  gulong             *index_used_count = quantobj->index_used_count;
-  glong               total_size       = 0;
-  glong               layer_size;
-  gint                count            = 0;
-  gint                nth_layer        = quantobj->nth_layer;
-  gint                n_layers         = quantobj->n_layers;
-
-  gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
-
-  src_format  = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
-  dest_format = gegl_buffer_get_format (new_buffer);
-
-  src_bpp  = babl_format_get_bytes_per_pixel (src_format);
-  dest_bpp = babl_format_get_bytes_per_pixel (dest_format);
-
-  has_alpha = babl_format_has_alpha (src_format);
-
-  /*  In the case of web/mono palettes, we actually force
-   *   grayscale drawables through the rgb pass2 functions
-   */
-  if (gimp_drawable_is_gray (GIMP_DRAWABLE (layer)))
-    {
-      red_pix = green_pix = blue_pix = GRAY;
-      alpha_pix = ALPHA_G;
-    }
+  gint                red_pix      = data->red_pix;
+  gint                green_pix    = data->green_pix;
+  gint                blue_pix     = data->blue_pix;
+  gint                alpha_pix    = data->alpha_pix;
+  gboolean            alpha_dither = quantobj->want_alpha_dither;
+  gint                offsetx      = data->offsetx;
+  gint                offsety      = data->offsety;
 
-  iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+  iter = gegl_buffer_iterator_new (data->src_buffer,
+                                   area, 0, NULL,
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
-  gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+  gegl_buffer_iterator_add (iter, data->dest_buffer,
+                            area, 0, NULL,
                             GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
-  layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
-                gimp_item_get_height (GIMP_ITEM (layer)));
-
   while (gegl_buffer_iterator_next (iter))
     {
       const guchar *src  = iter->data[0];
       guchar       *dest = iter->data[1];
       gint          row;
 
-      total_size += src_roi->height * src_roi->width;
-
       for (row = 0; row < src_roi->height; row++)
         {
           gint col;
@@ -3195,11 +3408,9 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
               /* get pixel value and index into the cache */
               rgb_to_lin (src[red_pix], src[green_pix], src[blue_pix],
                           &R, &G, &B);
-              cachep = HIST_LIN(histogram,R,G,B);
               /* If we have not seen this color before, find nearest
                  colormap entry and update the cache */
-              if (*cachep == 0)
-                fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+              cachep = lookup_inverse_cmap_rgb (quantobj, R, G, B);
 
               /* Now emit the colormap index for this cell, barfbarf */
               index_used_count[dest[INDEXED] = *cachep - 1]++;
@@ -3210,14 +3421,18 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
               dest += dest_bpp;
             }
         }
-
-      if (quantobj->progress && (count % 16 == 0))
-         gimp_progress_set_value (quantobj->progress,
-                                  (nth_layer + ((gdouble) total_size)/
-                                   layer_size) / (gdouble) n_layers);
     }
 }
 
+static void
+median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
+                                GimpLayer   *layer,
+                                GeglBuffer  *new_buffer)
+{
+  remap_layer (quantobj, layer, new_buffer,
+               median_cut_pass2_no_dither_rgb_area);
+}
+
 static void
 median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
                                    GimpLayer   *layer,
@@ -3450,45 +3665,35 @@ median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
 }
 
 static void
-median_cut_pass2_nodestruct_dither_rgb (QuantizeObj *quantobj,
-                                        GimpLayer   *layer,
-                                        GeglBuffer  *new_buffer)
+median_cut_pass2_nodestruct_dither_rgb_area (RemapData           *data,
+                                             const GeglRectangle *area,
+                                             gulong              *index_used_count)
 {
+  QuantizeObj        *quantobj     = data->quantobj;
   GeglBufferIterator *iter;
-  const Babl         *src_format;
-  const Babl         *dest_format;
   GeglRectangle      *src_roi;
-  gint                src_bpp;
-  gint                dest_bpp;
-  gint                has_alpha;
+  gint                src_bpp      = data->src_bpp;
+  gint                dest_bpp     = data->dest_bpp;
+  gboolean            has_alpha    = data->has_alpha;
   gboolean            alpha_dither = quantobj->want_alpha_dither;
-  gint                red_pix      = RED;
-  gint                green_pix    = GREEN;
-  gint                blue_pix     = BLUE;
-  gint                alpha_pix    = ALPHA;
+  gint                red_pix      = data->red_pix;
+  gint                green_pix    = data->green_pix;
+  gint                blue_pix     = data->blue_pix;
+  gint                alpha_pix    = data->alpha_pix;
   gint                lastindex    = 0;
   gint                lastred      = -1;
   gint                lastgreen    = -1;
   gint                lastblue     = -1;
-  gint                offsetx, offsety;
+  gint                offsetx      = data->offsetx;
+  gint                offsety      = data->offsety;
 
-  gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
-
-  src_format  = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
-  dest_format = gegl_buffer_get_format (new_buffer);
-
-  src_bpp  = babl_format_get_bytes_per_pixel (src_format);
-  dest_bpp = babl_format_get_bytes_per_pixel (dest_format);
-
-  has_alpha = babl_format_has_alpha (src_format);
-
-  iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+  iter = gegl_buffer_iterator_new (data->src_buffer,
+                                   area, 0, NULL,
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
-  gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+  gegl_buffer_iterator_add (iter, data->dest_buffer,
+                            area, 0, NULL,
                             GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
@@ -3573,6 +3778,15 @@ median_cut_pass2_nodestruct_dither_rgb (QuantizeObj *quantobj,
     }
 }
 
+static void
+median_cut_pass2_nodestruct_dither_rgb (QuantizeObj *quantobj,
+                                        GimpLayer   *layer,
+                                        GeglBuffer  *new_buffer)
+{
+  remap_layer (quantobj, layer, new_buffer,
+               median_cut_pass2_nodestruct_dither_rgb_area);
+}
+
 
 /*
  * Initialize the error-limiting transfer function (lookup table).
@@ -4293,6 +4507,8 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
 static void
 delete_median_cut (QuantizeObj *quantobj)
 {
+  g_mutex_clear (&quantobj->cache_mutex);
+
   g_free (quantobj->histogram);
   g_free (quantobj);
 }
@@ -4334,12 +4550,15 @@ initialize_median_cut (GimpImageBaseType       type,
                        GimpConvertDitherType   dither_type,
                        GimpConvertPaletteType  palette_type,
                        gboolean                want_alpha_dither,
+                       GimpPalette            *custom_palette,
                        GimpProgress           *progress)
 {
   QuantizeObj *quantobj;
 
-  /* Initialize the data structures */
-  quantobj = g_new (QuantizeObj, 1);
+  /* Initialize the data structures.  Everything a conversion needs
+   * lives here, so several conversions can run at the same time.
+   */
+  quantobj = g_new0 (QuantizeObj, 1);
 
   if (type == GIMP_GRAY && palette_type == GIMP_MAKE_PALETTE)
     quantobj->histogram = g_new (ColorFreq, 256);
@@ -4349,8 +4568,13 @@ initialize_median_cut (GimpImageBaseType       type,
 
   quantobj->desired_number_of_colors = num_colors;
   quantobj->want_alpha_dither        = want_alpha_dither;
+  quantobj->num_found_cols           = 0;
+  quantobj->needs_quantize           = FALSE;
+  quantobj->custom_palette           = custom_palette;
   quantobj->progress                 = progress;
 
+  g_mutex_init (&quantobj->cache_mutex);
+
   switch (type)
     {
     case GIMP_GRAY:
@@ -4364,7 +4588,7 @@ initialize_median_cut (GimpImageBaseType       type,
           break;
         case GIMP_CUSTOM_PALETTE:
           quantobj->first_pass = custompal_pass1;
-          needs_quantize=TRUE;
+          quantobj->needs_quantize = TRUE;
           break;
         case GIMP_MONO_PALETTE:
         default:
@@ -4436,11 +4660,11 @@ initialize_median_cut (GimpImageBaseType       type,
           break;
         case GIMP_WEB_PALETTE:
           quantobj->first_pass = webpal_pass1;
-          needs_quantize=TRUE;
+          quantobj->needs_quantize = TRUE;
           break;
         case GIMP_CUSTOM_PALETTE:
           quantobj->first_pass = custompal_pass1;
-          needs_quantize=TRUE;
+          quantobj->needs_quantize = TRUE;
           break;
         case GIMP_MONO_PALETTE:
         default:
@@ -24,6 +24,8 @@
 
 #include "config/gimpcoreconfig.h"
 
+#include "gimp-log.h"
+
 #include "gimp.h"
 #include "gimp-utils.h"
 #include "gimpdrawableundo.h"
@@ -340,6 +342,10 @@ gimp_image_undo_group_end (GimpImage *image)
     {
       private->pushing_undo_group = GIMP_UNDO_GROUP_NONE;
 
+      /*  the group was accounted for when it was still empty  */
+      gimp_undo_stack_update_size (private->undo_stack,
+                                   gimp_undo_stack_peek (private->undo_stack));
+
       /* Do it here, since undo_push doesn't emit this event while in
        * the middle of a group
        */
@@ -546,31 +552,27 @@ gimp_image_undo_free_space (GimpImage *image)
   container = private->undo_stack->undos;
 
   min_undo_levels = image->gimp->config->levels_of_undo;
-  max_undo_levels = 1024; /* FIXME */
+  max_undo_levels = image->gimp->config->max_levels_of_undo;
   undo_size       = image->gimp->config->undo_size;
 
-#ifdef DEBUG_IMAGE_UNDO
-  g_printerr ("undo_steps: %d    undo_bytes: %ld\n",
-              gimp_container_get_n_children (container),
-              (glong) gimp_object_get_memsize (GIMP_OBJECT (container), NULL));
-#endif
+  GIMP_LOG (UNDO, "undo_steps: %d    undo_bytes: %" G_GINT64_FORMAT,
+            gimp_container_get_n_children (container),
+            gimp_undo_stack_get_size (private->undo_stack));
 
   /*  keep at least min_undo_levels undo steps  */
   if (gimp_container_get_n_children (container) <= min_undo_levels)
     return;
 
-  while ((gimp_object_get_memsize (GIMP_OBJECT (container), NULL) > undo_size) ||
+  while ((gimp_undo_stack_get_size (private->undo_stack) > undo_size) ||
          (gimp_container_get_n_children (container) > max_undo_levels))
     {
       GimpUndo *freed = gimp_undo_stack_free_bottom (private->undo_stack,
                                                      GIMP_UNDO_MODE_UNDO);
 
-#ifdef DEBUG_IMAGE_UNDO
-      g_printerr ("freed one step: undo_steps: %d    undo_bytes: %ld\n",
-                  gimp_container_get_n_children (container),
-                  (glong) gimp_object_get_memsize (GIMP_OBJECT (container),
-                                                   NULL));
-#endif
+      GIMP_LOG (UNDO, "freed one step: undo_steps: %d    undo_bytes: %"
+                G_GINT64_FORMAT,
+                gimp_container_get_n_children (container),
+                gimp_undo_stack_get_size (private->undo_stack));
 
       gimp_image_undo_event (image, GIMP_UNDO_EVENT_UNDO_EXPIRED, freed);
 
@@ -587,11 +589,9 @@ gimp_image_undo_free_redo (GimpImage *image)
   GimpImagePrivate *private   = GIMP_IMAGE_GET_PRIVATE (image);
   GimpContainer    *container = private->redo_stack->undos;
 
-#ifdef DEBUG_IMAGE_UNDO
-  g_printerr ("redo_steps: %d    redo_bytes: %ld\n",
-              gimp_container_get_n_children (container),
-              (glong) gimp_object_get_memsize (GIMP_OBJECT (container), NULL));
-#endif
+  GIMP_LOG (UNDO, "redo_steps: %d    redo_bytes: %" G_GINT64_FORMAT,
+            gimp_container_get_n_children (container),
+            gimp_undo_stack_get_size (private->redo_stack));
 
   if (gimp_container_is_empty (container))
     return;
@@ -601,12 +601,10 @@ gimp_image_undo_free_redo (GimpImage *image)
       GimpUndo *freed = gimp_undo_stack_free_bottom (private->redo_stack,
                                                      GIMP_UNDO_MODE_REDO);
 
-#ifdef DEBUG_IMAGE_UNDO
-      g_printerr ("freed one step: redo_steps: %d    redo_bytes: %ld\n",
-                  gimp_container_get_n_children (container),
-                  (glong )gimp_object_get_memsize (GIMP_OBJECT (container),
-                                                   NULL));
-#endif
+      GIMP_LOG (UNDO, "freed one step: redo_steps: %d    redo_bytes: %"
+                G_GINT64_FORMAT,
+                gimp_container_get_n_children (container),
+                gimp_undo_stack_get_size (private->redo_stack));
 
       gimp_image_undo_event (image, GIMP_UNDO_EVENT_REDO_EXPIRED, freed);
 
@@ -217,6 +217,45 @@ gimp_progress_get_window_id (GimpProgress *progress)
   return 0;
 }
 
+/**
+ * gimp_progress_grab:
+ * @progress: a #GimpProgress
+ *
+ * Makes @progress's cancel button the only part of the user interface
+ * that receives input, so the main loop can be iterated while an
+ * operation works on an image, without letting the user change it.
+ *
+ * Return value: %TRUE if @progress grabbed the input, and
+ *               gimp_progress_ungrab() must be called.
+ **/
+gboolean
+gimp_progress_grab (GimpProgress *progress)
+{
+  GimpProgressInterface *progress_iface;
+
+  g_return_val_if_fail (GIMP_IS_PROGRESS (progress), FALSE);
+
+  progress_iface = GIMP_PROGRESS_GET_INTERFACE (progress);
+
+  if (progress_iface->grab)
+    return progress_iface->grab (progress);
+
+  return FALSE;
+}
+
+void
+gimp_progress_ungrab (GimpProgress *progress)
+{
+  GimpProgressInterface *progress_iface;
+
+  g_return_if_fail (GIMP_IS_PROGRESS (progress));
+
+  progress_iface = GIMP_PROGRESS_GET_INTERFACE (progress);
+
+  if (progress_iface->ungrab)
+    progress_iface->ungrab (progress);
+}
+
 gboolean
 gimp_progress_message (GimpProgress        *progress,
                        Gimp                *gimp,
@@ -50,6 +50,9 @@ struct _GimpProgressInterface
 
   guint32        (* get_window_id) (GimpProgress        *progress);
 
+  gboolean       (* grab)          (GimpProgress        *progress);
+  void           (* ungrab)        (GimpProgress        *progress);
+
   gboolean       (* message)       (GimpProgress        *progress,
                                     Gimp                *gimp,
                                     GimpMessageSeverity  severity,
@@ -78,6 +81,9 @@ void           gimp_progress_pulse              (GimpProgress        *progress);
 
 guint32        gimp_progress_get_window_id      (GimpProgress        *progress);
 
+gboolean       gimp_progress_grab               (GimpProgress        *progress);
+void           gimp_progress_ungrab             (GimpProgress        *progress);
+
 gboolean       gimp_progress_message            (GimpProgress        *progress,
                                                  Gimp                *gimp,
                                                  GimpMessageSeverity  severity,
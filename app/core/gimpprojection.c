@@ -21,6 +21,8 @@
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
+#include "libgimpmath/gimpmath.h"
+
 #include "core-types.h"
 
 #include "gegl/gimp-babl.h"
@@ -28,6 +30,7 @@
 #include "gegl/gimptilehandlerprojection.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimp-utils.h"
 #include "gimparea.h"
 #include "gimpimage.h"
@@ -49,6 +52,12 @@
 /*  how much time, in seconds, do we allow chunk rendering to take  */
 #define GIMP_PROJECTION_CHUNK_TIME 0.01
 
+/*  the mipmap levels are validated in tiles of this size  */
+#define GIMP_PROJECTION_LEVEL_TILE_SIZE 128
+
+/*  the smallest mipmap level is at least this large  */
+#define GIMP_PROJECTION_LEVEL_MIN_SIZE  64
+
 
 enum
 {
@@ -63,6 +72,25 @@ enum
 };
 
 
+struct _GimpProjectionLevel
+{
+  GeglBuffer *buffer;
+  gint        width;
+  gint        height;
+  gint        n_tiles_x;
+  gint        n_tiles_y;
+  gboolean   *valid;
+};
+
+typedef struct
+{
+  GimpProjectionLevel *level;
+  GeglBuffer          *src_buffer;
+  const Babl          *format;
+  const gint          *tiles;
+} GimpProjectionLevelRenderData;
+
+
 /*  local function prototypes  */
 
 static void   gimp_projection_pickable_iface_init (GimpPickableInterface  *iface);
@@ -94,6 +122,19 @@ static gdouble     gimp_projection_get_opacity_at        (GimpPickable    *picka
                                                           gint             y);
 
 static void        gimp_projection_free_buffer           (GimpProjection  *proj);
+static GimpProjectionLevel *
+                   gimp_projection_get_level             (GimpProjection  *proj,
+                                                          gint             level);
+static void        gimp_projection_invalidate_levels     (GimpProjection  *proj,
+                                                          const GeglRectangle *area);
+static void        gimp_projection_validate_area         (GimpProjection  *proj,
+                                                          const GeglRectangle *rect);
+static void        gimp_projection_validate_level        (GimpProjection  *proj,
+                                                          gint             level,
+                                                          const GeglRectangle *rect);
+static void        gimp_projection_level_render_tiles    (gsize            offset,
+                                                          gsize            size,
+                                                          gpointer         user_data);
 static void        gimp_projection_add_update_area       (GimpProjection  *proj,
                                                           gint             x,
                                                           gint             y,
@@ -106,6 +147,10 @@ static void        gimp_projection_chunk_render_stop     (GimpProjection  *proj)
 static gboolean    gimp_projection_chunk_render_callback (gpointer         data);
 static void        gimp_projection_chunk_render_init     (GimpProjection  *proj);
 static gboolean    gimp_projection_chunk_render_iteration(GimpProjection  *proj);
+static gboolean    gimp_projection_chunk_render_next_chunk
+                                                         (GimpProjection  *proj,
+                                                          GeglRectangle   *chunk);
+static void        gimp_projection_chunk_render_requeue  (GimpProjection  *proj);
 static gboolean    gimp_projection_chunk_render_next_area(GimpProjection  *proj);
 static void        gimp_projection_paint_area            (GimpProjection  *proj,
                                                           gboolean         now,
@@ -113,6 +158,13 @@ static void        gimp_projection_paint_area            (GimpProjection  *proj,
                                                           gint             y,
                                                           gint             w,
                                                           gint             h);
+static void        gimp_projection_clip_area             (GimpProjection  *proj,
+                                                          GeglRectangle   *area);
+static void        gimp_projection_render_area           (GimpProjection  *proj,
+                                                          const GeglRectangle *area);
+static void        gimp_projection_update_area           (GimpProjection  *proj,
+                                                          gboolean         now,
+                                                          const GeglRectangle *area);
 
 static void        gimp_projection_projectable_invalidate(GimpProjectable *projectable,
                                                           gint             x,
@@ -245,6 +297,19 @@ gimp_projection_get_memsize (GimpObject *object,
 
   memsize += gimp_gegl_buffer_get_memsize (projection->buffer);
 
+  if (projection->levels)
+    {
+      gint i;
+
+      for (i = 0; i < projection->n_levels; i++)
+        {
+          GimpProjectionLevel *level = &projection->levels[i];
+
+          memsize += (gimp_gegl_buffer_get_memsize (level->buffer) +
+                      level->n_tiles_x * level->n_tiles_y * sizeof (gboolean));
+        }
+    }
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -342,6 +407,17 @@ gimp_projection_get_buffer (GimpPickable *pickable)
                                                                  width, height);
       gimp_tile_handler_projection_assign (proj->validate_handler, proj->buffer);
 
+      proj->n_levels = 0;
+
+      while ((MAX (width, height) >> (proj->n_levels + 1)) >=
+             GIMP_PROJECTION_LEVEL_MIN_SIZE)
+        {
+          proj->n_levels++;
+        }
+
+      if (proj->n_levels > 0)
+        proj->levels = g_new0 (GimpProjectionLevel, proj->n_levels);
+
       /*  This used to call gimp_tile_handler_projection_invalidate()
        *  which forced the entire projection to be constructed in one
        *  go for new images, causing a potentially huge delay. Now we
@@ -443,6 +519,96 @@ gimp_projection_finish_draw (GimpProjection *proj)
     }
 }
 
+/**
+ * gimp_projection_set_priority_rect:
+ * @proj: a #GimpProjection
+ * @x:    x of the priority rect, in image coordinates
+ * @y:    y of the priority rect, in image coordinates
+ * @w:    width of the priority rect
+ * @h:    height of the priority rect
+ *
+ * Makes the chunk renderer render the part of the projection that
+ * intersects the given rect, usually the visible part of a display,
+ * before anything else.
+ **/
+void
+gimp_projection_set_priority_rect (GimpProjection *proj,
+                                   gint            x,
+                                   gint            y,
+                                   gint            w,
+                                   gint            h)
+{
+  gint off_x, off_y;
+
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+
+  /*  the chunk renderer works in tile-pyramid coordinates  */
+  gimp_projectable_get_offset (proj->projectable, &off_x, &off_y);
+
+  gegl_rectangle_set (&proj->priority_rect, x - off_x, y - off_y, w, h);
+
+  if (proj->chunk_render.running)
+    gimp_projection_chunk_render_requeue (proj);
+}
+
+/**
+ * gimp_projection_get_buffer_at_scale:
+ * @proj:         a #GimpProjection
+ * @scale:        the scale the projection is going to be rendered at
+ * @rect:         the area that is going to be rendered, in @scale's
+ *                coordinates
+ * @buffer_scale: returns the scale to pass to gegl_buffer_get()
+ *
+ * Returns the mipmap level of the projection that is closest to, but
+ * not smaller than @scale, with the part of it that is needed for
+ * rendering @rect brought up to date. The levels are only updated
+ * where the projection changed since they were last used, so reading
+ * a zoomed-out view doesn't resample the whole projection every time.
+ * The returned part is rendered on the calling thread, so it can be
+ * read from several threads afterwards.
+ *
+ * Return value: the buffer to read @rect from at @buffer_scale.
+ **/
+GeglBuffer *
+gimp_projection_get_buffer_at_scale (GimpProjection      *proj,
+                                     gdouble              scale,
+                                     const GeglRectangle *rect,
+                                     gdouble             *buffer_scale)
+{
+  GeglBuffer    *buffer;
+  GeglRectangle  level_rect;
+  gint           level = 0;
+
+  g_return_val_if_fail (GIMP_IS_PROJECTION (proj), NULL);
+  g_return_val_if_fail (scale > 0.0, NULL);
+  g_return_val_if_fail (rect != NULL, NULL);
+  g_return_val_if_fail (buffer_scale != NULL, NULL);
+
+  buffer = gimp_projection_get_buffer (GIMP_PICKABLE (proj));
+
+  while (level < proj->n_levels && scale * (2 << level) <= 1.0)
+    level++;
+
+  *buffer_scale = scale * (1 << level);
+
+  /*  the level's pixels the rect is sampled from, plus a margin for
+   *  the interpolation
+   */
+  level_rect.x      = floor (rect->x / *buffer_scale) - 1;
+  level_rect.y      = floor (rect->y / *buffer_scale) - 1;
+  level_rect.width  = ceil ((rect->x + rect->width)  / *buffer_scale) + 1 -
+                      level_rect.x;
+  level_rect.height = ceil ((rect->y + rect->height) / *buffer_scale) + 1 -
+                      level_rect.y;
+
+  gimp_projection_validate_level (proj, level, &level_rect);
+
+  if (level == 0)
+    return buffer;
+
+  return gimp_projection_get_level (proj, level)->buffer;
+}
+
 
 /*  private functions  */
 
@@ -463,6 +629,273 @@ gimp_projection_free_buffer (GimpProjection  *proj)
       g_object_unref (proj->validate_handler);
       proj->validate_handler = NULL;
     }
+
+  if (proj->levels)
+    {
+      gint i;
+
+      for (i = 0; i < proj->n_levels; i++)
+        {
+          if (proj->levels[i].buffer)
+            g_object_unref (proj->levels[i].buffer);
+
+          g_free (proj->levels[i].valid);
+        }
+
+      g_free (proj->levels);
+      proj->levels = NULL;
+    }
+
+  proj->n_levels = 0;
+}
+
+static GimpProjectionLevel *
+gimp_projection_get_level (GimpProjection *proj,
+                           gint            level)
+{
+  GimpProjectionLevel *l = &proj->levels[level - 1];
+
+  if (! l->buffer)
+    {
+      gint width;
+      gint height;
+
+      gimp_projectable_get_size (proj->projectable, &width, &height);
+
+      l->width  = (width  + (1 << level) - 1) >> level;
+      l->height = (height + (1 << level) - 1) >> level;
+
+      l->buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, l->width, l->height),
+                                   gegl_buffer_get_format (proj->buffer));
+
+      l->n_tiles_x = (l->width  + GIMP_PROJECTION_LEVEL_TILE_SIZE - 1) /
+                     GIMP_PROJECTION_LEVEL_TILE_SIZE;
+      l->n_tiles_y = (l->height + GIMP_PROJECTION_LEVEL_TILE_SIZE - 1) /
+                     GIMP_PROJECTION_LEVEL_TILE_SIZE;
+
+      l->valid = g_new0 (gboolean, l->n_tiles_x * l->n_tiles_y);
+    }
+
+  return l;
+}
+
+/*  marks the tiles of all mipmap levels that are computed from @area,
+ *  in tile-pyramid coordinates, as invalid
+ */
+static void
+gimp_projection_invalidate_levels (GimpProjection      *proj,
+                                   const GeglRectangle *area)
+{
+  gint i;
+
+  if (! proj->levels || area->width <= 0 || area->height <= 0)
+    return;
+
+  for (i = 0; i < proj->n_levels; i++)
+    {
+      GimpProjectionLevel *l     = &proj->levels[i];
+      gint                 level = i + 1;
+      gint                 tile_x1, tile_y1;
+      gint                 tile_x2, tile_y2;
+      gint                 tile_x, tile_y;
+
+      if (! l->buffer)
+        continue;
+
+      tile_x1 = (area->x >> level) / GIMP_PROJECTION_LEVEL_TILE_SIZE;
+      tile_y1 = (area->y >> level) / GIMP_PROJECTION_LEVEL_TILE_SIZE;
+      tile_x2 = ((area->x + area->width  - 1) >> level) /
+                GIMP_PROJECTION_LEVEL_TILE_SIZE + 1;
+      tile_y2 = ((area->y + area->height - 1) >> level) /
+                GIMP_PROJECTION_LEVEL_TILE_SIZE + 1;
+
+      tile_x2 = MIN (tile_x2, l->n_tiles_x);
+      tile_y2 = MIN (tile_y2, l->n_tiles_y);
+
+      for (tile_y = tile_y1; tile_y < tile_y2; tile_y++)
+        for (tile_x = tile_x1; tile_x < tile_x2; tile_x++)
+          l->valid[tile_y * l->n_tiles_x + tile_x] = FALSE;
+    }
+}
+
+/*  renders the dirty parts of the projection's tiles that intersect
+ *  @rect, on the calling thread, by fetching them once
+ */
+static void
+gimp_projection_validate_area (GimpProjection      *proj,
+                               const GeglRectangle *rect)
+{
+  GeglBufferIterator *iter;
+  GeglRectangle       area;
+
+  if (! proj->validate_handler)
+    return;
+
+  if (! gegl_rectangle_intersect (&area, rect,
+                                  gegl_buffer_get_extent (proj->buffer)))
+    return;
+
+  iter = gegl_buffer_iterator_new (proj->buffer, &area, 0,
+                                   gegl_buffer_get_format (proj->buffer),
+                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    ;
+}
+
+/*  brings the tiles of @level that intersect @rect up to date, by
+ *  scaling down the ones of the level below, which are validated
+ *  first.  Level 0 is the projection itself, which is rendered here
+ *  rather than by the workers reading it.
+ */
+static void
+gimp_projection_validate_level (GimpProjection      *proj,
+                                gint                 level,
+                                const GeglRectangle *rect)
+{
+  GimpProjectionLevel           *l;
+  GimpProjectionLevelRenderData  data;
+  GeglRectangle                  area;
+  GeglRectangle                  src_area;
+  gint                          *tiles;
+  gint                           n_tiles = 0;
+  gint                           tile_x1, tile_y1;
+  gint                           tile_x2, tile_y2;
+  gint                           tile_x, tile_y;
+  gint                           dirty_x1 = G_MAXINT, dirty_y1 = G_MAXINT;
+  gint                           dirty_x2 = 0,        dirty_y2 = 0;
+
+  if (level == 0)
+    {
+      gimp_projection_validate_area (proj, rect);
+      return;
+    }
+
+  l = gimp_projection_get_level (proj, level);
+
+  if (! gegl_rectangle_intersect (&area, rect,
+                                  GEGL_RECTANGLE (0, 0, l->width, l->height)))
+    return;
+
+  tile_x1 = area.x / GIMP_PROJECTION_LEVEL_TILE_SIZE;
+  tile_y1 = area.y / GIMP_PROJECTION_LEVEL_TILE_SIZE;
+  tile_x2 = (area.x + area.width  - 1) / GIMP_PROJECTION_LEVEL_TILE_SIZE + 1;
+  tile_y2 = (area.y + area.height - 1) / GIMP_PROJECTION_LEVEL_TILE_SIZE + 1;
+
+  tiles = g_new (gint, (tile_x2 - tile_x1) * (tile_y2 - tile_y1));
+
+  for (tile_y = tile_y1; tile_y < tile_y2; tile_y++)
+    for (tile_x = tile_x1; tile_x < tile_x2; tile_x++)
+      {
+        gint i = tile_y * l->n_tiles_x + tile_x;
+
+        if (! l->valid[i])
+          {
+            tiles[n_tiles++] = i;
+
+            dirty_x1 = MIN (dirty_x1, tile_x);
+            dirty_y1 = MIN (dirty_y1, tile_y);
+            dirty_x2 = MAX (dirty_x2, tile_x + 1);
+            dirty_y2 = MAX (dirty_y2, tile_y + 1);
+          }
+      }
+
+  if (n_tiles == 0)
+    {
+      g_free (tiles);
+      return;
+    }
+
+  /*  the dirty tiles are computed from this part of the level below  */
+  gegl_rectangle_set (&src_area,
+                      2 * dirty_x1 * GIMP_PROJECTION_LEVEL_TILE_SIZE,
+                      2 * dirty_y1 * GIMP_PROJECTION_LEVEL_TILE_SIZE,
+                      2 * (dirty_x2 - dirty_x1) * GIMP_PROJECTION_LEVEL_TILE_SIZE,
+                      2 * (dirty_y2 - dirty_y1) * GIMP_PROJECTION_LEVEL_TILE_SIZE);
+
+  gimp_projection_validate_level (proj, level - 1, &src_area);
+
+  for (tile_x = 0; tile_x < n_tiles; tile_x++)
+    l->valid[tiles[tile_x]] = TRUE;
+
+  data.level      = l;
+  data.src_buffer = level == 1 ? proj->buffer :
+                                 gimp_projection_get_level (proj,
+                                                            level - 1)->buffer;
+  data.tiles      = tiles;
+
+  /*  average premultiplied pixels, in the projection's TRC  */
+  if (gimp_babl_format_get_linear (gegl_buffer_get_format (proj->buffer)))
+    data.format = babl_format ("RaGaBaA float");
+  else
+    data.format = babl_format ("R'aG'aB'aA float");
+
+  gimp_parallel_distribute_range (n_tiles, 1,
+                                  gimp_projection_level_render_tiles, &data);
+
+  g_free (tiles);
+}
+
+static void
+gimp_projection_level_render_tiles (gsize    offset,
+                                    gsize    size,
+                                    gpointer user_data)
+{
+  GimpProjectionLevelRenderData *data = user_data;
+  GimpProjectionLevel           *l    = data->level;
+  gfloat                        *src;
+  gfloat                        *dest;
+  gsize                          i;
+
+  src  = g_new (gfloat, 4 * 4 * GIMP_PROJECTION_LEVEL_TILE_SIZE *
+                                GIMP_PROJECTION_LEVEL_TILE_SIZE);
+  dest = g_new (gfloat, 4 * GIMP_PROJECTION_LEVEL_TILE_SIZE *
+                            GIMP_PROJECTION_LEVEL_TILE_SIZE);
+
+  for (i = offset; i < offset + size; i++)
+    {
+      gint          tile_x = data->tiles[i] % l->n_tiles_x;
+      gint          tile_y = data->tiles[i] / l->n_tiles_x;
+      GeglRectangle rect;
+      gint          x, y, k;
+
+      gegl_rectangle_intersect (&rect,
+                                GEGL_RECTANGLE (tile_x * GIMP_PROJECTION_LEVEL_TILE_SIZE,
+                                                tile_y * GIMP_PROJECTION_LEVEL_TILE_SIZE,
+                                                GIMP_PROJECTION_LEVEL_TILE_SIZE,
+                                                GIMP_PROJECTION_LEVEL_TILE_SIZE),
+                                GEGL_RECTANGLE (0, 0, l->width, l->height));
+
+      /*  an odd-sized level below is extended by its edge pixels  */
+      gegl_buffer_get (data->src_buffer,
+                       GEGL_RECTANGLE (2 * rect.x,     2 * rect.y,
+                                       2 * rect.width, 2 * rect.height),
+                       1.0, data->format, src,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+
+      for (y = 0; y < rect.height; y++)
+        {
+          const gfloat *s0 = src + 2 * y * 2 * rect.width * 4;
+          const gfloat *s1 = s0 + 2 * rect.width * 4;
+          gfloat       *d  = dest + y * rect.width * 4;
+
+          for (x = 0; x < rect.width; x++)
+            {
+              for (k = 0; k < 4; k++)
+                d[k] = (s0[k] + s0[4 + k] + s1[k] + s1[4 + k]) * 0.25f;
+
+              s0 += 8;
+              s1 += 8;
+              d  += 4;
+            }
+        }
+
+      gegl_buffer_set (l->buffer, &rect, 0, data->format, dest,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (src);
+  g_free (dest);
 }
 
 static void
@@ -619,18 +1052,7 @@ gimp_projection_chunk_render_init (GimpProjection *proj)
    */
   if (proj->chunk_render.running)
     {
-      GimpArea *area =
-        gimp_area_new (proj->chunk_render.base_x,
-                       proj->chunk_render.y,
-                       proj->chunk_render.base_x + proj->chunk_render.width,
-                       proj->chunk_render.y + (proj->chunk_render.height -
-                                               (proj->chunk_render.y -
-                                                proj->chunk_render.base_y)));
-
-      proj->chunk_render.update_areas =
-        gimp_area_list_process (proj->chunk_render.update_areas, area);
-
-      gimp_projection_chunk_render_next_area (proj);
+      gimp_projection_chunk_render_requeue (proj);
     }
   else
     {
@@ -652,78 +1074,188 @@ gimp_projection_chunk_render_init (GimpProjection *proj)
  * them into bite-sized chunks which are chewed on in an idle
  * function. This greatly improves responsiveness for many GIMP
  * operations.  -- Adam
+ *
+ * The graph is only ever evaluated on the main thread, one chunk at
+ * a time; GEGL spreads the work of each chunk over its own threads.
  */
 static gboolean
 gimp_projection_chunk_render_iteration (GimpProjection *proj)
 {
-  gint workx = proj->chunk_render.x;
-  gint worky = proj->chunk_render.y;
-  gint workw = GIMP_PROJECTION_CHUNK_WIDTH;
-  gint workh = GIMP_PROJECTION_CHUNK_HEIGHT;
+  GeglRectangle chunk;
 
-  if (workx + workw > proj->chunk_render.base_x + proj->chunk_render.width)
+  if (gimp_projection_chunk_render_next_chunk (proj, &chunk) &&
+      chunk.width > 0 && chunk.height > 0)
     {
-      workw = proj->chunk_render.base_x + proj->chunk_render.width - workx;
+      gimp_projection_paint_area (proj, TRUE /* sic! */,
+                                  chunk.x, chunk.y,
+                                  chunk.width, chunk.height);
     }
 
-  if (worky + workh > proj->chunk_render.base_y + proj->chunk_render.height)
+  if (proj->chunk_render.y >=
+      proj->chunk_render.base_y + proj->chunk_render.height &&
+      ! proj->chunk_render.update_areas)
     {
-      workh = proj->chunk_render.base_y + proj->chunk_render.height - worky;
+      if (proj->invalidate_preview)
+        {
+          /* invalidate the preview here since it is constructed from
+           * the projection
+           */
+          proj->invalidate_preview = FALSE;
+
+          gimp_projectable_invalidate_preview (proj->projectable);
+        }
+
+      /* FINISHED */
+      return FALSE;
     }
 
-  gimp_projection_paint_area (proj, TRUE /* sic! */,
-                              workx, worky, workw, workh);
+  /* Still work to do. */
+  return TRUE;
+}
 
-  proj->chunk_render.x += GIMP_PROJECTION_CHUNK_WIDTH;
+static gboolean
+gimp_projection_chunk_render_next_chunk (GimpProjection *proj,
+                                         GeglRectangle  *chunk)
+{
+  GimpProjectionChunkRender *render = &proj->chunk_render;
+  gint                       x2;
+  gint                       y2;
 
-  if (proj->chunk_render.x >=
-      proj->chunk_render.base_x + proj->chunk_render.width)
+  while (render->y >= render->base_y + render->height)
     {
-      proj->chunk_render.x = proj->chunk_render.base_x;
-      proj->chunk_render.y += GIMP_PROJECTION_CHUNK_HEIGHT;
+      if (! gimp_projection_chunk_render_next_area (proj))
+        return FALSE;
+    }
 
-      if (proj->chunk_render.y >=
-          proj->chunk_render.base_y + proj->chunk_render.height)
-        {
-          if (! gimp_projection_chunk_render_next_area (proj))
-            {
-              if (proj->invalidate_preview)
-                {
-                  /* invalidate the preview here since it is constructed from
-                   * the projection
-                   */
-                  proj->invalidate_preview = FALSE;
+  /*  align the chunks to a fixed grid, so that consecutive chunks
+   *  don't share tiles of the projection buffer
+   */
+  x2 = (render->x / GIMP_PROJECTION_CHUNK_WIDTH  + 1) *
+       GIMP_PROJECTION_CHUNK_WIDTH;
+  y2 = (render->y / GIMP_PROJECTION_CHUNK_HEIGHT + 1) *
+       GIMP_PROJECTION_CHUNK_HEIGHT;
 
-                  gimp_projectable_invalidate_preview (proj->projectable);
-                }
+  x2 = MIN (x2, render->base_x + render->width);
+  y2 = MIN (y2, render->base_y + render->height);
 
-              /* FINISHED */
-              return FALSE;
-            }
-        }
+  gegl_rectangle_set (chunk,
+                      render->x, render->y,
+                      MAX (x2 - render->x, 0), y2 - render->y);
+
+  render->x = x2;
+
+  if (render->x >= render->base_x + render->width)
+    {
+      render->x = render->base_x;
+      render->y = y2;
     }
 
-  /* Still work to do. */
+  gimp_projection_clip_area (proj, chunk);
+
   return TRUE;
 }
 
+static void
+gimp_projection_chunk_render_requeue (GimpProjection *proj)
+{
+  GimpProjectionChunkRender *render = &proj->chunk_render;
+
+  /*  merge the remainder of the current area with the update_areas
+   *  list, and start over with the next unrendered area in the list
+   */
+  if (render->y < render->base_y + render->height)
+    {
+      GimpArea *area = gimp_area_new (render->base_x,
+                                      render->y,
+                                      render->base_x + render->width,
+                                      render->base_y + render->height);
+
+      render->update_areas = gimp_area_list_process (render->update_areas,
+                                                     area);
+    }
+
+  gimp_projection_chunk_render_next_area (proj);
+}
+
 static gboolean
 gimp_projection_chunk_render_next_area (GimpProjection *proj)
 {
-  GimpArea *area;
+  GimpProjectionChunkRender *render = &proj->chunk_render;
+  GimpArea                  *area   = NULL;
+  GeglRectangle              rect;
+  GSList                    *list;
 
-  if (! proj->chunk_render.update_areas)
+  if (! render->update_areas)
     return FALSE;
 
-  area = proj->chunk_render.update_areas->data;
+  /*  areas intersecting the priority rect go first, and only their
+   *  intersection with it, the rest is queued again
+   */
+  for (list = render->update_areas; list; list = g_slist_next (list))
+    {
+      GimpArea      *candidate = list->data;
+      GeglRectangle  candidate_rect;
 
-  proj->chunk_render.update_areas =
-    g_slist_remove (proj->chunk_render.update_areas, area);
+      gegl_rectangle_set (&candidate_rect,
+                          candidate->x1,
+                          candidate->y1,
+                          candidate->x2 - candidate->x1,
+                          candidate->y2 - candidate->y1);
 
-  proj->chunk_render.x      = proj->chunk_render.base_x = area->x1;
-  proj->chunk_render.y      = proj->chunk_render.base_y = area->y1;
-  proj->chunk_render.width  = area->x2 - area->x1;
-  proj->chunk_render.height = area->y2 - area->y1;
+      if (gegl_rectangle_intersect (&rect, &candidate_rect,
+                                    &proj->priority_rect))
+        {
+          area = candidate;
+          break;
+        }
+    }
+
+  if (area)
+    {
+      gint x2 = rect.x + rect.width;
+      gint y2 = rect.y + rect.height;
+
+      render->update_areas = g_slist_remove (render->update_areas, area);
+
+      if (area->y1 < rect.y)
+        render->update_areas =
+          g_slist_prepend (render->update_areas,
+                           gimp_area_new (area->x1, area->y1,
+                                          area->x2, rect.y));
+
+      if (y2 < area->y2)
+        render->update_areas =
+          g_slist_prepend (render->update_areas,
+                           gimp_area_new (area->x1, y2,
+                                          area->x2, area->y2));
+
+      if (area->x1 < rect.x)
+        render->update_areas =
+          g_slist_prepend (render->update_areas,
+                           gimp_area_new (area->x1, rect.y,
+                                          rect.x, y2));
+
+      if (x2 < area->x2)
+        render->update_areas =
+          g_slist_prepend (render->update_areas,
+                           gimp_area_new (x2, rect.y,
+                                          area->x2, y2));
+    }
+  else
+    {
+      area = render->update_areas->data;
+
+      render->update_areas = g_slist_remove (render->update_areas, area);
+
+      gegl_rectangle_set (&rect,
+                          area->x1, area->y1,
+                          area->x2 - area->x1, area->y2 - area->y1);
+    }
+
+  render->x      = render->base_x = rect.x;
+  render->y      = render->base_y = rect.y;
+  render->width  = rect.width;
+  render->height = rect.height;
 
   gimp_area_free (area);
 
@@ -738,33 +1270,65 @@ gimp_projection_paint_area (GimpProjection *proj,
                             gint            w,
                             gint            h)
 {
-  gint off_x, off_y;
+  GeglRectangle area = { x, y, w, h };
+
+  gimp_projection_clip_area (proj, &area);
+
+  if (proj->validate_handler)
+    gimp_tile_handler_projection_invalidate (proj->validate_handler,
+                                             area.x, area.y,
+                                             area.width, area.height);
+
+  gimp_projection_invalidate_levels (proj, &area);
+
+  if (now)
+    gimp_projection_render_area (proj, &area);
+
+  gimp_projection_update_area (proj, now, &area);
+}
+
+static void
+gimp_projection_clip_area (GimpProjection *proj,
+                           GeglRectangle  *area)
+{
   gint width, height;
   gint x1, y1, x2, y2;
 
-  gimp_projectable_get_offset (proj->projectable, &off_x, &off_y);
-  gimp_projectable_get_size   (proj->projectable, &width, &height);
+  gimp_projectable_get_size (proj->projectable, &width, &height);
 
   /*  Bounds check  */
-  x1 = CLAMP (x,     0, width);
-  y1 = CLAMP (y,     0, height);
-  x2 = CLAMP (x + w, 0, width);
-  y2 = CLAMP (y + h, 0, height);
+  x1 = CLAMP (area->x,                0, width);
+  y1 = CLAMP (area->y,                0, height);
+  x2 = CLAMP (area->x + area->width,  0, width);
+  y2 = CLAMP (area->y + area->height, 0, height);
+
+  gegl_rectangle_set (area, x1, y1, x2 - x1, y2 - y1);
+}
+
+static void
+gimp_projection_render_area (GimpProjection      *proj,
+                             const GeglRectangle *area)
+{
+  GeglNode *graph = gimp_projectable_get_graph (proj->projectable);
 
   if (proj->validate_handler)
-    gimp_tile_handler_projection_invalidate (proj->validate_handler,
-                                             x1, y1, x2 - x1, y2 - y1);
-  if (now)
-    {
-      GeglNode *graph = gimp_projectable_get_graph (proj->projectable);
+    gimp_tile_handler_projection_undo_invalidate (proj->validate_handler,
+                                                  area->x,
+                                                  area->y,
+                                                  area->width,
+                                                  area->height);
 
-      if (proj->validate_handler)
-        gimp_tile_handler_projection_undo_invalidate (proj->validate_handler,
-                                                      x1, y1, x2 - x1, y2 - y1);
+  gegl_node_blit_buffer (graph, proj->buffer, area);
+}
 
-      gegl_node_blit_buffer (graph, proj->buffer,
-                             GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1));
-    }
+static void
+gimp_projection_update_area (GimpProjection      *proj,
+                             gboolean             now,
+                             const GeglRectangle *area)
+{
+  gint off_x, off_y;
+
+  gimp_projectable_get_offset (proj->projectable, &off_x, &off_y);
 
   /*  add the projectable's offsets because the list of update areas
    *  is in tile-pyramid coordinates, but our external API is always
@@ -772,10 +1336,10 @@ gimp_projection_paint_area (GimpProjection *proj,
    */
   g_signal_emit (proj, projection_signals[UPDATE], 0,
                  now,
-                 x1 + off_x,
-                 y1 + off_y,
-                 x2 - x1,
-                 y2 - y1);
+                 area->x + off_x,
+                 area->y + off_y,
+                 area->width,
+                 area->height);
 }
 
 
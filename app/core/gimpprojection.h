@@ -23,6 +23,7 @@
 
 
 typedef struct _GimpProjectionChunkRender GimpProjectionChunkRender;
+typedef struct _GimpProjectionLevel       GimpProjectionLevel;
 
 struct _GimpProjectionChunkRender
 {
@@ -57,10 +58,17 @@ struct _GimpProjection
   GeglBuffer                *buffer;
   gpointer                   validate_handler;
 
+  GimpProjectionLevel       *levels;  /*  the mipmap pyramid, levels[i]
+                                       *  is scaled down by 2^(i + 1)
+                                       */
+  gint                       n_levels;
+
   GSList                    *update_areas;
   GimpProjectionChunkRender  chunk_render;
   guint                      chunk_render_idle_id;
 
+  GeglRectangle              priority_rect;
+
   gboolean                   invalidate_preview;
 };
 
@@ -85,6 +93,18 @@ void             gimp_projection_flush            (GimpProjection    *proj);
 void             gimp_projection_flush_now        (GimpProjection    *proj);
 void             gimp_projection_finish_draw      (GimpProjection    *proj);
 
+void             gimp_projection_set_priority_rect (GimpProjection   *proj,
+                                                    gint              x,
+                                                    gint              y,
+                                                    gint              w,
+                                                    gint              h);
+
+GeglBuffer     * gimp_projection_get_buffer_at_scale
+                                                   (GimpProjection      *proj,
+                                                    gdouble              scale,
+                                                    const GeglRectangle *rect,
+                                                    gdouble             *buffer_scale);
+
 gint64           gimp_projection_estimate_memsize (GimpImageBaseType  type,
                                                    GimpPrecision      precision,
                                                    gint               width,
@@ -41,6 +41,8 @@ static void           gimp_sub_progress_set_value     (GimpProgress        *prog
 static gdouble        gimp_sub_progress_get_value     (GimpProgress        *progress);
 static void           gimp_sub_progress_pulse         (GimpProgress        *progress);
 static guint32        gimp_sub_progress_get_window_id (GimpProgress        *progress);
+static gboolean       gimp_sub_progress_grab          (GimpProgress        *progress);
+static void           gimp_sub_progress_ungrab        (GimpProgress        *progress);
 static gboolean       gimp_sub_progress_message       (GimpProgress        *progress,
                                                        Gimp                *gimp,
                                                        GimpMessageSeverity  severity,
@@ -96,6 +98,8 @@ gimp_sub_progress_iface_init (GimpProgressInterface *iface)
   iface->get_value     = gimp_sub_progress_get_value;
   iface->pulse         = gimp_sub_progress_pulse;
   iface->get_window_id = gimp_sub_progress_get_window_id;
+  iface->grab          = gimp_sub_progress_grab;
+  iface->ungrab        = gimp_sub_progress_ungrab;
   iface->message       = gimp_sub_progress_message;
 }
 
@@ -174,6 +178,26 @@ gimp_sub_progress_get_window_id (GimpProgress *progress)
   return 0;
 }
 
+static gboolean
+gimp_sub_progress_grab (GimpProgress *progress)
+{
+  GimpSubProgress *sub = GIMP_SUB_PROGRESS (progress);
+
+  if (sub->progress)
+    return gimp_progress_grab (sub->progress);
+
+  return FALSE;
+}
+
+static void
+gimp_sub_progress_ungrab (GimpProgress *progress)
+{
+  GimpSubProgress *sub = GIMP_SUB_PROGRESS (progress);
+
+  if (sub->progress)
+    gimp_progress_ungrab (sub->progress);
+}
+
 static gboolean
 gimp_sub_progress_message (GimpProgress        *progress,
                            Gimp                *gimp,
@@ -61,6 +61,8 @@ struct _GimpUndo
 
   GimpTempBuf      *preview;
   guint             preview_idle_id;
+
+  gint64            stack_memsize;  /* memsize accounted by its undo stack */
 };
 
 struct _GimpUndoClass
@@ -39,6 +39,11 @@ static void    gimp_undo_stack_pop         (GimpUndo            *undo,
 static void    gimp_undo_stack_free        (GimpUndo            *undo,
                                             GimpUndoMode         undo_mode);
 
+static void    gimp_undo_stack_account     (GimpUndoStack       *stack,
+                                            GimpUndo            *undo);
+static void    gimp_undo_stack_unaccount   (GimpUndoStack       *stack,
+                                            GimpUndo            *undo);
+
 
 G_DEFINE_TYPE (GimpUndoStack, gimp_undo_stack, GIMP_TYPE_UNDO)
 
@@ -129,6 +134,29 @@ gimp_undo_stack_free (GimpUndo     *undo,
     }
 
   gimp_container_clear (stack->undos);
+
+  stack->memsize = 0;
+}
+
+static void
+gimp_undo_stack_account (GimpUndoStack *stack,
+                         GimpUndo      *undo)
+{
+  undo->stack_memsize = gimp_object_get_memsize (GIMP_OBJECT (undo), NULL);
+
+  stack->memsize += undo->stack_memsize;
+}
+
+static void
+gimp_undo_stack_unaccount (GimpUndoStack *stack,
+                           GimpUndo      *undo)
+{
+  /*  subtract exactly what was added, an undo's memsize changes when
+   *  it is popped or when the items it references change state
+   */
+  stack->memsize -= undo->stack_memsize;
+
+  undo->stack_memsize = 0;
 }
 
 GimpUndoStack *
@@ -149,6 +177,8 @@ gimp_undo_stack_push_undo (GimpUndoStack *stack,
   g_return_if_fail (GIMP_IS_UNDO (undo));
 
   gimp_container_add (stack->undos, GIMP_OBJECT (undo));
+
+  gimp_undo_stack_account (stack, undo);
 }
 
 GimpUndo *
@@ -166,6 +196,8 @@ gimp_undo_stack_pop_undo (GimpUndoStack       *stack,
   if (undo)
     {
       gimp_container_remove (stack->undos, GIMP_OBJECT (undo));
+      gimp_undo_stack_unaccount (stack, undo);
+
       gimp_undo_pop (undo, undo_mode, accum);
 
       return undo;
@@ -187,6 +219,8 @@ gimp_undo_stack_free_bottom (GimpUndoStack *stack,
   if (undo)
     {
       gimp_container_remove (stack->undos, GIMP_OBJECT (undo));
+      gimp_undo_stack_unaccount (stack, undo);
+
       gimp_undo_free (undo, undo_mode);
 
       return undo;
@@ -210,3 +244,41 @@ gimp_undo_stack_get_depth (GimpUndoStack *stack)
 
   return gimp_container_get_n_children (stack->undos);
 }
+
+/**
+ * gimp_undo_stack_update_size:
+ * @stack: a #GimpUndoStack
+ * @undo:  an undo on @stack
+ *
+ * Re-measures @undo after it changed while being on @stack, such as an
+ * undo group that got its children pushed after it was pushed itself.
+ **/
+void
+gimp_undo_stack_update_size (GimpUndoStack *stack,
+                             GimpUndo      *undo)
+{
+  g_return_if_fail (GIMP_IS_UNDO_STACK (stack));
+  g_return_if_fail (GIMP_IS_UNDO (undo));
+  g_return_if_fail (gimp_container_have (stack->undos, GIMP_OBJECT (undo)));
+
+  gimp_undo_stack_unaccount (stack, undo);
+  gimp_undo_stack_account (stack, undo);
+}
+
+/**
+ * gimp_undo_stack_get_size:
+ * @stack: a #GimpUndoStack
+ *
+ * Returns the memory used by the undos on @stack, without walking
+ * them. The total is updated whenever undos are pushed, popped or
+ * freed.
+ *
+ * Return value: the size of @stack's undos in bytes.
+ **/
+gint64
+gimp_undo_stack_get_size (GimpUndoStack *stack)
+{
+  g_return_val_if_fail (GIMP_IS_UNDO_STACK (stack), 0);
+
+  return stack->memsize;
+}
@@ -43,6 +43,7 @@
 #include "gimpdisplay-handlers.h"
 #include "gimpdisplayshell.h"
 #include "gimpdisplayshell-expose.h"
+#include "gimpdisplayshell-render.h"
 #include "gimpdisplayshell-handlers.h"
 #include "gimpdisplayshell-icon.h"
 #include "gimpdisplayshell-transform.h"
@@ -111,6 +112,8 @@ static void     gimp_display_progress_set_value     (GimpProgress        *progre
 static gdouble  gimp_display_progress_get_value     (GimpProgress        *progress);
 static void     gimp_display_progress_pulse         (GimpProgress        *progress);
 static guint32  gimp_display_progress_get_window_id (GimpProgress        *progress);
+static gboolean gimp_display_progress_grab          (GimpProgress        *progress);
+static void     gimp_display_progress_ungrab        (GimpProgress        *progress);
 static gboolean gimp_display_progress_message       (GimpProgress        *progress,
                                                      Gimp                *gimp,
                                                      GimpMessageSeverity  severity,
@@ -187,6 +190,8 @@ gimp_display_progress_iface_init (GimpProgressInterface *iface)
   iface->get_value     = gimp_display_progress_get_value;
   iface->pulse         = gimp_display_progress_pulse;
   iface->get_window_id = gimp_display_progress_get_window_id;
+  iface->grab          = gimp_display_progress_grab;
+  iface->ungrab        = gimp_display_progress_ungrab;
   iface->message       = gimp_display_progress_message;
 }
 
@@ -359,6 +364,28 @@ gimp_display_progress_get_window_id (GimpProgress *progress)
   return 0;
 }
 
+static gboolean
+gimp_display_progress_grab (GimpProgress *progress)
+{
+  GimpDisplay        *display = GIMP_DISPLAY (progress);
+  GimpDisplayPrivate *private = GIMP_DISPLAY_GET_PRIVATE (display);
+
+  if (private->shell)
+    return gimp_progress_grab (GIMP_PROGRESS (private->shell));
+
+  return FALSE;
+}
+
+static void
+gimp_display_progress_ungrab (GimpProgress *progress)
+{
+  GimpDisplay        *display = GIMP_DISPLAY (progress);
+  GimpDisplayPrivate *private = GIMP_DISPLAY_GET_PRIVATE (display);
+
+  if (private->shell)
+    gimp_progress_ungrab (GIMP_PROGRESS (private->shell));
+}
+
 static gboolean
 gimp_display_progress_message (GimpProgress        *progress,
                                Gimp                *gimp,
@@ -901,5 +928,7 @@ gimp_display_paint_area (GimpDisplay *display,
   x2 = ceil (x2_f + 0.5);
   y2 = ceil (y2_f + 0.5);
 
+  gimp_display_shell_render_invalidate_area (shell, x1, y1, x2 - x1, y2 - y1);
+
   gimp_display_shell_expose_area (shell, x1, y1, x2 - x1, y2 - y1);
 }
@@ -171,10 +171,10 @@ gimp_display_shell_draw_image (GimpDisplayShell *shell,
     }
   else
     {
-      x1 = x;
-      y1 = y;
-      x2 = x + w;
-      y2 = y + h;
+      /*  unrotated displays are drawn from the render cache  */
+      gimp_display_shell_render_cached (shell, cr, x, y, w, h);
+
+      return;
     }
 
   /*  display the image in RENDER_BUF_WIDTH x RENDER_BUF_HEIGHT
@@ -109,6 +109,24 @@ gimp_display_shell_progress_get_window_id (GimpProgress *progress)
   return 0;
 }
 
+static gboolean
+gimp_display_shell_progress_grab (GimpProgress *progress)
+{
+  GimpDisplayShell *shell     = GIMP_DISPLAY_SHELL (progress);
+  GimpStatusbar    *statusbar = gimp_display_shell_get_statusbar (shell);
+
+  return gimp_progress_grab (GIMP_PROGRESS (statusbar));
+}
+
+static void
+gimp_display_shell_progress_ungrab (GimpProgress *progress)
+{
+  GimpDisplayShell *shell     = GIMP_DISPLAY_SHELL (progress);
+  GimpStatusbar    *statusbar = gimp_display_shell_get_statusbar (shell);
+
+  gimp_progress_ungrab (GIMP_PROGRESS (statusbar));
+}
+
 static gboolean
 gimp_display_shell_progress_message (GimpProgress        *progress,
                                      Gimp                *gimp,
@@ -156,5 +174,7 @@ gimp_display_shell_progress_iface_init (GimpProgressInterface *iface)
   iface->get_value     = gimp_display_shell_progress_get_value;
   iface->pulse         = gimp_display_shell_progress_pulse;
   iface->get_window_id = gimp_display_shell_progress_get_window_id;
+  iface->grab          = gimp_display_shell_progress_grab;
+  iface->ungrab        = gimp_display_shell_progress_ungrab;
   iface->message       = gimp_display_shell_progress_message;
 }
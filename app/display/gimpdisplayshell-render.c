@@ -29,6 +29,7 @@
 
 #include "gegl/gimp-gegl-utils.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimpdrawable.h"
 #include "core/gimpimage.h"
 #include "core/gimppickable.h"
@@ -37,13 +38,88 @@
 
 #include "gimpdisplay.h"
 #include "gimpdisplayshell.h"
+#include "gimpdisplayshell-expose.h"
 #include "gimpdisplayshell-transform.h"
 #include "gimpdisplayshell-filter.h"
 #include "gimpdisplayshell-render.h"
+#include "gimpdisplayshell-scale.h"
 #include "gimpdisplayshell-scroll.h"
 #include "gimpdisplayxfer.h"
 
 
+/*  just a bit less than the projection's chunk renderer  */
+#define GIMP_DISPLAY_RENDER_IDLE_PRIORITY (G_PRIORITY_HIGH_IDLE + 20 + 2)
+
+/*  how much time, in seconds, do we allow one idle iteration to take  */
+#define GIMP_DISPLAY_RENDER_CHUNK_TIME    0.01
+
+/*  exposed areas up to this size are rendered right away  */
+#define GIMP_DISPLAY_RENDER_SYNC_AREA     (GIMP_DISPLAY_RENDER_BUF_WIDTH * \
+                                           GIMP_DISPLAY_RENDER_BUF_HEIGHT)
+
+/*  the first, fast pass renders at this fraction of the resolution  */
+#define GIMP_DISPLAY_RENDER_COARSE_FACTOR 4
+
+
+typedef struct
+{
+  GeglRectangle  dest;          /*  in the render cache's device pixels  */
+  gint           origin_x;      /*  dest's origin in the scaled image    */
+  gint           origin_y;
+  GeglRectangle  src_rect;      /*  in buffer_scale's coordinates        */
+  GeglBuffer    *buffer;
+  gdouble        buffer_scale;
+  guchar        *data;          /*  src_rect's pixels, or NULL if they are
+                                 *  read right into the render cache
+                                 */
+} RenderChunk;
+
+typedef struct
+{
+  RenderChunk *chunks;
+  gint         n_chunks;
+  gint         factor;
+  const Babl  *format;
+  guchar      *cache_data;
+  gint         cache_stride;
+} RenderChunksData;
+
+
+static gint     gimp_display_shell_render_get_window_scale
+                                                       (GimpDisplayShell *shell);
+static void     gimp_display_shell_render_mask         (GimpDisplayShell *shell,
+                                                        const GeglRectangle *rect,
+                                                        gint              window_scale);
+static void     gimp_display_shell_render_expand       (const RenderChunk *chunk,
+                                                        gint              factor,
+                                                        const guchar     *src,
+                                                        gint              src_stride,
+                                                        guchar           *cache_data,
+                                                        gint              cache_stride);
+static void     gimp_display_shell_render_chunks_func  (gint              i,
+                                                        gint              n,
+                                                        gpointer          user_data);
+static void     gimp_display_shell_render_chunks       (GimpDisplayShell *shell,
+                                                        const cairo_rectangle_int_t *rects,
+                                                        gint              n_rects,
+                                                        gint              factor);
+static void     gimp_display_shell_render_region       (GimpDisplayShell *shell,
+                                                        cairo_region_t   *region);
+static gint     gimp_display_shell_render_next_chunks  (cairo_region_t   *region,
+                                                        cairo_rectangle_int_t *rects,
+                                                        gint              max_rects);
+static gboolean gimp_display_shell_render_idle         (gpointer          data);
+static void     gimp_display_shell_render_update_cache (GimpDisplayShell *shell,
+                                                        gint              window_scale);
+static void     gimp_display_shell_render_move_cache   (GimpDisplayShell *shell,
+                                                        gint              window_scale,
+                                                        gint              dx,
+                                                        gint              dy);
+
+
+/*  renders the given area synchronously, this is used for rotated
+ *  displays, which don't use the render cache
+ */
 void
 gimp_display_shell_render (GimpDisplayShell *shell,
                            cairo_t          *cr,
@@ -56,6 +132,7 @@ gimp_display_shell_render (GimpDisplayShell *shell,
   GimpProjection  *projection;
   GeglBuffer      *buffer;
   gdouble          window_scale = 1.0;
+  gdouble          buffer_scale;
   gint             viewport_offset_x;
   gint             viewport_offset_y;
   gint             viewport_width;
@@ -63,8 +140,6 @@ gimp_display_shell_render (GimpDisplayShell *shell,
   cairo_surface_t *xfer;
   gint             xfer_src_x;
   gint             xfer_src_y;
-  gint             mask_src_x = 0;
-  gint             mask_src_y = 0;
   gint             stride;
   guchar          *data;
 
@@ -74,20 +149,26 @@ gimp_display_shell_render (GimpDisplayShell *shell,
 
   image      = gimp_display_get_image (shell->display);
   projection = gimp_image_get_projection (image);
-  buffer     = gimp_pickable_get_buffer (GIMP_PICKABLE (projection));
-
-#ifdef GIMP_DISPLAY_RENDER_ENABLE_SCALING
-  /* if we had this future API, things would look pretty on hires (retina) */
-  window_scale = gdk_window_get_scale_factor (gtk_widget_get_window (gtk_widget_get_toplevel (GTK_WIDGET (shell))));
-#endif
 
-  window_scale = MIN (window_scale, GIMP_DISPLAY_RENDER_MAX_SCALE);
+  window_scale = gimp_display_shell_render_get_window_scale (shell);
 
   gimp_display_shell_scroll_get_scaled_viewport (shell,
                                                  &viewport_offset_x,
                                                  &viewport_offset_y,
                                                  &viewport_width,
                                                  &viewport_height);
+
+  /*  when zoomed out, read from the projection's closest mipmap level
+   *  instead of resampling the full resolution projection
+   */
+  buffer = gimp_projection_get_buffer_at_scale (projection,
+                                                shell->scale_x * window_scale,
+                                                GEGL_RECTANGLE ((x + viewport_offset_x) * window_scale,
+                                                                (y + viewport_offset_y) * window_scale,
+                                                                w * window_scale,
+                                                                h * window_scale),
+                                                &buffer_scale);
+
   if (shell->rotate_transform)
     {
       xfer = cairo_surface_create_similar_image (cairo_get_target (cr),
@@ -140,7 +221,7 @@ gimp_display_shell_render (GimpDisplayShell *shell,
                                        (y + viewport_offset_y) * window_scale,
                                        w * window_scale,
                                        h * window_scale),
-                       shell->scale_x * window_scale,
+                       buffer_scale,
                        filter_format, shell->filter_data,
                        shell->filter_stride, GEGL_ABYSS_NONE);
 
@@ -167,59 +248,19 @@ gimp_display_shell_render (GimpDisplayShell *shell,
                                        (y + viewport_offset_y) * window_scale,
                                        w * window_scale,
                                        h * window_scale),
-                       shell->scale_x * window_scale,
+                       buffer_scale,
                        babl_format ("cairo-ARGB32"),
                        data, stride,
                        GEGL_ABYSS_NONE);
     }
 
   if (shell->mask)
-    {
-      gint mask_height;
-
-      if (! shell->mask_surface)
-        {
-          shell->mask_surface =
-            cairo_image_surface_create (CAIRO_FORMAT_A8,
-                                        GIMP_DISPLAY_RENDER_BUF_WIDTH  *
-                                        GIMP_DISPLAY_RENDER_MAX_SCALE,
-                                        GIMP_DISPLAY_RENDER_BUF_HEIGHT *
-                                        GIMP_DISPLAY_RENDER_MAX_SCALE);
-        }
-
-      cairo_surface_mark_dirty (shell->mask_surface);
-
-      stride = cairo_image_surface_get_stride (shell->mask_surface);
-      data = cairo_image_surface_get_data (shell->mask_surface);
-      data += mask_src_y * stride + mask_src_x * 4;
-
-      gegl_buffer_get (shell->mask,
-                       GEGL_RECTANGLE ((x + viewport_offset_x) * window_scale,
-                                       (y + viewport_offset_y) * window_scale,
-                                       w * window_scale,
-                                       h * window_scale),
-                       shell->scale_x * window_scale,
-                       babl_format ("Y u8"),
-                       data, stride,
-                       GEGL_ABYSS_NONE);
-
-      /* invert the mask so what is *not* the foreground object is masked */
-      mask_height = h * window_scale;
-      while (mask_height--)
-        {
-          gint    mask_width = w * window_scale;
-          guchar *d          = data;
-
-          while (mask_width--)
-            {
-              guchar inv = 255 - *d;
-
-              *d++ = inv;
-            }
-
-          data += stride;
-        }
-    }
+    gimp_display_shell_render_mask (shell,
+                                    GEGL_RECTANGLE ((x + viewport_offset_x) * window_scale,
+                                                    (y + viewport_offset_y) * window_scale,
+                                                    w * window_scale,
+                                                    h * window_scale),
+                                    window_scale);
 
   /*  put it to the screen  */
   cairo_save (cr);
@@ -252,9 +293,744 @@ gimp_display_shell_render (GimpDisplayShell *shell,
     {
       gimp_cairo_set_source_rgba (cr, &shell->mask_color);
       cairo_mask_surface (cr, shell->mask_surface,
-                          (x - mask_src_x) * window_scale,
-                          (y - mask_src_y) * window_scale);
+                          x * window_scale,
+                          y * window_scale);
     }
 
   cairo_restore (cr);
 }
+
+/**
+ * gimp_display_shell_render_cached:
+ * @shell: a #GimpDisplayShell
+ * @cr:    the canvas' cairo context
+ * @x:     the area to draw, in canvas coordinates
+ * @y:
+ * @w:
+ * @h:
+ *
+ * Draws the image from the shell's render cache. Parts of the area
+ * that are not rendered yet are rendered right away if they are
+ * small, like the updates while painting. Otherwise they are queued
+ * for rendering in an idle, which first renders them at a fraction
+ * of the resolution and then in full quality, so exposing the canvas
+ * takes about the same time regardless of the image size and zoom.
+ * Until then, whatever the cache holds for the area, even if it's
+ * outdated, is drawn.
+ **/
+void
+gimp_display_shell_render_cached (GimpDisplayShell *shell,
+                                  cairo_t          *cr,
+                                  gint              x,
+                                  gint              y,
+                                  gint              w,
+                                  gint              h)
+{
+  cairo_rectangle_int_t  rect;
+  cairo_rectangle_int_t  image_rect;
+  cairo_rectangle_int_t  canvas_rect;
+  cairo_region_t        *missing;
+  gint                   window_scale;
+  gint                   i;
+
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+  g_return_if_fail (cr != NULL);
+  g_return_if_fail (w > 0 && h > 0);
+
+  window_scale = gimp_display_shell_render_get_window_scale (shell);
+
+  gimp_display_shell_render_update_cache (shell, window_scale);
+
+  image_rect.x = - shell->offset_x;
+  image_rect.y = - shell->offset_y;
+  gimp_display_shell_scale_get_image_size (shell,
+                                           &image_rect.width,
+                                           &image_rect.height);
+
+  canvas_rect.x      = 0;
+  canvas_rect.y      = 0;
+  canvas_rect.width  = shell->disp_width;
+  canvas_rect.height = shell->disp_height;
+
+  rect.x      = x;
+  rect.y      = y;
+  rect.width  = w;
+  rect.height = h;
+
+  missing = cairo_region_create_rectangle (&rect);
+  cairo_region_intersect_rectangle (missing, &image_rect);
+  cairo_region_intersect_rectangle (missing, &canvas_rect);
+
+  if (cairo_region_is_empty (missing))
+    {
+      cairo_region_destroy (missing);
+      return;
+    }
+
+  cairo_region_get_extents (missing, &rect);
+
+  /*  render what's neither up to date nor queued already  */
+  cairo_region_subtract (missing, shell->render_valid);
+  cairo_region_subtract (missing, shell->render_queue);
+
+  if (! cairo_region_is_empty (missing))
+    {
+      gint area = 0;
+
+      for (i = 0; i < cairo_region_num_rectangles (missing); i++)
+        {
+          cairo_rectangle_int_t r;
+
+          cairo_region_get_rectangle (missing, i, &r);
+
+          area += r.width * r.height;
+        }
+
+      if (area <= GIMP_DISPLAY_RENDER_SYNC_AREA)
+        {
+          gimp_display_shell_render_region (shell, missing);
+        }
+      else
+        {
+          cairo_region_union (shell->render_queue, missing);
+
+          if (! shell->render_idle_id)
+            {
+              shell->render_idle_id =
+                g_idle_add_full (GIMP_DISPLAY_RENDER_IDLE_PRIORITY,
+                                 gimp_display_shell_render_idle, shell,
+                                 NULL);
+            }
+        }
+    }
+
+  cairo_region_destroy (missing);
+
+  /*  put whatever the cache has to the screen  */
+  cairo_save (cr);
+
+  cairo_rectangle (cr, rect.x, rect.y, rect.width, rect.height);
+  cairo_clip (cr);
+
+  for (i = 0; i < cairo_region_num_rectangles (shell->render_drawn); i++)
+    {
+      cairo_rectangle_int_t r;
+
+      cairo_region_get_rectangle (shell->render_drawn, i, &r);
+
+      cairo_rectangle (cr, r.x, r.y, r.width, r.height);
+    }
+
+  cairo_clip (cr);
+
+  cairo_scale (cr, 1.0 / window_scale, 1.0 / window_scale);
+  cairo_set_source_surface (cr, shell->render_cache, 0, 0);
+  cairo_paint (cr);
+
+  cairo_restore (cr);
+}
+
+/*  the image changed everywhere, keep drawing the outdated cache until
+ *  it is rendered again
+ */
+void
+gimp_display_shell_render_invalidate_full (GimpDisplayShell *shell)
+{
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+
+  if (! shell->render_cache)
+    return;
+
+  cairo_region_destroy (shell->render_valid);
+  shell->render_valid = cairo_region_create ();
+}
+
+void
+gimp_display_shell_render_invalidate_area (GimpDisplayShell *shell,
+                                           gint              x,
+                                           gint              y,
+                                           gint              w,
+                                           gint              h)
+{
+  cairo_rectangle_int_t rect = { x, y, w, h };
+
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+
+  if (! shell->render_cache)
+    return;
+
+  cairo_region_subtract_rectangle (shell->render_valid, &rect);
+
+  /*  so small updates, like while painting, are rendered right away
+   *  instead of waiting for their turn in the idle
+   */
+  cairo_region_subtract_rectangle (shell->render_queue, &rect);
+}
+
+/*  the canvas was scrolled by @dx, @dy, move the cache along so only
+ *  the newly exposed strips have to be rendered
+ */
+void
+gimp_display_shell_render_scroll (GimpDisplayShell *shell,
+                                  gint              dx,
+                                  gint              dy)
+{
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+
+  if (! shell->render_cache                            ||
+      shell->render_offset_x != shell->offset_x + dx ||
+      shell->render_offset_y != shell->offset_y + dy)
+    return;
+
+  gimp_display_shell_render_move_cache (shell,
+                                        gimp_display_shell_render_get_window_scale (shell),
+                                        dx, dy);
+
+  shell->render_offset_x = shell->offset_x;
+  shell->render_offset_y = shell->offset_y;
+}
+
+void
+gimp_display_shell_render_cache_free (GimpDisplayShell *shell)
+{
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+
+  if (shell->render_idle_id)
+    {
+      g_source_remove (shell->render_idle_id);
+      shell->render_idle_id = 0;
+    }
+
+  if (shell->render_cache)
+    {
+      cairo_surface_destroy (shell->render_cache);
+      shell->render_cache = NULL;
+
+      cairo_region_destroy (shell->render_valid);
+      shell->render_valid = NULL;
+
+      cairo_region_destroy (shell->render_drawn);
+      shell->render_drawn = NULL;
+
+      cairo_region_destroy (shell->render_queue);
+      shell->render_queue = NULL;
+    }
+}
+
+
+/*  private functions  */
+
+static gint
+gimp_display_shell_render_get_window_scale (GimpDisplayShell *shell)
+{
+  gint window_scale = 1;
+
+#ifdef GIMP_DISPLAY_RENDER_ENABLE_SCALING
+  /* if we had this future API, things would look pretty on hires (retina) */
+  window_scale = gdk_window_get_scale_factor (gtk_widget_get_window (gtk_widget_get_toplevel (GTK_WIDGET (shell))));
+#endif
+
+  return MIN (window_scale, GIMP_DISPLAY_RENDER_MAX_SCALE);
+}
+
+/*  renders the inverted mask for @rect to the top left corner of
+ *  shell->mask_surface
+ */
+static void
+gimp_display_shell_render_mask (GimpDisplayShell    *shell,
+                                const GeglRectangle *rect,
+                                gint                 window_scale)
+{
+  guchar *data;
+  gint    stride;
+  gint    mask_height;
+
+  if (! shell->mask_surface)
+    {
+      shell->mask_surface =
+        cairo_image_surface_create (CAIRO_FORMAT_A8,
+                                    GIMP_DISPLAY_RENDER_BUF_WIDTH  *
+                                    GIMP_DISPLAY_RENDER_MAX_SCALE,
+                                    GIMP_DISPLAY_RENDER_BUF_HEIGHT *
+                                    GIMP_DISPLAY_RENDER_MAX_SCALE);
+    }
+
+  cairo_surface_mark_dirty (shell->mask_surface);
+
+  stride = cairo_image_surface_get_stride (shell->mask_surface);
+  data   = cairo_image_surface_get_data (shell->mask_surface);
+
+  gegl_buffer_get (shell->mask, rect,
+                   shell->scale_x * window_scale,
+                   babl_format ("Y u8"),
+                   data, stride,
+                   GEGL_ABYSS_NONE);
+
+  /* invert the mask so what is *not* the foreground object is masked */
+  mask_height = rect->height;
+  while (mask_height--)
+    {
+      gint    mask_width = rect->width;
+      guchar *d          = data;
+
+      while (mask_width--)
+        {
+          guchar inv = 255 - *d;
+
+          *d++ = inv;
+        }
+
+      data += stride;
+    }
+}
+
+/*  scales a chunk rendered at 1 / @factor of the resolution up to the
+ *  cache, the nearest neighbor is good enough for the first pass
+ */
+static void
+gimp_display_shell_render_expand (const RenderChunk *chunk,
+                                  gint               factor,
+                                  const guchar      *src,
+                                  gint               src_stride,
+                                  guchar            *cache_data,
+                                  gint               cache_stride)
+{
+  guchar *dest = cache_data + chunk->dest.y * cache_stride + chunk->dest.x * 4;
+  gint    x, y;
+
+  for (y = 0; y < chunk->dest.height; y++)
+    {
+      const guint32 *s = (const guint32 *)
+        (src + ((chunk->origin_y + y) / factor - chunk->src_rect.y) * src_stride);
+      guint32       *d = (guint32 *) dest;
+
+      for (x = 0; x < chunk->dest.width; x++)
+        d[x] = s[(chunk->origin_x + x) / factor - chunk->src_rect.x];
+
+      dest += cache_stride;
+    }
+}
+
+static void
+gimp_display_shell_render_chunks_func (gint     i,
+                                       gint     n,
+                                       gpointer user_data)
+{
+  RenderChunksData *data = user_data;
+
+  for (; i < data->n_chunks; i += n)
+    {
+      RenderChunk *chunk = &data->chunks[i];
+
+      if (chunk->data)
+        {
+          gegl_buffer_get (chunk->buffer, &chunk->src_rect, chunk->buffer_scale,
+                           data->format, chunk->data,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          /*  filtered chunks are finished in the main thread  */
+          if (data->format == babl_format ("cairo-ARGB32"))
+            gimp_display_shell_render_expand (chunk, data->factor,
+                                              chunk->data,
+                                              chunk->src_rect.width * 4,
+                                              data->cache_data,
+                                              data->cache_stride);
+        }
+      else
+        {
+          gegl_buffer_get (chunk->buffer, &chunk->src_rect, chunk->buffer_scale,
+                           data->format,
+                           data->cache_data +
+                           chunk->dest.y * data->cache_stride +
+                           chunk->dest.x * 4,
+                           data->cache_stride, GEGL_ABYSS_NONE);
+        }
+    }
+}
+
+/*  renders @rects, each at most GIMP_DISPLAY_RENDER_BUF_WIDTH x
+ *  GIMP_DISPLAY_RENDER_BUF_HEIGHT, to the cache, reading the projection
+ *  on all threads. The display filters and the mask are applied in
+ *  the main thread afterwards.
+ */
+static void
+gimp_display_shell_render_chunks (GimpDisplayShell            *shell,
+                                  const cairo_rectangle_int_t *rects,
+                                  gint                         n_rects,
+                                  gint                         factor)
+{
+  GimpImage        *image;
+  GimpProjection   *projection;
+  RenderChunksData  data;
+  gint              window_scale;
+  gint              viewport_offset_x;
+  gint              viewport_offset_y;
+  gint              viewport_width;
+  gint              viewport_height;
+  gboolean          parallel = TRUE;
+  gint              i;
+
+  image      = gimp_display_get_image (shell->display);
+  projection = gimp_image_get_projection (image);
+
+  window_scale = gimp_display_shell_render_get_window_scale (shell);
+
+  gimp_display_shell_scroll_get_scaled_viewport (shell,
+                                                 &viewport_offset_x,
+                                                 &viewport_offset_y,
+                                                 &viewport_width,
+                                                 &viewport_height);
+
+  data.chunks   = g_new0 (RenderChunk, n_rects);
+  data.n_chunks = n_rects;
+  data.factor   = factor;
+
+  if (shell->filter_stack)
+    data.format = babl_format ("R'G'B'A float");
+  else
+    data.format = babl_format ("cairo-ARGB32");
+
+  cairo_surface_flush (shell->render_cache);
+
+  data.cache_data   = cairo_image_surface_get_data (shell->render_cache);
+  data.cache_stride = cairo_image_surface_get_stride (shell->render_cache);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      RenderChunk *chunk = &data.chunks[i];
+
+      chunk->dest.x      = rects[i].x      * window_scale;
+      chunk->dest.y      = rects[i].y      * window_scale;
+      chunk->dest.width  = rects[i].width  * window_scale;
+      chunk->dest.height = rects[i].height * window_scale;
+
+      chunk->origin_x = (rects[i].x + viewport_offset_x) * window_scale;
+      chunk->origin_y = (rects[i].y + viewport_offset_y) * window_scale;
+
+      chunk->src_rect.x      = chunk->origin_x / factor;
+      chunk->src_rect.y      = chunk->origin_y / factor;
+      chunk->src_rect.width  = ((chunk->origin_x + chunk->dest.width +
+                                 factor - 1) / factor -
+                                chunk->src_rect.x);
+      chunk->src_rect.height = ((chunk->origin_y + chunk->dest.height +
+                                 factor - 1) / factor -
+                                chunk->src_rect.y);
+
+      /*  the projection and its mipmap levels are brought up to date
+       *  here, in the main thread, so the workers only read tiles that
+       *  are already rendered
+       */
+      chunk->buffer =
+        gimp_projection_get_buffer_at_scale (projection,
+                                             shell->scale_x * window_scale /
+                                             factor,
+                                             &chunk->src_rect,
+                                             &chunk->buffer_scale);
+
+      /*  but GEGL's own mipmaps are not, read those from here too  */
+      if (chunk->buffer_scale <= 0.5)
+        parallel = FALSE;
+
+      if (factor > 1 || shell->filter_stack)
+        chunk->data = g_malloc (chunk->src_rect.width *
+                                chunk->src_rect.height *
+                                babl_format_get_bytes_per_pixel (data.format));
+    }
+
+  gimp_parallel_distribute (parallel ? n_rects : 1,
+                            gimp_display_shell_render_chunks_func, &data);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      RenderChunk *chunk = &data.chunks[i];
+
+      /*  display filters are not required to be thread-safe  */
+      if (shell->filter_stack)
+        {
+          GeglBuffer    *buffer;
+          GeglRectangle  rect = { 0, 0,
+                                  chunk->src_rect.width,
+                                  chunk->src_rect.height };
+
+          buffer = gegl_buffer_linear_new_from_data (chunk->data, data.format,
+                                                     &rect,
+                                                     GEGL_AUTO_ROWSTRIDE,
+                                                     NULL, NULL);
+
+          gimp_color_display_stack_convert_buffer (shell->filter_stack,
+                                                   buffer, &rect);
+
+          if (factor > 1)
+            {
+              guchar *pixels = g_malloc (rect.width * rect.height * 4);
+
+              gegl_buffer_get (buffer, &rect, 1.0,
+                               babl_format ("cairo-ARGB32"), pixels,
+                               GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+              gimp_display_shell_render_expand (chunk, factor,
+                                                pixels, rect.width * 4,
+                                                data.cache_data,
+                                                data.cache_stride);
+
+              g_free (pixels);
+            }
+          else
+            {
+              gegl_buffer_get (buffer, &rect, 1.0,
+                               babl_format ("cairo-ARGB32"),
+                               data.cache_data +
+                               chunk->dest.y * data.cache_stride +
+                               chunk->dest.x * 4,
+                               data.cache_stride, GEGL_ABYSS_NONE);
+            }
+
+          g_object_unref (buffer);
+        }
+
+      g_free (chunk->data);
+
+      cairo_surface_mark_dirty_rectangle (shell->render_cache,
+                                          chunk->dest.x,
+                                          chunk->dest.y,
+                                          chunk->dest.width,
+                                          chunk->dest.height);
+
+      if (shell->mask)
+        {
+          cairo_t *cr;
+
+          gimp_display_shell_render_mask (shell,
+                                          GEGL_RECTANGLE (chunk->origin_x,
+                                                          chunk->origin_y,
+                                                          chunk->dest.width,
+                                                          chunk->dest.height),
+                                          window_scale);
+
+          cr = cairo_create (shell->render_cache);
+
+          cairo_rectangle (cr,
+                           chunk->dest.x,     chunk->dest.y,
+                           chunk->dest.width, chunk->dest.height);
+          cairo_clip (cr);
+
+          gimp_cairo_set_source_rgba (cr, &shell->mask_color);
+          cairo_mask_surface (cr, shell->mask_surface,
+                              chunk->dest.x, chunk->dest.y);
+
+          cairo_destroy (cr);
+        }
+
+      /*  the coarse pass is only a placeholder until the real thing  */
+      if (factor == 1)
+        {
+          cairo_region_union_rectangle (shell->render_valid, &rects[i]);
+          cairo_region_subtract_rectangle (shell->render_queue, &rects[i]);
+        }
+
+      cairo_region_union_rectangle (shell->render_drawn, &rects[i]);
+    }
+
+  g_free (data.chunks);
+}
+
+/*  renders @region in full quality right away, emptying it  */
+static void
+gimp_display_shell_render_region (GimpDisplayShell *shell,
+                                  cairo_region_t   *region)
+{
+  gint                   max_rects = gimp_parallel_get_n_threads ();
+  cairo_rectangle_int_t *rects     = g_new (cairo_rectangle_int_t, max_rects);
+
+  while (! cairo_region_is_empty (region))
+    {
+      gint n_rects;
+
+      n_rects = gimp_display_shell_render_next_chunks (region,
+                                                       rects, max_rects);
+
+      gimp_display_shell_render_chunks (shell, rects, n_rects, 1);
+    }
+
+  g_free (rects);
+}
+
+/*  takes up to @max_rects render sized chunks off @region, top to
+ *  bottom, and returns how many it took
+ */
+static gint
+gimp_display_shell_render_next_chunks (cairo_region_t        *region,
+                                       cairo_rectangle_int_t *rects,
+                                       gint                   max_rects)
+{
+  gint n_rects = 0;
+
+  while (n_rects < max_rects && ! cairo_region_is_empty (region))
+    {
+      cairo_rectangle_int_t *rect = &rects[n_rects++];
+
+      cairo_region_get_rectangle (region, 0, rect);
+
+      rect->width  = MIN (rect->width,  GIMP_DISPLAY_RENDER_BUF_WIDTH);
+      rect->height = MIN (rect->height, GIMP_DISPLAY_RENDER_BUF_HEIGHT);
+
+      cairo_region_subtract_rectangle (region, rect);
+    }
+
+  return n_rects;
+}
+
+static gboolean
+gimp_display_shell_render_idle (gpointer data)
+{
+  GimpDisplayShell      *shell     = data;
+  gint                   max_rects = gimp_parallel_get_n_threads ();
+  cairo_rectangle_int_t *rects     = g_new (cairo_rectangle_int_t, max_rects);
+  GTimer                *timer     = g_timer_new ();
+  gboolean               done      = FALSE;
+
+  /*  drops the queue if the view changed since it was filled  */
+  gimp_display_shell_render_update_cache (shell,
+                                          gimp_display_shell_render_get_window_scale (shell));
+
+  do
+    {
+      cairo_region_t *region;
+      gint            factor;
+      gint            n_rects;
+      gint            i;
+
+      /*  first show something everywhere, then refine it  */
+      region = cairo_region_copy (shell->render_queue);
+      cairo_region_subtract (region, shell->render_drawn);
+
+      if (! cairo_region_is_empty (region))
+        {
+          factor = GIMP_DISPLAY_RENDER_COARSE_FACTOR;
+        }
+      else
+        {
+          cairo_region_destroy (region);
+
+          region = cairo_region_copy (shell->render_queue);
+          factor = 1;
+        }
+
+      if (cairo_region_is_empty (region))
+        {
+          cairo_region_destroy (region);
+
+          done = TRUE;
+          break;
+        }
+
+      n_rects = gimp_display_shell_render_next_chunks (region,
+                                                       rects, max_rects);
+
+      cairo_region_destroy (region);
+
+      gimp_display_shell_render_chunks (shell, rects, n_rects, factor);
+
+      for (i = 0; i < n_rects; i++)
+        gimp_display_shell_expose_area (shell,
+                                        rects[i].x,     rects[i].y,
+                                        rects[i].width, rects[i].height);
+    }
+  while (g_timer_elapsed (timer, NULL) < GIMP_DISPLAY_RENDER_CHUNK_TIME);
+
+  g_timer_destroy (timer);
+  g_free (rects);
+
+  if (done)
+    {
+      shell->render_idle_id = 0;
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*  makes sure the cache matches the canvas and the current view  */
+static void
+gimp_display_shell_render_update_cache (GimpDisplayShell *shell,
+                                        gint              window_scale)
+{
+  if (! shell->render_cache)
+    {
+      shell->render_cache =
+        cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                    shell->disp_width  * window_scale,
+                                    shell->disp_height * window_scale);
+
+      shell->render_valid = cairo_region_create ();
+      shell->render_drawn = cairo_region_create ();
+      shell->render_queue = cairo_region_create ();
+    }
+  else if (shell->render_scale_x  != shell->scale_x  ||
+           shell->render_scale_y  != shell->scale_y  ||
+           shell->render_offset_x != shell->offset_x ||
+           shell->render_offset_y != shell->offset_y)
+    {
+      /*  nothing in the cache is useful after zooming  */
+      cairo_region_destroy (shell->render_valid);
+      cairo_region_destroy (shell->render_drawn);
+      cairo_region_destroy (shell->render_queue);
+
+      shell->render_valid = cairo_region_create ();
+      shell->render_drawn = cairo_region_create ();
+      shell->render_queue = cairo_region_create ();
+    }
+
+  shell->render_scale_x  = shell->scale_x;
+  shell->render_scale_y  = shell->scale_y;
+  shell->render_offset_x = shell->offset_x;
+  shell->render_offset_y = shell->offset_y;
+
+  if (cairo_image_surface_get_width  (shell->render_cache) !=
+      shell->disp_width  * window_scale ||
+      cairo_image_surface_get_height (shell->render_cache) !=
+      shell->disp_height * window_scale)
+    {
+      gimp_display_shell_render_move_cache (shell, window_scale, 0, 0);
+    }
+}
+
+/*  moves the cache's contents by @dx, @dy and resizes it to the canvas  */
+static void
+gimp_display_shell_render_move_cache (GimpDisplayShell *shell,
+                                      gint              window_scale,
+                                      gint              dx,
+                                      gint              dy)
+{
+  cairo_surface_t       *cache;
+  cairo_t               *cr;
+  cairo_rectangle_int_t  canvas_rect;
+
+  cache = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                      shell->disp_width  * window_scale,
+                                      shell->disp_height * window_scale);
+
+  cr = cairo_create (cache);
+  cairo_set_source_surface (cr, shell->render_cache,
+                            dx * window_scale, dy * window_scale);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  cairo_surface_destroy (shell->render_cache);
+  shell->render_cache = cache;
+
+  canvas_rect.x      = 0;
+  canvas_rect.y      = 0;
+  canvas_rect.width  = shell->disp_width;
+  canvas_rect.height = shell->disp_height;
+
+  cairo_region_translate (shell->render_valid, dx, dy);
+  cairo_region_translate (shell->render_drawn, dx, dy);
+  cairo_region_translate (shell->render_queue, dx, dy);
+
+  cairo_region_intersect_rectangle (shell->render_valid, &canvas_rect);
+  cairo_region_intersect_rectangle (shell->render_drawn, &canvas_rect);
+  cairo_region_intersect_rectangle (shell->render_queue, &canvas_rect);
+}
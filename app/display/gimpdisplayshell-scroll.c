@@ -36,6 +36,7 @@
 #include "gimpdisplay-foreach.h"
 #include "gimpdisplayshell.h"
 #include "gimpdisplayshell-expose.h"
+#include "gimpdisplayshell-render.h"
 #include "gimpdisplayshell-rotate.h"
 #include "gimpdisplayshell-scale.h"
 #include "gimpdisplayshell-scroll.h"
@@ -122,6 +123,8 @@ gimp_display_shell_scroll (GimpDisplayShell *shell,
 
       gimp_display_shell_rotate_update_transform (shell);
 
+      gimp_display_shell_render_scroll (shell, -x_offset, -y_offset);
+
       gimp_overlay_box_scroll (GIMP_OVERLAY_BOX (shell->canvas),
                                -x_offset, -y_offset);
 
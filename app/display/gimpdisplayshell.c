@@ -170,6 +170,8 @@ static void   gimp_display_shell_transform_overlay (GimpDisplayShell *shell,
                                                     GtkWidget        *child,
                                                     gdouble          *x,
                                                     gdouble          *y);
+static void   gimp_display_shell_update_priority_rect
+                                                   (GimpDisplayShell *shell);
 
 
 G_DEFINE_TYPE_WITH_CODE (GimpDisplayShell, gimp_display_shell,
@@ -791,6 +793,8 @@ gimp_display_shell_dispose (GObject *object)
       shell->filter_idle_id = 0;
     }
 
+  gimp_display_shell_render_cache_free (shell);
+
   if (shell->mask_surface)
     {
       cairo_surface_destroy (shell->mask_surface);
@@ -1176,6 +1180,24 @@ gimp_display_shell_transform_overlay (GimpDisplayShell *shell,
     }
 }
 
+static void
+gimp_display_shell_update_priority_rect (GimpDisplayShell *shell)
+{
+  GimpImage *image = gimp_display_get_image (shell->display);
+
+  if (image)
+    {
+      gint x, y;
+      gint width, height;
+
+      /*  let the projection render the visible area first  */
+      gimp_display_shell_untransform_viewport (shell, &x, &y, &width, &height);
+
+      gimp_projection_set_priority_rect (gimp_image_get_projection (image),
+                                         x, y, width, height);
+    }
+}
+
 
 /*  public functions  */
 
@@ -1500,6 +1522,8 @@ gimp_display_shell_scaled (GimpDisplayShell *shell)
                                            child, x, y);
     }
 
+  gimp_display_shell_update_priority_rect (shell);
+
   g_signal_emit (shell, display_shell_signals[SCALED], 0);
 }
 
@@ -1523,6 +1547,8 @@ gimp_display_shell_scrolled (GimpDisplayShell *shell)
                                            child, x, y);
     }
 
+  gimp_display_shell_update_priority_rect (shell);
+
   g_signal_emit (shell, display_shell_signals[SCROLLED], 0);
 }
 
@@ -1533,6 +1559,8 @@ gimp_display_shell_rotated (GimpDisplayShell *shell)
 
   gimp_display_shell_rotate_update_transform (shell);
 
+  gimp_display_shell_update_priority_rect (shell);
+
   g_signal_emit (shell, display_shell_signals[ROTATED], 0);
 }
 
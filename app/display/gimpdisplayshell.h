@@ -116,6 +116,16 @@ struct _GimpDisplayShell
   guchar            *filter_data;      /*  filter_buffer's pixels             */
   gint               filter_stride;    /*  filter_buffer's stride             */
 
+  cairo_surface_t   *render_cache;     /*  the rendered canvas                */
+  cairo_region_t    *render_valid;     /*  up-to-date part of render_cache    */
+  cairo_region_t    *render_drawn;     /*  part with any, maybe old, contents */
+  cairo_region_t    *render_queue;     /*  area waiting to be rendered        */
+  guint              render_idle_id;   /*  idle rendering render_queue        */
+  gdouble            render_scale_x;   /*  the view render_cache is for       */
+  gdouble            render_scale_y;
+  gint               render_offset_x;
+  gint               render_offset_y;
+
   GimpCanvasItem    *canvas_item;      /*  items drawn on the canvas          */
   GimpCanvasItem    *unrotated_item;   /*  unrotated items for e.g. cursor    */
   GimpCanvasItem    *passe_partout;    /*  item for the highlight             */
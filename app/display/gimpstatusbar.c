@@ -88,6 +88,8 @@ static void     gimp_statusbar_progress_set_value (GimpProgress      *progress,
                                                    gdouble            percentage);
 static gdouble  gimp_statusbar_progress_get_value (GimpProgress      *progress);
 static void     gimp_statusbar_progress_pulse     (GimpProgress      *progress);
+static gboolean gimp_statusbar_progress_grab      (GimpProgress      *progress);
+static void     gimp_statusbar_progress_ungrab    (GimpProgress      *progress);
 static gboolean gimp_statusbar_progress_message   (GimpProgress      *progress,
                                                    Gimp              *gimp,
                                                    GimpMessageSeverity severity,
@@ -148,6 +150,8 @@ gimp_statusbar_progress_iface_init (GimpProgressInterface *iface)
   iface->set_value = gimp_statusbar_progress_set_value;
   iface->get_value = gimp_statusbar_progress_get_value;
   iface->pulse     = gimp_statusbar_progress_pulse;
+  iface->grab      = gimp_statusbar_progress_grab;
+  iface->ungrab    = gimp_statusbar_progress_ungrab;
   iface->message   = gimp_statusbar_progress_message;
 }
 
@@ -538,6 +542,32 @@ gimp_statusbar_progress_pulse (GimpProgress *progress)
     }
 }
 
+static gboolean
+gimp_statusbar_progress_grab (GimpProgress *progress)
+{
+  GimpStatusbar *statusbar = GIMP_STATUSBAR (progress);
+
+  /*  only a cancelable progress has anything to receive input  */
+  if (statusbar->progress_active &&
+      gtk_widget_is_sensitive (statusbar->cancel_button) &&
+      gtk_widget_get_visible (statusbar->cancel_button))
+    {
+      gtk_grab_add (statusbar->cancel_button);
+
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+gimp_statusbar_progress_ungrab (GimpProgress *progress)
+{
+  GimpStatusbar *statusbar = GIMP_STATUSBAR (progress);
+
+  gtk_grab_remove (statusbar->cancel_button);
+}
+
 static gboolean
 gimp_statusbar_progress_message (GimpProgress        *progress,
                                  Gimp                *gimp,
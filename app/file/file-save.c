@@ -60,6 +60,8 @@
 
 #include "plug-in/gimppluginprocedure.h"
 
+#include "xcf/xcf.h"
+
 #include "file-save.h"
 #include "file-utils.h"
 #include "gimp-file.h"
@@ -127,6 +129,15 @@ file_save (Gimp                *gimp,
               status = GIMP_PDB_EXECUTION_ERROR;
               goto out;
             }
+
+          /*  an open XCF may still decode its tiles from the file  */
+          {
+            GFile *file = g_file_new_for_path (filename);
+
+            xcf_unmap_file (file);
+
+            g_object_unref (file);
+          }
         }
 
       if (file_proc->handles_uri)
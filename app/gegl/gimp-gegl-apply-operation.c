@@ -34,6 +34,63 @@
 #include "gegl/gimp-gegl-utils.h"
 
 
+typedef struct
+{
+  GeglProcessor *processor;
+  GMutex         mutex;
+  GCond          cond;
+  gdouble        value;
+  gboolean       done;
+  gint           cancel;
+} GimpGeglApplyAsync;
+
+
+/*  local function prototypes  */
+
+static gpointer gimp_gegl_apply_operation_thread (gpointer            data);
+static void     gimp_gegl_apply_operation_cancel (GimpProgress       *progress,
+                                                  GimpGeglApplyAsync *async);
+
+
+/*  private functions  */
+
+static gpointer
+gimp_gegl_apply_operation_thread (gpointer data)
+{
+  GimpGeglApplyAsync *async = data;
+  gdouble             value;
+
+  while (! g_atomic_int_get (&async->cancel) &&
+         gegl_processor_work (async->processor, &value))
+    {
+      g_mutex_lock (&async->mutex);
+
+      async->value = value;
+      g_cond_signal (&async->cond);
+
+      g_mutex_unlock (&async->mutex);
+    }
+
+  g_mutex_lock (&async->mutex);
+
+  async->done = TRUE;
+  g_cond_signal (&async->cond);
+
+  g_mutex_unlock (&async->mutex);
+
+  return NULL;
+}
+
+static void
+gimp_gegl_apply_operation_cancel (GimpProgress       *progress,
+                                  GimpGeglApplyAsync *async)
+{
+  g_atomic_int_set (&async->cancel, TRUE);
+}
+
+
+/*  public functions  */
+
 void
 gimp_gegl_apply_operation (GeglBuffer          *src_buffer,
                            GimpProgress        *progress,
@@ -41,17 +98,57 @@ gimp_gegl_apply_operation (GeglBuffer          *src_buffer,
                            GeglNode            *operation,
                            GeglBuffer          *dest_buffer,
                            const GeglRectangle *dest_rect)
+{
+  gimp_gegl_apply_operation_cancelable (src_buffer, progress, undo_desc,
+                                        operation, dest_buffer, dest_rect,
+                                        FALSE);
+}
+
+/**
+ * gimp_gegl_apply_operation_cancelable:
+ * @src_buffer:  the source buffer, or %NULL
+ * @progress:    a #GimpProgress, or %NULL
+ * @undo_desc:   the progress text
+ * @operation:   the operation to apply
+ * @dest_buffer: the buffer to write to
+ * @dest_rect:   the area of @dest_buffer to write, or %NULL
+ * @cancelable:  whether the operation can be canceled through @progress
+ *
+ * Like gimp_gegl_apply_operation(), but processes the graph in a
+ * worker thread while the calling thread keeps @progress updated, and
+ * stops when @progress is canceled.
+ *
+ * If @src_buffer and @dest_buffer are the same, the result is written
+ * to a temporary buffer which only holds the tiles of @dest_rect and
+ * is copied to @dest_buffer when the operation completes, so a
+ * canceled operation leaves @dest_buffer untouched. Otherwise, the
+ * contents of @dest_rect are undefined after a cancel, and callers
+ * should only commit @dest_buffer (and push undo) on success.
+ *
+ * Returns: %TRUE if the operation completed, %FALSE if it was canceled.
+ **/
+gboolean
+gimp_gegl_apply_operation_cancelable (GeglBuffer          *src_buffer,
+                                      GimpProgress        *progress,
+                                      const gchar         *undo_desc,
+                                      GeglNode            *operation,
+                                      GeglBuffer          *dest_buffer,
+                                      const GeglRectangle *dest_rect,
+                                      gboolean             cancelable)
 {
   GeglNode      *gegl;
   GeglNode      *dest_node;
+  GeglBuffer    *result_buffer;
   GeglRectangle  rect = { 0, };
-  gdouble        value;
   gboolean       progress_active = FALSE;
+  gboolean       success         = TRUE;
 
-  g_return_if_fail (src_buffer == NULL || GEGL_IS_BUFFER (src_buffer));
-  g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
-  g_return_if_fail (GEGL_IS_NODE (operation));
-  g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
+  g_return_val_if_fail (src_buffer == NULL || GEGL_IS_BUFFER (src_buffer),
+                        FALSE);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress),
+                        FALSE);
+  g_return_val_if_fail (GEGL_IS_NODE (operation), FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (dest_buffer), FALSE);
 
   if (dest_rect)
     {
@@ -63,6 +160,8 @@ gimp_gegl_apply_operation (GeglBuffer          *src_buffer,
                                     gegl_buffer_get_height (dest_buffer));
     }
 
+  result_buffer = g_object_ref (dest_buffer);
+
   gegl = gegl_node_new ();
 
   if (! gegl_node_get_parent (operation))
@@ -72,28 +171,31 @@ gimp_gegl_apply_operation (GeglBuffer          *src_buffer,
     {
       GeglNode *src_node;
 
-      /* dup() because reading and writing the same buffer doesn't
-       * work with area ops when using a processor. See bug #701875.
+      /* reading and writing the same buffer doesn't work with area
+       * ops when using a processor, see bug #701875. Write the result
+       * to a separate buffer and copy it over at the end, which also
+       * leaves the source untouched if the operation is canceled.
        */
       if (progress && (src_buffer == dest_buffer))
-        src_buffer = gegl_buffer_dup (src_buffer);
-      else
-        g_object_ref (src_buffer);
+        {
+          g_object_unref (result_buffer);
+
+          result_buffer = gegl_buffer_new (&rect,
+                                           gegl_buffer_get_format (dest_buffer));
+        }
 
       src_node = gegl_node_new_child (gegl,
                                       "operation", "gegl:buffer-source",
                                       "buffer",    src_buffer,
                                       NULL);
 
-      g_object_unref (src_buffer);
-
       gegl_node_connect_to (src_node,  "output",
                             operation, "input");
     }
 
   dest_node = gegl_node_new_child (gegl,
                                    "operation", "gegl:write-buffer",
-                                   "buffer",    dest_buffer,
+                                   "buffer",    result_buffer,
                                    NULL);
 
 
@@ -102,9 +204,15 @@ gimp_gegl_apply_operation (GeglBuffer          *src_buffer,
 
   if (progress)
     {
-      GeglProcessor *processor;
+      GimpGeglApplyAsync  async     = { 0, };
+      gulong              cancel_id = 0;
+      gboolean            grabbed   = FALSE;
+      GThread            *thread;
+
+      async.processor = gegl_node_new_processor (dest_node, &rect);
 
-      processor = gegl_node_new_processor (dest_node, &rect);
+      g_mutex_init (&async.mutex);
+      g_cond_init (&async.cond);
 
       progress_active = gimp_progress_is_active (progress);
 
@@ -115,13 +223,72 @@ gimp_gegl_apply_operation (GeglBuffer          *src_buffer,
         }
       else
         {
-          gimp_progress_start (progress, undo_desc, FALSE);
+          gimp_progress_start (progress, undo_desc, cancelable);
+        }
+
+      if (cancelable)
+        {
+          cancel_id =
+            g_signal_connect (progress, "cancel",
+                              G_CALLBACK (gimp_gegl_apply_operation_cancel),
+                              &async);
+
+          /*  the cancel button needs its events dispatched, which is
+           *  only done if it is the only part of the user interface
+           *  receiving input, so nothing can change the image or close
+           *  it while the worker reads and writes its buffers
+           */
+          grabbed = gimp_progress_grab (progress);
         }
 
-      while (gegl_processor_work (processor, &value))
-        gimp_progress_set_value (progress, value);
+      thread = g_thread_new ("apply-operation",
+                             gimp_gegl_apply_operation_thread, &async);
+
+      /*  the graph is only processed by the worker, this thread only
+       *  updates the progress and dispatches the cancel button's
+       *  events
+       */
+      g_mutex_lock (&async.mutex);
+
+      while (! async.done)
+        {
+          gdouble value;
+
+          g_cond_wait_until (&async.cond, &async.mutex,
+                             g_get_monotonic_time () +
+                             G_TIME_SPAN_SECOND / 20);
+
+          value = async.value;
+
+          g_mutex_unlock (&async.mutex);
+
+          gimp_progress_set_value (progress, value);
+
+          if (grabbed)
+            {
+              while (g_main_context_pending (NULL))
+                g_main_context_iteration (NULL, FALSE);
+            }
+
+          g_mutex_lock (&async.mutex);
+        }
+
+      g_mutex_unlock (&async.mutex);
+
+      g_thread_join (thread);
 
-      g_object_unref (processor);
+      if (grabbed)
+        gimp_progress_ungrab (progress);
+
+      if (cancel_id)
+        g_signal_handler_disconnect (progress, cancel_id);
+
+      success = ! g_atomic_int_get (&async.cancel);
+
+      g_object_unref (async.processor);
+
+      g_cond_clear (&async.cond);
+      g_mutex_clear (&async.mutex);
     }
   else
     {
@@ -131,8 +298,15 @@ gimp_gegl_apply_operation (GeglBuffer          *src_buffer,
 
   g_object_unref (gegl);
 
+  if (success && result_buffer != dest_buffer)
+    gegl_buffer_copy (result_buffer, &rect, dest_buffer, &rect);
+
+  g_object_unref (result_buffer);
+
   if (progress && ! progress_active)
     gimp_progress_end (progress);
+
+  return success;
 }
 
 void
@@ -300,6 +474,42 @@ gimp_gegl_apply_opacity (GeglBuffer    *src_buffer,
   g_object_unref (node);
 }
 
+/*  @filters are GimpOperationPointFilter instances, which are applied
+ *  in one pass instead of one graph node each; returns FALSE if the
+ *  pass was canceled through @progress
+ */
+gboolean
+gimp_gegl_apply_point_filters (GeglBuffer          *src_buffer,
+                               GimpProgress        *progress,
+                               const gchar         *undo_desc,
+                               GeglBuffer          *dest_buffer,
+                               const GeglRectangle *dest_rect,
+                               GPtrArray           *filters,
+                               gboolean             use_lut)
+{
+  GeglNode *node;
+  gboolean  success;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (src_buffer), FALSE);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (dest_buffer), FALSE);
+  g_return_val_if_fail (filters != NULL, FALSE);
+
+  node = gegl_node_new_child (NULL,
+                              "operation", "gimp:point-chain",
+                              "filters",   filters,
+                              "use-lut",   use_lut,
+                              NULL);
+
+  success = gimp_gegl_apply_operation_cancelable (src_buffer, progress,
+                                                  undo_desc, node,
+                                                  dest_buffer, dest_rect,
+                                                  TRUE);
+  g_object_unref (node);
+
+  return success;
+}
+
 void
 gimp_gegl_apply_scale (GeglBuffer            *src_buffer,
                        GimpProgress          *progress,
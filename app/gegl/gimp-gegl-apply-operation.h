@@ -33,6 +33,14 @@ void   gimp_gegl_apply_operation       (GeglBuffer            *src_buffer,
                                         GeglBuffer            *dest_buffer,
                                         const GeglRectangle   *dest_rect);
 
+gboolean gimp_gegl_apply_operation_cancelable (GeglBuffer          *src_buffer,
+                                               GimpProgress        *progress,
+                                               const gchar         *undo_desc,
+                                               GeglNode            *operation,
+                                               GeglBuffer          *dest_buffer,
+                                               const GeglRectangle *dest_rect,
+                                               gboolean             cancelable);
+
 
 /*  apply specific operations  */
 
@@ -82,6 +90,14 @@ void   gimp_gegl_apply_opacity         (GeglBuffer            *src_buffer,
                                         gint                   mask_offset_y,
                                         gdouble                opacity);
 
+gboolean gimp_gegl_apply_point_filters (GeglBuffer          *src_buffer,
+                                        GimpProgress        *progress,
+                                        const gchar         *undo_desc,
+                                        GeglBuffer          *dest_buffer,
+                                        const GeglRectangle *dest_rect,
+                                        GPtrArray           *filters,
+                                        gboolean             use_lut);
+
 void   gimp_gegl_apply_scale           (GeglBuffer            *src_buffer,
                                         GimpProgress          *progress,
                                         const gchar           *undo_desc,
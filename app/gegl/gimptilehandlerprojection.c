@@ -93,6 +93,9 @@ gimp_tile_handler_projection_init (GimpTileHandlerProjection *projection)
 
   source->command = gimp_tile_handler_projection_command;
 
+  g_mutex_init (&projection->mutex);
+  g_rec_mutex_init (&projection->validate_mutex);
+
   projection->dirty_region = cairo_region_create ();
 }
 
@@ -110,6 +113,9 @@ gimp_tile_handler_projection_finalize (GObject *object)
   cairo_region_destroy (projection->dirty_region);
   projection->dirty_region = NULL;
 
+  g_mutex_clear (&projection->mutex);
+  g_rec_mutex_clear (&projection->validate_mutex);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -179,8 +185,14 @@ gimp_tile_handler_projection_validate (GeglTileSource *source,
 
   projection = GIMP_TILE_HANDLER_PROJECTION (source);
 
+  g_mutex_lock (&projection->mutex);
+
   if (cairo_region_is_empty (projection->dirty_region))
-    return tile;
+    {
+      g_mutex_unlock (&projection->mutex);
+
+      return tile;
+    }
 
   tile_region = cairo_region_copy (projection->dirty_region);
 
@@ -191,6 +203,8 @@ gimp_tile_handler_projection_validate (GeglTileSource *source,
 
   cairo_region_intersect_rectangle (tile_region, &tile_rect);
 
+  g_mutex_unlock (&projection->mutex);
+
   if (! cairo_region_is_empty (tile_region))
     {
       gint tile_bpp;
@@ -202,8 +216,6 @@ gimp_tile_handler_projection_validate (GeglTileSource *source,
         tile = gegl_tile_handler_create_tile (GEGL_TILE_HANDLER (source),
                                               x, y, 0);
 
-      cairo_region_subtract_rectangle (projection->dirty_region, &tile_rect);
-
       tile_bpp    = babl_format_get_bytes_per_pixel (projection->format);
       tile_stride = tile_bpp * projection->tile_width;
 
@@ -243,6 +255,15 @@ gimp_tile_handler_projection_validate (GeglTileSource *source,
         }
 
       gegl_tile_unlock (tile);
+
+      /*  the tile's area is only clean once it is completely rendered,
+       *  until then other threads wait in validate_mutex
+       */
+      g_mutex_lock (&projection->mutex);
+
+      cairo_region_subtract (projection->dirty_region, tile_region);
+
+      g_mutex_unlock (&projection->mutex);
     }
 
   cairo_region_destroy (tile_region);
@@ -258,12 +279,31 @@ gimp_tile_handler_projection_command (GeglTileSource  *source,
                                       gint             z,
                                       gpointer         data)
 {
-  gpointer retval;
+  GimpTileHandlerProjection *projection;
+  gpointer                   retval;
 
-  retval = gegl_tile_handler_source_command (source, command, x, y, z, data);
+  projection = GIMP_TILE_HANDLER_PROJECTION (source);
 
   if (command == GEGL_TILE_GET && z == 0)
-    retval = gimp_tile_handler_projection_validate (source, retval, x, y);
+    {
+      /*  the graph is evaluated by one thread at a time, and a tile
+       *  can't be fetched while it's being rendered.  the mutex is
+       *  recursive, so fetching another tile of the buffer while
+       *  rendering doesn't deadlock
+       */
+      g_rec_mutex_lock (&projection->validate_mutex);
+
+      retval = gegl_tile_handler_source_command (source, command,
+                                                 x, y, z, data);
+      retval = gimp_tile_handler_projection_validate (source, retval, x, y);
+
+      g_rec_mutex_unlock (&projection->validate_mutex);
+    }
+  else
+    {
+      retval = gegl_tile_handler_source_command (source, command,
+                                                 x, y, z, data);
+    }
 
   return retval;
 }
@@ -330,8 +370,12 @@ gimp_tile_handler_projection_invalidate (GimpTileHandlerProjection *projection,
 
   g_return_if_fail (GIMP_IS_TILE_HANDLER_PROJECTION (projection));
 
+  g_mutex_lock (&projection->mutex);
+
   cairo_region_union_rectangle (projection->dirty_region, &rect);
 
+  g_mutex_unlock (&projection->mutex);
+
   if (projection->max_z > 0)
     {
       GeglTileSource *source = GEGL_TILE_SOURCE (projection);
@@ -368,5 +412,9 @@ gimp_tile_handler_projection_undo_invalidate (GimpTileHandlerProjection *project
 
   g_return_if_fail (GIMP_IS_TILE_HANDLER_PROJECTION (projection));
 
+  g_mutex_lock (&projection->mutex);
+
   cairo_region_subtract_rectangle (projection->dirty_region, &rect);
+
+  g_mutex_unlock (&projection->mutex);
 }
@@ -43,6 +43,8 @@ struct _GimpTileHandlerProjection
   GeglTileHandler  parent_instance;
 
   GeglNode        *graph;
+  GMutex           mutex;
+  GRecMutex        validate_mutex;
   cairo_region_t  *dirty_region;
   const Babl      *format;
   gint             tile_width;
@@ -30,6 +30,7 @@
 
 
 static GHashTable *class_hash = NULL;
+static GMutex      class_hash_mutex;
 
 
 void
@@ -52,6 +53,8 @@ gimp_debug_add_instance (GObject      *instance,
       GHashTable  *instance_hash;
       const gchar *type_name;
 
+      g_mutex_lock (&class_hash_mutex);
+
       type_name = g_type_name (G_TYPE_FROM_CLASS (klass));
 
       instance_hash = g_hash_table_lookup (class_hash, type_name);
@@ -64,6 +67,8 @@ gimp_debug_add_instance (GObject      *instance,
         }
 
       g_hash_table_insert (instance_hash, instance, instance);
+
+      g_mutex_unlock (&class_hash_mutex);
     }
 }
 
@@ -75,6 +80,8 @@ gimp_debug_remove_instance (GObject *instance)
       GHashTable  *instance_hash;
       const gchar *type_name;
 
+      g_mutex_lock (&class_hash_mutex);
+
       type_name = g_type_name (G_OBJECT_TYPE (instance));
 
       instance_hash = g_hash_table_lookup (class_hash, type_name);
@@ -86,6 +93,8 @@ gimp_debug_remove_instance (GObject *instance)
           if (g_hash_table_size (instance_hash) == 0)
             g_hash_table_remove (class_hash, type_name);
         }
+
+      g_mutex_unlock (&class_hash_mutex);
     }
 }
 
@@ -40,7 +40,8 @@ typedef enum
   GIMP_LOG_INSTANCES          = 1 << 16,
   GIMP_LOG_RECTANGLE_TOOL     = 1 << 17,
   GIMP_LOG_BRUSH_CACHE        = 1 << 18,
-  GIMP_LOG_PROJECTION         = 1 << 19
+  GIMP_LOG_PROJECTION         = 1 << 19,
+  GIMP_LOG_UNDO               = 1 << 20
 } GimpLogFlags;
 
 
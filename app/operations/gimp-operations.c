@@ -47,6 +47,7 @@
 #include "gimpoperationdesaturate.h"
 #include "gimpoperationhuesaturation.h"
 #include "gimpoperationlevels.h"
+#include "gimpoperationpointchain.h"
 #include "gimpoperationposterize.h"
 #include "gimpoperationthreshold.h"
 
@@ -102,6 +103,7 @@ gimp_operations_init (void)
   g_type_class_ref (GIMP_TYPE_OPERATION_DESATURATE);
   g_type_class_ref (GIMP_TYPE_OPERATION_HUE_SATURATION);
   g_type_class_ref (GIMP_TYPE_OPERATION_LEVELS);
+  g_type_class_ref (GIMP_TYPE_OPERATION_POINT_CHAIN);
   g_type_class_ref (GIMP_TYPE_OPERATION_POSTERIZE);
   g_type_class_ref (GIMP_TYPE_OPERATION_THRESHOLD);
 
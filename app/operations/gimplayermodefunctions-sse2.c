@@ -0,0 +1,307 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995-1999 Spencer Kimball and Peter Mattis
+ *
+ * gimplayermodefunctions-sse2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+
+#include "operations-types.h"
+
+#include "gimpoperationmultiplymode.h"
+#include "gimpoperationscreenmode.h"
+#include "gimpoperationoverlaymode.h"
+#include "gimpoperationdifferencemode.h"
+#include "gimpoperationadditionmode.h"
+#include "gimpoperationsubtractmode.h"
+#include "gimpoperationdarkenonlymode.h"
+#include "gimpoperationlightenonlymode.h"
+#include "gimpoperationdividemode.h"
+#include "gimpoperationdodgemode.h"
+#include "gimpoperationburnmode.h"
+#include "gimpoperationhardlightmode.h"
+#include "gimpoperationsoftlightmode.h"
+#include "gimpoperationgrainextractmode.h"
+#include "gimpoperationgrainmergemode.h"
+
+#if COMPILE_SSE2_INTRINISICS
+/* SSE2 */
+#include <emmintrin.h>
+
+
+/*  All separable layer modes share the same compositing step, they only
+ *  differ in how the composite color is computed from the two inputs.
+ *  The kernels below handle one RGBA pixel per vector and produce the
+ *  same results as the scalar process_pixels functions of the modes.
+ */
+
+static inline __m128
+layer_mode_composite_sse2 (__m128 v_in,
+                           __m128 v_layer,
+                           __m128 v_comp,
+                           __m128 v_opacity,
+                           __m128 v_alpha_mask,
+                           __m128 v_mask)
+{
+  const __m128 zero = _mm_setzero_ps ();
+  const __m128 one  = _mm_set1_ps (1.0f);
+  __m128       in_alpha;
+  __m128       comp_alpha;
+  __m128       new_alpha;
+  __m128       ratio;
+  __m128       valid;
+  __m128       out;
+
+  in_alpha   = _mm_shuffle_ps (v_in, v_in, _MM_SHUFFLE (3, 3, 3, 3));
+  comp_alpha = _mm_min_ps (in_alpha,
+                           _mm_shuffle_ps (v_layer, v_layer,
+                                           _MM_SHUFFLE (3, 3, 3, 3)));
+  comp_alpha = _mm_mul_ps (_mm_mul_ps (comp_alpha, v_opacity), v_mask);
+
+  new_alpha = _mm_add_ps (in_alpha,
+                          _mm_mul_ps (_mm_sub_ps (one, in_alpha), comp_alpha));
+
+  valid = _mm_and_ps (_mm_cmpneq_ps (comp_alpha, zero),
+                      _mm_cmpneq_ps (new_alpha, zero));
+
+  ratio = _mm_div_ps (comp_alpha, new_alpha);
+
+  out = _mm_add_ps (_mm_mul_ps (v_comp, ratio),
+                    _mm_mul_ps (v_in, _mm_sub_ps (one, ratio)));
+
+  /*  keep the input where nothing gets composited, and always keep
+   *  the input's alpha
+   */
+  valid = _mm_andnot_ps (v_alpha_mask, valid);
+
+  return _mm_or_ps (_mm_and_ps (valid, out), _mm_andnot_ps (valid, v_in));
+}
+
+#define LAYER_MODE_SSE2(name)                                                 \
+gboolean                                                                      \
+gimp_operation_##name##_mode_process_pixels_sse2 (gfloat              *in,    \
+                                                  gfloat              *layer, \
+                                                  gfloat              *mask,  \
+                                                  gfloat              *out,   \
+                                                  gfloat               opacity, \
+                                                  glong                samples, \
+                                                  const GeglRectangle *roi,   \
+                                                  gint                 level) \
+{                                                                             \
+  const __m128 v_opacity    = _mm_set1_ps (opacity);                          \
+  const __m128 v_alpha_mask = _mm_castsi128_ps (_mm_set_epi32 (-1, 0, 0, 0)); \
+  __m128       v_mask       = _mm_set1_ps (1.0f);                             \
+                                                                              \
+  while (samples--)                                                           \
+    {                                                                         \
+      __m128 v_in    = _mm_loadu_ps (in);                                     \
+      __m128 v_layer = _mm_loadu_ps (layer);                                  \
+                                                                              \
+      if (mask)                                                               \
+        v_mask = _mm_set1_ps (*mask++);                                       \
+                                                                              \
+      _mm_storeu_ps (out,                                                     \
+                     layer_mode_composite_sse2 (v_in, v_layer,                \
+                                                name##_blend_sse2 (v_in,      \
+                                                                   v_layer),  \
+                                                v_opacity, v_alpha_mask,      \
+                                                v_mask));                     \
+                                                                              \
+      in    += 4;                                                             \
+      layer += 4;                                                             \
+      out   += 4;                                                             \
+    }                                                                         \
+                                                                              \
+  return TRUE;                                                                \
+}
+
+static inline __m128
+clamp_sse2 (__m128 v)
+{
+  return _mm_max_ps (_mm_min_ps (v, _mm_set1_ps (1.0f)), _mm_setzero_ps ());
+}
+
+static inline __m128
+multiply_blend_sse2 (__m128 in,
+                     __m128 layer)
+{
+  return clamp_sse2 (_mm_mul_ps (layer, in));
+}
+
+static inline __m128
+screen_blend_sse2 (__m128 in,
+                   __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+
+  return _mm_sub_ps (one, _mm_mul_ps (_mm_sub_ps (one, in),
+                                      _mm_sub_ps (one, layer)));
+}
+
+static inline __m128
+overlay_blend_sse2 (__m128 in,
+                    __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+  __m128       t;
+
+  t = _mm_mul_ps (_mm_add_ps (layer, layer), _mm_sub_ps (one, in));
+
+  return _mm_mul_ps (in, _mm_add_ps (in, t));
+}
+
+static inline __m128
+difference_blend_sse2 (__m128 in,
+                       __m128 layer)
+{
+  const __m128 sign = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+
+  return _mm_and_ps (_mm_sub_ps (in, layer), sign);
+}
+
+static inline __m128
+addition_blend_sse2 (__m128 in,
+                     __m128 layer)
+{
+  return clamp_sse2 (_mm_add_ps (in, layer));
+}
+
+static inline __m128
+subtract_blend_sse2 (__m128 in,
+                     __m128 layer)
+{
+  return _mm_max_ps (_mm_sub_ps (in, layer), _mm_setzero_ps ());
+}
+
+static inline __m128
+darken_only_blend_sse2 (__m128 in,
+                        __m128 layer)
+{
+  return _mm_min_ps (in, layer);
+}
+
+static inline __m128
+lighten_only_blend_sse2 (__m128 in,
+                         __m128 layer)
+{
+  return _mm_max_ps (layer, in);
+}
+
+static inline __m128
+divide_blend_sse2 (__m128 in,
+                   __m128 layer)
+{
+  __m128 comp;
+
+  comp = _mm_div_ps (_mm_mul_ps (_mm_set1_ps (256.0f / 255.0f), in),
+                     _mm_add_ps (_mm_set1_ps (1.0f / 255.0f), layer));
+
+  return _mm_min_ps (comp, _mm_set1_ps (1.0f));
+}
+
+static inline __m128
+dodge_blend_sse2 (__m128 in,
+                  __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+
+  return _mm_min_ps (_mm_div_ps (in, _mm_sub_ps (one, layer)), one);
+}
+
+static inline __m128
+burn_blend_sse2 (__m128 in,
+                 __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+
+  return clamp_sse2 (_mm_sub_ps (one,
+                                 _mm_div_ps (_mm_sub_ps (one, in), layer)));
+}
+
+static inline __m128
+hardlight_blend_sse2 (__m128 in,
+                      __m128 layer)
+{
+  const __m128 one  = _mm_set1_ps (1.0f);
+  const __m128 half = _mm_set1_ps (0.5f);
+  const __m128 two  = _mm_set1_ps (2.0f);
+  __m128       light;
+  __m128       dark;
+  __m128       select;
+
+  light = _mm_mul_ps (_mm_sub_ps (one, in),
+                      _mm_sub_ps (one, _mm_mul_ps (_mm_sub_ps (layer, half),
+                                                   two)));
+  light = _mm_min_ps (_mm_sub_ps (one, light), one);
+
+  dark = _mm_min_ps (_mm_mul_ps (in, _mm_mul_ps (layer, two)), one);
+
+  select = _mm_cmpgt_ps (layer, half);
+
+  return _mm_or_ps (_mm_and_ps (select, light), _mm_andnot_ps (select, dark));
+}
+
+static inline __m128
+softlight_blend_sse2 (__m128 in,
+                      __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+  __m128       multiply;
+  __m128       screen;
+
+  multiply = _mm_mul_ps (in, layer);
+  screen   = _mm_sub_ps (one, _mm_mul_ps (_mm_sub_ps (one, in),
+                                          _mm_sub_ps (one, layer)));
+
+  return _mm_add_ps (_mm_mul_ps (_mm_sub_ps (one, in), multiply),
+                     _mm_mul_ps (in, screen));
+}
+
+static inline __m128
+grain_extract_blend_sse2 (__m128 in,
+                          __m128 layer)
+{
+  return clamp_sse2 (_mm_add_ps (_mm_sub_ps (in, layer),
+                                 _mm_set1_ps (0.5f)));
+}
+
+static inline __m128
+grain_merge_blend_sse2 (__m128 in,
+                        __m128 layer)
+{
+  return clamp_sse2 (_mm_sub_ps (_mm_add_ps (in, layer),
+                                 _mm_set1_ps (0.5f)));
+}
+
+LAYER_MODE_SSE2 (multiply)
+LAYER_MODE_SSE2 (screen)
+LAYER_MODE_SSE2 (overlay)
+LAYER_MODE_SSE2 (difference)
+LAYER_MODE_SSE2 (addition)
+LAYER_MODE_SSE2 (subtract)
+LAYER_MODE_SSE2 (darken_only)
+LAYER_MODE_SSE2 (lighten_only)
+LAYER_MODE_SSE2 (divide)
+LAYER_MODE_SSE2 (dodge)
+LAYER_MODE_SSE2 (burn)
+LAYER_MODE_SSE2 (hardlight)
+LAYER_MODE_SSE2 (softlight)
+LAYER_MODE_SSE2 (grain_extract)
+LAYER_MODE_SSE2 (grain_merge)
+
+#endif /* COMPILE_SSE2_INTRINISICS */
@@ -22,6 +22,9 @@
 
 #include <gegl.h>
 #include <gegl-plugin.h>
+
+#include "libgimpbase/gimpbase.h"
+
 #include "operations-types.h"
 
 #include "gimplayermodefunctions.h"
@@ -54,35 +57,52 @@
 #include "gimpoperationreplacemode.h"
 #include "gimpoperationantierasemode.h"
 
+
+#if COMPILE_SSE2_INTRINISICS
+#define LAYER_MODE_FUNCTION(name)                              \
+  (use_sse2 ?                                                  \
+   gimp_operation_##name##_mode_process_pixels_sse2 :          \
+   gimp_operation_##name##_mode_process_pixels)
+#else
+#define LAYER_MODE_FUNCTION(name)                              \
+  gimp_operation_##name##_mode_process_pixels
+#endif /* COMPILE_SSE2_INTRINISICS */
+
 GimpLayerModeFunction
 get_layer_mode_function (GimpLayerModeEffects paint_mode)
 {
   GimpLayerModeFunction func = gimp_operation_normal_mode_process_pixels;
+#if COMPILE_SSE2_INTRINISICS
+  static gint           use_sse2 = -1;
+
+  if (use_sse2 < 0)
+    use_sse2 = (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2) != 0;
+#endif /* COMPILE_SSE2_INTRINISICS */
 
   switch (paint_mode)
     {
       case GIMP_NORMAL_MODE:        func = gimp_operation_normal_mode_process_pixels; break;
       case GIMP_DISSOLVE_MODE:      func = gimp_operation_dissolve_mode_process_pixels; break;
       case GIMP_BEHIND_MODE:        func = gimp_operation_behind_mode_process_pixels; break;
-      case GIMP_MULTIPLY_MODE:      func = gimp_operation_multiply_mode_process_pixels; break;
-      case GIMP_SCREEN_MODE:        func = gimp_operation_screen_mode_process_pixels; break;
-      case GIMP_OVERLAY_MODE:       func = gimp_operation_overlay_mode_process_pixels; break;
-      case GIMP_DIFFERENCE_MODE:    func = gimp_operation_difference_mode_process_pixels; break;
-      case GIMP_ADDITION_MODE:      func = gimp_operation_addition_mode_process_pixels; break;
-      case GIMP_SUBTRACT_MODE:      func = gimp_operation_subtract_mode_process_pixels; break;
-      case GIMP_DARKEN_ONLY_MODE:   func = gimp_operation_darken_only_mode_process_pixels; break;
-      case GIMP_LIGHTEN_ONLY_MODE:  func = gimp_operation_lighten_only_mode_process_pixels; break;
+      case GIMP_MULTIPLY_MODE:      func = LAYER_MODE_FUNCTION (multiply); break;
+      case GIMP_SCREEN_MODE:        func = LAYER_MODE_FUNCTION (screen); break;
+      case GIMP_OVERLAY_MODE:       func = LAYER_MODE_FUNCTION (overlay); break;
+      case GIMP_DIFFERENCE_MODE:    func = LAYER_MODE_FUNCTION (difference); break;
+      case GIMP_ADDITION_MODE:      func = LAYER_MODE_FUNCTION (addition); break;
+      case GIMP_SUBTRACT_MODE:      func = LAYER_MODE_FUNCTION (subtract); break;
+      case GIMP_DARKEN_ONLY_MODE:   func = LAYER_MODE_FUNCTION (darken_only); break;
+      case GIMP_LIGHTEN_ONLY_MODE:  func = LAYER_MODE_FUNCTION (lighten_only); break;
       case GIMP_HUE_MODE:           func = gimp_operation_hue_mode_process_pixels; break;
       case GIMP_SATURATION_MODE:    func = gimp_operation_saturation_mode_process_pixels; break;
       case GIMP_COLOR_MODE:         func = gimp_operation_color_mode_process_pixels; break;
       case GIMP_VALUE_MODE:         func = gimp_operation_value_mode_process_pixels; break;
-      case GIMP_DIVIDE_MODE:        func = gimp_operation_divide_mode_process_pixels; break;
-      case GIMP_DODGE_MODE:         func = gimp_operation_dodge_mode_process_pixels; break;
-      case GIMP_BURN_MODE:          func = gimp_operation_burn_mode_process_pixels; break;
-      case GIMP_HARDLIGHT_MODE:     func = gimp_operation_hardlight_mode_process_pixels; break;
-      case GIMP_SOFTLIGHT_MODE:     func = gimp_operation_softlight_mode_process_pixels; break;
-      case GIMP_GRAIN_EXTRACT_MODE: func = gimp_operation_grain_extract_mode_process_pixels; break;
-      case GIMP_GRAIN_MERGE_MODE:   func = gimp_operation_grain_merge_mode_process_pixels; break;
+      case GIMP_DIVIDE_MODE:        func = LAYER_MODE_FUNCTION (divide); break;
+      case GIMP_DODGE_MODE:         func = LAYER_MODE_FUNCTION (dodge); break;
+      case GIMP_BURN_MODE:          func = LAYER_MODE_FUNCTION (burn); break;
+      case GIMP_HARDLIGHT_MODE:     func = LAYER_MODE_FUNCTION (hardlight); break;
+      case GIMP_SOFTLIGHT_MODE:     func = LAYER_MODE_FUNCTION (softlight); break;
+      case GIMP_GRAIN_EXTRACT_MODE: func = LAYER_MODE_FUNCTION (grain_extract); break;
+      case GIMP_GRAIN_MERGE_MODE:   func = LAYER_MODE_FUNCTION (grain_merge); break;
       case GIMP_COLOR_ERASE_MODE:   func = gimp_operation_color_erase_mode_process_pixels; break;
       case GIMP_ERASE_MODE:         func = gimp_operation_erase_mode_process_pixels; break;
       case GIMP_REPLACE_MODE:       func = gimp_operation_replace_mode_process_pixels; break;
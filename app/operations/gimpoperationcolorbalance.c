@@ -33,6 +33,9 @@
 #include "gimpoperationcolorbalance.h"
 
 
+#define BLOCK_SIZE 64
+
+
 static gboolean gimp_operation_color_balance_process (GeglOperation       *operation,
                                                       void                *in_buf,
                                                       void                *out_buf,
@@ -131,65 +134,59 @@ gimp_operation_color_balance_process (GeglOperation       *operation,
   if (! config)
     return FALSE;
 
-  while (samples--)
+  while (samples > 0)
     {
-      gfloat r = src[RED];
-      gfloat g = src[GREEN];
-      gfloat b = src[BLUE];
-      gfloat r_n;
-      gfloat g_n;
-      gfloat b_n;
-
-      GimpRGB rgb = { r, g, b};
-      GimpHSL hsl;
+      gfloat hsla[BLOCK_SIZE * 4];
+      glong  n = MIN (samples, BLOCK_SIZE);
+      glong  i;
 
-      gimp_rgb_to_hsl (&rgb, &hsl);
+      gimp_rgb_to_hsl_array (src, hsla, n);
 
-      r_n = gimp_operation_color_balance_map (r, hsl.l,
+      for (i = 0; i < n; i++)
+        {
+          gfloat r = src[4 * i + RED];
+          gfloat g = src[4 * i + GREEN];
+          gfloat b = src[4 * i + BLUE];
+          gfloat a = src[4 * i + ALPHA];
+          gfloat l = hsla[4 * i + 2];
+
+          dest[4 * i + RED] =
+            gimp_operation_color_balance_map (r, l,
                                               config->cyan_red[GIMP_SHADOWS],
                                               config->cyan_red[GIMP_MIDTONES],
                                               config->cyan_red[GIMP_HIGHLIGHTS]);
 
-      g_n = gimp_operation_color_balance_map (g, hsl.l,
+          dest[4 * i + GREEN] =
+            gimp_operation_color_balance_map (g, l,
                                               config->magenta_green[GIMP_SHADOWS],
                                               config->magenta_green[GIMP_MIDTONES],
                                               config->magenta_green[GIMP_HIGHLIGHTS]);
 
-      b_n = gimp_operation_color_balance_map (b, hsl.l,
+          dest[4 * i + BLUE] =
+            gimp_operation_color_balance_map (b, l,
                                               config->yellow_blue[GIMP_SHADOWS],
                                               config->yellow_blue[GIMP_MIDTONES],
                                               config->yellow_blue[GIMP_HIGHLIGHTS]);
 
+          dest[4 * i + ALPHA] = a;
+        }
+
       if (config->preserve_luminosity)
         {
-          GimpHSL hsl2;
-
-          rgb.r = r_n;
-          rgb.g = g_n;
-          rgb.b = b_n;
-          gimp_rgb_to_hsl (&rgb, &hsl);
+          gfloat new_hsla[BLOCK_SIZE * 4];
 
-          rgb.r = r;
-          rgb.g = g;
-          rgb.b = b;
-          gimp_rgb_to_hsl (&rgb, &hsl2);
+          /*  give the balanced pixels their original lightness  */
+          gimp_rgb_to_hsl_array (dest, new_hsla, n);
 
-          hsl.l = hsl2.l;
+          for (i = 0; i < n; i++)
+            new_hsla[4 * i + 2] = hsla[4 * i + 2];
 
-          gimp_hsl_to_rgb (&hsl, &rgb);
-
-          r_n = rgb.r;
-          g_n = rgb.g;
-          b_n = rgb.b;
+          gimp_hsl_to_rgb_array (new_hsla, dest, n);
         }
 
-      dest[RED]   = r_n;
-      dest[GREEN] = g_n;
-      dest[BLUE]  = b_n;
-      dest[ALPHA] = src[ALPHA];
-
-      src  += 4;
-      dest += 4;
+      src     += 4 * n;
+      dest    += 4 * n;
+      samples -= n;
     }
 
   return TRUE;
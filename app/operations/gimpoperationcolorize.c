@@ -98,7 +98,6 @@ gimp_operation_colorize_process (GeglOperation       *operation,
 
   hsl.h = config->hue;
   hsl.s = config->saturation;
-  hsl.a = src[ALPHA];
 
   while (samples--)
     {
@@ -119,6 +118,7 @@ gimp_operation_colorize_process (GeglOperation       *operation,
         }
 
       hsl.l = lum;
+      hsl.a = src[ALPHA];
 
       gimp_hsl_to_rgb (&hsl, &rgb);
 
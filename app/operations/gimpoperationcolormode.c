@@ -32,6 +32,9 @@
 #include "gimpoperationcolormode.h"
 
 
+#define BLOCK_SIZE 64
+
+
 static gboolean gimp_operation_color_mode_process (GeglOperation       *operation,
                                                    void                *in_buf,
                                                    void                *aux_buf,
@@ -95,58 +98,67 @@ gimp_operation_color_mode_process_pixels (gfloat              *in,
 {
   const gboolean has_mask = mask != NULL;
 
-  while (samples--)
+  while (samples > 0)
     {
-      GimpHSL layer_hsl, out_hsl;
-      GimpRGB layer_rgb = {layer[0], layer[1], layer[2]};
-      GimpRGB out_rgb   = {in[0], in[1], in[2]};
-      gfloat  comp_alpha, new_alpha;
+      gfloat layer_hsl[BLOCK_SIZE * 4];
+      gfloat out_hsl[BLOCK_SIZE * 4];
+      glong  n = MIN (samples, BLOCK_SIZE);
+      glong  i;
 
-      comp_alpha = MIN (in[ALPHA], layer[ALPHA]) * opacity;
-      if (has_mask)
-        comp_alpha *= *mask;
+      gimp_rgb_to_hsl_array (layer, layer_hsl, n);
+      gimp_rgb_to_hsl_array (in,    out_hsl,   n);
 
-      new_alpha = in[ALPHA] + (1.0 - in[ALPHA]) * comp_alpha;
-
-      if (comp_alpha && new_alpha)
+      for (i = 0; i < n; i++)
         {
-          gint   b;
-          gfloat ratio = comp_alpha / new_alpha;
+          out_hsl[4 * i + 0] = layer_hsl[4 * i + 0];
+          out_hsl[4 * i + 1] = layer_hsl[4 * i + 1];
+        }
 
-          gimp_rgb_to_hsl (&layer_rgb, &layer_hsl);
-          gimp_rgb_to_hsl (&out_rgb, &out_hsl);
+      /*  converted in place, out_hsl holds RGB from here on  */
+      gimp_hsl_to_rgb_array (out_hsl, out_hsl, n);
 
-          out_hsl.h = layer_hsl.h;
-          out_hsl.s = layer_hsl.s;
-          gimp_hsl_to_rgb (&out_hsl, &out_rgb);
+      for (i = 0; i < n; i++)
+        {
+          const gfloat *out_rgb = out_hsl + 4 * i;
+          gfloat        comp_alpha, new_alpha;
+
+          comp_alpha = MIN (in[ALPHA], layer[ALPHA]) * opacity;
+          if (has_mask)
+            comp_alpha *= *mask;
 
-          out[0] = out_rgb.r;
-          out[1] = out_rgb.g;
-          out[2] = out_rgb.b;
+          new_alpha = in[ALPHA] + (1.0 - in[ALPHA]) * comp_alpha;
 
-          for (b = RED; b < ALPHA; b++)
+          if (comp_alpha && new_alpha)
             {
-              out[b] = out[b] * ratio + in[b] * (1.0 - ratio);
-            }
-        }
-      else
-        {
-          gint b;
+              gint   b;
+              gfloat ratio = comp_alpha / new_alpha;
 
-          for (b = RED; b < ALPHA; b++)
+              for (b = RED; b < ALPHA; b++)
+                {
+                  out[b] = out_rgb[b] * ratio + in[b] * (1.0 - ratio);
+                }
+            }
+          else
             {
-              out[b] = in[b];
+              gint b;
+
+              for (b = RED; b < ALPHA; b++)
+                {
+                  out[b] = in[b];
+                }
             }
-        }
 
-      out[ALPHA] = in[ALPHA];
+          out[ALPHA] = in[ALPHA];
+
+          in    += 4;
+          layer += 4;
+          out   += 4;
 
-      in    += 4;
-      layer += 4;
-      out   += 4;
+          if (has_mask)
+            mask++;
+        }
 
-      if (has_mask)
-        mask++;
+      samples -= n;
     }
 
   return TRUE;
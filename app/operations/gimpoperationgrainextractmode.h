@@ -58,4 +58,13 @@ gboolean gimp_operation_grain_extract_mode_process_pixels (gfloat              *
                                                            const GeglRectangle *roi,
                                                            gint                 level);
 
+gboolean gimp_operation_grain_extract_mode_process_pixels_sse2 (gfloat              *in,
+                                                                gfloat              *layer,
+                                                                gfloat              *mask,
+                                                                gfloat              *out,
+                                                                gfloat               opacity,
+                                                                glong                samples,
+                                                                const GeglRectangle *roi,
+                                                                gint                 level);
+
 #endif /* __GIMP_OPERATION_GRAIN_EXTRACT_MODE_H__ */
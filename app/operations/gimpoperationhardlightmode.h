@@ -58,4 +58,13 @@ gboolean gimp_operation_hardlight_mode_process_pixels (gfloat              *in,
                                                        const GeglRectangle *roi,
                                                        gint                 level);
 
+gboolean gimp_operation_hardlight_mode_process_pixels_sse2 (gfloat              *in,
+                                                            gfloat              *layer,
+                                                            gfloat              *mask,
+                                                            gfloat              *out,
+                                                            gfloat               opacity,
+                                                            glong                samples,
+                                                            const GeglRectangle *roi,
+                                                            gint                 level);
+
 #endif /* __GIMP_OPERATION_HARDLIGHT_MODE_H__ */
@@ -33,6 +33,9 @@
 #include "gimpoperationhuesaturation.h"
 
 
+#define BLOCK_SIZE 64
+
+
 static gboolean gimp_operation_hue_saturation_process (GeglOperation       *operation,
                                                        void                *in_buf,
                                                        void                *out_buf,
@@ -147,117 +150,114 @@ gimp_operation_hue_saturation_process (GeglOperation       *operation,
 
   overlap = config->overlap / 2.0;
 
-  while (samples--)
+  while (samples > 0)
     {
-      GimpRGB  rgb;
-      GimpHSL  hsl;
-      gdouble  h;
-      gint     hue_counter;
-      gint     hue                 = 0;
-      gint     secondary_hue       = 0;
-      gboolean use_secondary_hue   = FALSE;
-      gfloat   primary_intensity   = 0.0;
-      gfloat   secondary_intensity = 0.0;
-
-      rgb.r = src[RED];
-      rgb.g = src[GREEN];
-      rgb.b = src[BLUE];
-      rgb.a = src[ALPHA];
-
-      gimp_rgb_to_hsl (&rgb, &hsl);
-
-      h = hsl.h * 6.0;
-
-      for (hue_counter = 0; hue_counter < 7; hue_counter++)
-        {
-          gdouble hue_threshold = (gdouble) hue_counter + 0.5;
+      gfloat hsla[BLOCK_SIZE * 4];
+      glong  n = MIN (samples, BLOCK_SIZE);
+      glong  i;
 
-          if (h < ((gdouble) hue_threshold + overlap))
+      gimp_rgb_to_hsl_array (src, hsla, n);
+
+      for (i = 0; i < n; i++)
+        {
+          gfloat  *hsl = hsla + 4 * i;
+          gdouble  h;
+          gint     hue_counter;
+          gint     hue                 = 0;
+          gint     secondary_hue       = 0;
+          gboolean use_secondary_hue   = FALSE;
+          gfloat   primary_intensity   = 0.0;
+          gfloat   secondary_intensity = 0.0;
+
+          h = hsl[0] * 6.0;
+
+          for (hue_counter = 0; hue_counter < 7; hue_counter++)
             {
-              hue = hue_counter;
+              gdouble hue_threshold = (gdouble) hue_counter + 0.5;
 
-              if (overlap > 0.0 && h > ((gdouble) hue_threshold - overlap))
+              if (h < ((gdouble) hue_threshold + overlap))
                 {
-                  use_secondary_hue = TRUE;
+                  hue = hue_counter;
 
-                  secondary_hue = hue_counter + 1;
+                  if (overlap > 0.0 && h > ((gdouble) hue_threshold - overlap))
+                    {
+                      use_secondary_hue = TRUE;
 
-                  secondary_intensity =
-                    (h - (gdouble) hue_threshold + overlap) / (2.0 * overlap);
+                      secondary_hue = hue_counter + 1;
 
-                  primary_intensity = 1.0 - secondary_intensity;
-                }
-              else
-                {
-                  use_secondary_hue = FALSE;
-                }
+                      secondary_intensity =
+                        (h - (gdouble) hue_threshold + overlap) / (2.0 * overlap);
 
-              break;
-            }
-        }
-
-      if (hue >= 6)
-        {
-          hue = 0;
-          use_secondary_hue = FALSE;
-        }
+                      primary_intensity = 1.0 - secondary_intensity;
+                    }
+                  else
+                    {
+                      use_secondary_hue = FALSE;
+                    }
 
-      if (secondary_hue >= 6)
-        {
-          secondary_hue = 0;
-        }
-
-      /*  transform into GimpHueRange values  */
-      hue++;
-      secondary_hue++;
+                  break;
+                }
+            }
 
-      if (use_secondary_hue)
-        {
-          gdouble mapped_primary_hue;
-          gdouble mapped_secondary_hue;
-          gdouble diff;
-
-          mapped_primary_hue   = map_hue (config, hue,           hsl.h);
-          mapped_secondary_hue = map_hue (config, secondary_hue, hsl.h);
-
-          /* Find nearest hue on the circle between primary and
-           * secondary hue
-           */
-          diff = mapped_primary_hue - mapped_secondary_hue;
-          if (diff < -0.5)
+          if (hue >= 6)
             {
-              mapped_secondary_hue -= 1.0;
+              hue = 0;
+              use_secondary_hue = FALSE;
             }
-          else if (diff >= 0.5)
+
+          if (secondary_hue >= 6)
             {
-              mapped_secondary_hue += 1.0;
+              secondary_hue = 0;
             }
 
-          hsl.h = (mapped_primary_hue   * primary_intensity +
-                   mapped_secondary_hue * secondary_intensity);
+          /*  transform into GimpHueRange values  */
+          hue++;
+          secondary_hue++;
+
+          if (use_secondary_hue)
+            {
+              gdouble mapped_primary_hue;
+              gdouble mapped_secondary_hue;
+              gdouble diff;
+
+              mapped_primary_hue   = map_hue (config, hue,           hsl[0]);
+              mapped_secondary_hue = map_hue (config, secondary_hue, hsl[0]);
+
+              /* Find nearest hue on the circle between primary and
+               * secondary hue
+               */
+              diff = mapped_primary_hue - mapped_secondary_hue;
+              if (diff < -0.5)
+                {
+                  mapped_secondary_hue -= 1.0;
+                }
+              else if (diff >= 0.5)
+                {
+                  mapped_secondary_hue += 1.0;
+                }
+
+              hsl[0] = (mapped_primary_hue   * primary_intensity +
+                        mapped_secondary_hue * secondary_intensity);
 
-          hsl.s = (map_saturation (config, hue,           hsl.s) * primary_intensity +
-                   map_saturation (config, secondary_hue, hsl.s) * secondary_intensity);
+              hsl[1] = (map_saturation (config, hue,           hsl[1]) * primary_intensity +
+                        map_saturation (config, secondary_hue, hsl[1]) * secondary_intensity);
 
-          hsl.l = (map_lightness (config, hue,           hsl.l) * primary_intensity +
-                   map_lightness (config, secondary_hue, hsl.l) * secondary_intensity);
-        }
-      else
-        {
-          hsl.h = map_hue        (config, hue, hsl.h);
-          hsl.s = map_saturation (config, hue, hsl.s);
-          hsl.l = map_lightness  (config, hue, hsl.l);
+              hsl[2] = (map_lightness (config, hue,           hsl[2]) * primary_intensity +
+                        map_lightness (config, secondary_hue, hsl[2]) * secondary_intensity);
+            }
+          else
+            {
+              hsl[0] = map_hue        (config, hue, hsl[0]);
+              hsl[1] = map_saturation (config, hue, hsl[1]);
+              hsl[2] = map_lightness  (config, hue, hsl[2]);
+            }
         }
 
-      gimp_hsl_to_rgb (&hsl, &rgb);
-
-      dest[RED]   = rgb.r;
-      dest[GREEN] = rgb.g;
-      dest[BLUE]  = rgb.b;
-      dest[ALPHA] = rgb.a;
+      gimp_hsl_to_rgb_array (hsla, dest, n);
 
-      src  += 4;
-      dest += 4;
+      src     += 4 * n;
+      dest    += 4 * n;
+      samples -= n;
     }
 
   return TRUE;
@@ -0,0 +1,385 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationpointchain.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+
+#include "operations-types.h"
+
+#include "gimpoperationpointchain.h"
+
+
+#define LUT_SIZE       GIMP_OPERATION_POINT_CHAIN_LUT_SIZE
+#define ALPHA_LUT_SIZE GIMP_OPERATION_POINT_CHAIN_ALPHA_LUT_SIZE
+
+
+enum
+{
+  PROP_0,
+  PROP_FILTERS,
+  PROP_USE_LUT
+};
+
+
+static void     gimp_operation_point_chain_finalize     (GObject             *object);
+static void     gimp_operation_point_chain_get_property (GObject             *object,
+                                                         guint                property_id,
+                                                         GValue              *value,
+                                                         GParamSpec          *pspec);
+static void     gimp_operation_point_chain_set_property (GObject             *object,
+                                                         guint                property_id,
+                                                         const GValue        *value,
+                                                         GParamSpec          *pspec);
+
+static void     gimp_operation_point_chain_prepare      (GeglOperation       *operation);
+static gboolean gimp_operation_point_chain_process      (GeglOperation       *operation,
+                                                         void                *in_buf,
+                                                         void                *out_buf,
+                                                         glong                samples,
+                                                         const GeglRectangle *roi,
+                                                         gint                 level);
+
+
+G_DEFINE_TYPE (GimpOperationPointChain, gimp_operation_point_chain,
+               GIMP_TYPE_OPERATION_POINT_FILTER)
+
+#define parent_class gimp_operation_point_chain_parent_class
+
+
+static void
+gimp_operation_point_chain_class_init (GimpOperationPointChainClass *klass)
+{
+  GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
+  GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
+  GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
+
+  object_class->finalize       = gimp_operation_point_chain_finalize;
+  object_class->set_property   = gimp_operation_point_chain_set_property;
+  object_class->get_property   = gimp_operation_point_chain_get_property;
+
+  gegl_operation_class_set_keys (operation_class,
+                                 "name",        "gimp:point-chain",
+                                 "categories",  "color",
+                                 "description", "Applies a list of GIMP point "
+                                                "filters in a single pass",
+                                 NULL);
+
+  operation_class->prepare = gimp_operation_point_chain_prepare;
+
+  point_class->process     = gimp_operation_point_chain_process;
+
+  /*  a GPtrArray of GimpOperationPointFilter instances, which are
+   *  not part of any graph, applied in array order
+   */
+  g_object_class_install_property (object_class, PROP_FILTERS,
+                                   g_param_spec_boxed ("filters",
+                                                       "Filters",
+                                                       "The point filters",
+                                                       G_TYPE_PTR_ARRAY,
+                                                       G_PARAM_READWRITE));
+
+  g_object_class_install_property (object_class, PROP_USE_LUT,
+                                   g_param_spec_boolean ("use-lut",
+                                                         "Use LUT",
+                                                         "Bake the filters into "
+                                                         "a 3D LUT for integer "
+                                                         "input",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT));
+}
+
+static void
+gimp_operation_point_chain_init (GimpOperationPointChain *self)
+{
+}
+
+static void
+gimp_operation_point_chain_finalize (GObject *object)
+{
+  GimpOperationPointChain *self = GIMP_OPERATION_POINT_CHAIN (object);
+
+  if (self->filters)
+    {
+      g_ptr_array_unref (self->filters);
+      self->filters = NULL;
+    }
+
+  if (self->lut)
+    {
+      g_free (self->lut);
+      self->lut = NULL;
+    }
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gimp_operation_point_chain_get_property (GObject    *object,
+                                         guint       property_id,
+                                         GValue     *value,
+                                         GParamSpec *pspec)
+{
+  GimpOperationPointChain *self = GIMP_OPERATION_POINT_CHAIN (object);
+
+  switch (property_id)
+    {
+    case PROP_FILTERS:
+      g_value_set_boxed (value, self->filters);
+      break;
+
+    case PROP_USE_LUT:
+      g_value_set_boolean (value, self->use_lut);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+static void
+gimp_operation_point_chain_set_property (GObject      *object,
+                                         guint         property_id,
+                                         const GValue *value,
+                                         GParamSpec   *pspec)
+{
+  GimpOperationPointChain *self = GIMP_OPERATION_POINT_CHAIN (object);
+
+  switch (property_id)
+    {
+    case PROP_FILTERS:
+      if (self->filters)
+        g_ptr_array_unref (self->filters);
+      self->filters = g_value_dup_boxed (value);
+      break;
+
+    case PROP_USE_LUT:
+      self->use_lut = g_value_get_boolean (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+/*  run all filters on the same chunk, so the pixels make only one
+ *  trip through memory instead of one per filter
+ */
+static gboolean
+gimp_operation_point_chain_process_filters (GimpOperationPointChain *self,
+                                            gfloat                  *src,
+                                            gfloat                  *dest,
+                                            glong                    samples,
+                                            const GeglRectangle     *roi,
+                                            gint                     level)
+{
+  gint i;
+
+  if (! self->filters || self->filters->len == 0)
+    {
+      if (dest != src)
+        memcpy (dest, src, samples * 4 * sizeof (gfloat));
+
+      return TRUE;
+    }
+
+  for (i = 0; i < self->filters->len; i++)
+    {
+      GeglOperation                 *filter = g_ptr_array_index (self->filters,
+                                                                 i);
+      GeglOperationPointFilterClass *klass;
+
+      klass = GEGL_OPERATION_POINT_FILTER_GET_CLASS (filter);
+
+      /*  the first filter reads the input, the others work in place  */
+      if (! klass->process (filter, i == 0 ? src : dest, dest,
+                            samples, roi, level))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+gimp_operation_point_chain_build_lut (GimpOperationPointChain *self)
+{
+  GeglRectangle  roi = { 0, 0, LUT_SIZE * LUT_SIZE * LUT_SIZE, 1 };
+  gfloat        *pixels;
+  gfloat        *p;
+  gint           r, g, b;
+  gint           i;
+
+  pixels = g_new (gfloat, roi.width * 4);
+
+  for (b = 0, p = pixels; b < LUT_SIZE; b++)
+    for (g = 0; g < LUT_SIZE; g++)
+      for (r = 0; r < LUT_SIZE; r++, p += 4)
+        {
+          p[0] = (gfloat) r / (LUT_SIZE - 1);
+          p[1] = (gfloat) g / (LUT_SIZE - 1);
+          p[2] = (gfloat) b / (LUT_SIZE - 1);
+          p[3] = 1.0;
+        }
+
+  if (! gimp_operation_point_chain_process_filters (self, pixels, pixels,
+                                                    roi.width, &roi, 0))
+    {
+      g_free (self->lut);
+      self->lut = NULL;
+
+      g_free (pixels);
+      return;
+    }
+
+  if (! self->lut)
+    self->lut = g_new (gfloat, roi.width * 3);
+
+  for (i = 0; i < roi.width; i++)
+    {
+      self->lut[i * 3 + 0] = pixels[i * 4 + 0];
+      self->lut[i * 3 + 1] = pixels[i * 4 + 1];
+      self->lut[i * 3 + 2] = pixels[i * 4 + 2];
+    }
+
+  /*  the filters map alpha independently of the color  */
+  roi.width = ALPHA_LUT_SIZE;
+
+  for (i = 0, p = pixels; i < roi.width; i++, p += 4)
+    {
+      p[0] = p[1] = p[2] = 0.5;
+      p[3] = (gfloat) i / (roi.width - 1);
+    }
+
+  gimp_operation_point_chain_process_filters (self, pixels, pixels,
+                                              roi.width, &roi, 0);
+
+  for (i = 0; i < roi.width; i++)
+    self->alpha_lut[i] = pixels[i * 4 + 3];
+
+  g_free (pixels);
+}
+
+static void
+gimp_operation_point_chain_prepare (GeglOperation *operation)
+{
+  GimpOperationPointChain *self   = GIMP_OPERATION_POINT_CHAIN (operation);
+  const Babl              *format = gegl_operation_get_source_format (operation,
+                                                                      "input");
+  const Babl              *type   = NULL;
+
+  GEGL_OPERATION_CLASS (parent_class)->prepare (operation);
+
+  if (format)
+    type = babl_format_get_type (format, 0);
+
+  /*  the LUT interpolates, only use it where the input can't be
+   *  outside [0..1] and has limited precision anyway
+   */
+  if (self->use_lut &&
+      (type == babl_type ("u8")  ||
+       type == babl_type ("u16") ||
+       type == babl_type ("u32")))
+    {
+      gimp_operation_point_chain_build_lut (self);
+    }
+  else if (self->lut)
+    {
+      g_free (self->lut);
+      self->lut = NULL;
+    }
+}
+
+static inline gfloat
+lerp (gfloat a,
+      gfloat b,
+      gfloat t)
+{
+  return a + (b - a) * t;
+}
+
+static void
+gimp_operation_point_chain_process_lut (GimpOperationPointChain *self,
+                                        const gfloat            *src,
+                                        gfloat                  *dest,
+                                        glong                    samples)
+{
+  const gfloat *lut    = self->lut;
+  const gint    g_step = LUT_SIZE * 3;
+  const gint    b_step = LUT_SIZE * LUT_SIZE * 3;
+
+  while (samples--)
+    {
+      gfloat        r  = CLAMP (src[0], 0.0, 1.0) * (LUT_SIZE - 1);
+      gfloat        g  = CLAMP (src[1], 0.0, 1.0) * (LUT_SIZE - 1);
+      gfloat        b  = CLAMP (src[2], 0.0, 1.0) * (LUT_SIZE - 1);
+      gfloat        a  = CLAMP (src[3], 0.0, 1.0) * (ALPHA_LUT_SIZE - 1);
+      gint          ri = MIN ((gint) r, LUT_SIZE - 2);
+      gint          gi = MIN ((gint) g, LUT_SIZE - 2);
+      gint          bi = MIN ((gint) b, LUT_SIZE - 2);
+      gint          ai = MIN ((gint) a, ALPHA_LUT_SIZE - 2);
+      const gfloat *c  = lut + bi * b_step + gi * g_step + ri * 3;
+      gint          k;
+
+      r -= ri;
+      g -= gi;
+      b -= bi;
+      a -= ai;
+
+      for (k = 0; k < 3; k++)
+        {
+          gfloat c00 = lerp (c[k],                   c[k + 3],                   r);
+          gfloat c10 = lerp (c[k + g_step],          c[k + g_step + 3],          r);
+          gfloat c01 = lerp (c[k + b_step],          c[k + b_step + 3],          r);
+          gfloat c11 = lerp (c[k + b_step + g_step], c[k + b_step + g_step + 3], r);
+
+          dest[k] = lerp (lerp (c00, c10, g), lerp (c01, c11, g), b);
+        }
+
+      dest[3] = lerp (self->alpha_lut[ai], self->alpha_lut[ai + 1], a);
+
+      src  += 4;
+      dest += 4;
+    }
+}
+
+static gboolean
+gimp_operation_point_chain_process (GeglOperation       *operation,
+                                    void                *in_buf,
+                                    void                *out_buf,
+                                    glong                samples,
+                                    const GeglRectangle *roi,
+                                    gint                 level)
+{
+  GimpOperationPointChain *self = GIMP_OPERATION_POINT_CHAIN (operation);
+
+  if (self->lut)
+    {
+      gimp_operation_point_chain_process_lut (self, in_buf, out_buf, samples);
+
+      return TRUE;
+    }
+
+  return gimp_operation_point_chain_process_filters (self, in_buf, out_buf,
+                                                     samples, roi, level);
+}
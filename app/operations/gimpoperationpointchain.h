@@ -0,0 +1,63 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationpointchain.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_OPERATION_POINT_CHAIN_H__
+#define __GIMP_OPERATION_POINT_CHAIN_H__
+
+
+#include "gimpoperationpointfilter.h"
+
+
+#define GIMP_OPERATION_POINT_CHAIN_LUT_SIZE       33
+#define GIMP_OPERATION_POINT_CHAIN_ALPHA_LUT_SIZE 256
+
+
+#define GIMP_TYPE_OPERATION_POINT_CHAIN            (gimp_operation_point_chain_get_type ())
+#define GIMP_OPERATION_POINT_CHAIN(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIMP_TYPE_OPERATION_POINT_CHAIN, GimpOperationPointChain))
+#define GIMP_OPERATION_POINT_CHAIN_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  GIMP_TYPE_OPERATION_POINT_CHAIN, GimpOperationPointChainClass))
+#define GIMP_IS_OPERATION_POINT_CHAIN(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIMP_TYPE_OPERATION_POINT_CHAIN))
+#define GIMP_IS_OPERATION_POINT_CHAIN_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  GIMP_TYPE_OPERATION_POINT_CHAIN))
+#define GIMP_OPERATION_POINT_CHAIN_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  GIMP_TYPE_OPERATION_POINT_CHAIN, GimpOperationPointChainClass))
+
+
+typedef struct _GimpOperationPointChain      GimpOperationPointChain;
+typedef struct _GimpOperationPointChainClass GimpOperationPointChainClass;
+
+struct _GimpOperationPointChain
+{
+  GimpOperationPointFilter  parent_instance;
+
+  GPtrArray                *filters;
+  gboolean                  use_lut;
+
+  /*  baked in prepare() if use_lut is set and the input is integer  */
+  gfloat                   *lut;
+  gfloat                    alpha_lut[GIMP_OPERATION_POINT_CHAIN_ALPHA_LUT_SIZE];
+};
+
+struct _GimpOperationPointChainClass
+{
+  GimpOperationPointFilterClass  parent_class;
+};
+
+
+GType   gimp_operation_point_chain_get_type (void) G_GNUC_CONST;
+
+
+#endif /* __GIMP_OPERATION_POINT_CHAIN_H__ */
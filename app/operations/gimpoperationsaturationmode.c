@@ -32,6 +32,9 @@
 #include "gimpoperationsaturationmode.h"
 
 
+#define BLOCK_SIZE 64
+
+
 static gboolean gimp_operation_saturation_mode_process (GeglOperation       *operation,
                                                         void                *in_buf,
                                                         void                *aux_buf,
@@ -95,57 +98,66 @@ gimp_operation_saturation_mode_process_pixels (gfloat              *in,
 {
   const gboolean has_mask = mask != NULL;
 
-  while (samples--)
+  while (samples > 0)
     {
-      GimpHSV layer_hsv, out_hsv;
-      GimpRGB layer_rgb = {layer[0], layer[1], layer[2]};
-      GimpRGB out_rgb   = {in[0], in[1], in[2]};
-      gfloat  comp_alpha, new_alpha;
+      gfloat layer_hsv[BLOCK_SIZE * 4];
+      gfloat out_hsv[BLOCK_SIZE * 4];
+      glong  n = MIN (samples, BLOCK_SIZE);
+      glong  i;
 
-      comp_alpha = MIN (in[ALPHA], layer[ALPHA]) * opacity;
-      if (has_mask)
-        comp_alpha *= *mask;
+      gimp_rgb_to_hsv_array (layer, layer_hsv, n);
+      gimp_rgb_to_hsv_array (in,    out_hsv,   n);
 
-      new_alpha = in[ALPHA] + (1.0 - in[ALPHA]) * comp_alpha;
-
-      if (comp_alpha && new_alpha)
+      for (i = 0; i < n; i++)
         {
-          gint   b;
-          gfloat ratio = comp_alpha / new_alpha;
+          out_hsv[4 * i + 1] = layer_hsv[4 * i + 1];
+        }
 
-          gimp_rgb_to_hsv (&layer_rgb, &layer_hsv);
-          gimp_rgb_to_hsv (&out_rgb, &out_hsv);
+      /*  converted in place, out_hsv holds RGB from here on  */
+      gimp_hsv_to_rgb_array (out_hsv, out_hsv, n);
 
-          out_hsv.s = layer_hsv.s;
-          gimp_hsv_to_rgb (&out_hsv, &out_rgb);
+      for (i = 0; i < n; i++)
+        {
+          const gfloat *out_rgb = out_hsv + 4 * i;
+          gfloat        comp_alpha, new_alpha;
+
+          comp_alpha = MIN (in[ALPHA], layer[ALPHA]) * opacity;
+          if (has_mask)
+            comp_alpha *= *mask;
 
-          out[0] = out_rgb.r;
-          out[1] = out_rgb.g;
-          out[2] = out_rgb.b;
+          new_alpha = in[ALPHA] + (1.0 - in[ALPHA]) * comp_alpha;
 
-          for (b = RED; b < ALPHA; b++)
+          if (comp_alpha && new_alpha)
             {
-              out[b] = out[b] * ratio + in[b] * (1.0 - ratio);
-            }
-        }
-      else
-        {
-          gint b;
+              gint   b;
+              gfloat ratio = comp_alpha / new_alpha;
 
-          for (b = RED; b < ALPHA; b++)
+              for (b = RED; b < ALPHA; b++)
+                {
+                  out[b] = out_rgb[b] * ratio + in[b] * (1.0 - ratio);
+                }
+            }
+          else
             {
-              out[b] = in[b];
+              gint b;
+
+              for (b = RED; b < ALPHA; b++)
+                {
+                  out[b] = in[b];
+                }
             }
-        }
 
-      out[ALPHA] = in[ALPHA];
+          out[ALPHA] = in[ALPHA];
+
+          in    += 4;
+          layer += 4;
+          out   += 4;
 
-      in    += 4;
-      layer += 4;
-      out   += 4;
+          if (has_mask)
+            mask++;
+        }
 
-      if (has_mask)
-        mask++;
+      samples -= n;
     }
 
   return TRUE;
@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <cairo.h>
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -29,16 +31,33 @@
 
 #include "operations-types.h"
 
+#include "core/gimp-parallel.h"
+
 #include "gimpoperationshapeburst.h"
 
 
+#define MIN_SUB_COLUMNS 64
+#define MIN_SUB_ROWS    16
+
+
 enum
 {
   PROP_0,
   PROP_MAX_ITERATIONS,
-  PROP_PROGRESS
+  PROP_PROGRESS,
+  PROP_LEGACY
 };
 
+typedef struct
+{
+  const guchar *src;
+  gfloat       *dist;
+  gint          width;
+  gint          height;
+  gfloat        max;
+  GMutex        mutex;
+} ShapeburstData;
+
 
 static void     gimp_operation_shapeburst_get_property (GObject      *object,
                                                         guint         property_id,
@@ -63,6 +82,17 @@ static gboolean gimp_operation_shapeburst_process (GeglOperation       *operatio
                                                    const GeglRectangle *roi,
                                                    gint                 level);
 
+static gfloat   gimp_operation_shapeburst_exact   (GeglOperation       *operation,
+                                                   const guchar        *src,
+                                                   gfloat              *dist,
+                                                   gint                 width,
+                                                   gint                 height);
+static gfloat   gimp_operation_shapeburst_legacy  (GeglOperation       *operation,
+                                                   const guchar        *src,
+                                                   gfloat              *dist,
+                                                   gint                 width,
+                                                   gint                 height);
+
 
 G_DEFINE_TYPE (GimpOperationShapeburst, gimp_operation_shapeburst,
                GEGL_TYPE_OPERATION_FILTER)
@@ -105,6 +135,14 @@ gimp_operation_shapeburst_class_init (GimpOperationShapeburstClass *klass)
                                                         "Progress indicator, and a bad hack",
                                                         0.0, 1.0, 0.0,
                                                         G_PARAM_READWRITE));
+
+  g_object_class_install_property (object_class, PROP_LEGACY,
+                                   g_param_spec_boolean ("legacy",
+                                                         "Legacy",
+                                                         "Use the old, approximate distance metric instead of the Euclidean distance",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT));
 }
 
 static void
@@ -130,6 +168,10 @@ gimp_operation_shapeburst_get_property (GObject    *object,
       g_value_set_double (value, self->progress);
       break;
 
+    case PROP_LEGACY:
+      g_value_set_boolean (value, self->legacy);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -154,6 +196,10 @@ gimp_operation_shapeburst_set_property (GObject      *object,
       self->progress = g_value_get_double (value);
       break;
 
+    case PROP_LEGACY:
+      self->legacy = g_value_get_boolean (value);
+      break;
+
    default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -189,16 +235,226 @@ gimp_operation_shapeburst_process (GeglOperation       *operation,
                                    const GeglRectangle *roi,
                                    gint                 level)
 {
-  const Babl *input_format   = babl_format ("Y u8");
-  const Babl *output_format  = babl_format ("Y float");
-  gfloat      max_iterations = 0.0;
-  gfloat     *distp_cur;
-  gfloat     *distp_prev;
-  gfloat     *memory;
-  gint        length;
-  gint        i;
-
-  length = roi->width + 1;
+  GimpOperationShapeburst *self = GIMP_OPERATION_SHAPEBURST (operation);
+  guchar                  *src;
+  gfloat                  *dist;
+  gfloat                   max_iterations;
+
+  src  = g_new (guchar, roi->width * roi->height);
+  dist = g_new (gfloat, roi->width * roi->height);
+
+  gegl_buffer_get (input, roi, 1.0, babl_format ("Y u8"), src,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  if (self->legacy)
+    max_iterations = gimp_operation_shapeburst_legacy (operation, src, dist,
+                                                       roi->width,
+                                                       roi->height);
+  else
+    max_iterations = gimp_operation_shapeburst_exact (operation, src, dist,
+                                                      roi->width,
+                                                      roi->height);
+
+  gegl_buffer_set (output, roi, 0, babl_format ("Y float"), dist,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (src);
+  g_free (dist);
+
+  g_object_set (operation,
+                "max-iterations", (gdouble) max_iterations,
+                NULL);
+
+  return TRUE;
+}
+
+/*  Distance of each pixel to the nearest unselected pixel in its
+ *  column, everything outside the buffer counts as unselected.
+ */
+static void
+gimp_operation_shapeburst_columns (gsize    offset,
+                                   gsize    size,
+                                   gpointer user_data)
+{
+  ShapeburstData *data   = user_data;
+  const guchar   *src    = data->src;
+  gfloat         *dist   = data->dist;
+  gint            width  = data->width;
+  gint            height = data->height;
+  gint            x, y;
+
+  for (x = offset; x < offset + size; x++)
+    dist[x] = src[x] ? 1.0 : 0.0;
+
+  for (y = 1; y < height; y++)
+    {
+      const guchar *s    = src  + y * width;
+      gfloat       *d    = dist + y * width;
+      const gfloat *prev = d - width;
+
+      for (x = offset; x < offset + size; x++)
+        d[x] = s[x] ? prev[x] + 1.0 : 0.0;
+    }
+
+  for (x = offset; x < offset + size; x++)
+    dist[(height - 1) * width + x] = MIN (dist[(height - 1) * width + x], 1.0);
+
+  for (y = height - 2; y >= 0; y--)
+    {
+      gfloat       *d    = dist + y * width;
+      const gfloat *next = d + width;
+
+      for (x = offset; x < offset + size; x++)
+        d[x] = MIN (d[x], next[x] + 1.0);
+    }
+}
+
+/*  Felzenszwalb and Huttenlocher, "Distance Transforms of Sampled
+ *  Functions": the squared distance of each pixel is the lower
+ *  envelope of the parabolas rooted at the pixels of its row, raised
+ *  by the squared column distances.
+ */
+static void
+gimp_operation_shapeburst_rows (gsize    offset,
+                                gsize    size,
+                                gpointer user_data)
+{
+  ShapeburstData *data  = user_data;
+  gint            width = data->width;
+  gdouble        *f     = g_new (gdouble, width);
+  gdouble        *z     = g_new (gdouble, width + 1);
+  gint           *v     = g_new (gint,    width);
+  gfloat          max   = 0.0;
+  gint            y;
+
+  for (y = offset; y < offset + size; y++)
+    {
+      const guchar *s = data->src  + y * width;
+      gfloat       *d = data->dist + y * width;
+      gint          k = 0;
+      gint          q;
+
+      for (q = 0; q < width; q++)
+        f[q] = (gdouble) d[q] * d[q];
+
+      v[0] = 0;
+      z[0] = -G_MAXDOUBLE;
+      z[1] =  G_MAXDOUBLE;
+
+      for (q = 1; q < width; q++)
+        {
+          gdouble r;
+
+#define INTERSECTION(p) (((f[q] + (gdouble) q * q) -                    \
+                          (f[p] + (gdouble) (p) * (p))) / (2.0 * (q - (p))))
+
+          r = INTERSECTION (v[k]);
+
+          while (r <= z[k])
+            {
+              k--;
+              r = INTERSECTION (v[k]);
+            }
+
+#undef INTERSECTION
+
+          k++;
+          v[k]     = q;
+          z[k]     = r;
+          z[k + 1] = G_MAXDOUBLE;
+        }
+
+      k = 0;
+
+      for (q = 0; q < width; q++)
+        {
+          gdouble squared;
+          gfloat  value;
+
+          if (! s[q])
+            {
+              d[q] = 0.0;
+              continue;
+            }
+
+          while (z[k + 1] < q)
+            k++;
+
+          squared = (gdouble) (q - v[k]) * (q - v[k]) + f[v[k]];
+
+          /*  the unselected pixels left and right of the buffer  */
+          squared = MIN (squared, (gdouble) (q + 1) * (q + 1));
+          squared = MIN (squared, (gdouble) (width - q) * (width - q));
+
+          /*  partially selected pixels are that much closer to the
+           *  outside, fully selected pixels next to it are at 1.0
+           */
+          value = sqrt (squared) - 1.0 + s[q] / 255.0;
+
+          d[q] = value;
+          max  = MAX (max, value);
+        }
+    }
+
+  g_free (f);
+  g_free (z);
+  g_free (v);
+
+  g_mutex_lock (&data->mutex);
+  data->max = MAX (data->max, max);
+  g_mutex_unlock (&data->mutex);
+}
+
+static gfloat
+gimp_operation_shapeburst_exact (GeglOperation *operation,
+                                 const guchar  *src,
+                                 gfloat        *dist,
+                                 gint           width,
+                                 gint           height)
+{
+  ShapeburstData data;
+
+  data.src    = src;
+  data.dist   = dist;
+  data.width  = width;
+  data.height = height;
+  data.max    = 0.0;
+  g_mutex_init (&data.mutex);
+
+  gimp_parallel_distribute_range (width, MIN_SUB_COLUMNS,
+                                  gimp_operation_shapeburst_columns, &data);
+
+  g_object_set (operation,
+                "progress", 0.5,
+                NULL);
+
+  gimp_parallel_distribute_range (height, MIN_SUB_ROWS,
+                                  gimp_operation_shapeburst_rows, &data);
+
+  g_object_set (operation,
+                "progress", 1.0,
+                NULL);
+
+  g_mutex_clear (&data.mutex);
+
+  return data.max;
+}
+
+static gfloat
+gimp_operation_shapeburst_legacy (GeglOperation *operation,
+                                  const guchar  *src_buf,
+                                  gfloat        *dist,
+                                  gint           width,
+                                  gint           height)
+{
+  gfloat  max_iterations = 0.0;
+  gfloat *distp_cur;
+  gfloat *distp_prev;
+  gfloat *memory;
+  gint    length;
+  gint    i;
+
+  length = width + 1;
   memory = g_new (gfloat, length * 2);
 
   distp_prev = memory;
@@ -208,7 +464,7 @@ gimp_operation_shapeburst_process (GeglOperation       *operation,
   distp_prev += 1;
   distp_cur = distp_prev + length;
 
-  for (i = 0; i < roi->height; i++)
+  for (i = 0; i < height; i++)
     {
       gfloat *tmp;
       gint    src = 0;
@@ -217,11 +473,11 @@ gimp_operation_shapeburst_process (GeglOperation       *operation,
       /*  set the current dist row to 0's  */
       memset (distp_cur - 1, 0, sizeof (gfloat) * (length - 1));
 
-      for (j = 0; j < roi->width; j++)
+      for (j = 0; j < width; j++)
         {
           gfloat float_tmp;
           gfloat min_prev = MIN (distp_cur[j-1], distp_prev[j]);
-          gint   min_left = MIN ((roi->width - j - 1), (roi->height - i - 1));
+          gint   min_left = MIN ((width - j - 1), (height - i - 1));
           gint   min      = (gint) MIN (min_left, min_prev);
           gint   fraction = 255;
           gint   k;
@@ -237,22 +493,7 @@ gimp_operation_shapeburst_process (GeglOperation       *operation,
 
               while (y >= end)
                 {
-                  guchar src_uchar;
-
-#if 1
-                  /* FIXME: this should be much faster, it converts
-                   * to 32 bit rgba intermediately, bah...
-                   */
-                  gegl_buffer_sample (input, x, y, NULL, &src_uchar,
-                                      input_format,
-                                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-#else
-                  gegl_buffer_get (input, GEGL_RECTANGLE (x, y, 1, 1), 1.0,
-                                   input_format, &src_uchar,
-                                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-#endif
-
-                  src = src_uchar;
+                  src = src_buf[y * width + x];
 
                   if (src == 0)
                     {
@@ -294,11 +535,7 @@ gimp_operation_shapeburst_process (GeglOperation       *operation,
         }
 
       /*  set the dist row  */
-      gegl_buffer_set (output,
-                       GEGL_RECTANGLE (roi->x, roi->y + i,
-                                       roi->width, 1),
-                       1.0, output_format, distp_cur,
-                       GEGL_AUTO_ROWSTRIDE);
+      memcpy (dist + i * width, distp_cur, sizeof (gfloat) * width);
 
       /*  swap pointers around  */
       tmp = distp_prev;
@@ -306,15 +543,11 @@ gimp_operation_shapeburst_process (GeglOperation       *operation,
       distp_cur = tmp;
 
       g_object_set (operation,
-                    "progress", (gdouble) i / roi->height,
+                    "progress", (gdouble) i / height,
                     NULL);
     }
 
   g_free (memory);
 
-  g_object_set (operation,
-                "max-iterations", (gdouble) max_iterations,
-                NULL);
-
-  return TRUE;
+  return max_iterations;
 }
@@ -42,6 +42,7 @@ struct _GimpOperationShapeburst
 
   gdouble              max_iterations;
   gdouble              progress;
+  gboolean             legacy;
 };
 
 struct _GimpOperationShapeburstClass
@@ -0,0 +1,631 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpheal-laplace.c
+ * Copyright (C) Jean-Yves Couleaud <cjyves@free.fr>
+ * Copyright (C) 2013 Loren Merritt
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "paint-types.h"
+
+#include "core/gimp-parallel.h"
+
+#include "gimpheal-laplace.h"
+
+
+/* NOTES
+ *
+ * We solve DeltaI=0 (Laplace) for the masked pixels, with Dirichlet
+ * conditions at the borders of the mask, see gimpheal.c.
+ *
+ * gimp_heal_laplace_sor() is a red/black checker Gauss-Seidel with
+ * over-relaxation. It needs a number of sweeps that grows with the
+ * brush diameter, which makes large brushes slow.
+ *
+ * gimp_heal_laplace_multigrid() uses the same red/black Gauss-Seidel
+ * sweeps as a smoother in a V-cycle: the residual of each level is
+ * summed into a grid of half the size, where the equation for the
+ * error is solved recursively, and the error is added back to the
+ * level's pixels. A coarse pixel is only solved for if all of its
+ * fine pixels are, so that every level keeps Dirichlet conditions and
+ * stays solvable. The number of V-cycles hardly depends on the brush
+ * size. Pixels of the same color don't depend on each other, so the
+ * sweeps, as well as the transfers between levels, are distributed
+ * among threads.
+ */
+
+
+/* Tolerate a total deviation-from-smoothness of 0.1 LSBs at 8bit depth. */
+#define EPSILON          (0.1/255)
+#define MAX_ITER         500
+
+#define MAX_LEVELS       16
+#define MAX_CYCLES       50
+#define N_PRE_SMOOTH     2
+#define N_POST_SMOOTH    2
+#define COARSEST_ITER    100
+
+/* don't coarsen levels with fewer pixels to solve for than this */
+#define COARSEST_SIZE    64
+
+#define MIN_SUB_SIZE     4096
+#define MIN_SUB_ROWS     16
+
+/* the pixel itself, its 4 neighbors and the right-hand side */
+#define N_INDICES        6
+
+
+typedef struct
+{
+  gint          width;
+  gint          height;
+  gint          depth;
+  const guchar *mask;
+
+  gfloat       *pixels;    /* the solution, followed by a zero pixel and,
+                            * on coarse levels, the right-hand side
+                            */
+  gfloat       *residual;  /* only on levels that have a coarser one    */
+
+  gfloat       *Adiag;
+  gint         *Aidx;
+  gint          nmask;
+  gint          nred;      /* number of rows of the first color         */
+  gfloat        w;
+
+  guchar       *mask_alloc;
+  gfloat       *pixels_alloc;
+} GimpHealLevel;
+
+typedef struct
+{
+  GimpHealLevel *level;
+  gint           first;
+  gfloat         err;
+  GMutex         mutex;
+} GimpHealSmoothData;
+
+typedef struct
+{
+  GimpHealLevel *fine;
+  GimpHealLevel *coarse;
+} GimpHealTransferData;
+
+
+#if defined(__SSE__) && defined(__GNUC__) && __GNUC__ >= 4
+static float
+gimp_heal_laplace_iteration_sse (gfloat *pixels,
+                                 gfloat *Adiag,
+                                 gint   *Aidx,
+                                 gfloat  w,
+                                 gint    nmask)
+{
+  typedef float v4sf __attribute__((vector_size(16)));
+  gint i;
+  v4sf wv  = { w, w, w, w };
+  v4sf err = { 0, 0, 0, 0 };
+  union { v4sf v; float f[4]; } erru;
+
+#define Xv(j) (*(v4sf*)&pixels[Aidx[i * N_INDICES + j]])
+
+  for (i = 0; i < nmask; i++)
+    {
+      v4sf a    = { Adiag[i], Adiag[i], Adiag[i], Adiag[i] };
+      v4sf diff = a * Xv(0) - wv * (Xv(1) + Xv(2) + Xv(3) + Xv(4) + Xv(5));
+
+      Xv(0) -= diff;
+      err += diff * diff;
+    }
+
+#undef Xv
+
+  erru.v = err;
+
+  return erru.f[0] + erru.f[1] + erru.f[2] + erru.f[3];
+}
+#endif
+
+/* Perform one iteration of Gauss-Seidel, and return the sum squared residual.
+ */
+static float
+gimp_heal_laplace_iteration (gfloat *pixels,
+                             gfloat *Adiag,
+                             gint   *Aidx,
+                             gfloat  w,
+                             gint    nmask,
+                             gint    depth)
+{
+  gint   i, k;
+  gfloat err = 0;
+
+#if defined(__SSE__) && defined(__GNUC__) && __GNUC__ >= 4
+  if (depth == 4)
+    return gimp_heal_laplace_iteration_sse (pixels, Adiag, Aidx, w, nmask);
+#endif
+
+  for (i = 0; i < nmask; i++)
+    {
+      gint   j0 = Aidx[i * N_INDICES + 0];
+      gint   j1 = Aidx[i * N_INDICES + 1];
+      gint   j2 = Aidx[i * N_INDICES + 2];
+      gint   j3 = Aidx[i * N_INDICES + 3];
+      gint   j4 = Aidx[i * N_INDICES + 4];
+      gint   j5 = Aidx[i * N_INDICES + 5];
+      gfloat a  = Adiag[i];
+
+      for (k = 0; k < depth; k++)
+        {
+          gfloat diff = (a * pixels[j0 + k] -
+                         w * (pixels[j1 + k] +
+                              pixels[j2 + k] +
+                              pixels[j3 + k] +
+                              pixels[j4 + k] +
+                              pixels[j5 + k]));
+
+          pixels[j0 + k] -= diff;
+          err += diff * diff;
+        }
+    }
+
+  return err;
+}
+
+/* Empirically optimal over-relaxation factor. (Benchmarked on round
+ * brushes, at least. I don't know whether aspect ratio affects it.)
+ */
+static gfloat
+gimp_heal_laplace_sor_factor (gint nmask)
+{
+  return 2.0 - 1.0 / (0.1575 * sqrt (nmask) + 0.8);
+}
+
+static void
+gimp_heal_laplace_level_init (GimpHealLevel *level,
+                              gint           width,
+                              gint           height,
+                              gint           depth,
+                              const guchar  *mask,
+                              gfloat        *pixels,
+                              gboolean       has_rhs)
+{
+  gint i, j, parity, nmask, zero, rhs;
+
+  level->width    = width;
+  level->height   = height;
+  level->depth    = depth;
+  level->mask     = mask;
+  level->pixels   = pixels;
+  level->residual = NULL;
+  level->w        = 1.0;
+
+  level->Adiag = g_new (gfloat, width * height);
+  level->Aidx  = g_new (gint, N_INDICES * width * height);
+
+  /* All off-diagonal elements of A are either -1 or 0. We could store it as a
+   * general-purpose sparse matrix, but that adds some unnecessary overhead to
+   * the inner loop. Instead, assume exactly 4 off-diagonal elements in each
+   * row, all of which have value -1. Any row that in fact wants less than 4
+   * coefs can put them in a dummy column to be multiplied by an empty pixel.
+   * The right-hand side is added like a fifth neighbor, it's the empty pixel
+   * too on the finest level.
+   */
+  zero = depth * width * height;
+  memset (pixels + zero, 0, depth * sizeof (gfloat));
+
+  rhs = has_rhs ? zero + depth : zero;
+
+  /* Construct the system of equations.
+   * Arrange Aidx in checkerboard order, so that a single linear pass over that
+   * array results updating all of the red cells and then all of the black cells.
+   */
+  nmask = 0;
+  for (parity = 0; parity < 2; parity++)
+    {
+      if (parity == 1)
+        level->nred = nmask;
+
+      for (i = 0; i < height; i++)
+        for (j = (i&1)^parity; j < width; j+=2)
+          if (mask[j + i * width])
+            {
+#define A_NEIGHBOR(o,di,dj) \
+              if ((dj<0 && j==0) || (dj>0 && j==width-1) || (di<0 && i==0) || (di>0 && i==height-1)) \
+                level->Aidx[o + nmask * N_INDICES] = zero; \
+              else                                               \
+                level->Aidx[o + nmask * N_INDICES] = ((i + di) * width + (j + dj)) * depth;
+
+              /* Omit Dirichlet conditions for any neighbors off the
+               * edge of the canvas.
+               */
+              level->Adiag[nmask] = 4 - (i==0) - (j==0) - (i==height-1) - (j==width-1);
+              A_NEIGHBOR (0,  0,  0);
+              A_NEIGHBOR (1,  0,  1);
+              A_NEIGHBOR (2,  1,  0);
+              A_NEIGHBOR (3,  0, -1);
+              A_NEIGHBOR (4, -1,  0);
+#undef A_NEIGHBOR
+
+              if (has_rhs)
+                level->Aidx[5 + nmask * N_INDICES] = rhs + (i * width + j) * depth;
+              else
+                level->Aidx[5 + nmask * N_INDICES] = zero;
+
+              nmask++;
+            }
+    }
+
+  level->nmask = nmask;
+
+  level->mask_alloc   = NULL;
+  level->pixels_alloc = NULL;
+}
+
+static void
+gimp_heal_laplace_level_set_w (GimpHealLevel *level,
+                               gfloat         w)
+{
+  gint i;
+
+  level->w = 0.25 * w;
+
+  for (i = 0; i < level->nmask; i++)
+    level->Adiag[i] *= level->w;
+}
+
+static void
+gimp_heal_laplace_level_free (GimpHealLevel *level)
+{
+  g_free (level->Adiag);
+  g_free (level->Aidx);
+  g_free (level->residual);
+  g_free (level->mask_alloc);
+  g_free (level->pixels_alloc);
+}
+
+static gboolean
+gimp_heal_laplace_level_can_coarsen (GimpHealLevel *level)
+{
+  return (level->width  > 2 &&
+          level->height > 2 &&
+          level->nmask  > COARSEST_SIZE);
+}
+
+static void
+gimp_heal_laplace_level_coarsen (GimpHealLevel *fine,
+                                 GimpHealLevel *coarse)
+{
+  gint    width  = (fine->width  + 1) / 2;
+  gint    height = (fine->height + 1) / 2;
+  gint    depth  = fine->depth;
+  guchar *mask;
+  gfloat *pixels_alloc;
+  gfloat *pixels;
+  gint    x, y;
+
+  mask = g_new (guchar, width * height);
+  memset (mask, 1, width * height);
+
+  for (y = 0; y < fine->height; y++)
+    for (x = 0; x < fine->width; x++)
+      if (! fine->mask[y * fine->width + x])
+        mask[(y / 2) * width + x / 2] = 0;
+
+  /* the solution, the zero pixel and the right-hand side */
+  pixels_alloc = g_new0 (gfloat, 4 + (2 * width * height + 1) * depth);
+  pixels = (gfloat*)(((uintptr_t)pixels_alloc + 15) & ~15);
+
+  gimp_heal_laplace_level_init (coarse, width, height, depth,
+                                mask, pixels, TRUE);
+
+  coarse->mask_alloc   = mask;
+  coarse->pixels_alloc = pixels_alloc;
+
+  fine->residual = g_new0 (gfloat, fine->width * fine->height * depth);
+}
+
+static void
+gimp_heal_laplace_smooth_range (gsize    offset,
+                                gsize    size,
+                                gpointer user_data)
+{
+  GimpHealSmoothData *data  = user_data;
+  GimpHealLevel      *level = data->level;
+  gint                first = data->first + offset;
+  gfloat              err;
+
+  err = gimp_heal_laplace_iteration (level->pixels,
+                                     level->Adiag + first,
+                                     level->Aidx  + first * N_INDICES,
+                                     level->w, size, level->depth);
+
+  g_mutex_lock (&data->mutex);
+  data->err += err;
+  g_mutex_unlock (&data->mutex);
+}
+
+/* Perform one sweep of Gauss-Seidel over all red cells and then over
+ * all black cells, and return the sum squared residual.
+ */
+static gfloat
+gimp_heal_laplace_level_smooth (GimpHealLevel *level)
+{
+  GimpHealSmoothData data;
+
+  data.level = level;
+  data.err   = 0.0;
+  g_mutex_init (&data.mutex);
+
+  data.first = 0;
+  gimp_parallel_distribute_range (level->nred, MIN_SUB_SIZE,
+                                  gimp_heal_laplace_smooth_range, &data);
+
+  data.first = level->nred;
+  gimp_parallel_distribute_range (level->nmask - level->nred, MIN_SUB_SIZE,
+                                  gimp_heal_laplace_smooth_range, &data);
+
+  g_mutex_clear (&data.mutex);
+
+  return data.err;
+}
+
+static void
+gimp_heal_laplace_residual_range (gsize    offset,
+                                  gsize    size,
+                                  gpointer user_data)
+{
+  GimpHealLevel *level  = user_data;
+  gfloat        *pixels = level->pixels;
+  gint           depth  = level->depth;
+  gint           i, k;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      gint   *idx = level->Aidx + i * N_INDICES;
+      gfloat  a   = level->Adiag[i];
+
+      for (k = 0; k < depth; k++)
+        {
+          gfloat sum = (pixels[idx[1] + k] +
+                        pixels[idx[2] + k] +
+                        pixels[idx[3] + k] +
+                        pixels[idx[4] + k] +
+                        pixels[idx[5] + k]);
+
+          level->residual[idx[0] + k] = sum - a * pixels[idx[0] + k] / level->w;
+        }
+    }
+}
+
+static void
+gimp_heal_laplace_restrict_range (gsize    offset,
+                                  gsize    size,
+                                  gpointer user_data)
+{
+  GimpHealTransferData *data   = user_data;
+  GimpHealLevel        *fine   = data->fine;
+  GimpHealLevel        *coarse = data->coarse;
+  gint                  depth  = coarse->depth;
+  gfloat               *rhs;
+  gint                  x, y, k;
+
+  rhs = coarse->pixels + (coarse->width * coarse->height + 1) * depth;
+
+  for (y = offset; y < offset + size; y++)
+    for (x = 0; x < coarse->width; x++)
+      {
+        gint    p = y * coarse->width + x;
+        gint    fx, fy;
+
+        if (! coarse->mask[p])
+          continue;
+
+        for (k = 0; k < depth; k++)
+          {
+            coarse->pixels[p * depth + k] = 0.0;
+            rhs[p * depth + k]            = 0.0;
+          }
+
+        /* the coarse grid's spacing is twice as large, which makes the
+         * sum of the four fine residuals its right-hand side
+         */
+        for (fy = 2 * y; fy < MIN (2 * y + 2, fine->height); fy++)
+          for (fx = 2 * x; fx < MIN (2 * x + 2, fine->width); fx++)
+            {
+              const gfloat *r = fine->residual +
+                                (fy * fine->width + fx) * depth;
+
+              for (k = 0; k < depth; k++)
+                rhs[p * depth + k] += r[k];
+            }
+      }
+}
+
+static void
+gimp_heal_laplace_prolong_range (gsize    offset,
+                                 gsize    size,
+                                 gpointer user_data)
+{
+  GimpHealTransferData *data   = user_data;
+  GimpHealLevel        *fine   = data->fine;
+  GimpHealLevel        *coarse = data->coarse;
+  gint                  depth  = fine->depth;
+  gint                  x, y, k;
+
+  for (y = offset; y < offset + size; y++)
+    for (x = 0; x < fine->width; x++)
+      {
+        gint          p = y * fine->width + x;
+        const gfloat *e;
+
+        if (! fine->mask[p])
+          continue;
+
+        e = coarse->pixels + ((y / 2) * coarse->width + x / 2) * depth;
+
+        for (k = 0; k < depth; k++)
+          fine->pixels[p * depth + k] += e[k];
+      }
+}
+
+/* Perform one V-cycle on levels[0], and return the sum squared residual
+ * of its last smoothing sweep.
+ */
+static gfloat
+gimp_heal_laplace_vcycle (GimpHealLevel *levels,
+                          gint           n_levels)
+{
+  GimpHealLevel        *level = &levels[0];
+  GimpHealTransferData  data;
+  gfloat                err   = 0.0;
+  gint                  i;
+
+  if (n_levels == 1)
+    {
+      for (i = 0; i < COARSEST_ITER; i++)
+        {
+          err = gimp_heal_laplace_level_smooth (level);
+
+          if (err < EPSILON * EPSILON * level->w * level->w)
+            break;
+        }
+
+      return err;
+    }
+
+  data.fine   = level;
+  data.coarse = &levels[1];
+
+  for (i = 0; i < N_PRE_SMOOTH; i++)
+    gimp_heal_laplace_level_smooth (level);
+
+  gimp_parallel_distribute_range (level->nmask, MIN_SUB_SIZE,
+                                  gimp_heal_laplace_residual_range, level);
+  gimp_parallel_distribute_range (data.coarse->height, MIN_SUB_ROWS,
+                                  gimp_heal_laplace_restrict_range, &data);
+
+  gimp_heal_laplace_vcycle (levels + 1, n_levels - 1);
+
+  gimp_parallel_distribute_range (level->height, MIN_SUB_ROWS,
+                                  gimp_heal_laplace_prolong_range, &data);
+
+  for (i = 0; i < N_POST_SMOOTH; i++)
+    err = gimp_heal_laplace_level_smooth (level);
+
+  return err;
+}
+
+/* Solve the laplace equation for pixels and store the result in-place,
+ * using Gauss-Seidel with successive over-relaxation.
+ */
+gint
+gimp_heal_laplace_sor (gfloat       *pixels,
+                       gint          height,
+                       gint          depth,
+                       gint          width,
+                       const guchar *mask)
+{
+  GimpHealLevel level;
+  gint          iter;
+
+  g_return_val_if_fail (pixels != NULL, 0);
+  g_return_val_if_fail (mask != NULL, 0);
+
+  gimp_heal_laplace_level_init (&level, width, height, depth,
+                                mask, pixels, FALSE);
+  gimp_heal_laplace_level_set_w (&level,
+                                 gimp_heal_laplace_sor_factor (level.nmask));
+
+  for (iter = 0; iter < MAX_ITER; iter++)
+    {
+      gfloat err = gimp_heal_laplace_iteration (pixels,
+                                                level.Adiag, level.Aidx,
+                                                level.w, level.nmask, depth);
+      if (err < EPSILON * EPSILON * level.w * level.w)
+        break;
+    }
+
+  gimp_heal_laplace_level_free (&level);
+
+  return MIN (iter + 1, MAX_ITER);
+}
+
+/* Solve the laplace equation for pixels and store the result in-place,
+ * using multigrid V-cycles.
+ */
+gint
+gimp_heal_laplace_multigrid (gfloat       *pixels,
+                             gint          height,
+                             gint          depth,
+                             gint          width,
+                             const guchar *mask)
+{
+  GimpHealLevel levels[MAX_LEVELS];
+  gint          n_levels;
+  gint          cycle;
+  gint          i;
+
+  g_return_val_if_fail (pixels != NULL, 0);
+  g_return_val_if_fail (mask != NULL, 0);
+
+  gimp_heal_laplace_level_init (&levels[0], width, height, depth,
+                                mask, pixels, FALSE);
+
+  if (! gimp_heal_laplace_level_can_coarsen (&levels[0]))
+    {
+      /* small enough for plain SOR to be just as fast */
+      gimp_heal_laplace_level_free (&levels[0]);
+
+      return gimp_heal_laplace_sor (pixels, height, depth, width, mask);
+    }
+
+  for (n_levels = 1;
+       n_levels < MAX_LEVELS &&
+       gimp_heal_laplace_level_can_coarsen (&levels[n_levels - 1]);
+       n_levels++)
+    {
+      gimp_heal_laplace_level_coarsen (&levels[n_levels - 1],
+                                       &levels[n_levels]);
+    }
+
+  /* plain Gauss-Seidel smooths best, the coarsest level is solved */
+  for (i = 0; i < n_levels - 1; i++)
+    gimp_heal_laplace_level_set_w (&levels[i], 1.0);
+
+  gimp_heal_laplace_level_set_w (&levels[n_levels - 1],
+                                 gimp_heal_laplace_sor_factor (levels[n_levels - 1].nmask));
+
+  for (cycle = 0; cycle < MAX_CYCLES; cycle++)
+    {
+      gfloat err = gimp_heal_laplace_vcycle (levels, n_levels);
+
+      if (err < EPSILON * EPSILON * levels[0].w * levels[0].w)
+        break;
+    }
+
+  for (i = 0; i < n_levels; i++)
+    gimp_heal_laplace_level_free (&levels[i]);
+
+  return MIN (cycle + 1, MAX_CYCLES);
+}
@@ -21,10 +21,15 @@
 
 #include "paint-types.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimptempbuf.h"
 #include "gimppaintcore-loops.h"
 #include "operations/gimplayermodefunctions.h"
 
+
+#define LAYER_BLEND_MIN_AREA (64 * 64)
+
+
 void
 combine_paint_mask_to_canvas_mask (const GimpTempBuf *paint_mask,
                                    gint               mask_x_offset,
@@ -272,74 +277,80 @@ paint_mask_to_paint_buffer (const GimpTempBuf  *paint_mask,
     }
 }
 
-void
-do_layer_blend (GeglBuffer  *src_buffer,
-                GeglBuffer  *dst_buffer,
-                GimpTempBuf *paint_buf,
-                GeglBuffer  *mask_buffer,
-                gfloat       opacity,
-                gint         x_offset,
-                gint         y_offset,
-                gint         mask_x_offset,
-                gint         mask_y_offset,
-                gboolean     linear_mode,
-                GimpLayerModeEffects paint_mode)
+typedef struct
+{
+  GeglBuffer            *src_buffer;
+  GeglBuffer            *dst_buffer;
+  GeglBuffer            *mask_buffer;
+  const Babl            *iterator_format;
+  const GeglRectangle   *roi;
+  gint                   mask_x_offset;
+  gint                   mask_y_offset;
+  gfloat                *paint_data;
+  guint                  paint_stride;
+  gfloat                 opacity;
+  GimpLayerModeFunction  apply_func;
+} LayerBlendData;
+
+static void
+do_layer_blend_area (const GeglRectangle *area,
+                     LayerBlendData      *data)
 {
-  GeglRectangle       roi;
-  GeglRectangle       mask_roi;
+  GeglRectangle       mask_area;
   GeglRectangle       process_roi;
-  const Babl         *iterator_format;
   GeglBufferIterator *iter;
 
-  const guint         paint_stride = gimp_temp_buf_get_width (paint_buf);
-  gfloat             *paint_data   = (gfloat *) gimp_temp_buf_get_data (paint_buf);
-
-  GimpLayerModeFunction apply_func = get_layer_mode_function (paint_mode);
-
-  if (linear_mode)
-    iterator_format = babl_format ("RGBA float");
-  else
-    iterator_format = babl_format ("R'G'B'A float");
+  mask_area.x      = area->x + data->mask_x_offset;
+  mask_area.y      = area->y + data->mask_y_offset;
+  mask_area.width  = area->width;
+  mask_area.height = area->height;
 
-  roi.x = x_offset;
-  roi.y = y_offset;
-  roi.width  = gimp_temp_buf_get_width (paint_buf);
-  roi.height = gimp_temp_buf_get_height (paint_buf);
-
-  mask_roi.x = roi.x + mask_x_offset;
-  mask_roi.y = roi.y + mask_y_offset;
-  mask_roi.width  = roi.width;
-  mask_roi.height = roi.height;
-
-  g_return_if_fail (gimp_temp_buf_get_format (paint_buf) == iterator_format);
-
-  iter = gegl_buffer_iterator_new (dst_buffer, &roi, 0,
-                                   iterator_format,
+  iter = gegl_buffer_iterator_new (data->dst_buffer, area, 0,
+                                   data->iterator_format,
                                    GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, src_buffer, &roi, 0,
-                            iterator_format,
+  gegl_buffer_iterator_add (iter, data->src_buffer, area, 0,
+                            data->iterator_format,
                             GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
 
-  if (mask_buffer)
+  if (data->mask_buffer)
     {
-      gegl_buffer_iterator_add (iter, mask_buffer, &mask_roi, 0,
+      gegl_buffer_iterator_add (iter, data->mask_buffer, &mask_area, 0,
                                 babl_format ("Y float"),
                                 GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
     }
 
-  while (gegl_buffer_iterator_next(iter))
+  while (gegl_buffer_iterator_next (iter))
     {
-      gfloat *out_pixel   = (gfloat *)iter->data[0];
-      gfloat *in_pixel    = (gfloat *)iter->data[1];
+      gfloat *out_pixel   = (gfloat *) iter->data[0];
+      gfloat *in_pixel    = (gfloat *) iter->data[1];
       gfloat *mask_pixel  = NULL;
-      gfloat *paint_pixel = paint_data + ((iter->roi[0].y - roi.y) * paint_stride + iter->roi[0].x - roi.x) * 4;
-      int iy;
-
-      if (mask_buffer)
-        mask_pixel  = (gfloat *)iter->data[2];
+      gfloat *paint_pixel = data->paint_data +
+                            ((iter->roi[0].y - data->roi->y) * data->paint_stride +
+                             iter->roi[0].x - data->roi->x) * 4;
+      gint    iy;
+
+      if (data->mask_buffer)
+        mask_pixel = (gfloat *) iter->data[2];
+
+      /*  when the chunk spans the whole width of the paint buffer, all
+       *  the inputs are contiguous and the mode function can process
+       *  the chunk in one go
+       */
+      if (iter->roi[0].width == data->paint_stride)
+        {
+          data->apply_func (in_pixel,
+                            paint_pixel,
+                            mask_pixel,
+                            out_pixel,
+                            data->opacity,
+                            iter->length,
+                            &iter->roi[0],
+                            0);
+          continue;
+        }
 
-      process_roi.x = iter->roi[0].x;
+      process_roi.x      = iter->roi[0].x;
       process_roi.width  = iter->roi[0].width;
       process_roi.height = 1;
 
@@ -347,24 +358,76 @@ do_layer_blend (GeglBuffer  *src_buffer,
         {
           process_roi.y = iter->roi[0].y + iy;
 
-          (*apply_func) (in_pixel,
-                         paint_pixel,
-                         mask_pixel,
-                         out_pixel,
-                         opacity,
-                         iter->roi[0].width,
-                         &process_roi,
-                         0);
+          data->apply_func (in_pixel,
+                            paint_pixel,
+                            mask_pixel,
+                            out_pixel,
+                            data->opacity,
+                            iter->roi[0].width,
+                            &process_roi,
+                            0);
 
           in_pixel    += iter->roi[0].width * 4;
           out_pixel   += iter->roi[0].width * 4;
-          if (mask_buffer)
-            mask_pixel  += iter->roi[0].width;
-          paint_pixel += paint_stride * 4;
+          if (mask_pixel)
+            mask_pixel += iter->roi[0].width;
+          paint_pixel += data->paint_stride * 4;
         }
     }
 }
 
+void
+do_layer_blend (GeglBuffer  *src_buffer,
+                GeglBuffer  *dst_buffer,
+                GimpTempBuf *paint_buf,
+                GeglBuffer  *mask_buffer,
+                gfloat       opacity,
+                gint         x_offset,
+                gint         y_offset,
+                gint         mask_x_offset,
+                gint         mask_y_offset,
+                gboolean     linear_mode,
+                GimpLayerModeEffects paint_mode)
+{
+  GeglRectangle  roi;
+  LayerBlendData data;
+  gint           tile_height;
+
+  if (linear_mode)
+    data.iterator_format = babl_format ("RGBA float");
+  else
+    data.iterator_format = babl_format ("R'G'B'A float");
+
+  g_return_if_fail (gimp_temp_buf_get_format (paint_buf) == data.iterator_format);
+
+  roi.x = x_offset;
+  roi.y = y_offset;
+  roi.width  = gimp_temp_buf_get_width (paint_buf);
+  roi.height = gimp_temp_buf_get_height (paint_buf);
+
+  data.src_buffer    = src_buffer;
+  data.dst_buffer    = dst_buffer;
+  data.mask_buffer   = mask_buffer;
+  data.roi           = &roi;
+  data.mask_x_offset = mask_x_offset;
+  data.mask_y_offset = mask_y_offset;
+  data.paint_data    = (gfloat *) gimp_temp_buf_get_data (paint_buf);
+  data.paint_stride  = gimp_temp_buf_get_width (paint_buf);
+  data.opacity       = opacity;
+  data.apply_func    = get_layer_mode_function (paint_mode);
+
+  g_object_get (dst_buffer, "tile-height", &tile_height, NULL);
+
+  /*  large brushes are blended in horizontal strips on all threads,
+   *  small dabs stay on the calling thread.  the strips are aligned
+   *  to the destination's tile rows, so threads never write to the
+   *  same tile
+   */
+  gimp_parallel_distribute_tiles (&roi, tile_height, LAYER_BLEND_MIN_AREA,
+                                  (GimpParallelDistributeAreaFunc) do_layer_blend_area,
+                                  &data);
+}
+
 void
 mask_components_onto (GeglBuffer        *src_buffer,
                       GeglBuffer        *aux_buffer,
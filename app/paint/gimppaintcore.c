@@ -36,8 +36,11 @@
 #include "core/gimp.h"
 #include "core/gimp-utils.h"
 #include "core/gimpchannel.h"
+#include "core/gimpfilterstack.h"
 #include "core/gimpimage.h"
 #include "core/gimpimage-undo.h"
+#include "core/gimplayer.h"
+#include "core/gimplayermask.h"
 #include "core/gimppickable.h"
 #include "core/gimpprojection.h"
 #include "core/gimptempbuf.h"
@@ -109,6 +112,9 @@ static GimpUndo* gimp_paint_core_real_push_undo      (GimpPaintCore    *core,
                                                       GimpImage        *image,
                                                       const gchar      *undo_desc);
 
+static void      gimp_paint_core_cache_below         (GimpDrawable     *drawable,
+                                                      gboolean          cache);
+
 
 G_DEFINE_TYPE (GimpPaintCore, gimp_paint_core, GIMP_TYPE_OBJECT)
 
@@ -471,6 +477,9 @@ gimp_paint_core_start (GimpPaintCore     *core,
         }
     }
 
+  /*  Keep the layers below out of the projection updates of the stroke  */
+  gimp_paint_core_cache_below (drawable, TRUE);
+
   /*  Freeze the drawable preview so that it isn't constantly updated.  */
   gimp_viewable_preview_freeze (GIMP_VIEWABLE (drawable));
 
@@ -488,6 +497,8 @@ gimp_paint_core_finish (GimpPaintCore *core,
   g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
   g_return_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)));
 
+  gimp_paint_core_cache_below (drawable, FALSE);
+
   if (core->applicator)
     {
       g_object_unref (core->applicator);
@@ -579,6 +590,8 @@ gimp_paint_core_cancel (GimpPaintCore *core,
   g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
   g_return_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)));
 
+  gimp_paint_core_cache_below (drawable, FALSE);
+
   /*  Determine if any part of the image has been altered--
    *  if nothing has, then just return...
    */
@@ -1159,3 +1172,51 @@ gimp_paint_core_smooth_coords (GimpPaintCore    *core,
         }
     }
 }
+
+
+/*  private functions  */
+
+/*  while painting a layer, let the image's layer stack keep the
+ *  composite of the layers below it, so every dab only recomposes the
+ *  painted layer and the layers above
+ */
+static void
+gimp_paint_core_cache_below (GimpDrawable *drawable,
+                             gboolean      cache)
+{
+  GimpImage     *image  = gimp_item_get_image (GIMP_ITEM (drawable));
+  GimpContainer *layers = gimp_image_get_layers (image);
+  GimpLayer     *layer  = NULL;
+  gint           index;
+
+  if (GIMP_IS_LAYER_MASK (drawable))
+    layer = gimp_layer_mask_get_layer (GIMP_LAYER_MASK (drawable));
+  else if (GIMP_IS_LAYER (drawable))
+    layer = GIMP_LAYER (drawable);
+
+  /*  the children of a group layer are composited within the group's
+   *  bounds, only cache in the image's own stack
+   */
+  if (! layer || gimp_item_get_container (GIMP_ITEM (layer)) != layers)
+    return;
+
+  if (! cache)
+    {
+      if (GIMP_FILTER_STACK (layers)->cache_filter == GIMP_FILTER (layer))
+        gimp_filter_stack_cache_below (GIMP_FILTER_STACK (layers), NULL, NULL);
+
+      return;
+    }
+
+  index = gimp_container_get_child_index (layers, GIMP_OBJECT (layer));
+
+  /*  nothing to cache below the bottom layer  */
+  if (index == gimp_container_get_n_children (layers) - 1)
+    return;
+
+  gimp_filter_stack_cache_below (GIMP_FILTER_STACK (layers),
+                                 GIMP_FILTER (layer),
+                                 GEGL_RECTANGLE (0, 0,
+                                                 gimp_image_get_width  (image),
+                                                 gimp_image_get_height (image)));
+}
@@ -630,6 +630,68 @@ drawable_levels_stretch_invoker (GimpProcedure         *procedure,
                                            error ? *error : NULL);
 }
 
+static GimpValueArray *
+drawable_point_filters_invoker (GimpProcedure         *procedure,
+                                Gimp                  *gimp,
+                                GimpContext           *context,
+                                GimpProgress          *progress,
+                                const GimpValueArray  *args,
+                                GError               **error)
+{
+  gboolean success = TRUE;
+  GimpDrawable *drawable;
+  gint32 num_operations;
+  const gchar **operations;
+  gint32 num_settings;
+  const gchar **settings;
+  gboolean use_lut;
+
+  drawable = gimp_value_get_drawable (gimp_value_array_index (args, 0), gimp);
+  num_operations = g_value_get_int (gimp_value_array_index (args, 1));
+  operations = gimp_value_get_stringarray (gimp_value_array_index (args, 2));
+  num_settings = g_value_get_int (gimp_value_array_index (args, 3));
+  settings = gimp_value_get_stringarray (gimp_value_array_index (args, 4));
+  use_lut = g_value_get_boolean (gimp_value_array_index (args, 5));
+
+  if (success)
+    {
+      if (gimp_pdb_item_is_attached (GIMP_ITEM (drawable), NULL,
+                                     GIMP_PDB_ITEM_CONTENT, error) &&
+          gimp_pdb_item_is_not_group (GIMP_ITEM (drawable), error) &&
+          num_operations == num_settings)
+        {
+          GPtrArray *filters;
+          gint       i;
+
+          filters = g_ptr_array_new_with_free_func (g_object_unref);
+
+          for (i = 0; i < num_operations && success; i++)
+            {
+              GeglOperation *filter = gimp_pdb_get_point_filter (operations[i],
+                                                                 settings[i],
+                                                                 error);
+
+              if (filter)
+                g_ptr_array_add (filters, filter);
+              else
+                success = FALSE;
+            }
+
+          if (success && filters->len > 0)
+            gimp_drawable_apply_point_filters (drawable, progress,
+                                               C_("undo-type", "Color Adjustments"),
+                                               filters, use_lut);
+
+          g_ptr_array_unref (filters);
+        }
+      else
+        success = FALSE;
+    }
+
+  return gimp_procedure_get_return_values (procedure, success,
+                                           error ? *error : NULL);
+}
+
 static GimpValueArray *
 drawable_posterize_invoker (GimpProcedure         *procedure,
                             Gimp                  *gimp,
@@ -1225,6 +1287,57 @@ register_drawable_color_procs (GimpPDB *pdb)
   gimp_pdb_register_procedure (pdb, procedure);
   g_object_unref (procedure);
 
+  /*
+   * gimp-drawable-point-filters
+   */
+  procedure = gimp_procedure_new (drawable_point_filters_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-drawable-point-filters");
+  gimp_procedure_set_static_strings (procedure,
+                                     "gimp-drawable-point-filters",
+                                     "Apply several color adjustments to the drawable in one pass.",
+                                     "This procedure applies the point filter operations in 'operations' to the specified drawable, one after the other, reading and writing each pixel only once and pushing a single undo step. Each operation is the name of a per-pixel GIMP color operation, such as \"gimp:levels\", \"gimp:curves\" or \"gimp:colorize\", and the same entry of 'settings' holds its settings in the format of the tools' saved settings, or an empty string for the defaults. If 'use_lut' is TRUE, the operations are baked into a lookup table for 8 bit drawables, which is faster but only approximates the result.",
+                                     "Spencer Kimball & Peter Mattis",
+                                     "Spencer Kimball & Peter Mattis",
+                                     "2016",
+                                     NULL);
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_drawable_id ("drawable",
+                                                            "drawable",
+                                                            "The drawable",
+                                                            pdb->gimp, FALSE,
+                                                            GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("num-operations",
+                                                      "num operations",
+                                                      "The number of operations",
+                                                      0, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_string_array ("operations",
+                                                             "operations",
+                                                             "The point filter operations, in the order they are applied",
+                                                             GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("num-settings",
+                                                      "num settings",
+                                                      "The number of settings, must be the same as num_operations",
+                                                      0, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_string_array ("settings",
+                                                             "settings",
+                                                             "The settings of each operation",
+                                                             GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               g_param_spec_boolean ("use-lut",
+                                                     "use lut",
+                                                     "Use a lookup table for 8 bit drawables",
+                                                     FALSE,
+                                                     GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
+
   /*
    * gimp-drawable-posterize
    */
@@ -21,6 +21,9 @@
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
+#include <gegl-plugin.h>
+
+#include "libgimpconfig/gimpconfig.h"
 
 #include "pdb-types.h"
 
@@ -32,6 +35,8 @@
 #include "core/gimpimage.h"
 #include "core/gimpitem.h"
 
+#include "operations/gimpoperationpointchain.h"
+
 #include "text/gimptextlayer.h"
 
 #include "vectors/gimpvectors.h"
@@ -338,6 +343,65 @@ gimp_pdb_get_paint_info (Gimp         *gimp,
   return paint_info;
 }
 
+/*  creates the GimpOperationPointFilter @operation, with its config
+ *  deserialized from @settings, for use in a gimp:point-chain
+ */
+GeglOperation *
+gimp_pdb_get_point_filter (const gchar  *operation,
+                           const gchar  *settings,
+                           GError      **error)
+{
+  GType          type;
+  GObjectClass  *klass;
+  GParamSpec    *pspec = NULL;
+  GObject       *config;
+  GeglOperation *filter;
+
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (! operation || ! strlen (operation))
+    {
+      g_set_error_literal (error, GIMP_PDB_ERROR, GIMP_PDB_ERROR_INVALID_ARGUMENT,
+                           _("Invalid empty operation name"));
+      return NULL;
+    }
+
+  type = gegl_operation_gtype_from_name (operation);
+
+  if (g_type_is_a (type, GIMP_TYPE_OPERATION_POINT_FILTER) &&
+      ! g_type_is_a (type, GIMP_TYPE_OPERATION_POINT_CHAIN))
+    {
+      klass = g_type_class_ref (type);
+      pspec = g_object_class_find_property (klass, "config");
+      g_type_class_unref (klass);
+    }
+
+  if (! pspec || ! g_type_is_a (pspec->value_type, GIMP_TYPE_CONFIG))
+    {
+      g_set_error (error, GIMP_PDB_ERROR, GIMP_PDB_ERROR_INVALID_ARGUMENT,
+                   _("Operation '%s' is not a configurable point filter"),
+                   operation);
+      return NULL;
+    }
+
+  config = g_object_new (pspec->value_type, NULL);
+
+  if (settings && strlen (settings) &&
+      ! gimp_config_deserialize_string (GIMP_CONFIG (config),
+                                        settings, -1, NULL, error))
+    {
+      g_object_unref (config);
+      return NULL;
+    }
+
+  filter = g_object_new (type,
+                         "config", config,
+                         NULL);
+  g_object_unref (config);
+
+  return filter;
+}
+
 gboolean
 gimp_pdb_item_is_attached (GimpItem           *item,
                            GimpImage          *image,
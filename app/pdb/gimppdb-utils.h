@@ -51,6 +51,9 @@ GimpBuffer    * gimp_pdb_get_buffer             (Gimp               *gimp,
 GimpPaintInfo * gimp_pdb_get_paint_info         (Gimp               *gimp,
                                                  const gchar        *name,
                                                  GError            **error);
+GeglOperation * gimp_pdb_get_point_filter       (const gchar        *operation,
+                                                 const gchar        *settings,
+                                                 GError            **error);
 
 gboolean        gimp_pdb_item_is_attached       (GimpItem           *item,
                                                  GimpImage          *image,
@@ -63,8 +63,20 @@ static void gimp_plug_in_handle_tile_put         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
 static void gimp_plug_in_handle_tile_get         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
+static void gimp_plug_in_handle_tile_batch_request
+                                                 (GimpPlugIn      *plug_in,
+                                                  GPTileBatchReq  *request);
+static void gimp_plug_in_handle_tile_batch_put   (GimpPlugIn      *plug_in,
+                                                  GPTileBatchReq  *request);
+static void gimp_plug_in_handle_tile_batch_get   (GimpPlugIn      *plug_in,
+                                                  GPTileBatchReq  *request);
+static GimpValueArray *
+            gimp_plug_in_run_proc                (GimpPlugIn      *plug_in,
+                                                  GPProcRun       *proc_run);
 static void gimp_plug_in_handle_proc_run         (GimpPlugIn      *plug_in,
                                                   GPProcRun       *proc_run);
+static void gimp_plug_in_handle_proc_batch_run   (GimpPlugIn      *plug_in,
+                                                  GPProcBatchRun  *proc_batch_run);
 static void gimp_plug_in_handle_proc_return      (GimpPlugIn      *plug_in,
                                                   GPProcReturn    *proc_return);
 static void gimp_plug_in_handle_temp_proc_return (GimpPlugIn      *plug_in,
@@ -160,6 +172,32 @@ gimp_plug_in_handle_message (GimpPlugIn      *plug_in,
     case GP_HAS_INIT:
       gimp_plug_in_handle_has_init (plug_in);
       break;
+
+    case GP_TILE_BATCH_REQ:
+      gimp_plug_in_handle_tile_batch_request (plug_in, msg->data);
+      break;
+
+    case GP_TILE_BATCH_DATA:
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "sent a TILE_BATCH_DATA message.  This should not happen.",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog));
+      gimp_plug_in_close (plug_in, TRUE);
+      break;
+
+    case GP_PROC_BATCH_RUN:
+      gimp_plug_in_handle_proc_batch_run (plug_in, msg->data);
+      break;
+
+    case GP_PROC_BATCH_RETURN:
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "sent a PROC_BATCH_RETURN message.  This should not happen.",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog));
+      gimp_plug_in_close (plug_in, TRUE);
+      break;
     }
 }
 
@@ -469,6 +507,345 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
   gimp_wire_destroy (&msg);
 }
 
+static GeglBuffer *
+gimp_plug_in_get_tile_batch_buffer (GimpPlugIn  *plug_in,
+                                    gint32       drawable_ID,
+                                    gboolean     shadow,
+                                    gboolean     put,
+                                    const Babl **format)
+{
+  GimpDrawable *drawable;
+  GeglBuffer   *buffer;
+
+  drawable = (GimpDrawable *) gimp_item_get_by_ID (plug_in->manager->gimp,
+                                                   drawable_ID);
+
+  if (! GIMP_IS_DRAWABLE (drawable))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "tried accessing invalid drawable %d (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog),
+                    drawable_ID);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+  else if (gimp_item_is_removed (GIMP_ITEM (drawable)))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "tried accessing drawable %d which was removed "
+                    "from the image (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog),
+                    drawable_ID);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+
+  if (shadow)
+    {
+      buffer = gimp_drawable_get_shadow_buffer (drawable);
+
+      gimp_plug_in_cleanup_add_shadow (plug_in, drawable);
+    }
+  else
+    {
+      if (put && gimp_item_is_content_locked (GIMP_ITEM (drawable)))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-In \"%s\"\n(%s)\n\n"
+                        "tried writing to a locked drawable %d (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_filename_to_utf8 (plug_in->prog),
+                        drawable_ID);
+          gimp_plug_in_close (plug_in, TRUE);
+          return NULL;
+        }
+      else if (put && gimp_viewable_get_children (GIMP_VIEWABLE (drawable)))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-In \"%s\"\n(%s)\n\n"
+                        "tried writing to a group layer %d (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_filename_to_utf8 (plug_in->prog),
+                        drawable_ID);
+          gimp_plug_in_close (plug_in, TRUE);
+          return NULL;
+        }
+
+      buffer = gimp_drawable_get_buffer (drawable);
+    }
+
+  *format = gegl_buffer_get_format (buffer);
+
+  if (! gimp_plug_in_precision_enabled (plug_in))
+    {
+      *format = gimp_babl_compat_u8_format (*format);
+    }
+
+  return buffer;
+}
+
+static GeglRectangle *
+gimp_plug_in_get_tile_batch_rects (GimpPlugIn    *plug_in,
+                                   GeglBuffer    *buffer,
+                                   const guint32 *tile_nums,
+                                   gint           n_tiles,
+                                   gint           bpp,
+                                   gsize         *data_length)
+{
+  GeglRectangle *rects = g_new (GeglRectangle, MAX (n_tiles, 1));
+  gint           i;
+
+  *data_length = 0;
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      if (! gimp_gegl_buffer_get_tile_rect (buffer,
+                                            GIMP_PLUG_IN_TILE_WIDTH,
+                                            GIMP_PLUG_IN_TILE_HEIGHT,
+                                            tile_nums[i],
+                                            &rects[i]))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-In \"%s\"\n(%s)\n\n"
+                        "requested invalid tile (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_filename_to_utf8 (plug_in->prog));
+          gimp_plug_in_close (plug_in, TRUE);
+
+          g_free (rects);
+
+          return NULL;
+        }
+
+      *data_length += (gsize) bpp * rects[i].width * rects[i].height;
+    }
+
+  return rects;
+}
+
+static void
+gimp_plug_in_handle_tile_batch_request (GimpPlugIn     *plug_in,
+                                        GPTileBatchReq *request)
+{
+  g_return_if_fail (request != NULL);
+
+  if (request->put)
+    gimp_plug_in_handle_tile_batch_put (plug_in, request);
+  else
+    gimp_plug_in_handle_tile_batch_get (plug_in, request);
+}
+
+static void
+gimp_plug_in_handle_tile_batch_put (GimpPlugIn     *plug_in,
+                                    GPTileBatchReq *request)
+{
+  GPTileBatchData  tile_data = { 0, };
+  GPTileBatchData *tile_info;
+  GimpWireMessage  msg;
+  GeglBuffer      *buffer;
+  const Babl      *format;
+  GeglRectangle   *rects;
+  gsize            data_length;
+  const guchar    *src;
+  gint             bpp;
+  gint             i;
+
+  /*  like for single tiles, tell the plug-in whether to use shared
+   *  memory, and only then let it send its pixels
+   */
+  tile_data.drawable_ID = -1;
+  tile_data.use_shm     = (plug_in->manager->shm != NULL);
+
+  if (! gp_tile_batch_data_write (plug_in->my_write, &tile_data, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (msg.type != GP_TILE_BATCH_DATA)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "expected tile batch data and received: %d", msg.type);
+      gimp_wire_destroy (&msg);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  tile_info = msg.data;
+
+  buffer = gimp_plug_in_get_tile_batch_buffer (plug_in,
+                                               tile_info->drawable_ID,
+                                               tile_info->shadow,
+                                               TRUE, &format);
+
+  if (! buffer)
+    {
+      gimp_wire_destroy (&msg);
+      return;
+    }
+
+  bpp = babl_format_get_bytes_per_pixel (format);
+
+  rects = gimp_plug_in_get_tile_batch_rects (plug_in, buffer,
+                                             tile_info->tile_nums,
+                                             tile_info->n_tiles,
+                                             bpp, &data_length);
+
+  if (! rects)
+    {
+      gimp_wire_destroy (&msg);
+      return;
+    }
+
+  if (tile_info->bpp         != bpp         ||
+      tile_info->data_length != data_length ||
+      (tile_info->use_shm &&
+       (! tile_data.use_shm ||
+        data_length > gimp_plug_in_shm_get_size (plug_in->manager->shm))))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "sent tiles that don't match the drawable (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog));
+      g_free (rects);
+      gimp_wire_destroy (&msg);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (tile_info->use_shm)
+    src = gimp_plug_in_shm_get_addr (plug_in->manager->shm);
+  else
+    src = tile_info->data;
+
+  for (i = 0; i < tile_info->n_tiles; i++)
+    {
+      gegl_buffer_set (buffer, &rects[i], 0, format,
+                       src, GEGL_AUTO_ROWSTRIDE);
+
+      src += bpp * rects[i].width * rects[i].height;
+    }
+
+  g_free (rects);
+  gimp_wire_destroy (&msg);
+
+  if (! gp_tile_ack_write (plug_in->my_write, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+}
+
+static void
+gimp_plug_in_handle_tile_batch_get (GimpPlugIn     *plug_in,
+                                    GPTileBatchReq *request)
+{
+  GPTileBatchData  tile_data = { 0, };
+  GimpWireMessage  msg;
+  GeglBuffer      *buffer;
+  const Babl      *format;
+  GeglRectangle   *rects;
+  gsize            data_length;
+  guchar          *dest;
+  gint             bpp;
+  gint             i;
+
+  buffer = gimp_plug_in_get_tile_batch_buffer (plug_in,
+                                               request->drawable_ID,
+                                               request->shadow,
+                                               FALSE, &format);
+
+  if (! buffer)
+    return;
+
+  bpp = babl_format_get_bytes_per_pixel (format);
+
+  rects = gimp_plug_in_get_tile_batch_rects (plug_in, buffer,
+                                             request->tile_nums,
+                                             request->n_tiles,
+                                             bpp, &data_length);
+
+  if (! rects)
+    return;
+
+  tile_data.drawable_ID = request->drawable_ID;
+  tile_data.shadow      = request->shadow;
+  tile_data.bpp         = bpp;
+  tile_data.use_shm     = (plug_in->manager->shm != NULL &&
+                           data_length <=
+                           gimp_plug_in_shm_get_size (plug_in->manager->shm));
+  tile_data.n_tiles     = request->n_tiles;
+  tile_data.tile_nums   = request->tile_nums;
+  tile_data.data_length = data_length;
+
+  if (tile_data.use_shm)
+    {
+      dest = gimp_plug_in_shm_get_addr (plug_in->manager->shm);
+    }
+  else
+    {
+      tile_data.data = g_malloc (data_length);
+
+      dest = tile_data.data;
+    }
+
+  for (i = 0; i < request->n_tiles; i++)
+    {
+      gegl_buffer_get (buffer, &rects[i], 1.0, format,
+                       dest, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      dest += bpp * rects[i].width * rects[i].height;
+    }
+
+  g_free (rects);
+
+  if (! gp_tile_batch_data_write (plug_in->my_write, &tile_data, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      g_free (tile_data.data);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  g_free (tile_data.data);
+
+  if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (msg.type != GP_TILE_ACK)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "expected tile ack and received: %d", msg.type);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  gimp_wire_destroy (&msg);
+}
+
 static void
 gimp_plug_in_handle_proc_error (GimpPlugIn          *plug_in,
                                 GimpPlugInProcFrame *proc_frame,
@@ -504,9 +881,9 @@ gimp_plug_in_handle_proc_error (GimpPlugIn          *plug_in,
     }
 }
 
-static void
-gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
-                              GPProcRun  *proc_run)
+static GimpValueArray *
+gimp_plug_in_run_proc (GimpPlugIn *plug_in,
+                       GPProcRun  *proc_run)
 {
   GimpPlugInProcFrame *proc_frame;
   gchar               *canonical;
@@ -516,9 +893,6 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
   GimpValueArray      *return_vals = NULL;
   GError              *error       = NULL;
 
-  g_return_if_fail (proc_run != NULL);
-  g_return_if_fail (proc_run->name != NULL);
-
   canonical = gimp_canonicalize_identifier (proc_run->name);
 
   proc_frame = gimp_plug_in_get_proc_frame (plug_in);
@@ -608,6 +982,20 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
 
   g_free (canonical);
 
+  return return_vals;
+}
+
+static void
+gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
+                              GPProcRun  *proc_run)
+{
+  GimpValueArray *return_vals;
+
+  g_return_if_fail (proc_run != NULL);
+  g_return_if_fail (proc_run->name != NULL);
+
+  return_vals = gimp_plug_in_run_proc (plug_in, proc_run);
+
   /*  Don't bother to send the return value if executing the procedure
    *  closed the plug-in (e.g. if the procedure is gimp-quit)
    */
@@ -636,6 +1024,70 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
   gimp_value_array_unref (return_vals);
 }
 
+/*  runs the procedures in order and sends all their return values in
+ *  one reply, stopping at the first one that fails, like a plug-in
+ *  calling them one by one would
+ */
+static void
+gimp_plug_in_handle_proc_batch_run (GimpPlugIn     *plug_in,
+                                    GPProcBatchRun *proc_batch_run)
+{
+  GPProcBatchReturn   proc_batch_return;
+  GimpValueArray    **return_vals;
+  gint                i;
+
+  g_return_if_fail (proc_batch_run != NULL);
+
+  return_vals = g_new0 (GimpValueArray *, proc_batch_run->n_procs);
+
+  proc_batch_return.n_procs = 0;
+  proc_batch_return.procs   = g_new0 (GPProcReturn, proc_batch_run->n_procs);
+
+  for (i = 0; i < proc_batch_run->n_procs; i++)
+    {
+      GPProcRun         *proc_run    = &proc_batch_run->procs[i];
+      GPProcReturn      *proc_return = &proc_batch_return.procs[i];
+      GimpPDBStatusType  status;
+
+      if (! proc_run->name)
+        break;
+
+      return_vals[i] = gimp_plug_in_run_proc (plug_in, proc_run);
+
+      /*  Return the name we got called with, see above  */
+      proc_return->name    = proc_run->name;
+      proc_return->nparams = gimp_value_array_length (return_vals[i]);
+      proc_return->params  = plug_in_args_to_params (return_vals[i], FALSE);
+
+      proc_batch_return.n_procs++;
+
+      status = g_value_get_enum (gimp_value_array_index (return_vals[i], 0));
+
+      if (status != GIMP_PDB_SUCCESS || ! plug_in->open)
+        break;
+    }
+
+  if (plug_in->open)
+    {
+      if (! gp_proc_batch_return_write (plug_in->my_write,
+                                        &proc_batch_return, plug_in))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "%s: ERROR", G_STRFUNC);
+          gimp_plug_in_close (plug_in, TRUE);
+        }
+    }
+
+  for (i = 0; i < proc_batch_return.n_procs; i++)
+    {
+      g_free (proc_batch_return.procs[i].params);
+      gimp_value_array_unref (return_vals[i]);
+    }
+
+  g_free (proc_batch_return.procs);
+  g_free (return_vals);
+}
+
 static void
 gimp_plug_in_handle_proc_return (GimpPlugIn   *plug_in,
                                  GPProcReturn *proc_return)
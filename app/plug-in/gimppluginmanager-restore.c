@@ -46,6 +46,7 @@
 #include "gimppluginmanager-restore.h"
 #include "gimppluginprocedure.h"
 #include "plug-in-rc.h"
+#include "plug-in-rc-cache.h"
 
 #include "gimp-intl.h"
 
@@ -55,6 +56,7 @@ static void    gimp_plug_in_manager_search            (GimpPlugInManager      *m
 static gchar * gimp_plug_in_manager_get_pluginrc      (GimpPlugInManager      *manager);
 static void    gimp_plug_in_manager_read_pluginrc     (GimpPlugInManager      *manager,
                                                        const gchar            *pluginrc,
+                                                       const gchar            *pluginrc_cache,
                                                        GimpInitStatusFunc      status_callback);
 static void    gimp_plug_in_manager_query_new         (GimpPlugInManager      *manager,
                                                        GimpContext            *context,
@@ -69,7 +71,8 @@ static void    gimp_plug_in_manager_bind_text_domains (GimpPlugInManager      *m
 static void    gimp_plug_in_manager_add_from_file     (const GimpDatafileData *file_data,
                                                        gpointer                data);
 static void    gimp_plug_in_manager_add_from_rc       (GimpPlugInManager      *manager,
-                                                       GimpPlugInDef          *plug_in_def);
+                                                       GimpPlugInDef          *plug_in_def,
+                                                       GHashTable             *ondisk_defs);
 static void     gimp_plug_in_manager_add_to_db         (GimpPlugInManager      *manager,
                                                         GimpContext            *context,
                                                         GimpPlugInProcedure    *proc);
@@ -86,6 +89,7 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
 {
   Gimp   *gimp;
   gchar  *pluginrc;
+  gchar  *pluginrc_cache;
   GSList *list;
   GError *error = NULL;
 
@@ -102,9 +106,11 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
   gimp_plug_in_manager_search (manager, status_callback);
 
   /* read the pluginrc file for cached data */
-  pluginrc = gimp_plug_in_manager_get_pluginrc (manager);
+  pluginrc       = gimp_plug_in_manager_get_pluginrc (manager);
+  pluginrc_cache = g_strconcat (pluginrc, ".cache", NULL);
 
-  gimp_plug_in_manager_read_pluginrc (manager, pluginrc, status_callback);
+  gimp_plug_in_manager_read_pluginrc (manager, pluginrc, pluginrc_cache,
+                                      status_callback);
 
   /* query any plug-ins that changed since we last wrote out pluginrc */
   gimp_plug_in_manager_query_new (manager, context, status_callback);
@@ -136,11 +142,21 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
                                 NULL, GIMP_MESSAGE_ERROR, error->message);
           g_clear_error (&error);
         }
+      else if (! plug_in_rc_cache_write (manager->plug_in_defs,
+                                         pluginrc_cache, pluginrc, &error))
+        {
+          /*  not fatal, pluginrc is parsed next time  */
+          if (gimp->be_verbose)
+            g_printerr ("%s\n", error->message);
+
+          g_clear_error (&error);
+        }
 
       manager->write_pluginrc = FALSE;
     }
 
   g_free (pluginrc);
+  g_free (pluginrc_cache);
 
   /* create locale and help domain lists */
   for (list = manager->plug_in_defs; list; list = list->next)
@@ -273,10 +289,11 @@ gimp_plug_in_manager_get_pluginrc (GimpPlugInManager *manager)
   return pluginrc;
 }
 
-/* read the pluginrc file for cached data */
+/* read the pluginrc file, or its binary cache, for cached data */
 static void
 gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
                                     const gchar        *pluginrc,
+                                    const gchar        *pluginrc_cache,
                                     GimpInitStatusFunc  status_callback)
 {
   GSList *rc_defs;
@@ -285,18 +302,63 @@ gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
   status_callback (_("Resource configuration"),
                    gimp_filename_to_utf8 (pluginrc), 0.0);
 
-  if (manager->gimp->be_verbose)
-    g_print ("Parsing '%s'\n", gimp_filename_to_utf8 (pluginrc));
+  rc_defs = plug_in_rc_cache_read (manager->gimp, pluginrc_cache, pluginrc,
+                                   &error);
+
+  if (error)
+    {
+      if (manager->gimp->be_verbose)
+        g_printerr ("%s\n", error->message);
+
+      g_clear_error (&error);
+    }
 
-  rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
+  if (rc_defs)
+    {
+      if (manager->gimp->be_verbose)
+        g_print ("Read '%s'\n", gimp_filename_to_utf8 (pluginrc_cache));
+    }
+  else
+    {
+      if (manager->gimp->be_verbose)
+        g_print ("Parsing '%s'\n", gimp_filename_to_utf8 (pluginrc));
+
+      rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
+
+      /*  write the cache for the next time  */
+      if (rc_defs)
+        manager->write_pluginrc = TRUE;
+    }
 
   if (rc_defs)
     {
-      GSList *list;
+      GHashTable *ondisk_defs;
+      GSList     *list;
+
+      /*  index the plug-ins found on disk by their basename, the first
+       *  one in the plug-in path wins
+       */
+      ondisk_defs = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, NULL);
+
+      for (list = manager->plug_in_defs; list; list = list->next)
+        {
+          GimpPlugInDef *ondisk_plug_in_def = list->data;
+          gchar         *basename;
+
+          basename = g_path_get_basename (ondisk_plug_in_def->prog);
+
+          if (! g_hash_table_contains (ondisk_defs, basename))
+            g_hash_table_insert (ondisk_defs, basename, list);
+          else
+            g_free (basename);
+        }
 
       for (list = rc_defs; list; list = g_slist_next (list))
-        gimp_plug_in_manager_add_from_rc (manager, list->data); /* consumes list->data */
+        gimp_plug_in_manager_add_from_rc (manager, list->data,
+                                          ondisk_defs); /* consumes list->data */
 
+      g_hash_table_unref (ondisk_defs);
       g_slist_free (rc_defs);
     }
   else if (error)
@@ -585,10 +647,11 @@ gimp_plug_in_manager_add_from_file (const GimpDatafileData *file_data,
 
 static void
 gimp_plug_in_manager_add_from_rc (GimpPlugInManager *manager,
-                                  GimpPlugInDef     *plug_in_def)
+                                  GimpPlugInDef     *plug_in_def,
+                                  GHashTable        *ondisk_defs)
 {
   GSList *list;
-  gchar  *basename1;
+  gchar  *basename;
 
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
   g_return_if_fail (plug_in_def != NULL);
@@ -601,7 +664,7 @@ gimp_plug_in_manager_add_from_rc (GimpPlugInManager *manager,
       return;
     }
 
-  basename1 = g_path_get_basename (plug_in_def->prog);
+  basename = g_path_get_basename (plug_in_def->prog);
 
   /*  If this is a file load or save plugin, make sure we have
    *  something for one of the extensions, prefixes, or magic number.
@@ -627,40 +690,31 @@ gimp_plug_in_manager_add_from_rc (GimpPlugInManager *manager,
   /*  Check if the entry mentioned in pluginrc matches an executable
    *  found in the plug_in_path.
    */
-  for (list = manager->plug_in_defs; list; list = list->next)
+  list = g_hash_table_lookup (ondisk_defs, basename);
+
+  g_free (basename);
+
+  if (list)
     {
       GimpPlugInDef *ondisk_plug_in_def = list->data;
-      gchar         *basename2;
-
-      basename2 = g_path_get_basename (ondisk_plug_in_def->prog);
 
-      if (! strcmp (basename1, basename2))
+      if (! g_ascii_strcasecmp (plug_in_def->prog,
+                                ondisk_plug_in_def->prog) &&
+          (plug_in_def->mtime == ondisk_plug_in_def->mtime))
         {
-          if (! g_ascii_strcasecmp (plug_in_def->prog,
-                                    ondisk_plug_in_def->prog) &&
-              (plug_in_def->mtime == ondisk_plug_in_def->mtime))
-            {
-              /* Use pluginrc entry, deleting on-disk entry */
-              list->data = plug_in_def;
-              g_object_unref (ondisk_plug_in_def);
-            }
-          else
-            {
-              /* Use on-disk entry, deleting pluginrc entry */
-              g_object_unref (plug_in_def);
-            }
-
-          g_free (basename2);
-          g_free (basename1);
-
-          return;
+          /* Use pluginrc entry, deleting on-disk entry */
+          list->data = plug_in_def;
+          g_object_unref (ondisk_plug_in_def);
+        }
+      else
+        {
+          /* Use on-disk entry, deleting pluginrc entry */
+          g_object_unref (plug_in_def);
         }
 
-      g_free (basename2);
+      return;
     }
 
-  g_free (basename1);
-
   manager->write_pluginrc = TRUE;
 
   if (manager->gimp->be_verbose)
@@ -0,0 +1,766 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * plug-in-rc-cache.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  A binary copy of pluginrc, which is memory mapped and read without
+ *  tokenizing anything. It is only used as long as pluginrc's mtime
+ *  and size are the ones recorded in it, so editing or replacing
+ *  pluginrc makes GIMP parse that instead.
+ *
+ *  The file is a header, followed by the plug-in defs as a stream of
+ *  32 bit words in the byte order of the machine that wrote it, and a
+ *  table of NUL-terminated strings and inline pixbuf data the words
+ *  refer to by offset. The same string is stored only once, and the
+ *  table always ends in a NUL.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "pdb/gimp-pdb-compat.h"
+
+#include "gimpplugindef.h"
+#include "gimppluginprocedure.h"
+#include "plug-in-rc.h"
+#include "plug-in-rc-cache.h"
+
+#include "gimp-intl.h"
+
+
+#define PLUG_IN_RC_CACHE_MAGIC      "GIMPPRC"
+#define PLUG_IN_RC_CACHE_BYTE_ORDER 0x01020304
+#define PLUG_IN_RC_CACHE_VERSION    1
+
+/*  the offset of a NULL string  */
+#define PLUG_IN_RC_CACHE_NULL       G_MAXUINT32
+
+
+typedef struct
+{
+  gchar   magic[8];
+  guint32 byte_order;
+  guint32 cache_version;
+  guint32 protocol_version;
+  guint32 file_version;
+  gint64  rc_mtime;
+  gint64  rc_size;
+  guint32 n_plug_in_defs;
+  guint32 n_words;
+  guint32 strings_size;
+  guint32 padding;
+} PlugInRcCacheHeader;
+
+typedef struct
+{
+  GArray     *words;
+  GByteArray *strings;
+  GHashTable *string_offsets;
+} CacheWriter;
+
+typedef struct
+{
+  const guint32 *words;
+  gsize          n_words;
+  gsize          pos;
+  const gchar   *strings;
+  gsize          strings_size;
+  gboolean       error;
+} CacheReader;
+
+
+static void                  cache_writer_uint      (CacheWriter         *writer,
+                                                     guint32              value);
+static void                  cache_writer_int64     (CacheWriter         *writer,
+                                                     gint64               value);
+static void                  cache_writer_string    (CacheWriter         *writer,
+                                                     const gchar         *str);
+static void                  cache_writer_data      (CacheWriter         *writer,
+                                                     const guint8        *data,
+                                                     gint                 length);
+static void                  cache_write_procedure  (CacheWriter         *writer,
+                                                     GimpPlugInProcedure *proc);
+
+static guint32               cache_reader_uint      (CacheReader         *reader);
+static gint64                cache_reader_int64     (CacheReader         *reader);
+static const gchar         * cache_reader_string    (CacheReader         *reader);
+static const guint8        * cache_reader_data      (CacheReader         *reader,
+                                                     gint                *length);
+static GimpPlugInDef       * cache_read_plug_in_def (CacheReader         *reader,
+                                                     Gimp                *gimp);
+static GimpPlugInProcedure * cache_read_procedure   (CacheReader         *reader,
+                                                     Gimp                *gimp,
+                                                     const gchar         *prog);
+
+static gboolean              cache_get_rc_stat      (const gchar         *pluginrc,
+                                                     gint64              *mtime,
+                                                     gint64              *size);
+
+
+/**
+ * plug_in_rc_cache_read:
+ * @gimp:     a #Gimp
+ * @filename: the cache file
+ * @pluginrc: the pluginrc file the cache was written for
+ * @error:    return location for errors
+ *
+ * Reads the plug-in defs from the cache written by
+ * plug_in_rc_cache_write(), if it is still up to date with @pluginrc.
+ *
+ * Return value: the list of plug-in defs, or %NULL if the cache is
+ *               missing, outdated or broken, in which case @error is
+ *               only set for a broken cache.
+ **/
+GSList *
+plug_in_rc_cache_read (Gimp         *gimp,
+                       const gchar  *filename,
+                       const gchar  *pluginrc,
+                       GError      **error)
+{
+  GMappedFile         *file;
+  const gchar         *contents;
+  gsize                length;
+  PlugInRcCacheHeader  header;
+  CacheReader          reader;
+  GSList              *plug_in_defs = NULL;
+  gint64               rc_mtime;
+  gint64               rc_size;
+  guint32              i;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (pluginrc != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (! cache_get_rc_stat (pluginrc, &rc_mtime, &rc_size))
+    return NULL;
+
+  file = g_mapped_file_new (filename, FALSE, NULL);
+
+  if (! file)
+    return NULL;
+
+  contents = g_mapped_file_get_contents (file);
+  length   = g_mapped_file_get_length (file);
+
+  if (length < sizeof (header))
+    goto broken;
+
+  memcpy (&header, contents, sizeof (header));
+
+  if (memcmp (header.magic,
+              PLUG_IN_RC_CACHE_MAGIC, sizeof (PLUG_IN_RC_CACHE_MAGIC)) ||
+      header.byte_order != PLUG_IN_RC_CACHE_BYTE_ORDER)
+    goto broken;
+
+  /*  silently ignore caches of other versions or another pluginrc  */
+  if (header.cache_version    != PLUG_IN_RC_CACHE_VERSION ||
+      header.protocol_version != GIMP_PROTOCOL_VERSION    ||
+      header.file_version     != PLUG_IN_RC_FILE_VERSION  ||
+      header.rc_mtime         != rc_mtime                 ||
+      header.rc_size          != rc_size)
+    {
+      g_mapped_file_unref (file);
+      return NULL;
+    }
+
+  if (header.n_words > (length - sizeof (header)) / sizeof (guint32) ||
+      header.strings_size == 0                                       ||
+      header.strings_size != (length - sizeof (header) -
+                              header.n_words * sizeof (guint32)))
+    goto broken;
+
+  reader.words        = (const guint32 *) (contents + sizeof (header));
+  reader.n_words      = header.n_words;
+  reader.pos          = 0;
+  reader.strings      = (const gchar *) (reader.words + reader.n_words);
+  reader.strings_size = header.strings_size;
+  reader.error        = FALSE;
+
+  /*  so every string in the table is terminated  */
+  if (reader.strings[reader.strings_size - 1] != '\0')
+    goto broken;
+
+  for (i = 0; i < header.n_plug_in_defs && ! reader.error; i++)
+    {
+      GimpPlugInDef *plug_in_def = cache_read_plug_in_def (&reader, gimp);
+
+      if (plug_in_def)
+        plug_in_defs = g_slist_prepend (plug_in_defs, plug_in_def);
+    }
+
+  if (reader.error || reader.pos != reader.n_words)
+    {
+      g_slist_free_full (plug_in_defs, (GDestroyNotify) g_object_unref);
+
+      goto broken;
+    }
+
+  g_mapped_file_unref (file);
+
+  return g_slist_reverse (plug_in_defs);
+
+ broken:
+
+  g_mapped_file_unref (file);
+
+  g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+               _("Skipping '%s': broken plug-in cache."),
+               gimp_filename_to_utf8 (filename));
+
+  return NULL;
+}
+
+/**
+ * plug_in_rc_cache_write:
+ * @plug_in_defs: the plug-in defs
+ * @filename:     the cache file
+ * @pluginrc:     the pluginrc file @plug_in_defs were just written to
+ * @error:        return location for errors
+ *
+ * Writes the same plug-in defs plug_in_rc_write() writes to @pluginrc
+ * to a binary cache of it.
+ *
+ * Return value: %TRUE on success.
+ **/
+gboolean
+plug_in_rc_cache_write (GSList       *plug_in_defs,
+                        const gchar  *filename,
+                        const gchar  *pluginrc,
+                        GError      **error)
+{
+  CacheWriter          writer;
+  PlugInRcCacheHeader  header = { { 0, } };
+  GByteArray          *contents;
+  GSList              *list;
+  gboolean             success;
+
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (pluginrc != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  memcpy (header.magic,
+          PLUG_IN_RC_CACHE_MAGIC, sizeof (PLUG_IN_RC_CACHE_MAGIC));
+
+  header.byte_order       = PLUG_IN_RC_CACHE_BYTE_ORDER;
+  header.cache_version    = PLUG_IN_RC_CACHE_VERSION;
+  header.protocol_version = GIMP_PROTOCOL_VERSION;
+  header.file_version     = PLUG_IN_RC_FILE_VERSION;
+
+  if (! cache_get_rc_stat (pluginrc, &header.rc_mtime, &header.rc_size))
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_OPEN,
+                   _("Could not open '%s' for reading: %s"),
+                   gimp_filename_to_utf8 (pluginrc), g_strerror (errno));
+      return FALSE;
+    }
+
+  writer.words          = g_array_new (FALSE, FALSE, sizeof (guint32));
+  writer.strings        = g_byte_array_new ();
+  writer.string_offsets = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (list = plug_in_defs; list; list = list->next)
+    {
+      GimpPlugInDef *plug_in_def = list->data;
+      GSList        *list2;
+      gint           n_procedures = 0;
+
+      /*  skip what plug_in_rc_write() skips  */
+      for (list2 = plug_in_def->procedures; list2; list2 = list2->next)
+        {
+          GimpPlugInProcedure *proc = list2->data;
+
+          if (! proc->installed_during_init)
+            n_procedures++;
+        }
+
+      if (! plug_in_def->procedures)
+        continue;
+
+      header.n_plug_in_defs++;
+
+      cache_writer_string (&writer, plug_in_def->prog);
+      cache_writer_int64  (&writer, plug_in_def->mtime);
+      cache_writer_string (&writer, plug_in_def->locale_domain_name);
+      cache_writer_string (&writer, plug_in_def->locale_domain_path);
+      cache_writer_string (&writer, plug_in_def->help_domain_name);
+      cache_writer_string (&writer, plug_in_def->help_domain_uri);
+      cache_writer_uint   (&writer, plug_in_def->has_init);
+      cache_writer_uint   (&writer, n_procedures);
+
+      for (list2 = plug_in_def->procedures; list2; list2 = list2->next)
+        {
+          GimpPlugInProcedure *proc = list2->data;
+
+          if (! proc->installed_during_init)
+            cache_write_procedure (&writer, proc);
+        }
+    }
+
+  /*  always terminate the table, even when it is empty or ends in
+   *  inline pixbuf data, which is not NUL-terminated
+   */
+  g_byte_array_append (writer.strings, (const guint8 *) "", 1);
+
+  header.n_words      = writer.words->len;
+  header.strings_size = writer.strings->len;
+
+  contents = g_byte_array_sized_new (sizeof (header) +
+                                     writer.words->len * sizeof (guint32) +
+                                     writer.strings->len);
+
+  g_byte_array_append (contents, (const guint8 *) &header, sizeof (header));
+  g_byte_array_append (contents, (const guint8 *) writer.words->data,
+                       writer.words->len * sizeof (guint32));
+  g_byte_array_append (contents, writer.strings->data, writer.strings->len);
+
+  success = g_file_set_contents (filename,
+                                 (const gchar *) contents->data, contents->len,
+                                 error);
+
+  g_byte_array_free (contents, TRUE);
+  g_hash_table_unref (writer.string_offsets);
+  g_byte_array_free (writer.strings, TRUE);
+  g_array_free (writer.words, TRUE);
+
+  return success;
+}
+
+
+/*  private functions  */
+
+static void
+cache_writer_uint (CacheWriter *writer,
+                   guint32      value)
+{
+  g_array_append_val (writer->words, value);
+}
+
+static void
+cache_writer_int64 (CacheWriter *writer,
+                    gint64       value)
+{
+  cache_writer_uint (writer, (guint64) value & G_MAXUINT32);
+  cache_writer_uint (writer, (guint64) value >> 32);
+}
+
+static void
+cache_writer_string (CacheWriter *writer,
+                     const gchar *str)
+{
+  gpointer offset;
+
+  if (! str)
+    {
+      cache_writer_uint (writer, PLUG_IN_RC_CACHE_NULL);
+      return;
+    }
+
+  if (! g_hash_table_lookup_extended (writer->string_offsets, str,
+                                      NULL, &offset))
+    {
+      offset = GUINT_TO_POINTER (writer->strings->len);
+
+      g_byte_array_append (writer->strings,
+                           (const guint8 *) str, strlen (str) + 1);
+
+      /*  the strings outlive the writer  */
+      g_hash_table_insert (writer->string_offsets, (gpointer) str, offset);
+    }
+
+  cache_writer_uint (writer, GPOINTER_TO_UINT (offset));
+}
+
+static void
+cache_writer_data (CacheWriter  *writer,
+                   const guint8 *data,
+                   gint          length)
+{
+  cache_writer_uint (writer, writer->strings->len);
+  cache_writer_uint (writer, length);
+
+  g_byte_array_append (writer->strings, data, length);
+}
+
+/*  writes @proc the way plug_in_rc_write() does, so reading it back
+ *  results in the same procedure as parsing pluginrc
+ */
+static void
+cache_write_procedure (CacheWriter         *writer,
+                       GimpPlugInProcedure *proc)
+{
+  GimpProcedure *procedure = GIMP_PROCEDURE (proc);
+  GList         *list;
+  gint           i;
+
+#define NOT_NULL(str) ((str) ? (str) : "")
+#define NOT_EMPTY(str) ((str) && *(str) ? (str) : NULL)
+
+  cache_writer_string (writer, procedure->original_name);
+  cache_writer_uint   (writer, procedure->proc_type);
+  cache_writer_string (writer, NOT_NULL (procedure->blurb));
+  cache_writer_string (writer, NOT_NULL (procedure->help));
+  cache_writer_string (writer, NOT_NULL (procedure->author));
+  cache_writer_string (writer, NOT_NULL (procedure->copyright));
+  cache_writer_string (writer, NOT_NULL (procedure->date));
+  cache_writer_string (writer, NOT_NULL (proc->menu_label));
+
+  cache_writer_uint (writer, g_list_length (proc->menu_paths));
+
+  for (list = proc->menu_paths; list; list = list->next)
+    cache_writer_string (writer, NOT_NULL (list->data));
+
+  cache_writer_uint (writer, proc->icon_type);
+
+  switch (proc->icon_type)
+    {
+    case GIMP_ICON_TYPE_STOCK_ID:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      cache_writer_string (writer, NOT_NULL ((const gchar *) proc->icon_data));
+      break;
+
+    case GIMP_ICON_TYPE_INLINE_PIXBUF:
+      cache_writer_data (writer, proc->icon_data, proc->icon_data_length);
+      break;
+    }
+
+  cache_writer_uint (writer, proc->file_proc);
+
+  if (proc->file_proc)
+    {
+      cache_writer_string (writer, NOT_EMPTY (proc->extensions));
+      cache_writer_string (writer, NOT_EMPTY (proc->prefixes));
+      cache_writer_string (writer, NOT_EMPTY (proc->magics));
+      cache_writer_string (writer, proc->mime_type);
+      cache_writer_uint   (writer, proc->handles_uri);
+      cache_writer_string (writer, proc->thumb_loader);
+    }
+
+  cache_writer_string (writer, NOT_NULL (proc->image_types));
+
+  cache_writer_uint (writer, procedure->num_args);
+  cache_writer_uint (writer, procedure->num_values);
+
+  for (i = 0; i < procedure->num_args + procedure->num_values; i++)
+    {
+      GParamSpec *pspec;
+
+      if (i < procedure->num_args)
+        pspec = procedure->args[i];
+      else
+        pspec = procedure->values[i - procedure->num_args];
+
+      cache_writer_uint   (writer,
+                           gimp_pdb_compat_arg_type_from_gtype (G_PARAM_SPEC_VALUE_TYPE (pspec)));
+      cache_writer_string (writer, g_param_spec_get_name (pspec));
+      cache_writer_string (writer, NOT_NULL (g_param_spec_get_blurb (pspec)));
+    }
+
+#undef NOT_NULL
+#undef NOT_EMPTY
+}
+
+static guint32
+cache_reader_uint (CacheReader *reader)
+{
+  if (reader->pos >= reader->n_words)
+    {
+      reader->error = TRUE;
+      return 0;
+    }
+
+  return reader->words[reader->pos++];
+}
+
+static gint64
+cache_reader_int64 (CacheReader *reader)
+{
+  guint64 low  = cache_reader_uint (reader);
+  guint64 high = cache_reader_uint (reader);
+
+  return (gint64) (low | (high << 32));
+}
+
+static const gchar *
+cache_reader_string (CacheReader *reader)
+{
+  guint32 offset = cache_reader_uint (reader);
+
+  if (offset == PLUG_IN_RC_CACHE_NULL)
+    return NULL;
+
+  if (offset >= reader->strings_size)
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  return reader->strings + offset;
+}
+
+static const guint8 *
+cache_reader_data (CacheReader *reader,
+                   gint        *length)
+{
+  guint32 offset = cache_reader_uint (reader);
+  guint32 size   = cache_reader_uint (reader);
+
+  if (offset > reader->strings_size        ||
+      size   > reader->strings_size - offset ||
+      size   > G_MAXINT)
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  *length = size;
+
+  return (const guint8 *) reader->strings + offset;
+}
+
+static GimpPlugInDef *
+cache_read_plug_in_def (CacheReader *reader,
+                        Gimp        *gimp)
+{
+  GimpPlugInDef *plug_in_def;
+  const gchar   *prog;
+  gint64         mtime;
+  const gchar   *locale_domain_name;
+  const gchar   *locale_domain_path;
+  const gchar   *help_domain_name;
+  const gchar   *help_domain_uri;
+  gboolean       has_init;
+  guint32        n_procedures;
+  guint32        i;
+
+  prog               = cache_reader_string (reader);
+  mtime              = cache_reader_int64  (reader);
+  locale_domain_name = cache_reader_string (reader);
+  locale_domain_path = cache_reader_string (reader);
+  help_domain_name   = cache_reader_string (reader);
+  help_domain_uri    = cache_reader_string (reader);
+  has_init           = cache_reader_uint   (reader);
+  n_procedures       = cache_reader_uint   (reader);
+
+  if (reader->error || ! prog)
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  plug_in_def = gimp_plug_in_def_new (prog);
+
+  plug_in_def->mtime = mtime;
+
+  if (locale_domain_name)
+    gimp_plug_in_def_set_locale_domain (plug_in_def,
+                                        locale_domain_name,
+                                        locale_domain_path);
+
+  if (help_domain_name)
+    gimp_plug_in_def_set_help_domain (plug_in_def,
+                                      help_domain_name,
+                                      help_domain_uri);
+
+  if (has_init)
+    gimp_plug_in_def_set_has_init (plug_in_def, TRUE);
+
+  for (i = 0; i < n_procedures && ! reader->error; i++)
+    {
+      GimpPlugInProcedure *proc;
+
+      proc = cache_read_procedure (reader, gimp, plug_in_def->prog);
+
+      if (proc)
+        {
+          gimp_plug_in_def_add_procedure (plug_in_def, proc);
+          g_object_unref (proc);
+        }
+    }
+
+  if (reader->error)
+    {
+      g_object_unref (plug_in_def);
+      return NULL;
+    }
+
+  return plug_in_def;
+}
+
+static GimpPlugInProcedure *
+cache_read_procedure (CacheReader *reader,
+                      Gimp        *gimp,
+                      const gchar *prog)
+{
+  GimpProcedure       *procedure;
+  GimpPlugInProcedure *proc;
+  const gchar         *name;
+  gint                 proc_type;
+  guint32              n_menu_paths;
+  guint32              n_args;
+  guint32              n_values;
+  guint32              i;
+
+  name      = cache_reader_string (reader);
+  proc_type = cache_reader_uint   (reader);
+
+  if (reader->error || ! name)
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  procedure = gimp_plug_in_procedure_new (proc_type, prog);
+  proc      = GIMP_PLUG_IN_PROCEDURE (procedure);
+
+  gimp_object_take_name (GIMP_OBJECT (procedure),
+                         gimp_canonicalize_identifier (name));
+
+  procedure->original_name = g_strdup (name);
+  procedure->blurb         = g_strdup (cache_reader_string (reader));
+  procedure->help          = g_strdup (cache_reader_string (reader));
+  procedure->author        = g_strdup (cache_reader_string (reader));
+  procedure->copyright     = g_strdup (cache_reader_string (reader));
+  procedure->date          = g_strdup (cache_reader_string (reader));
+  proc->menu_label         = g_strdup (cache_reader_string (reader));
+
+  n_menu_paths = cache_reader_uint (reader);
+
+  for (i = 0; i < n_menu_paths && ! reader->error; i++)
+    {
+      const gchar *menu_path = cache_reader_string (reader);
+
+      if (menu_path)
+        proc->menu_paths = g_list_prepend (proc->menu_paths,
+                                           g_strdup (menu_path));
+    }
+
+  proc->menu_paths = g_list_reverse (proc->menu_paths);
+
+  proc->icon_type = cache_reader_uint (reader);
+
+  switch (proc->icon_type)
+    {
+    case GIMP_ICON_TYPE_STOCK_ID:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      proc->icon_data_length = -1;
+      proc->icon_data        = (guint8 *) g_strdup (cache_reader_string (reader));
+      break;
+
+    case GIMP_ICON_TYPE_INLINE_PIXBUF:
+      {
+        const guint8 *data = cache_reader_data (reader,
+                                                &proc->icon_data_length);
+
+        if (data)
+          proc->icon_data = g_memdup (data, proc->icon_data_length);
+      }
+      break;
+
+    default:
+      reader->error = TRUE;
+      break;
+    }
+
+  if (cache_reader_uint (reader))
+    {
+      const gchar *mime_type;
+      const gchar *thumb_loader;
+
+      proc->file_proc  = TRUE;
+      proc->extensions = g_strdup (cache_reader_string (reader));
+      proc->prefixes   = g_strdup (cache_reader_string (reader));
+      proc->magics     = g_strdup (cache_reader_string (reader));
+
+      mime_type = cache_reader_string (reader);
+
+      if (mime_type)
+        gimp_plug_in_procedure_set_mime_type (proc, mime_type);
+
+      if (cache_reader_uint (reader))
+        gimp_plug_in_procedure_set_handles_uri (proc);
+
+      thumb_loader = cache_reader_string (reader);
+
+      if (thumb_loader)
+        gimp_plug_in_procedure_set_thumb_loader (proc, thumb_loader);
+    }
+
+  gimp_plug_in_procedure_set_image_types (proc,
+                                          cache_reader_string (reader));
+
+  n_args   = cache_reader_uint (reader);
+  n_values = cache_reader_uint (reader);
+
+  for (i = 0; i < n_args + n_values && ! reader->error; i++)
+    {
+      gint         arg_type = cache_reader_uint   (reader);
+      const gchar *arg_name = cache_reader_string (reader);
+      const gchar *arg_desc = cache_reader_string (reader);
+      GParamSpec  *pspec;
+
+      if (reader->error || ! arg_name)
+        {
+          reader->error = TRUE;
+          break;
+        }
+
+      pspec = gimp_pdb_compat_param_spec (gimp, arg_type, arg_name, arg_desc);
+
+      if (i < n_args)
+        gimp_procedure_add_argument (procedure, pspec);
+      else
+        gimp_procedure_add_return_value (procedure, pspec);
+    }
+
+  if (reader->error)
+    {
+      g_object_unref (procedure);
+      return NULL;
+    }
+
+  return proc;
+}
+
+static gboolean
+cache_get_rc_stat (const gchar *pluginrc,
+                   gint64      *mtime,
+                   gint64      *size)
+{
+  GStatBuf st;
+
+  if (g_stat (pluginrc, &st) != 0)
+    return FALSE;
+
+  *mtime = st.st_mtime;
+  *size  = st.st_size;
+
+  return TRUE;
+}
@@ -22,6 +22,9 @@
 #define __PLUG_IN_RC_H__
 
 
+#define PLUG_IN_RC_FILE_VERSION 2
+
+
 GSList   * plug_in_rc_parse (Gimp         *gimp,
                              const gchar  *filename,
                              GError      **error);
@@ -0,0 +1,309 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpcolor/gimpcolor.h"
+
+#include "core/core-types.h"
+
+#include "gegl/gimp-gegl-utils.h"
+
+#include "core/gimp.h"
+#include "core/gimpboundary.h"
+#include "core/gimpchannel.h"
+#include "core/gimpchannel-select.h"
+#include "core/gimpimage.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-boundary-cache/" #function, gimp, function);
+
+
+/*  not a multiple of the cache's 128 pixel tiles, so the last row and
+ *  column of tiles are partial
+ */
+#define IMAGE_WIDTH  400
+#define IMAGE_HEIGHT 300
+
+
+typedef struct
+{
+  GimpImage         *image;
+  GimpChannel       *channel;
+  GimpBoundaryCache *cache;
+} TestMask;
+
+
+static void
+test_mask_init (Gimp     *gimp,
+                TestMask *test)
+{
+  test->image = gimp_image_new (gimp, IMAGE_WIDTH, IMAGE_HEIGHT,
+                                GIMP_GRAY, GIMP_PRECISION_U8_GAMMA);
+
+  test->channel = gimp_channel_new_mask (test->image,
+                                         IMAGE_WIDTH, IMAGE_HEIGHT);
+
+  test->cache =
+    gimp_boundary_cache_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (test->channel)),
+                             babl_format ("Y float"),
+                             GIMP_BOUNDARY_HALF_WAY);
+}
+
+static void
+test_mask_free (TestMask *test)
+{
+  gimp_boundary_cache_free (test->cache);
+
+  g_object_unref (test->channel);
+  g_object_unref (test->image);
+}
+
+static gint
+boundary_seg_compare (const void *a,
+                      const void *b)
+{
+  const GimpBoundSeg *seg_a = a;
+  const GimpBoundSeg *seg_b = b;
+
+  if (seg_a->x1 != seg_b->x1)
+    return seg_a->x1 - seg_b->x1;
+
+  if (seg_a->y1 != seg_b->y1)
+    return seg_a->y1 - seg_b->y1;
+
+  if (seg_a->x2 != seg_b->x2)
+    return seg_a->x2 - seg_b->x2;
+
+  if (seg_a->y2 != seg_b->y2)
+    return seg_a->y2 - seg_b->y2;
+
+  return (gint) seg_a->open - (gint) seg_b->open;
+}
+
+/*  the cache has to find the same segments as tracing the whole mask,
+ *  in any order; returns the number of segments
+ */
+static gint
+compare_with_boundary_find (TestMask *test)
+{
+  GeglBuffer   *buffer;
+  GimpBoundSeg *cached;
+  GimpBoundSeg *traced;
+  gint          n_cached;
+  gint          n_traced;
+  gint          i;
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (test->channel));
+
+  cached = gimp_boundary_cache_find (test->cache, &n_cached);
+
+  traced = gimp_boundary_find (buffer, NULL,
+                               babl_format ("Y float"),
+                               GIMP_BOUNDARY_WITHIN_BOUNDS,
+                               0, 0, IMAGE_WIDTH, IMAGE_HEIGHT,
+                               GIMP_BOUNDARY_HALF_WAY,
+                               &n_traced);
+
+  g_assert_cmpint (n_cached, ==, n_traced);
+
+  qsort (cached, n_cached, sizeof (GimpBoundSeg), boundary_seg_compare);
+  qsort (traced, n_traced, sizeof (GimpBoundSeg), boundary_seg_compare);
+
+  for (i = 0; i < n_cached; i++)
+    {
+      g_assert_cmpint (cached[i].x1,   ==, traced[i].x1);
+      g_assert_cmpint (cached[i].y1,   ==, traced[i].y1);
+      g_assert_cmpint (cached[i].x2,   ==, traced[i].x2);
+      g_assert_cmpint (cached[i].y2,   ==, traced[i].y2);
+      g_assert_cmpint (cached[i].open, ==, traced[i].open);
+    }
+
+  g_free (cached);
+  g_free (traced);
+
+  return n_cached;
+}
+
+/**
+ * empty_mask:
+ * @data:
+ *
+ * Make sure an empty mask has no segments, before and after
+ * something was selected and cleared again.
+ **/
+static void
+empty_mask (gconstpointer data)
+{
+  TestMask test;
+
+  test_mask_init (GIMP (data), &test);
+
+  g_assert_cmpint (compare_with_boundary_find (&test), ==, 0);
+
+  gimp_channel_select_rectangle (test.channel, 100, 100, 100, 100,
+                                 GIMP_CHANNEL_OP_REPLACE,
+                                 FALSE, 0.0, 0.0, FALSE);
+  g_assert_cmpint (compare_with_boundary_find (&test), ==, 4);
+
+  gimp_channel_clear (test.channel, NULL, FALSE);
+  g_assert_cmpint (compare_with_boundary_find (&test), ==, 0);
+
+  test_mask_free (&test);
+}
+
+/**
+ * segments_across_tiles:
+ * @data:
+ *
+ * Make sure segments which cross tile edges, or run along them, are
+ * joined the way tracing the whole mask finds them.
+ **/
+static void
+segments_across_tiles (gconstpointer data)
+{
+  TestMask test;
+
+  test_mask_init (GIMP (data), &test);
+
+  /*  crosses the tile edges at 128 and 256 in both directions  */
+  gimp_channel_select_rectangle (test.channel, 50, 40, 300, 250,
+                                 GIMP_CHANNEL_OP_REPLACE,
+                                 FALSE, 0.0, 0.0, FALSE);
+  compare_with_boundary_find (&test);
+
+  /*  a hole whose edges lie exactly on tile edges  */
+  gimp_channel_select_rectangle (test.channel, 128, 128, 128, 128,
+                                 GIMP_CHANNEL_OP_SUBTRACT,
+                                 FALSE, 0.0, 0.0, FALSE);
+  compare_with_boundary_find (&test);
+
+  /*  one pixel on each side of a tile corner  */
+  gimp_channel_select_rectangle (test.channel, 127, 127, 2, 2,
+                                 GIMP_CHANNEL_OP_ADD,
+                                 FALSE, 0.0, 0.0, FALSE);
+  compare_with_boundary_find (&test);
+
+  /*  reaching the partial tiles at the right and bottom  */
+  gimp_channel_select_rectangle (test.channel, 300, 200,
+                                 IMAGE_WIDTH - 300, IMAGE_HEIGHT - 200,
+                                 GIMP_CHANNEL_OP_ADD,
+                                 FALSE, 0.0, 0.0, FALSE);
+  compare_with_boundary_find (&test);
+
+  test_mask_free (&test);
+}
+
+/**
+ * edit_mask:
+ * @data:
+ *
+ * Make sure the cache follows a sequence of edits, each of which only
+ * changes some of its tiles.
+ **/
+static void
+edit_mask (gconstpointer data)
+{
+  TestMask   test;
+  GimpRGB    rgb;
+  GeglColor *color;
+
+  test_mask_init (GIMP (data), &test);
+
+  gimp_channel_select_ellipse (test.channel, 20, 30, 220, 180,
+                               GIMP_CHANNEL_OP_REPLACE,
+                               TRUE, FALSE, 0.0, 0.0, FALSE);
+  compare_with_boundary_find (&test);
+
+  gimp_channel_select_ellipse (test.channel, 200, 100, 150, 180,
+                               GIMP_CHANNEL_OP_ADD,
+                               TRUE, FALSE, 0.0, 0.0, FALSE);
+  compare_with_boundary_find (&test);
+
+  gimp_channel_select_round_rect (test.channel, 90, 60, 120, 140,
+                                  30.0, 30.0,
+                                  GIMP_CHANNEL_OP_SUBTRACT,
+                                  TRUE, FALSE, 0.0, 0.0, FALSE);
+  compare_with_boundary_find (&test);
+
+  gimp_channel_select_rectangle (test.channel, 0, 0, 400, 300,
+                                 GIMP_CHANNEL_OP_INTERSECT,
+                                 TRUE, 8.0, 8.0, FALSE);
+  compare_with_boundary_find (&test);
+
+  /*  a change the channel doesn't know about, right below the
+   *  threshold in one tile and above it in the next one
+   */
+  gimp_rgba_set (&rgb, 0.45, 0.45, 0.45, 1.0);
+  color = gimp_gegl_color_new (&rgb);
+  gegl_buffer_set_color (gimp_drawable_get_buffer (GIMP_DRAWABLE (test.channel)),
+                         GEGL_RECTANGLE (60, 240, 68, 40), color);
+  g_object_unref (color);
+
+  gimp_rgba_set (&rgb, 0.55, 0.55, 0.55, 1.0);
+  color = gimp_gegl_color_new (&rgb);
+  gegl_buffer_set_color (gimp_drawable_get_buffer (GIMP_DRAWABLE (test.channel)),
+                         GEGL_RECTANGLE (128, 240, 60, 40), color);
+  g_object_unref (color);
+
+  compare_with_boundary_find (&test);
+
+  gimp_channel_invert (test.channel, FALSE);
+  compare_with_boundary_find (&test);
+
+  gimp_channel_all (test.channel, FALSE);
+  compare_with_boundary_find (&test);
+
+  test_mask_free (&test);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /*  initialize the threads the dirty tiles are traced in  */
+  gimp = gimp_init_for_testing ();
+
+  ADD_TEST (empty_mask);
+  ADD_TEST (segments_across_tiles);
+  ADD_TEST (edit_mask);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
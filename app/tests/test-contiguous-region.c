@@ -0,0 +1,360 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpcolor/gimpcolor.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpimage.h"
+#include "core/gimpimage-contiguous-region.h"
+#include "core/gimplayer.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-contiguous-region/" #function, gimp, function);
+
+
+#define IMAGE_WIDTH  256
+#define IMAGE_HEIGHT 256
+
+/*  the size of the image used by the -m perf benchmark  */
+#define PERF_IMAGE_WIDTH  5000
+#define PERF_IMAGE_HEIGHT 4000
+
+#define SEED_X    5
+#define SEED_Y    5
+#define THRESHOLD 0.1
+
+
+static GimpImage *
+create_test_image (Gimp *gimp,
+                   gint  width,
+                   gint  height)
+{
+  GimpImage          *image;
+  GimpLayer          *layer;
+  GeglBufferIterator *iter;
+  GRand              *rand;
+
+  image = gimp_image_new (gimp, width, height,
+                          GIMP_RGB, GIMP_PRECISION_FLOAT_LINEAR);
+
+  layer = gimp_layer_new (image, width, height,
+                          babl_format ("RGBA float"),
+                          "Test Layer",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_NORMAL_MODE);
+
+  gimp_image_add_layer (image, layer, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  /*  a noisy background, split by vertical walls which are open
+   *  alternately at the top and the bottom, so that the region has
+   *  to snake up and down through the whole image
+   */
+  rand = g_rand_new_with_seed (42);
+
+  iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                                   NULL, 0, babl_format ("RGBA float"),
+                                   GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat *data = iter->data[0];
+      gint    x, y;
+
+      for (y = iter->roi[0].y; y < iter->roi[0].y + iter->roi[0].height; y++)
+        for (x = iter->roi[0].x; x < iter->roi[0].x + iter->roi[0].width; x++)
+          {
+            gboolean gap   = ((x / 40) % 2 == 0) ? (y < 6) : (y >= height - 6);
+            gboolean wall  = (x % 40 >= 20 && x % 40 < 23 && ! gap);
+            gfloat   value = wall ? 0.9 : 0.2;
+
+            value += g_rand_double_range (rand, 0.0, 0.12);
+
+            data[0] = data[1] = data[2] = value;
+            data[3] = 1.0;
+
+            data += 4;
+          }
+    }
+
+  g_rand_free (rand);
+
+  return image;
+}
+
+/*  the flood fill used before, sampling the pixel differences and the
+ *  mask one pixel at a time, and keeping the spans in a GQueue
+ */
+static GeglBuffer *
+reference_region_by_seed (GimpImage *image,
+                          gboolean   antialias,
+                          gint       x,
+                          gint       y)
+{
+  GimpDrawable *drawable = gimp_image_get_active_drawable (image);
+  GeglBuffer   *diff_buffer;
+  GeglBuffer   *mask_buffer;
+  GQueue       *coord_stack;
+  gfloat        seed[4];
+  GimpRGB       color;
+  gint          width    = gimp_image_get_width  (image);
+  gint          height   = gimp_image_get_height (image);
+  gfloat       *mask_row;
+
+  gegl_buffer_sample (gimp_drawable_get_buffer (drawable), x, y, NULL,
+                      seed, babl_format ("R'G'B'A float"),
+                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+  gimp_rgba_set (&color, seed[0], seed[1], seed[2], seed[3]);
+
+  diff_buffer = gimp_image_contiguous_region_by_color (image, drawable,
+                                                       FALSE, antialias,
+                                                       THRESHOLD, FALSE,
+                                                       GIMP_SELECT_CRITERION_COMPOSITE,
+                                                       &color);
+
+  mask_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
+                                 babl_format ("Y float"));
+
+  mask_row    = g_new (gfloat, width);
+  coord_stack = g_queue_new ();
+
+  g_queue_push_tail (coord_stack, GINT_TO_POINTER (y));
+  g_queue_push_tail (coord_stack, GINT_TO_POINTER (x - 1));
+  g_queue_push_tail (coord_stack, GINT_TO_POINTER (x + 1));
+
+  do
+    {
+      gint start, end;
+
+      y     = GPOINTER_TO_INT (g_queue_pop_head (coord_stack));
+      start = GPOINTER_TO_INT (g_queue_pop_head (coord_stack));
+      end   = GPOINTER_TO_INT (g_queue_pop_head (coord_stack));
+
+      for (x = start + 1; x < end; x++)
+        {
+          gfloat val;
+          gint   new_start, new_end;
+
+          gegl_buffer_sample (mask_buffer, x, y, NULL, &val,
+                              babl_format ("Y float"),
+                              GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+          if (val != 0.0)
+            continue;
+
+          gegl_buffer_sample (diff_buffer, x, y, NULL, &val,
+                              babl_format ("Y float"),
+                              GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+          if (val == 0.0)
+            continue;
+
+          for (new_start = x; new_start >= 0; new_start--)
+            {
+              gegl_buffer_sample (diff_buffer, new_start, y, NULL, &val,
+                                  babl_format ("Y float"),
+                                  GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+              if (val == 0.0)
+                break;
+
+              mask_row[new_start] = val;
+            }
+
+          for (new_end = x + 1; new_end < width; new_end++)
+            {
+              gegl_buffer_sample (diff_buffer, new_end, y, NULL, &val,
+                                  babl_format ("Y float"),
+                                  GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+              if (val == 0.0)
+                break;
+
+              mask_row[new_end] = val;
+            }
+
+          gegl_buffer_set (mask_buffer,
+                           GEGL_RECTANGLE (new_start + 1, y,
+                                           new_end - new_start - 1, 1),
+                           0, babl_format ("Y float"),
+                           &mask_row[new_start + 1],
+                           GEGL_AUTO_ROWSTRIDE);
+
+          if (y + 1 < height)
+            {
+              g_queue_push_tail (coord_stack, GINT_TO_POINTER (y + 1));
+              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_start));
+              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_end));
+            }
+
+          if (y - 1 >= 0)
+            {
+              g_queue_push_tail (coord_stack, GINT_TO_POINTER (y - 1));
+              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_start));
+              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_end));
+            }
+        }
+    }
+  while (! g_queue_is_empty (coord_stack));
+
+  g_queue_free (coord_stack);
+  g_free (mask_row);
+  g_object_unref (diff_buffer);
+
+  return mask_buffer;
+}
+
+static void
+compare_regions (gconstpointer data,
+                 gboolean      antialias)
+{
+  Gimp       *gimp = GIMP (data);
+  GimpImage  *image;
+  GeglBuffer *region;
+  GeglBuffer *reference;
+  gint        width  = IMAGE_WIDTH;
+  gint        height = IMAGE_HEIGHT;
+  gfloat     *region_data;
+  gfloat     *reference_data;
+  gint        n_selected = 0;
+  gint        i;
+
+  image = create_test_image (gimp, width, height);
+
+  region = gimp_image_contiguous_region_by_seed (image,
+                                                 gimp_image_get_active_drawable (image),
+                                                 FALSE, antialias,
+                                                 THRESHOLD, FALSE,
+                                                 GIMP_SELECT_CRITERION_COMPOSITE,
+                                                 SEED_X, SEED_Y);
+
+  reference = reference_region_by_seed (image, antialias, SEED_X, SEED_Y);
+
+  region_data    = g_new (gfloat, width * height);
+  reference_data = g_new (gfloat, width * height);
+
+  gegl_buffer_get (region, NULL, 1.0, babl_format ("Y float"),
+                   region_data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_get (reference, NULL, 1.0, babl_format ("Y float"),
+                   reference_data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < width * height; i++)
+    {
+      /*  the reference seeds with a color that made a round trip
+       *  through GimpRGB, allow for rounding errors
+       */
+      g_assert_cmpfloat (ABS (region_data[i] - reference_data[i]), <, 1e-4);
+
+      if (region_data[i] > 0.0)
+        n_selected++;
+    }
+
+  /*  make sure the region actually went around the walls  */
+  g_assert_cmpint (n_selected, >, width * height / 2);
+
+  g_free (region_data);
+  g_free (reference_data);
+
+  g_object_unref (region);
+  g_object_unref (reference);
+  g_object_unref (image);
+}
+
+static void
+region_by_seed (gconstpointer data)
+{
+  compare_regions (data, FALSE);
+}
+
+static void
+region_by_seed_antialias (gconstpointer data)
+{
+  compare_regions (data, TRUE);
+}
+
+/*  only run with -m perf: times the flood fill against the old one
+ *  on a large image
+ */
+static void
+region_by_seed_perf (gconstpointer data)
+{
+  Gimp       *gimp = GIMP (data);
+  GimpImage  *image;
+  GeglBuffer *region;
+  GeglBuffer *reference;
+  gdouble     region_time;
+  gdouble     reference_time;
+
+  image = create_test_image (gimp, PERF_IMAGE_WIDTH, PERF_IMAGE_HEIGHT);
+
+  g_test_timer_start ();
+  region = gimp_image_contiguous_region_by_seed (image,
+                                                 gimp_image_get_active_drawable (image),
+                                                 FALSE, FALSE,
+                                                 THRESHOLD, FALSE,
+                                                 GIMP_SELECT_CRITERION_COMPOSITE,
+                                                 SEED_X, SEED_Y);
+  region_time = g_test_timer_elapsed ();
+
+  g_test_timer_start ();
+  reference = reference_region_by_seed (image, FALSE, SEED_X, SEED_Y);
+  reference_time = g_test_timer_elapsed ();
+
+  g_test_minimized_result (region_time,
+                           "%dx%d: flood fill %.3f s, old flood fill %.3f s",
+                           PERF_IMAGE_WIDTH, PERF_IMAGE_HEIGHT,
+                           region_time, reference_time);
+
+  g_object_unref (region);
+  g_object_unref (reference);
+  g_object_unref (image);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  ADD_TEST (region_by_seed);
+  ADD_TEST (region_by_seed_antialias);
+
+  if (g_test_perf ())
+    ADD_TEST (region_by_seed_perf);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
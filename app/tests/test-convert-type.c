@@ -0,0 +1,297 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpimage.h"
+#include "core/gimpimage-colormap.h"
+#include "core/gimpimage-convert-type.h"
+#include "core/gimplayer.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-convert-type/" #function, gimp, function);
+
+
+/*  the number of threads many_colors compares with a single one  */
+#define N_THREADS 4
+
+
+/*  an RGB image of the given size with one layer, which has about
+ *  @n_colors distinct colors, or a smooth gradient with noise if
+ *  @n_colors is 0
+ */
+static GimpImage *
+create_rgb_image (Gimp *gimp,
+                  gint  size,
+                  gint  n_colors)
+{
+  GimpImage *image;
+  GimpLayer *layer;
+  GRand     *rand;
+  guchar    *pixels;
+  gint       x, y;
+
+  image = gimp_image_new (gimp, size, size,
+                          GIMP_RGB, GIMP_PRECISION_U8_GAMMA);
+
+  layer = gimp_layer_new (image, size, size,
+                          babl_format ("R'G'B' u8"),
+                          "Test Layer",
+                          1.0,
+                          GIMP_NORMAL_MODE);
+
+  gimp_image_add_layer (image, layer, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  rand   = g_rand_new_with_seed (size);
+  pixels = g_new (guchar, size * size * 3);
+
+  for (y = 0; y < size; y++)
+    for (x = 0; x < size; x++)
+      {
+        guchar *p = pixels + (y * size + x) * 3;
+
+        if (n_colors)
+          {
+            gint c = (x / 8 + y / 8 * 3) % n_colors;
+
+            p[0] = c * 37;
+            p[1] = c * 91;
+            p[2] = 255 - c * 13;
+          }
+        else
+          {
+            p[0] = CLAMP (x * 255 / size + g_rand_int_range (rand, -8, 8),
+                          0, 255);
+            p[1] = CLAMP (y * 255 / size + g_rand_int_range (rand, -8, 8),
+                          0, 255);
+            p[2] = g_rand_int_range (rand, 0, 256);
+          }
+      }
+
+  gegl_buffer_set (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                   GEGL_RECTANGLE (0, 0, size, size), 0,
+                   babl_format ("R'G'B' u8"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (pixels);
+  g_rand_free (rand);
+
+  return image;
+}
+
+static guchar *
+get_image_pixels (GimpImage *image)
+{
+  GimpLayer *layer = gimp_image_get_active_layer (image);
+  gint       size  = gimp_image_get_width (image);
+  guchar    *pixels;
+
+  pixels = g_new (guchar, size * size * 3);
+
+  gegl_buffer_get (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                   GEGL_RECTANGLE (0, 0, size, size), 1.0,
+                   babl_format ("R'G'B' u8"), pixels,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  return pixels;
+}
+
+/*  an image with few colors keeps them exactly
+ */
+static void
+few_colors (gconstpointer data)
+{
+  Gimp      *gimp = GIMP (data);
+  GimpImage *image;
+  guchar    *before;
+  guchar    *after;
+  gboolean   success;
+
+  image  = create_rgb_image (gimp, 300, 16);
+  before = get_image_pixels (image);
+
+  success = gimp_image_convert_type (image, GIMP_INDEXED,
+                                     256, GIMP_NO_DITHER,
+                                     FALSE, FALSE, FALSE,
+                                     GIMP_MAKE_PALETTE, NULL,
+                                     NULL, NULL);
+
+  g_assert (success);
+  g_assert_cmpint (gimp_image_get_base_type (image), ==, GIMP_INDEXED);
+  g_assert_cmpint (gimp_image_get_colormap_size (image), ==, 16);
+
+  after = get_image_pixels (image);
+
+  g_assert (memcmp (before, after, 300 * 300 * 3) == 0);
+
+  g_free (before);
+  g_free (after);
+  g_object_unref (image);
+}
+
+/*  converts @image to indexed with a generated 256 color palette,
+ *  with the work split among @n_threads threads
+ */
+static gboolean
+convert_to_indexed (GimpImage *image,
+                    gint       n_threads)
+{
+  Gimp     *gimp = image->gimp;
+  guint     num_processors;
+  gboolean  success;
+
+  g_object_get (gimp->config,
+                "num-processors", &num_processors,
+                NULL);
+  g_object_set (gimp->config,
+                "num-processors", n_threads,
+                NULL);
+
+  success = gimp_image_convert_type (image, GIMP_INDEXED,
+                                     256, GIMP_NO_DITHER,
+                                     FALSE, FALSE, FALSE,
+                                     GIMP_MAKE_PALETTE, NULL,
+                                     NULL, NULL);
+
+  g_object_set (gimp->config,
+                "num-processors", num_processors,
+                NULL);
+
+  return success;
+}
+
+/*  RGB -> indexed with a generated 256 color palette gives the same
+ *  result with one thread and with several
+ */
+static void
+many_colors (gconstpointer data)
+{
+  Gimp      *gimp = GIMP (data);
+  GimpImage *image1;
+  GimpImage *image2;
+  guchar    *pixels1;
+  guchar    *pixels2;
+
+  image1 = create_rgb_image (gimp, 256, 0);
+  image2 = create_rgb_image (gimp, 256, 0);
+
+  g_assert (convert_to_indexed (image1, 1));
+  g_assert (convert_to_indexed (image2, N_THREADS));
+
+  g_assert_cmpint (gimp_image_get_base_type (image1), ==, GIMP_INDEXED);
+  g_assert_cmpint (gimp_image_get_colormap_size (image1), <=, 256);
+  g_assert_cmpint (gimp_image_get_colormap_size (image1), >, 200);
+
+  g_assert_cmpint (gimp_image_get_colormap_size (image1), ==,
+                   gimp_image_get_colormap_size (image2));
+  g_assert (memcmp (gimp_image_get_colormap (image1),
+                    gimp_image_get_colormap (image2),
+                    gimp_image_get_colormap_size (image1) * 3) == 0);
+
+  pixels1 = get_image_pixels (image1);
+  pixels2 = get_image_pixels (image2);
+
+  g_assert (memcmp (pixels1, pixels2, 256 * 256 * 3) == 0);
+
+  g_free (pixels1);
+  g_free (pixels2);
+  g_object_unref (image1);
+  g_object_unref (image2);
+}
+
+/*  only run with -m perf: the throughput of RGB -> indexed with a
+ *  generated 256 color palette on increasingly large images
+ */
+static void
+many_colors_perf (gconstpointer data)
+{
+  static const gint  sizes[] = { 256, 1024, 2048, 4096 };
+  Gimp              *gimp    = GIMP (data);
+  gint               i;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      GimpImage *image = create_rgb_image (gimp, sizes[i], 0);
+      gdouble    elapsed;
+      gboolean   success;
+
+      g_test_timer_start ();
+
+      success = gimp_image_convert_type (image, GIMP_INDEXED,
+                                         256, GIMP_NO_DITHER,
+                                         FALSE, FALSE, FALSE,
+                                         GIMP_MAKE_PALETTE, NULL,
+                                         NULL, NULL);
+
+      elapsed = g_test_timer_elapsed ();
+
+      g_assert (success);
+
+      g_test_minimized_result (elapsed,
+                               "%d x %d RGB -> 256 colors: %.4f s, "
+                               "%.1f Mpixels/s",
+                               sizes[i], sizes[i], elapsed,
+                               sizes[i] * sizes[i] / elapsed / 1000000.0);
+
+      g_object_unref (image);
+    }
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /*  initialize the threads the conversion is split among  */
+  gimp = gimp_init_for_testing ();
+
+  ADD_TEST (few_colors);
+  ADD_TEST (many_colors);
+
+  if (g_test_perf ())
+    ADD_TEST (many_colors_perf);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
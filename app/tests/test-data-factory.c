@@ -0,0 +1,348 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gstdio.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpdata.h"
+#include "core/gimpdatafactory.h"
+#include "core/gimpgradient-load.h"
+#include "core/gimplist.h"
+#include "core/gimppalette-load.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-data-factory/" #function, gimp, function);
+
+
+/*  the number of threads the loads are compared with a single one  */
+#define N_THREADS        4
+
+#define FILES_PER_FOLDER 16
+
+
+typedef gchar * (* TestDataFunc) (const gchar *name);
+
+
+/*  the toplevel folder, nested ones, and one with obsolete files  */
+static const gchar *folders[] =
+{
+  "",
+  "sub",
+  "sub/deeper",
+  "other",
+  "gimp-obsolete-files"
+};
+
+
+static gchar *
+gradient_contents (const gchar *name)
+{
+  return g_strdup_printf ("GIMP Gradient\n"
+                          "Name: %s\n"
+                          "1\n"
+                          "0.000000 0.500000 1.000000 "
+                          "0.1 0.2 0.3 1.0 0.9 0.8 0.7 1.0 0 0\n",
+                          name);
+}
+
+static gchar *
+palette_contents (const gchar *name)
+{
+  return g_strdup_printf ("GIMP Palette\n"
+                          "Name: %s\n"
+                          "Columns: 0\n"
+                          "#\n"
+                          " 10  20  30\tFirst\n"
+                          "200 100   0\tSecond\n",
+                          name);
+}
+
+/*  fills @dirname with files in several folders, every third of them
+ *  with the same name, so the order they are added to the container
+ *  in decides which one gets which unique name
+ */
+static void
+create_data_folder (const gchar  *dirname,
+                    const gchar  *extension,
+                    TestDataFunc  contents_func)
+{
+  gint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (folders); i++)
+    {
+      gchar *folder = g_build_filename (dirname, folders[i], NULL);
+
+      g_assert_cmpint (g_mkdir_with_parents (folder, 0755), ==, 0);
+
+      for (j = 0; j < FILES_PER_FOLDER; j++)
+        {
+          gchar *name;
+          gchar *basename;
+          gchar *filename;
+          gchar *contents;
+
+          if (j % 3 == 0)
+            name = g_strdup ("Duplicate");
+          else
+            name = g_strdup_printf ("Data %d-%d", i, j);
+
+          /*  the last one has no extension and goes to the
+           *  fallback loader
+           */
+          if (j == FILES_PER_FOLDER - 1)
+            basename = g_strdup_printf ("data-%02d", j);
+          else
+            basename = g_strdup_printf ("data-%02d%s", j, extension);
+
+          filename = g_build_filename (folder, basename, NULL);
+          contents = contents_func (name);
+
+          g_assert (g_file_set_contents (filename, contents, -1, NULL));
+
+          g_free (contents);
+          g_free (filename);
+          g_free (basename);
+          g_free (name);
+        }
+
+      g_free (folder);
+    }
+}
+
+static void
+remove_folder (const gchar *dirname)
+{
+  GDir        *dir;
+  const gchar *basename;
+
+  dir = g_dir_open (dirname, 0, NULL);
+  g_assert (dir != NULL);
+
+  while ((basename = g_dir_read_name (dir)))
+    {
+      gchar *filename = g_build_filename (dirname, basename, NULL);
+
+      if (g_file_test (filename, G_FILE_TEST_IS_DIR))
+        remove_folder (filename);
+      else
+        g_remove (filename);
+
+      g_free (filename);
+    }
+
+  g_dir_close (dir);
+
+  g_rmdir (dirname);
+}
+
+static void
+add_data_names (GPtrArray     *names,
+                GimpContainer *container)
+{
+  GList *list;
+
+  for (list = GIMP_LIST (container)->list; list; list = g_list_next (list))
+    {
+      GimpData    *data     = list->data;
+      const gchar *filename = gimp_data_get_filename (data);
+
+      g_ptr_array_add (names,
+                       g_strdup_printf ("%s %s %ld",
+                                        gimp_object_get_name (data),
+                                        filename ? filename : "(none)",
+                                        (glong) gimp_data_get_mtime (data)));
+    }
+}
+
+/*  loads @factory's data with @n_threads, returns the names, files
+ *  and mtimes of what ended up in its containers, in their order
+ */
+static GPtrArray *
+load_data (Gimp            *gimp,
+           GimpDataFactory *factory,
+           gint             n_threads,
+           gboolean         refresh)
+{
+  GimpContext *context = gimp_get_user_context (gimp);
+  GPtrArray   *names;
+  gint         num_processors;
+
+  gimp_data_factory_data_free (factory);
+  gimp_container_clear (gimp_data_factory_get_container_obsolete (factory));
+
+  g_object_get (gimp->config,
+                "num-processors", &num_processors,
+                NULL);
+  g_object_set (gimp->config,
+                "num-processors", n_threads,
+                NULL);
+
+  if (refresh)
+    gimp_data_factory_data_refresh (factory, context);
+  else
+    gimp_data_factory_data_init (factory, context, FALSE);
+
+  g_object_set (gimp->config,
+                "num-processors", num_processors,
+                NULL);
+
+  names = g_ptr_array_new_with_free_func (g_free);
+
+  add_data_names (names, gimp_data_factory_get_container (factory));
+  add_data_names (names, gimp_data_factory_get_container_obsolete (factory));
+
+  return names;
+}
+
+static void
+compare_data_names (GPtrArray *names1,
+                    GPtrArray *names2)
+{
+  gint i;
+
+  g_assert_cmpint (names1->len, ==, names2->len);
+
+  for (i = 0; i < names1->len; i++)
+    g_assert_cmpstr (g_ptr_array_index (names1, i),
+                     ==,
+                     g_ptr_array_index (names2, i));
+}
+
+static void
+compare_loads (Gimp            *gimp,
+               GimpDataFactory *factory,
+               const gchar     *path_property_name,
+               const gchar     *extension,
+               TestDataFunc     contents_func)
+{
+  GPtrArray *serial;
+  GPtrArray *parallel;
+  GPtrArray *indexed;
+  gchar     *dirname;
+  gchar     *path;
+
+  dirname = g_dir_make_tmp ("gimp-test-data-factory-XXXXXX", NULL);
+  g_assert (dirname != NULL);
+
+  create_data_folder (dirname, extension, contents_func);
+
+  g_object_get (gimp->config,
+                path_property_name, &path,
+                NULL);
+  g_object_set (gimp->config,
+                path_property_name, dirname,
+                NULL);
+
+  /*  a new path is always scanned, a refresh too, a second load of
+   *  an unchanged path takes the files from the index
+   */
+  serial   = load_data (gimp, factory, 1,         FALSE);
+  parallel = load_data (gimp, factory, N_THREADS, TRUE);
+  indexed  = load_data (gimp, factory, N_THREADS, FALSE);
+
+  g_assert_cmpint (serial->len, >=,
+                   G_N_ELEMENTS (folders) * FILES_PER_FOLDER);
+
+  compare_data_names (serial, parallel);
+  compare_data_names (serial, indexed);
+
+  g_ptr_array_unref (serial);
+  g_ptr_array_unref (parallel);
+  g_ptr_array_unref (indexed);
+
+  gimp_data_factory_data_free (factory);
+  gimp_container_clear (gimp_data_factory_get_container_obsolete (factory));
+
+  g_object_set (gimp->config,
+                path_property_name, path,
+                NULL);
+  g_free (path);
+
+  remove_folder (dirname);
+  g_free (dirname);
+}
+
+/**
+ * load_gradients:
+ * @data:
+ *
+ * Make sure loading gradients, which are decoded on all threads,
+ * fills the containers the same way with one and several threads,
+ * and from the index.
+ **/
+static void
+load_gradients (gconstpointer data)
+{
+  Gimp *gimp = GIMP (data);
+
+  compare_loads (gimp, gimp->gradient_factory, "gradient-path",
+                 GIMP_GRADIENT_FILE_EXTENSION, gradient_contents);
+}
+
+/**
+ * load_palettes:
+ * @data:
+ *
+ * Make sure loading palettes, which are decoded in the main thread,
+ * fills the containers the same way with one and several threads,
+ * and from the index.
+ **/
+static void
+load_palettes (gconstpointer data)
+{
+  Gimp *gimp = GIMP (data);
+
+  compare_loads (gimp, gimp->palette_factory, "palette-path",
+                 GIMP_PALETTE_FILE_EXTENSION, palette_contents);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  ADD_TEST (load_gradients);
+  ADD_TEST (load_palettes);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,313 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpcolor/gimpcolor.h"
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "gegl/gimp-gegl-utils.h"
+
+#include "core/gimp.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpfilterstack.h"
+#include "core/gimpimage.h"
+#include "core/gimplayer.h"
+#include "core/gimpprojectable.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-filter-stack-cache/" #function, gimp, function);
+
+
+#define IMAGE_SIZE 256
+
+/*  an area that crosses tile edges of the cache buffer  */
+#define PAINT_RECT GEGL_RECTANGLE (100, 40, 80, 60)
+
+
+typedef enum
+{
+  PAINT_BOTTOM,
+  PAINT_MIDDLE,
+  PAINT_TOP
+} PaintLayer;
+
+typedef struct
+{
+  GimpImage *image;
+  GimpLayer *top;
+  GimpLayer *middle;
+  GimpLayer *bottom;
+} TestImage;
+
+
+static void
+fill_layer (GimpLayer           *layer,
+            const GeglRectangle *rect,
+            gdouble              r,
+            gdouble              g,
+            gdouble              b,
+            gdouble              a)
+{
+  GimpRGB    rgb;
+  GeglColor *color;
+
+  gimp_rgba_set (&rgb, r, g, b, a);
+  color = gimp_gegl_color_new (&rgb);
+
+  gegl_buffer_set_color (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                         rect, color);
+
+  g_object_unref (color);
+
+  gimp_drawable_update (GIMP_DRAWABLE (layer),
+                        rect->x, rect->y, rect->width, rect->height);
+}
+
+static GimpLayer *
+add_layer (GimpImage            *image,
+           const gchar          *name,
+           gdouble               opacity,
+           GimpLayerModeEffects  mode)
+{
+  GimpLayer *layer;
+
+  layer = gimp_layer_new (image, IMAGE_SIZE, IMAGE_SIZE,
+                          babl_format ("R'G'B'A u8"),
+                          name,
+                          opacity,
+                          mode);
+
+  gimp_image_add_layer (image, layer, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  return layer;
+}
+
+static gfloat *
+render_image (GimpImage *image)
+{
+  GeglNode *graph = gimp_projectable_get_graph (GIMP_PROJECTABLE (image));
+  gfloat   *data  = g_new (gfloat, IMAGE_SIZE * IMAGE_SIZE * 4);
+
+  gegl_node_blit (graph, 1.0, GEGL_RECTANGLE (0, 0, IMAGE_SIZE, IMAGE_SIZE),
+                  babl_format ("RGBA float"), data,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  return data;
+}
+
+/*  three overlapping layers, with the composite below the middle one
+ *  cached the way GimpPaintCore does while painting it
+ */
+static void
+create_test_image (Gimp      *gimp,
+                   TestImage *test)
+{
+  GimpFilterStack *stack;
+
+  test->image = gimp_image_new (gimp, IMAGE_SIZE, IMAGE_SIZE,
+                                GIMP_RGB, GIMP_PRECISION_U8_GAMMA);
+
+  test->bottom = add_layer (test->image, "Bottom", 1.0, GIMP_NORMAL_MODE);
+  test->middle = add_layer (test->image, "Middle", 0.6, GIMP_NORMAL_MODE);
+  test->top    = add_layer (test->image, "Top",    0.7, GIMP_MULTIPLY_MODE);
+
+  fill_layer (test->bottom, GEGL_RECTANGLE (0, 0, IMAGE_SIZE, IMAGE_SIZE),
+              0.2, 0.4, 0.8, 1.0);
+  fill_layer (test->middle, GEGL_RECTANGLE (32, 32, 160, 160),
+              0.9, 0.3, 0.1, 0.8);
+  fill_layer (test->top, GEGL_RECTANGLE (64, 16, 128, 224),
+              0.5, 0.9, 0.5, 0.5);
+
+  stack = GIMP_FILTER_STACK (gimp_image_get_layers (test->image));
+
+  gimp_filter_stack_cache_below (stack,
+                                 GIMP_FILTER (test->middle),
+                                 GEGL_RECTANGLE (0, 0, IMAGE_SIZE, IMAGE_SIZE));
+
+  /*  render the cache, so the changes made later have something
+   *  to invalidate
+   */
+  g_free (render_image (test->image));
+}
+
+/*  compares the cached composite with the one rendered without the
+ *  cache, and leaves a rendered cache enabled again
+ */
+static void
+compare_with_uncached (TestImage *test)
+{
+  GimpFilterStack *stack;
+  gfloat          *cached;
+  gfloat          *uncached;
+  gdouble          max = 0.0;
+  gint             i;
+
+  stack = GIMP_FILTER_STACK (gimp_image_get_layers (test->image));
+
+  g_assert (stack->cache_filter == GIMP_FILTER (test->middle));
+
+  cached = render_image (test->image);
+
+  gimp_filter_stack_cache_below (stack, NULL, NULL);
+
+  uncached = render_image (test->image);
+
+  for (i = 0; i < IMAGE_SIZE * IMAGE_SIZE * 4; i++)
+    max = MAX (max, fabs (cached[i] - uncached[i]));
+
+  g_assert_cmpfloat (max, <=, 1e-5);
+
+  g_free (cached);
+  g_free (uncached);
+
+  gimp_filter_stack_cache_below (stack,
+                                 GIMP_FILTER (test->middle),
+                                 GEGL_RECTANGLE (0, 0, IMAGE_SIZE, IMAGE_SIZE));
+
+  g_free (render_image (test->image));
+}
+
+static void
+paint_and_compare (Gimp       *gimp,
+                   PaintLayer  paint_layer)
+{
+  TestImage  test;
+  GimpLayer *layer;
+
+  create_test_image (gimp, &test);
+
+  switch (paint_layer)
+    {
+    case PAINT_BOTTOM:
+      layer = test.bottom;
+      break;
+    case PAINT_MIDDLE:
+      layer = test.middle;
+      break;
+    default:
+      layer = test.top;
+      break;
+    }
+
+  fill_layer (layer, PAINT_RECT, 0.1, 0.7, 0.3, 0.9);
+
+  compare_with_uncached (&test);
+
+  /*  and a second time, partly over the first change  */
+  fill_layer (layer, GEGL_RECTANGLE (120, 60, 100, 90),
+              0.8, 0.8, 0.2, 0.4);
+
+  compare_with_uncached (&test);
+
+  g_object_unref (test.image);
+}
+
+/**
+ * cache_matches_uncached:
+ * @data:
+ *
+ * Make sure the composite with the cache below the middle layer is
+ * the same as without it.
+ **/
+static void
+cache_matches_uncached (gconstpointer data)
+{
+  TestImage test;
+
+  create_test_image (GIMP (data), &test);
+
+  compare_with_uncached (&test);
+
+  g_object_unref (test.image);
+}
+
+/**
+ * paint_below_cached:
+ * @data:
+ *
+ * Make sure painting a layer below the cached one renders the
+ * changed area of the cache again.
+ **/
+static void
+paint_below_cached (gconstpointer data)
+{
+  paint_and_compare (GIMP (data), PAINT_BOTTOM);
+}
+
+/**
+ * paint_cached:
+ * @data:
+ *
+ * Make sure painting the cached layer itself shows up, with the
+ * cache left alone.
+ **/
+static void
+paint_cached (gconstpointer data)
+{
+  paint_and_compare (GIMP (data), PAINT_MIDDLE);
+}
+
+/**
+ * paint_above_cached:
+ * @data:
+ *
+ * Make sure painting a layer above the cached one shows up, with the
+ * cache left alone.
+ **/
+static void
+paint_above_cached (gconstpointer data)
+{
+  paint_and_compare (GIMP (data), PAINT_TOP);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  ADD_TEST (cache_matches_uncached);
+  ADD_TEST (paint_below_cached);
+  ADD_TEST (paint_cached);
+  ADD_TEST (paint_above_cached);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,288 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+
+#include "paint/gimpheal-laplace.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-heal/" #function, gimp, function);
+
+
+/*  gimp_heal_laplace_sor()'s iteration limit  */
+#define SOR_MAX_ITER 500
+
+#define DEPTH        4
+
+
+typedef struct
+{
+  gint    width;
+  gint    height;
+  guchar *mask;
+  gfloat *pixels;
+  gfloat *alloc;
+} HealProblem;
+
+
+/*  a round brush of the given diameter on a smooth but not linear
+ *  background, which is what gimp_heal() gets as the difference of
+ *  the destination and the source
+ */
+static HealProblem *
+heal_problem_new (gint diameter)
+{
+  HealProblem *problem = g_slice_new (HealProblem);
+  gdouble      radius  = diameter / 2.0;
+  gint         x, y, k;
+
+  problem->width  = diameter + 2;
+  problem->height = diameter + 2;
+
+  problem->mask  = g_new (guchar, problem->width * problem->height);
+  problem->alloc = g_new (gfloat,
+                          4 + (problem->width * problem->height + 1) * DEPTH);
+
+  problem->pixels = (gfloat *) (((uintptr_t) problem->alloc + 15) & ~15);
+
+  for (y = 0; y < problem->height; y++)
+    for (x = 0; x < problem->width; x++)
+      {
+        gint    i  = y * problem->width + x;
+        gdouble dx = x + 0.5 - problem->width  / 2.0;
+        gdouble dy = y + 0.5 - problem->height / 2.0;
+
+        problem->mask[i] = (dx * dx + dy * dy < radius * radius);
+
+        for (k = 0; k < DEPTH; k++)
+          {
+            if (problem->mask[i])
+              problem->pixels[i * DEPTH + k] = 0.0;
+            else
+              problem->pixels[i * DEPTH + k] = (0.5 * sin (x * 0.05 + k) +
+                                                0.3 * cos (y * 0.07));
+          }
+      }
+
+  return problem;
+}
+
+static HealProblem *
+heal_problem_copy (HealProblem *problem)
+{
+  HealProblem *copy = g_slice_new (HealProblem);
+  gint         size = problem->width * problem->height;
+
+  copy->width  = problem->width;
+  copy->height = problem->height;
+
+  copy->mask   = g_memdup (problem->mask, size);
+  copy->alloc  = g_new (gfloat, 4 + (size + 1) * DEPTH);
+  copy->pixels = (gfloat *) (((uintptr_t) copy->alloc + 15) & ~15);
+
+  memcpy (copy->pixels, problem->pixels, size * DEPTH * sizeof (gfloat));
+
+  return copy;
+}
+
+static void
+heal_problem_free (HealProblem *problem)
+{
+  g_free (problem->mask);
+  g_free (problem->alloc);
+
+  g_slice_free (HealProblem, problem);
+}
+
+/*  the largest deviation of a solved pixel from the mean of its
+ *  neighbors on the canvas
+ */
+static gdouble
+heal_problem_get_residual (HealProblem *problem)
+{
+  gdouble max = 0.0;
+  gint    x, y, k;
+
+  for (y = 0; y < problem->height; y++)
+    for (x = 0; x < problem->width; x++)
+      {
+        gint i = y * problem->width + x;
+
+        if (! problem->mask[i])
+          continue;
+
+        for (k = 0; k < DEPTH; k++)
+          {
+            gdouble sum = 0.0;
+            gint    n   = 0;
+
+#define NEIGHBOR(dx,dy)                                                  \
+            if (x + dx >= 0 && x + dx < problem->width &&               \
+                y + dy >= 0 && y + dy < problem->height)                \
+              {                                                          \
+                sum += problem->pixels[(i + dy * problem->width + dx) *  \
+                                       DEPTH + k];                       \
+                n++;                                                     \
+              }
+
+            NEIGHBOR (-1,  0);
+            NEIGHBOR ( 1,  0);
+            NEIGHBOR ( 0, -1);
+            NEIGHBOR ( 0,  1);
+
+#undef NEIGHBOR
+
+            max = MAX (max, fabs (sum / n - problem->pixels[i * DEPTH + k]));
+          }
+      }
+
+  return max;
+}
+
+static void
+compare_solvers (gint diameter)
+{
+  HealProblem *sor;
+  HealProblem *multigrid;
+  gint         sor_iter;
+  gdouble      max_diff = 0.0;
+  gint         i;
+
+  sor       = heal_problem_new (diameter);
+  multigrid = heal_problem_copy (sor);
+
+  sor_iter = gimp_heal_laplace_sor (sor->pixels, sor->height, DEPTH,
+                                    sor->width, sor->mask);
+
+  gimp_heal_laplace_multigrid (multigrid->pixels, multigrid->height, DEPTH,
+                               multigrid->width, multigrid->mask);
+
+  /*  the multigrid solution has to be smooth...  */
+  g_assert_cmpfloat (heal_problem_get_residual (multigrid), <, 0.05 / 255);
+
+  /*  ...and the same as SOR's, unless SOR ran out of iterations  */
+  if (sor_iter < SOR_MAX_ITER)
+    {
+      for (i = 0; i < sor->width * sor->height * DEPTH; i++)
+        max_diff = MAX (max_diff, fabs (sor->pixels[i] - multigrid->pixels[i]));
+
+      g_assert_cmpfloat (max_diff, <, 0.5 / 255);
+    }
+
+  heal_problem_free (sor);
+  heal_problem_free (multigrid);
+}
+
+static void
+laplace_solvers (gconstpointer data)
+{
+  static const gint diameters[] = { 20, 50, 150 };
+  gint              i;
+
+  for (i = 0; i < G_N_ELEMENTS (diameters); i++)
+    compare_solvers (diameters[i]);
+}
+
+/*  only run with -m perf: times both solvers on increasingly large
+ *  brushes
+ */
+static void
+laplace_solvers_perf (gconstpointer data)
+{
+  static const gint diameters[] = { 20, 50, 150, 300, 600, 1000 };
+  gint              i;
+
+  for (i = 0; i < G_N_ELEMENTS (diameters); i++)
+    {
+      HealProblem *sor;
+      HealProblem *multigrid;
+      gint         sor_iter;
+      gint         multigrid_cycles;
+      gdouble      sor_time;
+      gdouble      multigrid_time;
+
+      sor       = heal_problem_new (diameters[i]);
+      multigrid = heal_problem_copy (sor);
+
+      g_test_timer_start ();
+      sor_iter = gimp_heal_laplace_sor (sor->pixels, sor->height, DEPTH,
+                                        sor->width, sor->mask);
+      sor_time = g_test_timer_elapsed ();
+
+      g_test_timer_start ();
+      multigrid_cycles = gimp_heal_laplace_multigrid (multigrid->pixels,
+                                                      multigrid->height, DEPTH,
+                                                      multigrid->width,
+                                                      multigrid->mask);
+      multigrid_time = g_test_timer_elapsed ();
+
+      g_test_minimized_result (multigrid_time,
+                               "diameter %d: SOR %d sweeps %.4f s, "
+                               "multigrid %d V-cycles %.4f s",
+                               diameters[i],
+                               sor_iter, sor_time,
+                               multigrid_cycles, multigrid_time);
+
+      heal_problem_free (sor);
+      heal_problem_free (multigrid);
+    }
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /*  initialize the threads used by the multigrid solver  */
+  gimp = gimp_init_for_testing ();
+
+  ADD_TEST (laplace_solvers);
+
+  if (g_test_perf ())
+    ADD_TEST (laplace_solvers_perf);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,320 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core/core-types.h"
+#include "plug-in/plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "pdb/gimp-pdb-compat.h"
+
+#include "plug-in/gimpplugindef.h"
+#include "plug-in/gimppluginprocedure.h"
+#include "plug-in/plug-in-rc.h"
+#include "plug-in/plug-in-rc-cache.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-plug-in-rc/" #function, gimp, function);
+
+
+/*  some bytes standing in for an inline pixbuf, which are not
+ *  NUL-terminated
+ */
+static const guint8 icon_pixbuf[] =
+{
+  'G', 'd', 'k', 'P', 0x00, 0x00, 0x00, 0x1c,
+  0x01, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x04,
+  0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+  0xff, 0x80, 0x40, 0xff
+};
+
+
+/*  a plug-in def with a filter, a load procedure and a procedure
+ *  with an inline pixbuf icon
+ */
+static GSList *
+create_plug_in_defs (Gimp *gimp)
+{
+  GimpPlugInDef       *plug_in_def;
+  GimpProcedure       *procedure;
+  GimpPlugInProcedure *proc;
+
+  plug_in_def = gimp_plug_in_def_new ("/usr/lib/gimp/plug-ins/test");
+  gimp_plug_in_def_set_mtime (plug_in_def, 1234567890);
+  gimp_plug_in_def_set_locale_domain (plug_in_def, "gimp-test", NULL);
+
+  procedure = gimp_plug_in_procedure_new (GIMP_PLUGIN, plug_in_def->prog);
+  proc      = GIMP_PLUG_IN_PROCEDURE (procedure);
+
+  gimp_object_set_name (GIMP_OBJECT (procedure), "plug-in-test");
+  procedure->original_name = g_strdup ("plug_in_test");
+  procedure->blurb         = g_strdup ("Test");
+  procedure->help          = g_strdup ("A test filter");
+  procedure->author        = g_strdup ("Someone");
+  procedure->copyright     = g_strdup ("Someone");
+  procedure->date          = g_strdup ("2016");
+  proc->menu_label         = g_strdup ("_Test...");
+  proc->menu_paths         = g_list_append (NULL,
+                                            g_strdup ("<Image>/Filters/Misc"));
+  proc->icon_type          = GIMP_ICON_TYPE_STOCK_ID;
+  proc->icon_data_length   = -1;
+  proc->icon_data          = (guint8 *) g_strdup ("gimp-test");
+
+  gimp_plug_in_procedure_set_image_types (proc, "RGB*, GRAY*");
+
+  gimp_procedure_add_argument (procedure,
+                               gimp_pdb_compat_param_spec (gimp,
+                                                           GIMP_PDB_INT32,
+                                                           "run-mode",
+                                                           "The run mode"));
+  gimp_procedure_add_argument (procedure,
+                               gimp_pdb_compat_param_spec (gimp,
+                                                           GIMP_PDB_FLOAT,
+                                                           "amount",
+                                                           "The amount"));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_pdb_compat_param_spec (gimp,
+                                                               GIMP_PDB_IMAGE,
+                                                               "image",
+                                                               "The image"));
+
+  gimp_plug_in_def_add_procedure (plug_in_def, proc);
+  g_object_unref (procedure);
+
+  procedure = gimp_plug_in_procedure_new (GIMP_PLUGIN, plug_in_def->prog);
+  proc      = GIMP_PLUG_IN_PROCEDURE (procedure);
+
+  gimp_object_set_name (GIMP_OBJECT (procedure), "file-test-load");
+  procedure->original_name = g_strdup ("file_test_load");
+  proc->file_proc          = TRUE;
+  proc->extensions         = g_strdup ("tst,test");
+  proc->magics             = g_strdup ("0,string,TEST");
+
+  gimp_plug_in_procedure_set_mime_type (proc, "image/x-test");
+  gimp_plug_in_procedure_set_handles_uri (proc);
+
+  gimp_plug_in_def_add_procedure (plug_in_def, proc);
+  g_object_unref (procedure);
+
+  /*  all of its strings but the name are already in the cache's
+   *  string table, so the icon data ends up at the end of it
+   */
+  procedure = gimp_plug_in_procedure_new (GIMP_PLUGIN, plug_in_def->prog);
+  proc      = GIMP_PLUG_IN_PROCEDURE (procedure);
+
+  gimp_object_set_name (GIMP_OBJECT (procedure), "plug-in-test-icon");
+  procedure->original_name = g_strdup ("plug_in_test_icon");
+
+  gimp_plug_in_procedure_set_icon (proc, GIMP_ICON_TYPE_INLINE_PIXBUF,
+                                   icon_pixbuf, sizeof (icon_pixbuf));
+
+  gimp_plug_in_def_add_procedure (plug_in_def, proc);
+  g_object_unref (procedure);
+
+  return g_slist_append (NULL, plug_in_def);
+}
+
+static void
+compare_procedures (GimpPlugInProcedure *a,
+                    GimpPlugInProcedure *b)
+{
+  GimpProcedure *procedure_a = GIMP_PROCEDURE (a);
+  GimpProcedure *procedure_b = GIMP_PROCEDURE (b);
+  GList         *list_a;
+  GList         *list_b;
+  gint           i;
+
+  g_assert_cmpstr (gimp_object_get_name (a), ==, gimp_object_get_name (b));
+  g_assert_cmpstr (procedure_a->original_name, ==, procedure_b->original_name);
+  g_assert_cmpint (procedure_a->proc_type, ==, procedure_b->proc_type);
+  g_assert_cmpstr (procedure_a->blurb,     ==, procedure_b->blurb);
+  g_assert_cmpstr (procedure_a->help,      ==, procedure_b->help);
+  g_assert_cmpstr (procedure_a->author,    ==, procedure_b->author);
+  g_assert_cmpstr (procedure_a->copyright, ==, procedure_b->copyright);
+  g_assert_cmpstr (procedure_a->date,      ==, procedure_b->date);
+  g_assert_cmpstr (a->menu_label,          ==, b->menu_label);
+  g_assert_cmpstr (a->image_types,         ==, b->image_types);
+  g_assert_cmpstr (a->locale_domain,       ==, b->locale_domain);
+  g_assert_cmpint (a->mtime,               ==, b->mtime);
+
+  g_assert_cmpint (g_list_length (a->menu_paths), ==,
+                   g_list_length (b->menu_paths));
+
+  for (list_a = a->menu_paths, list_b = b->menu_paths;
+       list_a;
+       list_a = list_a->next, list_b = list_b->next)
+    {
+      g_assert_cmpstr (list_a->data, ==, list_b->data);
+    }
+
+  g_assert_cmpint (a->icon_type,        ==, b->icon_type);
+  g_assert_cmpint (a->icon_data_length, ==, b->icon_data_length);
+
+  if (a->icon_type == GIMP_ICON_TYPE_INLINE_PIXBUF)
+    g_assert (memcmp (a->icon_data, b->icon_data, a->icon_data_length) == 0);
+  else
+    g_assert_cmpstr ((gchar *) a->icon_data, ==, (gchar *) b->icon_data);
+
+  g_assert_cmpint (a->file_proc,   ==, b->file_proc);
+  g_assert_cmpstr (a->extensions,  ==, b->extensions);
+  g_assert_cmpstr (a->prefixes,    ==, b->prefixes);
+  g_assert_cmpstr (a->magics,      ==, b->magics);
+  g_assert_cmpstr (a->mime_type,   ==, b->mime_type);
+  g_assert_cmpint (a->handles_uri, ==, b->handles_uri);
+
+  g_assert_cmpint (procedure_a->num_args,   ==, procedure_b->num_args);
+  g_assert_cmpint (procedure_a->num_values, ==, procedure_b->num_values);
+
+  for (i = 0; i < procedure_a->num_args; i++)
+    {
+      GParamSpec *pspec_a = procedure_a->args[i];
+      GParamSpec *pspec_b = procedure_b->args[i];
+
+      g_assert (G_PARAM_SPEC_VALUE_TYPE (pspec_a) ==
+                G_PARAM_SPEC_VALUE_TYPE (pspec_b));
+      g_assert_cmpstr (g_param_spec_get_name (pspec_a), ==,
+                       g_param_spec_get_name (pspec_b));
+      g_assert_cmpstr (g_param_spec_get_blurb (pspec_a), ==,
+                       g_param_spec_get_blurb (pspec_b));
+    }
+
+  for (i = 0; i < procedure_a->num_values; i++)
+    {
+      g_assert_cmpstr (g_param_spec_get_name (procedure_a->values[i]), ==,
+                       g_param_spec_get_name (procedure_b->values[i]));
+    }
+}
+
+/*  the cache reads back the same as parsing pluginrc, and is ignored
+ *  once pluginrc changed
+ */
+static void
+cache_matches_pluginrc (gconstpointer data)
+{
+  Gimp    *gimp    = GIMP (data);
+  GSList  *plug_in_defs;
+  GSList  *parsed;
+  GSList  *cached;
+  GSList  *list_a;
+  GSList  *list_b;
+  gchar   *dir;
+  gchar   *pluginrc;
+  gchar   *cache;
+  GError  *error   = NULL;
+
+  dir      = g_dir_make_tmp ("gimp-test-plug-in-rc-XXXXXX", NULL);
+  pluginrc = g_build_filename (dir, "pluginrc", NULL);
+  cache    = g_build_filename (dir, "pluginrc.cache", NULL);
+
+  plug_in_defs = create_plug_in_defs (gimp);
+
+  g_assert (plug_in_rc_write (plug_in_defs, pluginrc, &error));
+  g_assert (plug_in_rc_cache_write (plug_in_defs, cache, pluginrc, &error));
+
+  parsed = plug_in_rc_parse (gimp, pluginrc, &error);
+  g_assert_no_error (error);
+
+  cached = plug_in_rc_cache_read (gimp, cache, pluginrc, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpint (g_slist_length (cached), ==, g_slist_length (parsed));
+
+  for (list_a = parsed, list_b = cached;
+       list_a;
+       list_a = list_a->next, list_b = list_b->next)
+    {
+      GimpPlugInDef *def_a = list_a->data;
+      GimpPlugInDef *def_b = list_b->data;
+      GSList        *procs_a;
+      GSList        *procs_b;
+
+      g_assert_cmpstr (def_a->prog, ==, def_b->prog);
+      g_assert_cmpint (def_a->mtime, ==, def_b->mtime);
+      g_assert_cmpstr (def_a->locale_domain_name, ==,
+                       def_b->locale_domain_name);
+      g_assert_cmpint (def_a->has_init, ==, def_b->has_init);
+
+      g_assert_cmpint (g_slist_length (def_a->procedures), ==,
+                       g_slist_length (def_b->procedures));
+
+      for (procs_a = def_a->procedures, procs_b = def_b->procedures;
+           procs_a;
+           procs_a = procs_a->next, procs_b = procs_b->next)
+        {
+          compare_procedures (procs_a->data, procs_b->data);
+        }
+    }
+
+  g_slist_free_full (cached, (GDestroyNotify) g_object_unref);
+
+  /*  a different pluginrc invalidates the cache  */
+  g_assert (g_file_set_contents (pluginrc, "", -1, NULL));
+
+  cached = plug_in_rc_cache_read (gimp, cache, pluginrc, &error);
+  g_assert_no_error (error);
+  g_assert (cached == NULL);
+
+  g_slist_free_full (parsed,       (GDestroyNotify) g_object_unref);
+  g_slist_free_full (plug_in_defs, (GDestroyNotify) g_object_unref);
+
+  g_unlink (cache);
+  g_unlink (pluginrc);
+  g_rmdir (dir);
+
+  g_free (cache);
+  g_free (pluginrc);
+  g_free (dir);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  ADD_TEST (cache_matches_pluginrc);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,282 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "gegl/gimp-gegl-apply-operation.h"
+
+#include "operations/gimpcolorizeconfig.h"
+#include "operations/gimplevelsconfig.h"
+#include "operations/gimpoperationcolorize.h"
+#include "operations/gimpoperationlevels.h"
+
+#include "core/gimp.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-point-chain/" #function, gimp, function);
+
+
+#define IMAGE_SIZE    256
+
+/*  the largest error of the 33x33x33 LUT's trilinear interpolation
+ *  for the filters below
+ */
+#define LUT_TOLERANCE (4.0 / 255.0)
+
+
+/*  an 8 bit buffer with every red/green combination and a varying
+ *  blue and alpha
+ */
+static GeglBuffer *
+create_test_buffer (void)
+{
+  GeglBuffer *buffer;
+  guchar     *pixels;
+  gint        x, y;
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, IMAGE_SIZE, IMAGE_SIZE),
+                            babl_format ("R'G'B'A u8"));
+
+  pixels = g_new (guchar, IMAGE_SIZE * IMAGE_SIZE * 4);
+
+  for (y = 0; y < IMAGE_SIZE; y++)
+    for (x = 0; x < IMAGE_SIZE; x++)
+      {
+        guchar *p = pixels + (y * IMAGE_SIZE + x) * 4;
+
+        p[0] = x;
+        p[1] = y;
+        p[2] = (x * 7 + y * 3) & 0xff;
+        p[3] = 255 - ((x + y) >> 1);
+      }
+
+  gegl_buffer_set (buffer, NULL, 0, babl_format ("R'G'B'A u8"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (pixels);
+
+  return buffer;
+}
+
+static GeglBuffer *
+create_float_buffer (void)
+{
+  return gegl_buffer_new (GEGL_RECTANGLE (0, 0, IMAGE_SIZE, IMAGE_SIZE),
+                          babl_format ("R'G'B'A float"));
+}
+
+static GObject *
+create_levels_config (void)
+{
+  return g_object_new (GIMP_TYPE_LEVELS_CONFIG,
+                       "channel",     GIMP_HISTOGRAM_VALUE,
+                       "gamma",       0.8,
+                       "low-output",  0.1,
+                       "high-output", 0.9,
+                       NULL);
+}
+
+static GObject *
+create_colorize_config (void)
+{
+  return g_object_new (GIMP_TYPE_COLORIZE_CONFIG,
+                       "hue",        0.3,
+                       "saturation", 0.6,
+                       "lightness",  0.1,
+                       NULL);
+}
+
+static void
+apply_node (GeglBuffer *src_buffer,
+            GeglNode   *node,
+            GeglBuffer *dest_buffer)
+{
+  gimp_gegl_apply_operation (src_buffer, NULL, NULL, node, dest_buffer, NULL);
+  g_object_unref (node);
+}
+
+/*  levels and then colorize, as two separate graph nodes  */
+static GeglBuffer *
+apply_sequentially (GeglBuffer *src_buffer,
+                    GObject    *levels,
+                    GObject    *colorize)
+{
+  GeglBuffer *temp_buffer = create_float_buffer ();
+  GeglBuffer *dest_buffer = create_float_buffer ();
+
+  apply_node (src_buffer,
+              gegl_node_new_child (NULL,
+                                   "operation", "gimp:levels",
+                                   "config",    levels,
+                                   NULL),
+              temp_buffer);
+
+  apply_node (temp_buffer,
+              gegl_node_new_child (NULL,
+                                   "operation", "gimp:colorize",
+                                   "config",    colorize,
+                                   NULL),
+              dest_buffer);
+
+  g_object_unref (temp_buffer);
+
+  return dest_buffer;
+}
+
+/*  levels and then colorize, in one gimp:point-chain pass  */
+static GeglBuffer *
+apply_chained (GeglBuffer *src_buffer,
+               GObject    *levels,
+               GObject    *colorize,
+               gboolean    use_lut)
+{
+  GeglBuffer *dest_buffer = create_float_buffer ();
+  GPtrArray  *filters;
+
+  filters = g_ptr_array_new_with_free_func (g_object_unref);
+
+  g_ptr_array_add (filters, g_object_new (GIMP_TYPE_OPERATION_LEVELS,
+                                          "config", levels,
+                                          NULL));
+  g_ptr_array_add (filters, g_object_new (GIMP_TYPE_OPERATION_COLORIZE,
+                                          "config", colorize,
+                                          NULL));
+
+  g_assert (gimp_gegl_apply_point_filters (src_buffer, NULL, NULL,
+                                           dest_buffer, NULL,
+                                           filters, use_lut));
+
+  g_ptr_array_unref (filters);
+
+  return dest_buffer;
+}
+
+static gdouble
+buffers_get_max_diff (GeglBuffer *buffer1,
+                      GeglBuffer *buffer2)
+{
+  gfloat  *data1;
+  gfloat  *data2;
+  gdouble  max = 0.0;
+  gint     i;
+
+  data1 = g_new (gfloat, IMAGE_SIZE * IMAGE_SIZE * 4);
+  data2 = g_new (gfloat, IMAGE_SIZE * IMAGE_SIZE * 4);
+
+  gegl_buffer_get (buffer1, NULL, 1.0, babl_format ("R'G'B'A float"), data1,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_get (buffer2, NULL, 1.0, babl_format ("R'G'B'A float"), data2,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < IMAGE_SIZE * IMAGE_SIZE * 4; i++)
+    max = MAX (max, fabs (data1[i] - data2[i]));
+
+  g_free (data1);
+  g_free (data2);
+
+  return max;
+}
+
+static void
+compare_chain (gboolean use_lut,
+               gdouble  tolerance)
+{
+  GeglBuffer *src_buffer;
+  GeglBuffer *reference;
+  GeglBuffer *chained;
+  GObject    *levels;
+  GObject    *colorize;
+
+  src_buffer = create_test_buffer ();
+  levels     = create_levels_config ();
+  colorize   = create_colorize_config ();
+
+  reference = apply_sequentially (src_buffer, levels, colorize);
+  chained   = apply_chained (src_buffer, levels, colorize, use_lut);
+
+  g_assert_cmpfloat (buffers_get_max_diff (reference, chained), <=, tolerance);
+
+  g_object_unref (reference);
+  g_object_unref (chained);
+  g_object_unref (levels);
+  g_object_unref (colorize);
+  g_object_unref (src_buffer);
+}
+
+/**
+ * point_chain:
+ * @data:
+ *
+ * Make sure gimp:point-chain gives the same result as applying its
+ * filters one after the other.
+ **/
+static void
+point_chain (gconstpointer data)
+{
+  compare_chain (FALSE, 1e-5);
+}
+
+/**
+ * point_chain_lut:
+ * @data:
+ *
+ * Make sure gimp:point-chain's LUT for 8 bit input stays close to
+ * applying its filters one after the other.
+ **/
+static void
+point_chain_lut (gconstpointer data)
+{
+  compare_chain (TRUE, LUT_TOLERANCE);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /*  initialize the GEGL operations  */
+  gimp = gimp_init_for_testing ();
+
+  ADD_TEST (point_chain);
+  ADD_TEST (point_chain_lut);
+
+  result = g_test_run ();
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
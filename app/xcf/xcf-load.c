@@ -19,6 +19,8 @@
 
 #include <string.h>
 
+#include <zlib.h>
+
 #include <cairo.h>
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -66,6 +68,7 @@
 #include "xcf-load.h"
 #include "xcf-read.h"
 #include "xcf-seek.h"
+#include "xcf-tile-handler.h"
 
 #include "gimp-intl.h"
 
@@ -104,6 +107,10 @@ static gboolean        xcf_load_buffer        (XcfInfo       *info,
                                                GeglBuffer    *buffer);
 static gboolean        xcf_load_level         (XcfInfo       *info,
                                                GeglBuffer    *buffer);
+static gboolean        xcf_load_level_mapped  (XcfInfo       *info,
+                                               GeglBuffer    *buffer,
+                                               goffset        offset,
+                                               gint           ntiles);
 static gboolean        xcf_load_tile          (XcfInfo       *info,
                                                GeglBuffer    *buffer,
                                                GeglRectangle *tile_rect,
@@ -113,6 +120,11 @@ static gboolean        xcf_load_tile_rle      (XcfInfo       *info,
                                                GeglRectangle *tile_rect,
                                                const Babl    *format,
                                                gint           data_length);
+static gboolean        xcf_load_tile_zlib     (XcfInfo       *info,
+                                               GeglBuffer    *buffer,
+                                               GeglRectangle *tile_rect,
+                                               const Babl    *format,
+                                               gint           data_length);
 static GimpParasite  * xcf_load_parasite      (XcfInfo       *info);
 static gboolean        xcf_load_old_paths     (XcfInfo       *info,
                                                GimpImage     *image);
@@ -126,6 +138,10 @@ static gboolean        xcf_load_vector        (XcfInfo       *info,
 static gboolean        xcf_skip_unknown_prop  (XcfInfo       *info,
                                                gsize          size);
 
+static guint           xcf_read_offset        (XcfInfo       *info,
+                                               goffset       *data,
+                                               gint           count);
+
 
 #define xcf_progress_update(info) G_STMT_START  \
   {                                             \
@@ -142,8 +158,8 @@ xcf_load_image (Gimp     *gimp,
   GimpImage          *image = NULL;
   const GimpParasite *parasite;
   gboolean            has_metadata = FALSE;
-  guint32             saved_pos;
-  guint32             offset;
+  goffset             saved_pos;
+  goffset             offset;
   gint                width;
   gint                height;
   gint                image_type;
@@ -336,7 +352,7 @@ xcf_load_image (Gimp     *gimp,
       GList     *item_path = NULL;
 
       /* read in the offset of the next layer */
-      info->cp += xcf_read_int32 (info->input, &offset, 1);
+      info->cp += xcf_read_offset (info, &offset, 1);
 
       /* if the offset is 0 then we are at the end
        *  of the layer list.
@@ -420,7 +436,7 @@ xcf_load_image (Gimp     *gimp,
       GimpChannel *channel;
 
       /* read in the offset of the next channel */
-      info->cp += xcf_read_int32 (info->input, &offset, 1);
+      info->cp += xcf_read_offset (info, &offset, 1);
 
       /* if the offset is 0 then we are at the end
        *  of the channel list.
@@ -505,6 +521,172 @@ xcf_load_image (Gimp     *gimp,
   return NULL;
 }
 
+/**
+ * xcf_load_decode_tile_rle:
+ * @xcfdata:     the RLE encoded tile data
+ * @data_length: the number of bytes available at @xcfdata, may be
+ *               more than the encoded tile
+ * @tile_data:   return location for @n_pixels pixels of @bpp bytes
+ * @bpp:         the number of bytes per pixel
+ * @n_pixels:    the number of pixels in the tile
+ *
+ * Decodes a tile from XCF's byte-planar RLE encoding. This function
+ * does not depend on any loader state and can be called from any
+ * thread.
+ *
+ * Return value: %FALSE if the encoded data is bogus.
+ **/
+gboolean
+xcf_load_decode_tile_rle (const guchar *xcfdata,
+                          gsize         data_length,
+                          guchar       *tile_data,
+                          gint          bpp,
+                          gint          n_pixels)
+{
+  const guchar *xcfdatalimit;
+  gint          i;
+
+  if (data_length == 0)
+    return FALSE;
+
+  xcfdatalimit = &xcfdata[data_length - 1];
+
+  for (i = 0; i < bpp; i++)
+    {
+      guchar *data  = tile_data + i;
+      gint    size  = n_pixels;
+      gint    count = 0;
+      guchar  val;
+      gint    length;
+      gint    j;
+
+      while (size > 0)
+        {
+          if (xcfdata > xcfdatalimit)
+            {
+              goto bogus_rle;
+            }
+
+          val = *xcfdata++;
+
+          length = val;
+          if (length >= 128)
+            {
+              length = 255 - (length - 1);
+              if (length == 128)
+                {
+                  if (xcfdata >= xcfdatalimit)
+                    {
+                      goto bogus_rle;
+                    }
+
+                  length = (*xcfdata << 8) + xcfdata[1];
+                  xcfdata += 2;
+                }
+
+              count += length;
+              size -= length;
+
+              if (size < 0)
+                {
+                  goto bogus_rle;
+                }
+
+              if (&xcfdata[length-1] > xcfdatalimit)
+                {
+                  goto bogus_rle;
+                }
+
+              while (length-- > 0)
+                {
+                  *data = *xcfdata++;
+                  data += bpp;
+                }
+            }
+          else
+            {
+              length += 1;
+              if (length == 128)
+                {
+                  if (xcfdata >= xcfdatalimit)
+                    {
+                      goto bogus_rle;
+                    }
+
+                  length = (*xcfdata << 8) + xcfdata[1];
+                  xcfdata += 2;
+                }
+
+              count += length;
+              size -= length;
+
+              if (size < 0)
+                {
+                  goto bogus_rle;
+                }
+
+              if (xcfdata > xcfdatalimit)
+                {
+                  goto bogus_rle;
+                }
+
+              val = *xcfdata++;
+
+              for (j = 0; j < length; j++)
+                {
+                  *data = val;
+                  data += bpp;
+                }
+            }
+        }
+    }
+
+  return TRUE;
+
+ bogus_rle:
+  return FALSE;
+}
+
+/**
+ * xcf_load_decode_tile_zlib:
+ * @xcfdata:     the zlib compressed tile data
+ * @data_length: the number of bytes available at @xcfdata, may be
+ *               more than the compressed tile
+ * @tile_data:   return location for the decompressed tile
+ * @tile_size:   the size of the decompressed tile, in bytes
+ *
+ * Decompresses a zlib compressed tile. This function does not depend
+ * on any loader state and can be called from any thread.
+ *
+ * Return value: %FALSE if the compressed data is bogus.
+ **/
+gboolean
+xcf_load_decode_tile_zlib (const guchar *xcfdata,
+                           gsize         data_length,
+                           guchar       *tile_data,
+                           gint          tile_size)
+{
+  z_stream strm = { 0, };
+  gint     status;
+
+  if (inflateInit (&strm) != Z_OK)
+    return FALSE;
+
+  strm.next_in   = (guchar *) xcfdata;
+  strm.avail_in  = data_length;
+  strm.next_out  = tile_data;
+  strm.avail_out = tile_size;
+
+  /* the stream carries its own end marker, so any trailing bytes we
+   * read past the end of the tile are simply left unconsumed
+   */
+  status = inflate (&strm, Z_FINISH);
+
+  inflateEnd (&strm);
+
+  return (status == Z_STREAM_END && strm.avail_out == 0);
+}
+
 static void
 xcf_load_add_masks (GimpImage *image)
 {
@@ -730,7 +912,7 @@ xcf_load_image_props (XcfInfo   *info,
 
         case PROP_PARASITES:
           {
-            glong base = info->cp;
+            goffset base = info->cp;
 
             while (info->cp - base < prop_size)
               {
@@ -826,7 +1008,7 @@ xcf_load_image_props (XcfInfo   *info,
 
         case PROP_VECTORS:
           {
-            guint32 base = info->cp;
+            goffset base = info->cp;
 
             if (xcf_load_vectors (info, image))
               {
@@ -834,7 +1016,7 @@ xcf_load_image_props (XcfInfo   *info,
                   {
                     g_printerr ("Mismatch in PROP_VECTORS size: "
                                 "skipping %d bytes.\n",
-                                base + prop_size - info->cp);
+                                (gint) (base + prop_size - info->cp));
                     xcf_seek_pos (info, base + prop_size, NULL);
                   }
               }
@@ -892,9 +1074,7 @@ xcf_load_layer_props (XcfInfo    *info,
 
         case PROP_FLOATING_SELECTION:
           info->floating_sel = *layer;
-          info->cp +=
-            xcf_read_int32 (info->input,
-                            (guint32 *) &info->floating_sel_offset, 1);
+          info->cp += xcf_read_offset (info, &info->floating_sel_offset, 1);
           break;
 
         case PROP_OPACITY:
@@ -1003,7 +1183,7 @@ xcf_load_layer_props (XcfInfo    *info,
 
         case PROP_PARASITES:
           {
-            glong base = info->cp;
+            goffset base = info->cp;
 
             while (info->cp - base < prop_size)
               {
@@ -1044,8 +1224,8 @@ xcf_load_layer_props (XcfInfo    *info,
 
         case PROP_ITEM_PATH:
           {
-            glong  base = info->cp;
-            GList *path = NULL;
+            goffset  base = info->cp;
+            GList   *path = NULL;
 
             while (info->cp - base < prop_size)
               {
@@ -1199,7 +1379,7 @@ xcf_load_channel_props (XcfInfo      *info,
 
         case PROP_PARASITES:
           {
-            glong base = info->cp;
+            goffset base = info->cp;
 
             while ((info->cp - base) < prop_size)
               {
@@ -1258,8 +1438,8 @@ xcf_load_layer (XcfInfo    *info,
 {
   GimpLayer         *layer;
   GimpLayerMask     *layer_mask;
-  guint32            hierarchy_offset;
-  guint32            layer_mask_offset;
+  goffset            hierarchy_offset;
+  goffset            layer_mask_offset;
   gboolean           apply_mask = TRUE;
   gboolean           edit_mask  = FALSE;
   gboolean           show_mask  = FALSE;
@@ -1361,8 +1541,8 @@ xcf_load_layer (XcfInfo    *info,
     }
 
   /* read the hierarchy and layer mask offsets */
-  info->cp += xcf_read_int32 (info->input, &hierarchy_offset, 1);
-  info->cp += xcf_read_int32 (info->input, &layer_mask_offset, 1);
+  info->cp += xcf_read_offset (info, &hierarchy_offset, 1);
+  info->cp += xcf_read_offset (info, &layer_mask_offset, 1);
 
   /* read in the hierarchy (ignore it for group layers, both as an
    * optimization and because the hierarchy's extents don't match
@@ -1429,7 +1609,7 @@ xcf_load_channel (XcfInfo   *info,
                   GimpImage *image)
 {
   GimpChannel *channel;
-  guint32      hierarchy_offset;
+  goffset      hierarchy_offset;
   gint         width;
   gint         height;
   gboolean     is_fs_drawable;
@@ -1459,7 +1639,7 @@ xcf_load_channel (XcfInfo   *info,
   xcf_progress_update (info);
 
   /* read the hierarchy and layer mask offsets */
-  info->cp += xcf_read_int32 (info->input, &hierarchy_offset, 1);
+  info->cp += xcf_read_offset (info, &hierarchy_offset, 1);
 
   /* read in the hierarchy */
   if (!xcf_seek_pos (info, hierarchy_offset, NULL))
@@ -1487,7 +1667,7 @@ xcf_load_layer_mask (XcfInfo   *info,
 {
   GimpLayerMask *layer_mask;
   GimpChannel   *channel;
-  guint32        hierarchy_offset;
+  goffset        hierarchy_offset;
   gint           width;
   gint           height;
   gboolean       is_fs_drawable;
@@ -1518,7 +1698,7 @@ xcf_load_layer_mask (XcfInfo   *info,
   xcf_progress_update (info);
 
   /* read the hierarchy and layer mask offsets */
-  info->cp += xcf_read_int32 (info->input, &hierarchy_offset, 1);
+  info->cp += xcf_read_offset (info, &hierarchy_offset, 1);
 
   /* read in the hierarchy */
   if (! xcf_seek_pos (info, hierarchy_offset, NULL))
@@ -1546,9 +1726,9 @@ xcf_load_buffer (XcfInfo    *info,
                  GeglBuffer *buffer)
 {
   const Babl *format;
-  guint32     saved_pos;
-  guint32     offset;
-  guint32     junk;
+  goffset     saved_pos;
+  goffset     offset;
+  goffset     junk;
   gint        width;
   gint        height;
   gint        bpp;
@@ -1572,13 +1752,13 @@ xcf_load_buffer (XcfInfo    *info,
    *  as the number of levels found in the file.
    */
 
-  info->cp += xcf_read_int32 (info->input, &offset, 1); /* top level */
+  info->cp += xcf_read_offset (info, &offset, 1); /* top level */
 
   /* discard offsets for layers below first, if any.
    */
   do
     {
-      info->cp += xcf_read_int32 (info->input, &junk, 1);
+      info->cp += xcf_read_offset (info, &junk, 1);
     }
   while (junk != 0);
 
@@ -1611,8 +1791,8 @@ xcf_load_level (XcfInfo    *info,
 {
   const Babl *format;
   gint        bpp;
-  guint32     saved_pos;
-  guint32     offset, offset2;
+  goffset     saved_pos;
+  goffset     offset, offset2;
   gint        n_tile_rows;
   gint        n_tile_cols;
   guint       ntiles;
@@ -1635,7 +1815,7 @@ xcf_load_level (XcfInfo    *info,
    *  if it is '0', then this tile level is empty
    *  and we can simply return.
    */
-  info->cp += xcf_read_int32 (info->input, &offset, 1);
+  info->cp += xcf_read_offset (info, &offset, 1);
   if (offset == 0)
     return TRUE;
 
@@ -1643,6 +1823,13 @@ xcf_load_level (XcfInfo    *info,
   n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
 
   ntiles = n_tile_rows * n_tile_cols;
+
+  /* if the file is mapped, only read the tile offsets here and let
+   * the buffer decode the tiles when they are first accessed
+   */
+  if (info->mapped_file && info->compression != COMPRESS_FRACTAL)
+    return xcf_load_level_mapped (info, buffer, offset, ntiles);
+
   for (i = 0; i < ntiles; i++)
     {
       GeglRectangle rect;
@@ -1664,14 +1851,16 @@ xcf_load_level (XcfInfo    *info,
 
       /* read in the offset of the next tile so we can calculate the amount
          of data needed for this tile*/
-      info->cp += xcf_read_int32 (info->input, &offset2, 1);
+      info->cp += xcf_read_offset (info, &offset2, 1);
 
       /* if the offset is 0 then we need to read in the maximum possible
          allowing for negative compression */
       if (offset2 == 0)
         offset2 = offset + XCF_TILE_WIDTH * XCF_TILE_WIDTH * bpp * 1.5;
                                         /* 1.5 is probably more
-                                           than we need to allow */
+                                           than we need to allow, it
+                                           also covers zlib's worst
+                                           case (compressBound()) */
 
       /* seek to the tile offset */
       if (! xcf_seek_pos (info, offset, NULL))
@@ -1691,12 +1880,13 @@ xcf_load_level (XcfInfo    *info,
           break;
         case COMPRESS_RLE:
           if (!xcf_load_tile_rle (info, buffer, &rect, format,
-                                  offset2 - offset))
+                                  (gint) (offset2 - offset)))
             fail = TRUE;
           break;
         case COMPRESS_ZLIB:
-          g_error ("xcf: zlib compression unimplemented");
-          fail = TRUE;
+          if (!xcf_load_tile_zlib (info, buffer, &rect, format,
+                                   (gint) (offset2 - offset)))
+            fail = TRUE;
           break;
         case COMPRESS_FRACTAL:
           g_error ("xcf: fractal compression unimplemented");
@@ -1714,19 +1904,99 @@ xcf_load_level (XcfInfo    *info,
         return FALSE;
 
       /* read in the offset of the next tile */
-      info->cp += xcf_read_int32 (info->input, &offset, 1);
+      info->cp += xcf_read_offset (info, &offset, 1);
     }
 
   if (offset != 0)
     {
       gimp_message (info->gimp, G_OBJECT (info->progress), GIMP_MESSAGE_ERROR,
-                    "encountered garbage after reading level: %d", offset);
+                    "encountered garbage after reading level: %" G_GINT64_FORMAT,
+                    (gint64) offset);
       return FALSE;
     }
 
   return TRUE;
 }
 
+static gboolean
+xcf_load_level_mapped (XcfInfo    *info,
+                       GeglBuffer *buffer,
+                       goffset     offset,
+                       gint        ntiles)
+{
+  GeglTileHandler *handler;
+  goffset         *offsets;
+  goffset          file_length;
+  gint             bpp;
+  gint             i;
+
+  file_length = g_mapped_file_get_length (info->mapped_file);
+  bpp         = babl_format_get_bytes_per_pixel (gegl_buffer_get_format (buffer));
+
+  offsets = g_new (goffset, ntiles + 1);
+
+  offsets[0] = offset;
+  info->cp += xcf_read_offset (info, offsets + 1, ntiles);
+
+  for (i = 0; i < ntiles; i++)
+    {
+      if (offsets[i] == 0)
+        {
+          gimp_message_literal (info->gimp, G_OBJECT (info->progress),
+                                GIMP_MESSAGE_ERROR,
+                                "not enough tiles found in level");
+          g_free (offsets);
+          return FALSE;
+        }
+
+      /*  the tiles are decoded straight from the mapping later, so
+       *  make sure none of them reaches outside of it
+       */
+      if (offsets[i] > 0)
+        {
+          GeglRectangle rect;
+          goffset       data_length;
+
+          gimp_gegl_buffer_get_tile_rect (buffer,
+                                          XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                          i, &rect);
+
+          if (info->compression == COMPRESS_NONE)
+            data_length = bpp * rect.width * rect.height;
+          else if (offsets[i + 1] > offsets[i])
+            data_length = offsets[i + 1] - offsets[i];
+          else
+            data_length = 1;
+
+          if (offsets[i] <= file_length - data_length)
+            continue;
+        }
+
+      gimp_message (info->gimp, G_OBJECT (info->progress), GIMP_MESSAGE_ERROR,
+                    "invalid tile offset in level: %" G_GINT64_FORMAT,
+                    (gint64) offsets[i]);
+      g_free (offsets);
+      return FALSE;
+    }
+
+  if (offsets[ntiles] != 0)
+    {
+      gimp_message (info->gimp, G_OBJECT (info->progress), GIMP_MESSAGE_ERROR,
+                    "encountered garbage after reading level: %" G_GINT64_FORMAT,
+                    (gint64) offsets[ntiles]);
+      g_free (offsets);
+      return FALSE;
+    }
+
+  handler = xcf_tile_handler_new (info, offsets, ntiles);
+  xcf_tile_handler_assign (XCF_TILE_HANDLER (handler), buffer);
+  g_object_unref (handler);
+
+  g_free (offsets);
+
+  return TRUE;
+}
+
 static gboolean
 xcf_load_tile (XcfInfo       *info,
                GeglBuffer    *buffer,
@@ -1755,11 +2025,8 @@ xcf_load_tile_rle (XcfInfo       *info,
   gint    bpp       = babl_format_get_bytes_per_pixel (format);
   gint    tile_size = bpp * tile_rect->width * tile_rect->height;
   guchar *tile_data = g_alloca (tile_size);
-  gint    i;
   gsize   nmemb_read_successfully;
   guchar *xcfdata;
-  guchar *xcfodata;
-  guchar *xcfdatalimit;
 
   /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
    * this tile (return TRUE without storing data) as if it did not
@@ -1770,7 +2037,7 @@ xcf_load_tile_rle (XcfInfo       *info,
   if (data_length <= 0)
     return TRUE;
 
-  xcfdata = xcfodata = g_alloca (data_length);
+  xcfdata = g_alloca (data_length);
 
   /* we have to read directly instead of xcf_read_* because we may be
    * reading past the end of the file here
@@ -1783,105 +2050,61 @@ xcf_load_tile_rle (XcfInfo       *info,
 
   info->cp += nmemb_read_successfully;
 
-  xcfdatalimit = &xcfodata[nmemb_read_successfully - 1];
-
-  for (i = 0; i < bpp; i++)
-    {
-      guchar *data  = tile_data + i;
-      gint    size  = tile_rect->width * tile_rect->height;
-      gint    count = 0;
-      guchar  val;
-      gint    length;
-      gint    j;
-
-      while (size > 0)
-        {
-          if (xcfdata > xcfdatalimit)
-            {
-              goto bogus_rle;
-            }
-
-          val = *xcfdata++;
-
-          length = val;
-          if (length >= 128)
-            {
-              length = 255 - (length - 1);
-              if (length == 128)
-                {
-                  if (xcfdata >= xcfdatalimit)
-                    {
-                      goto bogus_rle;
-                    }
-
-                  length = (*xcfdata << 8) + xcfdata[1];
-                  xcfdata += 2;
-                }
-
-              count += length;
-              size -= length;
+  if (! xcf_load_decode_tile_rle (xcfdata, nmemb_read_successfully,
+                                  tile_data, bpp,
+                                  tile_rect->width * tile_rect->height))
+    return FALSE;
 
-              if (size < 0)
-                {
-                  goto bogus_rle;
-                }
+  gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
+                   GEGL_AUTO_ROWSTRIDE);
 
-              if (&xcfdata[length-1] > xcfdatalimit)
-                {
-                  goto bogus_rle;
-                }
+  return TRUE;
+}
 
-              while (length-- > 0)
-                {
-                  *data = *xcfdata++;
-                  data += bpp;
-                }
-            }
-          else
-            {
-              length += 1;
-              if (length == 128)
-                {
-                  if (xcfdata >= xcfdatalimit)
-                    {
-                      goto bogus_rle;
-                    }
+static gboolean
+xcf_load_tile_zlib (XcfInfo       *info,
+                    GeglBuffer    *buffer,
+                    GeglRectangle *tile_rect,
+                    const Babl    *format,
+                    gint           data_length)
+{
+  gint    bpp       = babl_format_get_bytes_per_pixel (format);
+  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
+  guchar *tile_data = g_alloca (tile_size);
+  gsize   nmemb_read_successfully;
+  guchar *xcfdata;
 
-                  length = (*xcfdata << 8) + xcfdata[1];
-                  xcfdata += 2;
-                }
+  /* Workaround for bug #357809, see xcf_load_tile_rle()
+   */
+  if (data_length <= 0)
+    return TRUE;
 
-              count += length;
-              size -= length;
+  xcfdata = g_alloca (data_length);
 
-              if (size < 0)
-                {
-                  goto bogus_rle;
-                }
+  /* we have to read directly instead of xcf_read_* because we may be
+   * reading past the end of the file here
+   */
+  g_input_stream_read_all (info->input, xcfdata, data_length,
+                           &nmemb_read_successfully, NULL, NULL);
 
-              if (xcfdata > xcfdatalimit)
-                {
-                  goto bogus_rle;
-                }
+  if (nmemb_read_successfully == 0)
+    return TRUE;
 
-              val = *xcfdata++;
+  info->cp += nmemb_read_successfully;
 
-              for (j = 0; j < length; j++)
-                {
-                  *data = val;
-                  data += bpp;
-                }
-            }
-        }
+  if (! xcf_load_decode_tile_zlib (xcfdata, nmemb_read_successfully,
+                                   tile_data, tile_size))
+    {
+      gimp_message_literal (info->gimp, G_OBJECT (info->progress),
+                            GIMP_MESSAGE_ERROR,
+                            "xcf: tile decompression failed");
+      return FALSE;
     }
 
   gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
                    GEGL_AUTO_ROWSTRIDE);
 
   return TRUE;
-
- bogus_rle:
-  return FALSE;
 }
 
 static GimpParasite *
@@ -2252,3 +2475,32 @@ xcf_skip_unknown_prop (XcfInfo *info,
 
   return TRUE;
 }
+
+static guint
+xcf_read_offset (XcfInfo *info,
+                 goffset *data,
+                 gint     count)
+{
+  guint total = 0;
+  gint  i;
+
+  for (i = 0; i < count; i++)
+    {
+      guint32 words[2];
+
+      if (info->bytes_per_offset == 8)
+        {
+          total += xcf_read_int32 (info->input, words, 2);
+
+          data[i] = ((guint64) words[0] << 32) | words[1];
+        }
+      else
+        {
+          total += xcf_read_int32 (info->input, words, 1);
+
+          data[i] = words[0];
+        }
+    }
+
+  return total;
+}
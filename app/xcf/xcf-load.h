@@ -19,9 +19,19 @@
 #define __XCF_LOAD_H__
 
 
-GimpImage * xcf_load_image (Gimp     *gimp,
-                            XcfInfo  *info,
-                            GError  **error);
+GimpImage * xcf_load_image            (Gimp          *gimp,
+                                       XcfInfo       *info,
+                                       GError       **error);
+
+gboolean    xcf_load_decode_tile_rle  (const guchar  *xcfdata,
+                                       gsize          data_length,
+                                       guchar        *tile_data,
+                                       gint           bpp,
+                                       gint           n_pixels);
+gboolean    xcf_load_decode_tile_zlib (const guchar  *xcfdata,
+                                       gsize          data_length,
+                                       guchar        *tile_data,
+                                       gint           tile_size);
 
 
 #endif  /* __XCF_LOAD_H__ */
@@ -19,6 +19,8 @@
 
 #include <string.h>
 
+#include <zlib.h>
+
 #include <cairo.h>
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -32,6 +34,7 @@
 #include "gegl/gimp-gegl-tile-compat.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
 #include "core/gimpcontainer.h"
 #include "core/gimpchannel.h"
 #include "core/gimpdrawable.h"
@@ -68,6 +71,24 @@
 #include "gimp-intl.h"
 
 
+/*  the number of tiles encoded in parallel before being written  */
+#define XCF_SAVE_TILE_BATCH_SIZE 128
+
+
+typedef struct
+{
+  GeglBuffer         *buffer;
+  const Babl         *format;
+  XcfCompressionType  compression;
+  gint                first_tile;
+  gint                n_tiles;
+  guchar             *data;      /* n_tiles slots of slot_size bytes */
+  gsize               slot_size;
+  gsize              *sizes;     /* encoded size of each tile, 0 on error */
+} XcfSaveTilesData;
+
+
+static guint64  xcf_save_estimate_size (GimpImage         *image);
 static gboolean xcf_save_image_props   (XcfInfo           *info,
                                         GimpImage         *image,
                                         GError           **error);
@@ -98,16 +119,20 @@ static gboolean xcf_save_buffer        (XcfInfo           *info,
 static gboolean xcf_save_level         (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GError           **error);
-static gboolean xcf_save_tile          (XcfInfo           *info,
-                                        GeglBuffer        *buffer,
-                                        GeglRectangle     *tile_rect,
-                                        const Babl        *format,
-                                        GError           **error);
-static gboolean xcf_save_tile_rle      (XcfInfo           *info,
-                                        GeglBuffer        *buffer,
-                                        GeglRectangle     *tile_rect,
-                                        const Babl        *format,
-                                        guchar            *rlebuf,
+static void     xcf_save_encode_tiles  (gsize              offset,
+                                        gsize              size,
+                                        XcfSaveTilesData  *data);
+static gsize    xcf_save_tile_rle      (const guchar      *tile_data,
+                                        gint               bpp,
+                                        gint               n_pixels,
+                                        guchar            *rlebuf);
+static gsize    xcf_save_tile_zlib     (const guchar      *tile_data,
+                                        gint               tile_size,
+                                        guchar            *zlib_data,
+                                        gsize              zlib_size);
+static guint    xcf_write_offset       (XcfInfo           *info,
+                                        const goffset     *data,
+                                        gint               count,
                                         GError           **error);
 static gboolean xcf_save_parasite      (XcfInfo           *info,
                                         GimpParasite      *parasite,
@@ -160,6 +185,20 @@ static gboolean xcf_save_vectors       (XcfInfo           *info,
     }                                                                   \
   } G_STMT_END
 
+#define xcf_write_offset_check_error(info, data, count) G_STMT_START {  \
+  info->cp += xcf_write_offset (info, data, count, &tmp_error);        \
+  if (tmp_error)                                                       \
+    {                                                                  \
+      g_propagate_error (error, tmp_error);                            \
+      return FALSE;                                                    \
+    }                                                                  \
+  } G_STMT_END
+
+#define xcf_write_zero_offset_check_error(info) G_STMT_START { \
+  goffset _zero_offset = 0;                                   \
+  xcf_write_offset_check_error (info, &_zero_offset, 1);      \
+  } G_STMT_END
+
 #define xcf_write_prop_type_check_error(info, prop_type) G_STMT_START { \
   guint32 _prop_int32 = prop_type;                     \
   xcf_write_int32_check_error (info, &_prop_int32, 1); \
@@ -223,7 +262,24 @@ xcf_save_choose_format (XcfInfo   *info,
   if (gimp_image_get_metadata (image))
     save_version = MAX (6, save_version);
 
-  info->file_version = save_version;
+  /* high bit depth images can't be opened by GIMP 2.8 anyway, so
+   * use zlib compressed tiles for them, RLE does a poor job on
+   * anything but 8 bit data. Need version 7 for zlib compression.
+   */
+  if (gimp_image_get_precision (image) != GIMP_PRECISION_U8_GAMMA)
+    info->compression = COMPRESS_ZLIB;
+
+  if (info->compression == COMPRESS_ZLIB)
+    save_version = MAX (7, save_version);
+
+  /* need version 8 for 64 bit offsets, which we only use if the
+   * file could possibly grow beyond 4 GB
+   */
+  if (xcf_save_estimate_size (image) >= G_MAXUINT32)
+    save_version = MAX (8, save_version);
+
+  info->file_version     = save_version;
+  info->bytes_per_offset = save_version >= 8 ? 8 : 4;
 }
 
 gint
@@ -234,8 +290,8 @@ xcf_save_image (XcfInfo    *info,
   GList   *all_layers;
   GList   *all_channels;
   GList   *list;
-  guint32  saved_pos;
-  guint32  offset;
+  goffset  saved_pos;
+  goffset  offset;
   guint32  value;
   guint    n_layers;
   guint    n_channels;
@@ -303,7 +359,8 @@ xcf_save_image (XcfInfo    *info,
 
   /* seek to after the offset lists */
   xcf_check_error (xcf_seek_pos (info,
-                                 info->cp + (n_layers + n_channels + 2) * 4,
+                                 info->cp + (n_layers + n_channels + 2) *
+                                 info->bytes_per_offset,
                                  error));
 
   for (list = all_layers; list; list = g_list_next (list))
@@ -324,7 +381,7 @@ xcf_save_image (XcfInfo    *info,
        *  layer offset and write it out.
        */
       xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-      xcf_write_int32_check_error (info, &offset, 1);
+      xcf_write_offset_check_error (info, &offset, 1);
 
       /* increment the location we are to write out the
        *  next offset.
@@ -340,9 +397,8 @@ xcf_save_image (XcfInfo    *info,
   /* write out a '0' offset position to indicate the end
    *  of the layer offsets.
    */
-  offset = 0;
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_zero_offset_check_error (info);
   saved_pos = info->cp;
   xcf_check_error (xcf_seek_end (info, error));
 
@@ -364,7 +420,7 @@ xcf_save_image (XcfInfo    *info,
        *  channel offset and write it out.
        */
       xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-      xcf_write_int32_check_error (info, &offset, 1);
+      xcf_write_offset_check_error (info, &offset, 1);
 
       /* increment the location we are to write out the
        *  next offset.
@@ -383,14 +439,56 @@ xcf_save_image (XcfInfo    *info,
   /* write out a '0' offset position to indicate the end
    *  of the channel offsets.
    */
-  offset = 0;
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_zero_offset_check_error (info);
   saved_pos = info->cp;
 
   return ! g_output_stream_is_closed (info->output);
 }
 
+/*  a pessimistic estimate of the file size: the size of all pixel
+ *  data, uncompressed, plus the worst case growth of RLE
+ */
+static guint64
+xcf_save_estimate_size (GimpImage *image)
+{
+  GList   *drawables;
+  GList   *list;
+  guint64  size = 0;
+
+  drawables = g_list_concat (gimp_image_get_layer_list (image),
+                             gimp_image_get_channel_list (image));
+
+  drawables = g_list_prepend (drawables, gimp_image_get_mask (image));
+
+  for (list = drawables; list; list = g_list_next (list))
+    {
+      GimpDrawable *drawable = list->data;
+      guint64       n_bytes;
+
+      n_bytes = ((guint64) gimp_item_get_width  (GIMP_ITEM (drawable)) *
+                 (guint64) gimp_item_get_height (GIMP_ITEM (drawable)) *
+                 babl_format_get_bytes_per_pixel (gimp_drawable_get_format (drawable)));
+
+      size += n_bytes * 3 / 2;
+
+      if (GIMP_IS_LAYER (drawable) && gimp_layer_get_mask (GIMP_LAYER (drawable)))
+        {
+          GimpDrawable *mask = GIMP_DRAWABLE (gimp_layer_get_mask (GIMP_LAYER (drawable)));
+
+          n_bytes = ((guint64) gimp_item_get_width  (GIMP_ITEM (mask)) *
+                     (guint64) gimp_item_get_height (GIMP_ITEM (mask)) *
+                     babl_format_get_bytes_per_pixel (gimp_drawable_get_format (mask)));
+
+          size += n_bytes * 3 / 2;
+        }
+    }
+
+  g_list_free (drawables);
+
+  return size;
+}
+
 static gboolean
 xcf_save_image_props (XcfInfo    *info,
                       GimpImage  *image,
@@ -704,15 +802,12 @@ xcf_save_prop (XcfInfo    *info,
 
     case PROP_FLOATING_SELECTION:
       {
-        guint32 dummy;
-
-        dummy = 0;
-        size = 4;
+        size = info->bytes_per_offset;
 
         xcf_write_prop_type_check_error (info, prop_type);
         xcf_write_int32_check_error (info, &size, 1);
         info->floating_sel_offset = info->cp;
-        xcf_write_int32_check_error (info, &dummy, 1);
+        xcf_write_zero_offset_check_error (info);
       }
       break;
 
@@ -1011,8 +1106,9 @@ xcf_save_prop (XcfInfo    *info,
 
         if (gimp_parasite_list_persistent_length (list) > 0)
           {
-            guint32 base, length = 0;
-            long    pos;
+            guint32 length = 0;
+            goffset base;
+            goffset pos;
 
             xcf_write_prop_type_check_error (info, prop_type);
 
@@ -1056,8 +1152,9 @@ xcf_save_prop (XcfInfo    *info,
 
     case PROP_PATHS:
       {
-        guint32 base, length = 0;
-        glong   pos;
+        guint32 length = 0;
+        goffset base;
+        goffset pos;
 
         xcf_write_prop_type_check_error (info, prop_type);
 
@@ -1122,8 +1219,9 @@ xcf_save_prop (XcfInfo    *info,
 
     case PROP_VECTORS:
       {
-        guint32 base, length = 0;
-        glong   pos;
+        guint32 length = 0;
+        goffset base;
+        goffset pos;
 
         xcf_write_prop_type_check_error (info, prop_type);
 
@@ -1211,8 +1309,8 @@ xcf_save_layer (XcfInfo    *info,
                 GimpLayer  *layer,
                 GError    **error)
 {
-  guint32      saved_pos;
-  guint32      offset;
+  goffset      saved_pos;
+  goffset      offset;
   guint32      value;
   const gchar *string;
   GError      *tmp_error = NULL;
@@ -1224,7 +1322,7 @@ xcf_save_layer (XcfInfo    *info,
     {
       saved_pos = info->cp;
       xcf_check_error (xcf_seek_pos (info, info->floating_sel_offset, error));
-      xcf_write_int32_check_error (info, &saved_pos, 1);
+      xcf_write_offset_check_error (info, &saved_pos, 1);
       xcf_check_error (xcf_seek_pos (info, saved_pos, error));
     }
 
@@ -1251,7 +1349,9 @@ xcf_save_layer (XcfInfo    *info,
   saved_pos = info->cp;
 
   /*  write out the layer tile hierarchy  */
-  xcf_check_error (xcf_seek_pos (info, info->cp + 8, error));
+  xcf_check_error (xcf_seek_pos (info,
+                                 info->cp + 2 * info->bytes_per_offset,
+                                 error));
   offset = info->cp;
 
   xcf_check_error (xcf_save_buffer (info,
@@ -1259,7 +1359,7 @@ xcf_save_layer (XcfInfo    *info,
                                     error));
 
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_offset_check_error (info, &offset, 1);
 
   /*  save the current position which is where the layer mask offset
    *  will be stored.
@@ -1281,7 +1381,7 @@ xcf_save_layer (XcfInfo    *info,
     offset = 0;
 
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_offset_check_error (info, &offset, 1);
 
   return TRUE;
 }
@@ -1292,8 +1392,8 @@ xcf_save_channel (XcfInfo      *info,
                   GimpChannel  *channel,
                   GError      **error)
 {
-  guint32      saved_pos;
-  guint32      offset;
+  goffset      saved_pos;
+  goffset      offset;
   guint32      value;
   const gchar *string;
   GError      *tmp_error = NULL;
@@ -1305,7 +1405,7 @@ xcf_save_channel (XcfInfo      *info,
     {
       saved_pos = info->cp;
       xcf_check_error (xcf_seek_pos (info, info->floating_sel_offset, error));
-      xcf_write_int32_check_error (info, &saved_pos, 1);
+      xcf_write_offset_check_error (info, &saved_pos, 1);
       xcf_check_error (xcf_seek_pos (info, saved_pos, error));
     }
 
@@ -1329,7 +1429,8 @@ xcf_save_channel (XcfInfo      *info,
   saved_pos = info->cp;
 
   /* write out the channel tile hierarchy */
-  xcf_check_error (xcf_seek_pos (info, info->cp + 4, error));
+  xcf_check_error (xcf_seek_pos (info, info->cp + info->bytes_per_offset,
+                                 error));
   offset = info->cp;
 
   xcf_check_error (xcf_save_buffer (info,
@@ -1337,7 +1438,7 @@ xcf_save_channel (XcfInfo      *info,
                                     error));
 
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_offset_check_error (info, &offset, 1);
   saved_pos = info->cp;
 
   return TRUE;
@@ -1366,8 +1467,8 @@ xcf_save_buffer (XcfInfo     *info,
                  GError     **error)
 {
   const Babl *format;
-  guint32     saved_pos;
-  guint32     offset;
+  goffset     saved_pos;
+  goffset     offset;
   guint32     width;
   guint32     height;
   guint32     bpp;
@@ -1392,7 +1493,10 @@ xcf_save_buffer (XcfInfo     *info,
   tmp2 = xcf_calc_levels (height, XCF_TILE_HEIGHT);
   nlevels = MAX (tmp1, tmp2);
 
-  xcf_check_error (xcf_seek_pos (info, info->cp + (1 + nlevels) * 4, error));
+  xcf_check_error (xcf_seek_pos (info,
+                                 info->cp + (1 + nlevels) *
+                                 info->bytes_per_offset,
+                                 error));
 
   for (i = 0; i < nlevels; i++)
     {
@@ -1406,19 +1510,18 @@ xcf_save_buffer (XcfInfo     *info,
       else
         {
           /* fake an empty level */
-          tmp1 = 0;
           width  /= 2;
           height /= 2;
           xcf_write_int32_check_error (info, (guint32 *) &width,  1);
           xcf_write_int32_check_error (info, (guint32 *) &height, 1);
-          xcf_write_int32_check_error (info, (guint32 *) &tmp1,   1);
+          xcf_write_zero_offset_check_error (info);
         }
 
       /* seek back to where we are to write out the next
        *  level offset and write it out.
        */
       xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-      xcf_write_int32_check_error (info, &offset, 1);
+      xcf_write_offset_check_error (info, &offset, 1);
 
       /* increment the location we are to write out the
        *  next offset.
@@ -1434,9 +1537,8 @@ xcf_save_buffer (XcfInfo     *info,
   /* write out a '0' offset position to indicate the end
    *  of the level offsets.
    */
-  offset = 0;
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_zero_offset_check_error (info);
 
   return TRUE;
 }
@@ -1446,18 +1548,19 @@ xcf_save_level (XcfInfo     *info,
                 GeglBuffer  *buffer,
                 GError     **error)
 {
-  const Babl *format;
-  guint32     saved_pos;
-  guint32     offset;
-  guint32     width;
-  guint32     height;
-  gint        bpp;
-  gint        n_tile_rows;
-  gint        n_tile_cols;
-  guint       ntiles;
-  gint        i;
-  guchar     *rlebuf;
-  GError     *tmp_error = NULL;
+  XcfSaveTilesData  data;
+  const Babl       *format;
+  goffset           saved_pos;
+  goffset          *offsets;
+  guint32           width;
+  guint32           height;
+  gint              bpp;
+  gint              n_tile_rows;
+  gint              n_tile_cols;
+  guint             ntiles;
+  gint              i;
+  gboolean          success   = TRUE;
+  GError           *tmp_error = NULL;
 
   format = gegl_buffer_get_format (buffer);
 
@@ -1470,114 +1573,162 @@ xcf_save_level (XcfInfo     *info,
 
   saved_pos = info->cp;
 
-  /* allocate a temporary buffer to store the rle data before it is
-   * written to disk
-   */
-  rlebuf = g_alloca (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp * 1.5);
-
   n_tile_rows = gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT);
   n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
 
   ntiles = n_tile_rows * n_tile_cols;
-  xcf_check_error (xcf_seek_pos (info, info->cp + (ntiles + 1) * 4, error));
+  xcf_check_error (xcf_seek_pos (info,
+                                 info->cp + (ntiles + 1) *
+                                 info->bytes_per_offset,
+                                 error));
 
-  for (i = 0; i < ntiles; i++)
-    {
-      GeglRectangle rect;
+  /*  the tiles are fetched and encoded in batches, in parallel, into
+   *  memory, and then appended to the file in order.  the tile
+   *  offsets are collected on the way and written in one go at the
+   *  end, instead of seeking back and forth for each tile.
+   */
+  data.buffer      = buffer;
+  data.format      = format;
+  data.compression = info->compression;
+  data.n_tiles     = MIN (ntiles, XCF_SAVE_TILE_BATCH_SIZE);
 
-      /* save the start offset of where we are writing
-       *  out the next tile.
-       */
-      offset = info->cp;
+  /*  allow for negative compression, 1.5 is what the loader expects
+   *  at most, and covers zlib's worst case too
+   */
+  data.slot_size   = MAX (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp * 3 / 2,
+                          compressBound (XCF_TILE_WIDTH * XCF_TILE_HEIGHT *
+                                         bpp));
+  data.data        = g_malloc (data.n_tiles * data.slot_size);
+  data.sizes       = g_new (gsize, data.n_tiles);
 
-      gimp_gegl_buffer_get_tile_rect (buffer,
-                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
-                                      i, &rect);
+  offsets = g_new (goffset, ntiles + 1);
+
+  for (data.first_tile = 0;
+       success && data.first_tile < ntiles;
+       data.first_tile += data.n_tiles)
+    {
+      data.n_tiles = MIN (ntiles - data.first_tile,
+                          XCF_SAVE_TILE_BATCH_SIZE);
 
-      /* write out the tile. */
-      switch (info->compression)
+      gimp_parallel_distribute_range (data.n_tiles, 1,
+                                      (GimpParallelDistributeRangeFunc)
+                                      xcf_save_encode_tiles,
+                                      &data);
+
+      for (i = 0; i < data.n_tiles; i++)
         {
-        case COMPRESS_NONE:
-          xcf_check_error (xcf_save_tile (info, buffer, &rect, format,
-                                          error));
-          break;
-        case COMPRESS_RLE:
-          xcf_check_error (xcf_save_tile_rle (info, buffer, &rect, format,
-                                              rlebuf, error));
-          break;
-        case COMPRESS_ZLIB:
-          g_error ("xcf: zlib compression unimplemented");
-          break;
-        case COMPRESS_FRACTAL:
-          g_error ("xcf: fractal compression unimplemented");
-          break;
+          if (data.sizes[i] == 0)
+            {
+              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("Could not compress XCF tile %d"),
+                           data.first_tile + i);
+              success = FALSE;
+              break;
+            }
+
+          /* save the start offset of where we are writing
+           *  out the tile.
+           */
+          offsets[data.first_tile + i] = info->cp;
+
+          info->cp += xcf_write_int8 (info->output,
+                                      data.data + i * data.slot_size,
+                                      data.sizes[i], &tmp_error);
+
+          if (tmp_error)
+            {
+              g_propagate_error (error, tmp_error);
+              success = FALSE;
+              break;
+            }
         }
+    }
 
-      /* seek back to where we are to write out the next
-       *  tile offset and write it out.
-       */
-      xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-      xcf_write_int32_check_error (info, &offset, 1);
+  g_free (data.sizes);
+  g_free (data.data);
 
-      /* increment the location we are to write out the
-       *  next offset.
+  if (success)
+    {
+      /* write out the tile offsets, followed by a '0' offset position
+       *  to indicate the end of the level offsets.
        */
-      saved_pos = info->cp;
+      offsets[ntiles] = 0;
 
-      /* seek to the end of the file which is where
-       *  we will write out the next tile.
-       */
-      xcf_check_error (xcf_seek_end (info, error));
-    }
+      success = xcf_seek_pos (info, saved_pos, error);
 
-  /* write out a '0' offset position to indicate the end
-   *  of the level offsets.
-   */
-  offset = 0;
-  xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+      if (success)
+        {
+          info->cp += xcf_write_offset (info, offsets, ntiles + 1,
+                                        &tmp_error);
 
-  return TRUE;
+          if (tmp_error)
+            {
+              g_propagate_error (error, tmp_error);
+              success = FALSE;
+            }
+        }
+    }
+
+  g_free (offsets);
 
+  return success;
 }
 
-static gboolean
-xcf_save_tile (XcfInfo        *info,
-               GeglBuffer     *buffer,
-               GeglRectangle  *tile_rect,
-               const Babl     *format,
-               GError        **error)
+static void
+xcf_save_encode_tiles (gsize             offset,
+                       gsize             size,
+                       XcfSaveTilesData *data)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  GError *tmp_error = NULL;
+  gint    bpp       = babl_format_get_bytes_per_pixel (data->format);
+  guchar *tile_data = g_alloca (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp);
+  gsize   i;
 
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  for (i = offset; i < offset + size; i++)
+    {
+      GeglRectangle  rect;
+      guchar        *out = data->data + i * data->slot_size;
+      gint           n_pixels;
 
-  xcf_write_int8_check_error (info, tile_data, tile_size);
+      gimp_gegl_buffer_get_tile_rect (data->buffer,
+                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                      data->first_tile + i, &rect);
 
-  return TRUE;
+      n_pixels = rect.width * rect.height;
+
+      gegl_buffer_get (data->buffer, &rect, 1.0, data->format, tile_data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      switch (data->compression)
+        {
+        case COMPRESS_NONE:
+          memcpy (out, tile_data, n_pixels * bpp);
+          data->sizes[i] = n_pixels * bpp;
+          break;
+        case COMPRESS_RLE:
+          data->sizes[i] = xcf_save_tile_rle (tile_data, bpp, n_pixels, out);
+          break;
+        case COMPRESS_ZLIB:
+          data->sizes[i] = xcf_save_tile_zlib (tile_data, n_pixels * bpp,
+                                               out, data->slot_size);
+          break;
+        case COMPRESS_FRACTAL:
+          g_error ("xcf: fractal compression unimplemented");
+          break;
+        }
+    }
 }
 
-static gboolean
-xcf_save_tile_rle (XcfInfo        *info,
-                   GeglBuffer     *buffer,
-                   GeglRectangle  *tile_rect,
-                   const Babl     *format,
-                   guchar         *rlebuf,
-                   GError        **error)
+/*  the tile encoders below run on worker threads, they must not touch
+ *  the XcfInfo, and return 0 on failure.
+ */
+static gsize
+xcf_save_tile_rle (const guchar *tile_data,
+                   gint          bpp,
+                   gint          n_pixels,
+                   guchar       *rlebuf)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  gint    len       = 0;
-  gint    i, j;
-  GError *tmp_error  = NULL;
-
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gsize len = 0;
+  gint  i, j;
 
   for (i = 0; i < bpp; i++)
     {
@@ -1585,7 +1736,7 @@ xcf_save_tile_rle (XcfInfo        *info,
       gint          state  = 0;
       gint          length = 0;
       gint          count  = 0;
-      gint          size   = tile_rect->width * tile_rect->height;
+      gint          size   = n_pixels;
       guint         last   = -1;
 
       while (size > 0)
@@ -1671,13 +1822,81 @@ xcf_save_tile_rle (XcfInfo        *info,
             }
         }
 
-      if (count != (tile_rect->width * tile_rect->height))
-        g_message ("xcf: uh oh! xcf rle tile saving error: %d", count);
+      /* uh oh! xcf rle tile saving error */
+      if (count != n_pixels)
+        return 0;
     }
 
-  xcf_write_int8_check_error (info, rlebuf, len);
+  return len;
+}
 
-  return TRUE;
+static gsize
+xcf_save_tile_zlib (const guchar *tile_data,
+                    gint          tile_size,
+                    guchar       *zlib_data,
+                    gsize         zlib_size)
+{
+  z_stream strm = { 0, };
+  gint     status;
+
+  if (deflateInit (&strm, Z_DEFAULT_COMPRESSION) != Z_OK)
+    return 0;
+
+  strm.next_in   = (guchar *) tile_data;
+  strm.avail_in  = tile_size;
+  strm.next_out  = zlib_data;
+  strm.avail_out = zlib_size;
+
+  /*  zlib_data is at least compressBound() of a full tile, so the
+   *  whole tile always fits in one go
+   */
+  status = deflate (&strm, Z_FINISH);
+
+  deflateEnd (&strm);
+
+  if (status != Z_STREAM_END)
+    return 0;
+
+  return zlib_size - strm.avail_out;
+}
+
+static guint
+xcf_write_offset (XcfInfo        *info,
+                  const goffset  *data,
+                  gint            count,
+                  GError        **error)
+{
+  GError *tmp_error = NULL;
+  guint   total     = 0;
+  gint    i;
+
+  for (i = 0; i < count; i++)
+    {
+      guint32 words[2];
+
+      if (info->bytes_per_offset == 8)
+        {
+          /* big endian, like everything else in XCF */
+          words[0] = (guint64) data[i] >> 32;
+          words[1] = (guint64) data[i] & 0xffffffff;
+
+          total += xcf_write_int32 (info->output, words, 2, &tmp_error);
+        }
+      else
+        {
+          words[0] = data[i];
+
+          total += xcf_write_int32 (info->output, words, 1, &tmp_error);
+        }
+
+      if (tmp_error)
+        {
+          g_propagate_error (error, tmp_error);
+          break;
+        }
+    }
+
+  return total;
 }
 
 static gboolean
@@ -0,0 +1,604 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <cairo.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+
+#include "xcf-private.h"
+#include "xcf-load.h"
+#include "xcf-tile-handler.h"
+
+
+static void       xcf_tile_handler_finalize       (GObject         *object);
+
+static gpointer   xcf_tile_handler_command        (GeglTileSource  *source,
+                                                   GeglTileCommand  command,
+                                                   gint             x,
+                                                   gint             y,
+                                                   gint             z,
+                                                   gpointer         data);
+
+static GeglTile * xcf_tile_handler_validate       (XcfTileHandler  *handler,
+                                                   GeglTile        *tile,
+                                                   gint             x,
+                                                   gint             y);
+static void       xcf_tile_handler_validate_level (XcfTileHandler  *handler,
+                                                   gint             x,
+                                                   gint             y,
+                                                   gint             z);
+static void       xcf_tile_handler_discard        (XcfTileHandler  *handler,
+                                                   gint             x,
+                                                   gint             y);
+static void       xcf_tile_handler_get_xcf_rect   (XcfTileHandler  *handler,
+                                                   gint             index,
+                                                   GeglRectangle   *rect);
+static gboolean   xcf_tile_handler_decode         (XcfTileHandler  *handler,
+                                                   gint             index);
+static void       xcf_tile_handler_release        (XcfTileHandler  *handler);
+static gboolean   xcf_tile_handler_report_idle    (gpointer         data);
+
+
+G_DEFINE_TYPE (XcfTileHandler, xcf_tile_handler, GEGL_TYPE_TILE_HANDLER)
+
+#define parent_class xcf_tile_handler_parent_class
+
+
+/*  all handlers, to find the ones decoding from a file  */
+static GMutex  handlers_mutex;
+static GList  *handlers = NULL;
+
+
+static void
+xcf_tile_handler_class_init (XcfTileHandlerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xcf_tile_handler_finalize;
+}
+
+static void
+xcf_tile_handler_init (XcfTileHandler *handler)
+{
+  GeglTileSource *source = GEGL_TILE_SOURCE (handler);
+
+  source->command = xcf_tile_handler_command;
+
+  g_mutex_init (&handler->mutex);
+
+  handler->pending_region = cairo_region_create ();
+  handler->cached_tile    = -1;
+}
+
+static void
+xcf_tile_handler_finalize (GObject *object)
+{
+  XcfTileHandler *handler = XCF_TILE_HANDLER (object);
+
+  g_mutex_lock (&handlers_mutex);
+  handlers = g_list_remove (handlers, handler);
+  g_mutex_unlock (&handlers_mutex);
+
+  xcf_tile_handler_release (handler);
+
+  g_clear_pointer (&handler->filename, g_free);
+  g_clear_pointer (&handler->file_id,  g_free);
+
+  cairo_region_destroy (handler->pending_region);
+  handler->pending_region = NULL;
+
+  g_mutex_clear (&handler->mutex);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static gpointer
+xcf_tile_handler_command (GeglTileSource  *source,
+                          GeglTileCommand  command,
+                          gint             x,
+                          gint             y,
+                          gint             z,
+                          gpointer         data)
+{
+  XcfTileHandler *handler = XCF_TILE_HANDLER (source);
+  gpointer        retval;
+
+  switch (command)
+    {
+    case GEGL_TILE_GET:
+      /*  mipmap levels are built from the level-0 tiles below us,
+       *  so make sure those are decoded before passing the request on
+       */
+      if (z > 0)
+        xcf_tile_handler_validate_level (handler, x, y, z);
+      break;
+
+    case GEGL_TILE_SET:
+    case GEGL_TILE_VOID:
+      /*  the tile's contents are replaced, don't decode over them later  */
+      if (z == 0)
+        xcf_tile_handler_discard (handler, x, y);
+      break;
+
+    default:
+      break;
+    }
+
+  retval = gegl_tile_handler_source_command (source, command, x, y, z, data);
+
+  if (command == GEGL_TILE_GET && z == 0)
+    retval = xcf_tile_handler_validate (handler, retval, x, y);
+
+  return retval;
+}
+
+static GeglTile *
+xcf_tile_handler_validate (XcfTileHandler *handler,
+                           GeglTile       *tile,
+                           gint            x,
+                           gint            y)
+{
+  cairo_region_t        *tile_region;
+  cairo_rectangle_int_t  tile_rect;
+
+  g_mutex_lock (&handler->mutex);
+
+  if (cairo_region_is_empty (handler->pending_region))
+    {
+      g_mutex_unlock (&handler->mutex);
+
+      return tile;
+    }
+
+  tile_rect.x      = x * handler->tile_width;
+  tile_rect.y      = y * handler->tile_height;
+  tile_rect.width  = handler->tile_width;
+  tile_rect.height = handler->tile_height;
+
+  tile_region = cairo_region_copy (handler->pending_region);
+  cairo_region_intersect_rectangle (tile_region, &tile_rect);
+
+  if (! cairo_region_is_empty (tile_region))
+    {
+      gint    bpp         = babl_format_get_bytes_per_pixel (handler->format);
+      gint    tile_stride = bpp * handler->tile_width;
+      gint    n_tile_cols = (handler->width + XCF_TILE_WIDTH - 1) /
+                            XCF_TILE_WIDTH;
+      guchar *tile_data;
+      gint    n_rects;
+      gint    i;
+
+      if (! tile)
+        {
+          tile = gegl_tile_handler_create_tile (GEGL_TILE_HANDLER (handler),
+                                                x, y, 0);
+
+          memset (gegl_tile_get_data (tile), 0,
+                  tile_stride * handler->tile_height);
+        }
+
+      cairo_region_subtract_rectangle (handler->pending_region, &tile_rect);
+
+      gegl_tile_lock (tile);
+
+      tile_data = gegl_tile_get_data (tile);
+
+      n_rects = cairo_region_num_rectangles (tile_region);
+
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+          gint                  col1, col2;
+          gint                  row1, row2;
+          gint                  col, row;
+
+          cairo_region_get_rectangle (tile_region, i, &rect);
+
+          col1 = rect.x / XCF_TILE_WIDTH;
+          row1 = rect.y / XCF_TILE_HEIGHT;
+          col2 = (rect.x + rect.width  - 1) / XCF_TILE_WIDTH;
+          row2 = (rect.y + rect.height - 1) / XCF_TILE_HEIGHT;
+
+          for (row = row1; row <= row2; row++)
+            for (col = col1; col <= col2; col++)
+              {
+                gint                   index = row * n_tile_cols + col;
+                GeglRectangle          xcf_rect;
+                GeglRectangle          blit_rect;
+                gint                   xcf_stride;
+                const guchar          *src;
+                guchar                *dest;
+                gint                   j;
+
+                if (! xcf_tile_handler_decode (handler, index))
+                  continue;
+
+                xcf_tile_handler_get_xcf_rect (handler, index, &xcf_rect);
+
+                if (! gegl_rectangle_intersect (&blit_rect, &xcf_rect,
+                                                GEGL_RECTANGLE (rect.x,
+                                                                rect.y,
+                                                                rect.width,
+                                                                rect.height)))
+                  continue;
+
+                xcf_stride = bpp * xcf_rect.width;
+
+                src  = handler->cached_data +
+                       (blit_rect.y - xcf_rect.y) * xcf_stride +
+                       (blit_rect.x - xcf_rect.x) * bpp;
+                dest = tile_data +
+                       (blit_rect.y - tile_rect.y) * tile_stride +
+                       (blit_rect.x - tile_rect.x) * bpp;
+
+                for (j = 0; j < blit_rect.height; j++)
+                  {
+                    memcpy (dest, src, blit_rect.width * bpp);
+
+                    src  += xcf_stride;
+                    dest += tile_stride;
+                  }
+              }
+        }
+
+      gegl_tile_unlock (tile);
+
+      if (cairo_region_is_empty (handler->pending_region))
+        xcf_tile_handler_release (handler);
+    }
+
+  cairo_region_destroy (tile_region);
+
+  g_mutex_unlock (&handler->mutex);
+
+  return tile;
+}
+
+static void
+xcf_tile_handler_validate_level (XcfTileHandler *handler,
+                                 gint            x,
+                                 gint            y,
+                                 gint            z)
+{
+  cairo_rectangle_int_t  rect;
+  cairo_region_overlap_t overlap;
+  gint                   tile_x, tile_y;
+
+  rect.x      = (x * handler->tile_width)  << z;
+  rect.y      = (y * handler->tile_height) << z;
+  rect.width  = handler->tile_width  << z;
+  rect.height = handler->tile_height << z;
+
+  g_mutex_lock (&handler->mutex);
+
+  overlap = cairo_region_contains_rectangle (handler->pending_region, &rect);
+
+  g_mutex_unlock (&handler->mutex);
+
+  if (overlap == CAIRO_REGION_OVERLAP_OUT)
+    return;
+
+  for (tile_y = y << z; tile_y < (y + 1) << z; tile_y++)
+    for (tile_x = x << z; tile_x < (x + 1) << z; tile_x++)
+      {
+        GeglTile *tile;
+
+        tile = gegl_tile_source_get_tile (GEGL_TILE_SOURCE (handler),
+                                          tile_x, tile_y, 0);
+
+        if (tile)
+          gegl_tile_unref (tile);
+      }
+}
+
+static void
+xcf_tile_handler_discard (XcfTileHandler *handler,
+                          gint            x,
+                          gint            y)
+{
+  cairo_rectangle_int_t rect;
+
+  rect.x      = x * handler->tile_width;
+  rect.y      = y * handler->tile_height;
+  rect.width  = handler->tile_width;
+  rect.height = handler->tile_height;
+
+  g_mutex_lock (&handler->mutex);
+
+  cairo_region_subtract_rectangle (handler->pending_region, &rect);
+
+  if (cairo_region_is_empty (handler->pending_region))
+    xcf_tile_handler_release (handler);
+
+  g_mutex_unlock (&handler->mutex);
+}
+
+static void
+xcf_tile_handler_get_xcf_rect (XcfTileHandler *handler,
+                               gint            index,
+                               GeglRectangle  *rect)
+{
+  gint n_tile_cols = (handler->width + XCF_TILE_WIDTH - 1) / XCF_TILE_WIDTH;
+
+  rect->x      = (index % n_tile_cols) * XCF_TILE_WIDTH;
+  rect->y      = (index / n_tile_cols) * XCF_TILE_HEIGHT;
+  rect->width  = MIN (XCF_TILE_WIDTH,  handler->width  - rect->x);
+  rect->height = MIN (XCF_TILE_HEIGHT, handler->height - rect->y);
+}
+
+static gboolean
+xcf_tile_handler_decode (XcfTileHandler *handler,
+                         gint            index)
+{
+  GeglRectangle          rect;
+  const guchar          *contents;
+  goffset                file_length;
+  goffset                offset;
+  goffset                data_length;
+  gint                   bpp;
+  gint                   tile_size;
+  gboolean               success = FALSE;
+
+  if (index == handler->cached_tile)
+    return TRUE;
+
+  if (index < 0 || index >= handler->n_tiles || ! handler->mapped_file)
+    return FALSE;
+
+  xcf_tile_handler_get_xcf_rect (handler, index, &rect);
+
+  bpp       = babl_format_get_bytes_per_pixel (handler->format);
+  tile_size = bpp * rect.width * rect.height;
+
+  contents    = (const guchar *) g_mapped_file_get_contents (handler->mapped_file);
+  file_length = g_mapped_file_get_length (handler->mapped_file);
+  offset      = handler->offsets[index];
+
+  /* if the next offset is 0 then we read the maximum possible
+   * allowing for negative compression, like the eager loader does
+   */
+  if (handler->offsets[index + 1] > offset)
+    data_length = handler->offsets[index + 1] - offset;
+  else
+    data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp * 3 / 2;
+
+  data_length = MIN (data_length, file_length - offset);
+
+  if (! handler->cached_data)
+    handler->cached_data = g_malloc (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp);
+
+  /*  the offsets were validated when loading, this is paranoia  */
+  if (offset >= 0 && data_length > 0)
+    {
+      switch (handler->compression)
+        {
+        case COMPRESS_NONE:
+          if (data_length >= tile_size)
+            {
+              memcpy (handler->cached_data, contents + offset, tile_size);
+              success = TRUE;
+            }
+          break;
+
+        case COMPRESS_RLE:
+          success = xcf_load_decode_tile_rle (contents + offset, data_length,
+                                              handler->cached_data,
+                                              bpp, rect.width * rect.height);
+          break;
+
+        case COMPRESS_ZLIB:
+          success = xcf_load_decode_tile_zlib (contents + offset, data_length,
+                                               handler->cached_data, tile_size);
+          break;
+
+        case COMPRESS_FRACTAL:
+          break;
+        }
+    }
+
+  if (! success)
+    {
+      /*  keep the tile transparent, and tell the user about it from
+       *  the main thread, since we may be running in any thread here
+       */
+      if (! handler->decode_failed)
+        {
+          handler->decode_failed = TRUE;
+
+          g_idle_add (xcf_tile_handler_report_idle, g_object_ref (handler));
+        }
+
+      memset (handler->cached_data, 0, tile_size);
+    }
+
+  handler->cached_tile = index;
+
+  return TRUE;
+}
+
+static void
+xcf_tile_handler_release (XcfTileHandler *handler)
+{
+  if (handler->mapped_file)
+    {
+      g_mapped_file_unref (handler->mapped_file);
+      handler->mapped_file = NULL;
+    }
+
+  g_clear_pointer (&handler->offsets,     g_free);
+  g_clear_pointer (&handler->cached_data, g_free);
+
+  handler->cached_tile = -1;
+}
+
+static gboolean
+xcf_tile_handler_report_idle (gpointer data)
+{
+  XcfTileHandler *handler = data;
+
+  gimp_message (handler->gimp, NULL, GIMP_MESSAGE_ERROR,
+                "failed to decode pixel data of '%s', "
+                "it was left transparent",
+                gimp_filename_to_utf8 (handler->filename));
+
+  g_object_unref (handler);
+
+  return FALSE;
+}
+
+
+/*  public functions  */
+
+/**
+ * xcf_tile_handler_new:
+ * @info:    the #XcfInfo of the file being loaded
+ * @offsets: the level's tile offsets, @n_tiles + 1 of them
+ * @n_tiles: the number of XCF tiles in the level
+ *
+ * Creates a tile handler that decodes the tiles of an XCF level
+ * directly from @info's mapped file the first time they are accessed.
+ * The offsets must have been validated against the file's length.
+ *
+ * Return value: the new tile handler.
+ **/
+GeglTileHandler *
+xcf_tile_handler_new (XcfInfo       *info,
+                      const goffset *offsets,
+                      gint           n_tiles)
+{
+  XcfTileHandler *handler;
+
+  g_return_val_if_fail (info != NULL, NULL);
+  g_return_val_if_fail (info->mapped_file != NULL, NULL);
+  g_return_val_if_fail (offsets != NULL, NULL);
+  g_return_val_if_fail (n_tiles > 0, NULL);
+
+  handler = g_object_new (XCF_TYPE_TILE_HANDLER, NULL);
+
+  handler->gimp        = info->gimp;
+  handler->filename    = g_strdup (info->filename);
+  handler->file_id     = g_strdup (info->mapped_file_id);
+  handler->mapped_file = g_mapped_file_ref (info->mapped_file);
+  handler->compression = info->compression;
+  handler->offsets     = g_memdup (offsets, (n_tiles + 1) * sizeof (goffset));
+  handler->n_tiles     = n_tiles;
+
+  g_mutex_lock (&handlers_mutex);
+  handlers = g_list_prepend (handlers, handler);
+  g_mutex_unlock (&handlers_mutex);
+
+  return GEGL_TILE_HANDLER (handler);
+}
+
+/**
+ * xcf_tile_handler_assign:
+ * @handler: a #XcfTileHandler
+ * @buffer:  the level's buffer
+ *
+ * Adds @handler to @buffer. The whole extent of @buffer is marked
+ * as pending, and is decoded tile by tile when it is read.
+ **/
+void
+xcf_tile_handler_assign (XcfTileHandler *handler,
+                         GeglBuffer     *buffer)
+{
+  cairo_rectangle_int_t rect = { 0, 0, 0, 0 };
+
+  g_return_if_fail (XCF_IS_TILE_HANDLER (handler));
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+
+  gegl_buffer_add_handler (buffer, handler);
+
+  handler->buffer = buffer;
+
+  g_object_get (buffer,
+                "format",      &handler->format,
+                "tile-width",  &handler->tile_width,
+                "tile-height", &handler->tile_height,
+                NULL);
+
+  handler->width  = gegl_buffer_get_width  (buffer);
+  handler->height = gegl_buffer_get_height (buffer);
+
+  rect.width  = handler->width;
+  rect.height = handler->height;
+
+  cairo_region_union_rectangle (handler->pending_region, &rect);
+}
+
+/**
+ * xcf_tile_handler_unmap_file:
+ * @file_id: the file's %G_FILE_ATTRIBUTE_ID_FILE
+ *
+ * Decodes all pending tiles of all handlers which decode from the
+ * file identified by @file_id, so that they drop their mapping.
+ * Must be called before the file is written to, because the file
+ * may be rewritten in place instead of being replaced.
+ **/
+void
+xcf_tile_handler_unmap_file (const gchar *file_id)
+{
+  GList *buffers = NULL;
+  GList *list;
+
+  g_return_if_fail (file_id != NULL);
+
+  g_mutex_lock (&handlers_mutex);
+
+  for (list = handlers; list; list = g_list_next (list))
+    {
+      XcfTileHandler *handler = list->data;
+
+      g_mutex_lock (&handler->mutex);
+
+      if (handler->mapped_file && handler->buffer &&
+          ! g_strcmp0 (handler->file_id, file_id))
+        {
+          buffers = g_list_prepend (buffers, g_object_ref (handler->buffer));
+        }
+
+      g_mutex_unlock (&handler->mutex);
+    }
+
+  g_mutex_unlock (&handlers_mutex);
+
+  for (list = buffers; list; list = g_list_next (list))
+    {
+      GeglBuffer         *buffer = list->data;
+      GeglBufferIterator *iter;
+
+      /*  reading the tiles through the buffer decodes them, and keeps
+       *  them in the buffer
+       */
+      iter = gegl_buffer_iterator_new (buffer, gegl_buffer_get_extent (buffer),
+                                       0, NULL,
+                                       GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter));
+    }
+
+  g_list_free_full (buffers, (GDestroyNotify) g_object_unref);
+}
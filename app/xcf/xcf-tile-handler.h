@@ -0,0 +1,92 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __XCF_TILE_HANDLER_H__
+#define __XCF_TILE_HANDLER_H__
+
+#include <gegl-buffer-backend.h>
+
+/***
+ * XcfTileHandler is a GeglTileHandler that decodes the tiles of a
+ * level of a memory-mapped XCF file when they are first accessed.
+ */
+
+G_BEGIN_DECLS
+
+#define XCF_TYPE_TILE_HANDLER            (xcf_tile_handler_get_type ())
+#define XCF_TILE_HANDLER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), XCF_TYPE_TILE_HANDLER, XcfTileHandler))
+#define XCF_TILE_HANDLER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  XCF_TYPE_TILE_HANDLER, XcfTileHandlerClass))
+#define XCF_IS_TILE_HANDLER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), XCF_TYPE_TILE_HANDLER))
+#define XCF_IS_TILE_HANDLER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  XCF_TYPE_TILE_HANDLER))
+#define XCF_TILE_HANDLER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  XCF_TYPE_TILE_HANDLER, XcfTileHandlerClass))
+
+
+typedef struct _XcfTileHandler      XcfTileHandler;
+typedef struct _XcfTileHandlerClass XcfTileHandlerClass;
+
+struct _XcfTileHandler
+{
+  GeglTileHandler     parent_instance;
+
+  GMutex              mutex;
+
+  Gimp               *gimp;
+  gchar              *filename;
+  gchar              *file_id;
+
+  GMappedFile        *mapped_file;
+  XcfCompressionType  compression;
+  goffset            *offsets;
+  gint                n_tiles;
+  gboolean            decode_failed;
+
+  /*  not referenced, the buffer owns the handler  */
+  GeglBuffer         *buffer;
+  const Babl         *format;
+  gint                width;
+  gint                height;
+  gint                tile_width;
+  gint                tile_height;
+
+  /*  the area that has not been decoded yet  */
+  cairo_region_t     *pending_region;
+
+  /*  the last decoded XCF tile  */
+  gint                cached_tile;
+  guchar             *cached_data;
+};
+
+struct _XcfTileHandlerClass
+{
+  GeglTileHandlerClass  parent_class;
+};
+
+
+GType             xcf_tile_handler_get_type   (void) G_GNUC_CONST;
+GeglTileHandler * xcf_tile_handler_new        (XcfInfo        *info,
+                                               const goffset  *offsets,
+                                               gint            n_tiles);
+
+void              xcf_tile_handler_assign     (XcfTileHandler *handler,
+                                               GeglBuffer     *buffer);
+
+void              xcf_tile_handler_unmap_file (const gchar    *file_id);
+
+
+G_END_DECLS
+
+#endif /* __XCF_TILE_HANDLER_H__ */
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <cairo.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib/gstdio.h>
 #include <gegl.h>
@@ -42,6 +43,7 @@
 #include "xcf-load.h"
 #include "xcf-read.h"
 #include "xcf-save.h"
+#include "xcf-tile-handler.h"
 
 #include "gimp-intl.h"
 
@@ -64,6 +66,8 @@ static GimpValueArray * xcf_save_invoker (GimpProcedure         *procedure,
                                           const GimpValueArray  *args,
                                           GError               **error);
 
+static gchar          * xcf_get_file_id  (GFile                 *file);
+
 
 static GimpXcfLoaderFunc * const xcf_loaders[] =
 {
@@ -73,7 +77,9 @@ static GimpXcfLoaderFunc * const xcf_loaders[] =
   xcf_load_image,   /* version 3 */
   xcf_load_image,   /* version 4 */
   xcf_load_image,   /* version 5 */
-  xcf_load_image    /* version 6 */
+  xcf_load_image,   /* version 6 */
+  xcf_load_image,   /* version 7 */
+  xcf_load_image    /* version 8 */
 };
 
 
@@ -238,6 +244,32 @@ xcf_exit (Gimp *gimp)
   g_return_if_fail (GIMP_IS_GIMP (gimp));
 }
 
+/**
+ * xcf_unmap_file:
+ * @file: a #GFile about to be written
+ *
+ * Makes sure that no loaded image still decodes tiles from @file,
+ * which is mapped while loading.  Must be called before writing to a
+ * file, since it may be rewritten in place, for example when it is a
+ * symlink or a hard link, or by a plug-in truncating it.
+ **/
+void
+xcf_unmap_file (GFile *file)
+{
+  gchar *file_id;
+
+  g_return_if_fail (G_IS_FILE (file));
+
+  file_id = xcf_get_file_id (file);
+
+  if (file_id)
+    {
+      xcf_tile_handler_unmap_file (file_id);
+
+      g_free (file_id);
+    }
+}
+
 static GimpValueArray *
 xcf_load_invoker (GimpProcedure         *procedure,
                   Gimp                  *gimp,
@@ -276,6 +308,31 @@ xcf_load_invoker (GimpProcedure         *procedure,
       info.filename    = filename;
       info.compression = COMPRESS_NONE;
 
+#ifndef G_OS_WIN32
+      /* map local files, so that tile data is decoded only when it
+       * is accessed.  not on win32, where a mapped file can't be
+       * replaced when saving over it.  on other platforms, the file
+       * can still be rewritten in place, so xcf_unmap_file() must be
+       * called before writing to it.
+       */
+      {
+        gchar *path    = g_file_get_path (file);
+        gchar *file_id = xcf_get_file_id (file);
+
+        if (path && file_id)
+          {
+            info.mapped_file    = g_mapped_file_new (path, FALSE, NULL);
+            info.mapped_file_id = file_id;
+          }
+        else
+          {
+            g_free (file_id);
+          }
+
+        g_free (path);
+      }
+#endif
+
       if (progress)
         {
           gchar *name = g_filename_display_name (filename);
@@ -310,6 +367,9 @@ xcf_load_invoker (GimpProcedure         *procedure,
 
       if (success)
         {
+          /* version 8 introduced 64 bit offsets */
+          info.bytes_per_offset = info.file_version >= 8 ? 8 : 4;
+
           if (info.file_version >= 0 &&
               info.file_version < G_N_ELEMENTS (xcf_loaders))
             {
@@ -329,6 +389,11 @@ xcf_load_invoker (GimpProcedure         *procedure,
 
       g_object_unref (info.input);
 
+      if (info.mapped_file)
+        g_mapped_file_unref (info.mapped_file);
+
+      g_free (info.mapped_file_id);
+
       if (progress)
         gimp_progress_end (progress);
     }
@@ -381,6 +446,8 @@ xcf_save_invoker (GimpProcedure         *procedure,
 #endif
   filename = g_file_get_parse_name (file);
 
+  xcf_unmap_file (file);
+
   info.output = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE, 0, NULL,
                                                  &my_error));
 
@@ -429,3 +496,25 @@ xcf_save_invoker (GimpProcedure         *procedure,
 
   return return_vals;
 }
+
+/*  identifies the file itself, not its name, so that links to it
+ *  are found too
+ */
+static gchar *
+xcf_get_file_id (GFile *file)
+{
+  GFileInfo *info;
+  gchar     *file_id = NULL;
+
+  info = g_file_query_info (file, G_FILE_ATTRIBUTE_ID_FILE,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+  if (info)
+    {
+      file_id = g_strdup (g_file_info_get_attribute_string (info,
+                                                            G_FILE_ATTRIBUTE_ID_FILE));
+      g_object_unref (info);
+    }
+
+  return file_id;
+}
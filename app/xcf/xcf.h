@@ -19,8 +19,10 @@
 #define __XCF_H__
 
 
-void   xcf_init (Gimp *gimp);
-void   xcf_exit (Gimp *gimp);
+void   xcf_init       (Gimp  *gimp);
+void   xcf_exit       (Gimp  *gimp);
+
+void   xcf_unmap_file (GFile *file);
 
 
 #endif /* __XCF_H__ */
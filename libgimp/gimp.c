@@ -119,7 +119,7 @@
  **/
 
 
-#define TILE_MAP_SIZE (_tile_width * _tile_height * 16)
+#define TILE_MAP_SIZE (_tile_width * _tile_height * 16 * GP_TILE_BATCH_MAX_TILES)
 
 #define ERRMSG_SHM_FAILED "Could not attach to gimp shared memory segment"
 
@@ -138,8 +138,9 @@ typedef enum
 
 #define WRITE_BUFFER_SIZE  1024
 
-void gimp_read_expect_msg   (GimpWireMessage *msg,
-                             gint             type);
+void     gimp_read_expect_msg (GimpWireMessage *msg,
+                               gint             type);
+gboolean _gimp_batch_flush    (void);
 
 
 static void       gimp_close                   (void);
@@ -173,6 +174,17 @@ static gboolean   gimp_extension_read          (GIOChannel      *channel,
 static void       gimp_set_pdb_error           (const GimpParam *return_vals,
                                                 gint             n_return_vals);
 
+static GimpParam * gimp_run_procedure_direct   (const gchar     *name,
+                                                gint            *n_return_vals,
+                                                gint             n_params,
+                                                const GimpParam *params);
+static gboolean   gimp_batch_can_queue         (const gchar     *name);
+static gboolean   gimp_batch_is_undo_group     (const gchar     *name);
+static void       gimp_batch_set_error         (const GimpParam *return_vals,
+                                                gint             n_return_vals);
+static void       gimp_batch_get_error         (void);
+static GimpParam * gimp_batch_return_error     (gint            *n_return_vals);
+
 
 static GIOChannel *_readchannel  = NULL;
 GIOChannel *_writechannel = NULL;
@@ -226,6 +238,13 @@ static GimpPlugInInfo PLUG_IN_INFO;
 static GimpPDBStatusType  pdb_error_status   = GIMP_PDB_SUCCESS;
 static gchar             *pdb_error_message  = NULL;
 
+/*  PDB calls queued between gimp_batch_begin() and gimp_batch_commit()  */
+static gint               batch_depth          = 0;
+static GArray            *batch_procs          = NULL;
+static GHashTable        *batch_n_values       = NULL;
+static GimpPDBStatusType  batch_error_status   = GIMP_PDB_SUCCESS;
+static gchar             *batch_error_message  = NULL;
+
 
 /**
  * gimp_main:
@@ -735,6 +754,8 @@ gimp_uninstall_temp_proc (const gchar *name)
 
   g_return_if_fail (name != NULL);
 
+  _gimp_batch_flush ();
+
   proc_uninstall.name = (gchar *) name;
 
   if (! gp_proc_uninstall_write (_writechannel, &proc_uninstall, NULL))
@@ -746,6 +767,10 @@ gimp_uninstall_temp_proc (const gchar *name)
       g_hash_table_remove (temp_proc_ht, (gpointer) name);
       g_free (hash_name);
     }
+
+  /*  the name may be installed again with other return values  */
+  if (batch_n_values)
+    g_hash_table_remove (batch_n_values, name);
 }
 
 /**
@@ -989,6 +1014,10 @@ gimp_read_expect_msg (GimpWireMessage *msg,
  * As soon as you don't need the return values any longer, you should
  * free them using gimp_destroy_params().
  *
+ * Between gimp_batch_begin() and gimp_batch_commit(), procedures
+ * without return values are only queued and this function returns
+ * %GIMP_PDB_SUCCESS right away, see gimp_batch_begin().
+ *
  * Return value: the procedure's return values.
  **/
 GimpParam *
@@ -997,38 +1026,184 @@ gimp_run_procedure2 (const gchar     *name,
                      gint             n_params,
                      const GimpParam *params)
 {
-  GPProcRun        proc_run;
-  GPProcReturn    *proc_return;
-  GimpWireMessage  msg;
-  GimpParam       *return_vals;
+  GimpParam *return_vals;
 
   g_return_val_if_fail (name != NULL, NULL);
   g_return_val_if_fail (n_return_vals != NULL, NULL);
 
-  proc_run.name    = (gchar *) name;
-  proc_run.nparams = n_params;
-  proc_run.params  = (GPParam *) params;
+  if (batch_depth > 0 && gimp_batch_can_queue (name))
+    {
+      /*  after a failed call, the rest of the batch is skipped  */
+      if (batch_error_status == GIMP_PDB_SUCCESS)
+        {
+          GPProcRun proc_run;
 
-  if (! gp_proc_run_write (_writechannel, &proc_run, NULL))
-    gimp_quit ();
+          proc_run.name    = g_strdup (name);
+          proc_run.nparams = n_params;
+          proc_run.params  = gp_params_copy ((const GPParam *) params, n_params);
 
-  gimp_read_expect_msg (&msg, GP_PROC_RETURN);
+          if (! batch_procs)
+            batch_procs = g_array_new (FALSE, FALSE, sizeof (GPProcRun));
 
-  proc_return = msg.data;
+          g_array_append_val (batch_procs, proc_run);
 
-  *n_return_vals = proc_return->nparams;
-  return_vals    = (GimpParam *) proc_return->params;
+          if (batch_procs->len >= GP_PROC_BATCH_MAX_PROCS)
+            _gimp_batch_flush ();
+        }
 
-  proc_return->nparams = 0;
-  proc_return->params  = NULL;
+      return gimp_batch_return_error (n_return_vals);
+    }
 
-  gimp_wire_destroy (&msg);
+  /*  the procedure may depend on the queued ones, and its return
+   *  values on their results, so it isn't run after a failed one.
+   *  Undo groups are still opened and closed, to keep them balanced
+   */
+  if (! g_str_has_prefix (name, "gimp-procedural-db-") &&
+      ! _gimp_batch_flush ()                           &&
+      ! gimp_batch_is_undo_group (name))
+    {
+      return gimp_batch_return_error (n_return_vals);
+    }
+
+  return_vals = gimp_run_procedure_direct (name, n_return_vals,
+                                           n_params, params);
 
   gimp_set_pdb_error (return_vals, *n_return_vals);
 
   return return_vals;
 }
 
+/**
+ * gimp_batch_begin:
+ *
+ * Starts queueing procedure calls.
+ *
+ * Until the matching gimp_batch_commit(), calls to procedures which
+ * have no return values are not sent to the core one by one, but
+ * collected and sent in a single message, which saves a round trip
+ * per call. The queue is sent before any procedure with return
+ * values runs, and before tiles are transferred, so the calls are
+ * still executed in order.
+ *
+ * Because queued calls return %GIMP_PDB_SUCCESS before they ran,
+ * errors are only reported by gimp_batch_commit(). The core stops
+ * at the first failing call, and all further queued calls are
+ * skipped. Other procedures that are called after the failure
+ * aren't run either, they return the failed call's status, except
+ * for the ones opening and closing undo groups.
+ *
+ * Batches can be nested, only the outermost gimp_batch_commit()
+ * resets the error state.
+ *
+ * Since: GIMP 2.10
+ **/
+void
+gimp_batch_begin (void)
+{
+  batch_depth++;
+}
+
+/**
+ * gimp_batch_commit:
+ *
+ * Sends all procedure calls queued since gimp_batch_begin() and
+ * waits for them to finish.
+ *
+ * If a call failed, its error is available via gimp_get_pdb_error().
+ *
+ * Return value: %TRUE if all calls of the batch succeeded.
+ *
+ * Since: GIMP 2.10
+ **/
+gboolean
+gimp_batch_commit (void)
+{
+  gboolean success;
+
+  g_return_val_if_fail (batch_depth > 0, FALSE);
+
+  success = _gimp_batch_flush ();
+
+  gimp_batch_get_error ();
+
+  if (--batch_depth == 0)
+    {
+      batch_error_status = GIMP_PDB_SUCCESS;
+
+      g_free (batch_error_message);
+      batch_error_message = NULL;
+    }
+
+  return success;
+}
+
+/*  sends the queued calls, returns FALSE if a call of the current
+ *  batch failed
+ */
+gboolean
+_gimp_batch_flush (void)
+{
+  GPProcBatchRun     batch_run;
+  GPProcBatchReturn *batch_return;
+  GimpWireMessage    msg;
+  GArray            *procs;
+  gint               i;
+
+  if (! batch_procs || batch_procs->len == 0)
+    return batch_error_status == GIMP_PDB_SUCCESS;
+
+  /*  reading the reply can run temporary procedures, which make
+   *  calls of their own
+   */
+  procs       = batch_procs;
+  batch_procs = NULL;
+
+  batch_run.n_procs = procs->len;
+  batch_run.procs   = (GPProcRun *) procs->data;
+
+  if (! gp_proc_batch_run_write (_writechannel, &batch_run, NULL))
+    gimp_quit ();
+
+  gimp_read_expect_msg (&msg, GP_PROC_BATCH_RETURN);
+
+  batch_return = msg.data;
+
+  /*  the core stops at the first failure, so it is the last return  */
+  if (batch_return->n_procs > 0)
+    {
+      GPProcReturn *proc_return = &batch_return->procs[batch_return->n_procs - 1];
+
+      if (proc_return->nparams > 0)
+        gimp_batch_set_error ((GimpParam *) proc_return->params,
+                              proc_return->nparams);
+    }
+
+  if (batch_return->n_procs < procs->len &&
+      batch_error_status == GIMP_PDB_SUCCESS)
+    {
+      GimpParam error;
+
+      error.type          = GIMP_PDB_STATUS;
+      error.data.d_status = GIMP_PDB_CALLING_ERROR;
+
+      gimp_batch_set_error (&error, 1);
+    }
+
+  gimp_wire_destroy (&msg);
+
+  for (i = 0; i < procs->len; i++)
+    {
+      GPProcRun *proc_run = &g_array_index (procs, GPProcRun, i);
+
+      g_free (proc_run->name);
+      gp_params_destroy (proc_run->params, proc_run->nparams);
+    }
+
+  g_array_free (procs, TRUE);
+
+  return batch_error_status == GIMP_PDB_SUCCESS;
+}
+
 /**
  * gimp_destroy_params:
  * @params:   the #GimpParam array to destroy
@@ -1878,6 +2053,8 @@ gimp_loop (void)
         case GP_TILE_REQ:
         case GP_TILE_ACK:
         case GP_TILE_DATA:
+        case GP_TILE_BATCH_REQ:
+        case GP_TILE_BATCH_DATA:
           g_warning ("unexpected tile message received (should not happen)");
           break;
 
@@ -2053,6 +2230,10 @@ gimp_proc_run (GPProcRun *proc_run)
                                  (GimpParam *) proc_run->params,
                                  &n_return_vals, &return_vals);
 
+      /*  a batch left open must not outlive the procedure  */
+      while (batch_depth > 0)
+        gimp_batch_commit ();
+
       proc_return.name    = proc_run->name;
       proc_return.nparams = n_return_vals;
       proc_return.params  = (GPParam *) return_vals;
@@ -2069,9 +2250,21 @@ gimp_temp_proc_run (GPProcRun *proc_run)
 
   if (run_proc)
     {
-      GPProcReturn  proc_return;
-      GimpParam    *return_vals;
-      gint          n_return_vals;
+      GPProcReturn       proc_return;
+      GimpParam         *return_vals;
+      gint               n_return_vals;
+      gint               depth         = batch_depth;
+      GArray            *procs         = batch_procs;
+      GimpPDBStatusType  error_status  = batch_error_status;
+      gchar             *error_message = batch_error_message;
+
+      /*  the temporary procedure can run in the middle of a batch,
+       *  it must not add to the caller's batch
+       */
+      batch_depth         = 0;
+      batch_procs         = NULL;
+      batch_error_status  = GIMP_PDB_SUCCESS;
+      batch_error_message = NULL;
 
 #ifdef GDK_WINDOWING_QUARTZ
       if (proc_run->params &&
@@ -2086,6 +2279,14 @@ gimp_temp_proc_run (GPProcRun *proc_run)
                     (GimpParam *) proc_run->params,
                     &n_return_vals, &return_vals);
 
+      while (batch_depth > 0)
+        gimp_batch_commit ();
+
+      batch_depth         = depth;
+      batch_procs         = procs;
+      batch_error_status  = error_status;
+      batch_error_message = error_message;
+
       proc_return.name    = proc_run->name;
       proc_return.nparams = n_return_vals;
       proc_return.params  = (GPParam *) return_vals;
@@ -2109,6 +2310,8 @@ gimp_process_message (GimpWireMessage *msg)
     case GP_TILE_REQ:
     case GP_TILE_ACK:
     case GP_TILE_DATA:
+    case GP_TILE_BATCH_REQ:
+    case GP_TILE_BATCH_DATA:
       g_warning ("unexpected tile message received (should not happen)");
       break;
     case GP_PROC_RUN:
@@ -2184,3 +2387,148 @@ gimp_set_pdb_error (const GimpParam *return_vals,
       break;
     }
 }
+
+static GimpParam *
+gimp_run_procedure_direct (const gchar     *name,
+                           gint            *n_return_vals,
+                           gint             n_params,
+                           const GimpParam *params)
+{
+  GPProcRun        proc_run;
+  GPProcReturn    *proc_return;
+  GimpWireMessage  msg;
+  GimpParam       *return_vals;
+
+  proc_run.name    = (gchar *) name;
+  proc_run.nparams = n_params;
+  proc_run.params  = (GPParam *) params;
+
+  if (! gp_proc_run_write (_writechannel, &proc_run, NULL))
+    gimp_quit ();
+
+  gimp_read_expect_msg (&msg, GP_PROC_RETURN);
+
+  proc_return = msg.data;
+
+  *n_return_vals = proc_return->nparams;
+  return_vals    = (GimpParam *) proc_return->params;
+
+  proc_return->nparams = 0;
+  proc_return->params  = NULL;
+
+  gimp_wire_destroy (&msg);
+
+  return return_vals;
+}
+
+/*  only procedures without return values can be queued, the
+ *  caller can't wait for values which are not there yet
+ */
+static gboolean
+gimp_batch_can_queue (const gchar *name)
+{
+  gpointer n_values;
+
+  /*  don't let procedure lookups break up a batch  */
+  if (g_str_has_prefix (name, "gimp-procedural-db-"))
+    return FALSE;
+
+  /*  undo groups run directly, so a group is closed even if a queued
+   *  call before its end failed and the rest of the batch was skipped
+   */
+  if (gimp_batch_is_undo_group (name))
+    return FALSE;
+
+  if (! batch_n_values)
+    batch_n_values = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                            g_free, NULL);
+
+  if (! g_hash_table_lookup_extended (batch_n_values, name, NULL, &n_values))
+    {
+      GimpParam  param;
+      GimpParam *return_vals;
+      gint       n_return_vals;
+
+      param.type          = GIMP_PDB_STRING;
+      param.data.d_string = (gchar *) name;
+
+      return_vals = gimp_run_procedure_direct ("gimp-procedural-db-proc-info",
+                                               &n_return_vals, 1, &param);
+
+      /*  unknown procedures run directly and fail right away  */
+      if (n_return_vals > 8 &&
+          return_vals[0].data.d_status == GIMP_PDB_SUCCESS)
+        n_values = GINT_TO_POINTER (return_vals[8].data.d_int32);
+      else
+        n_values = GINT_TO_POINTER (-1);
+
+      gimp_destroy_params (return_vals, n_return_vals);
+
+      g_hash_table_insert (batch_n_values, g_strdup (name), n_values);
+    }
+
+  return GPOINTER_TO_INT (n_values) == 0;
+}
+
+static gboolean
+gimp_batch_is_undo_group (const gchar *name)
+{
+  return (! strcmp (name, "gimp-image-undo-group-start") ||
+          ! strcmp (name, "gimp-image-undo-group-end"));
+}
+
+/*  remembers the first failure of a batch  */
+static void
+gimp_batch_set_error (const GimpParam *return_vals,
+                      gint             n_return_vals)
+{
+  if (batch_error_status != GIMP_PDB_SUCCESS)
+    return;
+
+  switch (return_vals[0].data.d_status)
+    {
+    case GIMP_PDB_SUCCESS:
+    case GIMP_PDB_PASS_THROUGH:
+      break;
+
+    default:
+      batch_error_status = return_vals[0].data.d_status;
+
+      if (n_return_vals > 1 && return_vals[1].type == GIMP_PDB_STRING)
+        batch_error_message = g_strdup (return_vals[1].data.d_string);
+      break;
+    }
+}
+
+/*  makes the batch's failure the last procedure call's error  */
+static void
+gimp_batch_get_error (void)
+{
+  GimpParam return_vals[2];
+
+  return_vals[0].type          = GIMP_PDB_STATUS;
+  return_vals[0].data.d_status = batch_error_status;
+  return_vals[1].type          = GIMP_PDB_STRING;
+  return_vals[1].data.d_string = batch_error_message;
+
+  gimp_set_pdb_error (return_vals, batch_error_message ? 2 : 1);
+}
+
+/*  the return values of a call that wasn't run, with the batch's
+ *  status, which is only a success if nothing failed so far
+ */
+static GimpParam *
+gimp_batch_return_error (gint *n_return_vals)
+{
+  GimpParam *return_vals;
+
+  *n_return_vals = 1;
+  return_vals    = g_new0 (GimpParam, 1);
+
+  return_vals[0].type          = GIMP_PDB_STATUS;
+  return_vals[0].data.d_status = batch_error_status;
+
+  gimp_batch_get_error ();
+
+  return return_vals;
+}
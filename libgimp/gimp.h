@@ -297,6 +297,12 @@ GimpParam    * gimp_run_procedure2      (const gchar     *name,
                                          gint             n_params,
                                          const GimpParam *params);
 
+/* Queue procedures which have no return values and send them to the
+ *  core in one message, until the matching 'gimp_batch_commit'.
+ */
+void           gimp_batch_begin         (void);
+gboolean       gimp_batch_commit        (void);
+
 /* Destroy the an array of parameters. This is useful for
  *  destroying the return values returned by a call to
  *  'gimp_run_procedure'.
@@ -599,6 +599,60 @@ gimp_drawable_levels_stretch (gint32 drawable_ID)
   return success;
 }
 
+/**
+ * gimp_drawable_point_filters:
+ * @drawable_ID: The drawable.
+ * @num_operations: The number of operations.
+ * @operations: The point filter operations, in the order they are applied.
+ * @num_settings: The number of settings, must be the same as num_operations.
+ * @settings: The settings of each operation.
+ * @use_lut: Use a lookup table for 8 bit drawables.
+ *
+ * Apply several color adjustments to the drawable in one pass.
+ *
+ * This procedure applies the point filter operations in 'operations'
+ * to the specified drawable, one after the other, reading and writing
+ * each pixel only once and pushing a single undo step. Each operation
+ * is the name of a per-pixel GIMP color operation, such as
+ * \"gimp:levels\", \"gimp:curves\" or \"gimp:colorize\", and the
+ * same entry of 'settings' holds its settings in the format of the
+ * tools' saved settings, or an empty string for the defaults. If
+ * 'use_lut' is TRUE, the operations are baked into a lookup table for
+ * 8 bit drawables, which is faster but only approximates the result.
+ *
+ * Returns: TRUE on success.
+ *
+ * Since: GIMP 2.10
+ **/
+gboolean
+gimp_drawable_point_filters (gint32        drawable_ID,
+                             gint          num_operations,
+                             const gchar **operations,
+                             gint          num_settings,
+                             const gchar **settings,
+                             gboolean      use_lut)
+{
+  GimpParam *return_vals;
+  gint nreturn_vals;
+  gboolean success = TRUE;
+
+  return_vals = gimp_run_procedure ("gimp-drawable-point-filters",
+                                    &nreturn_vals,
+                                    GIMP_PDB_DRAWABLE, drawable_ID,
+                                    GIMP_PDB_INT32, num_operations,
+                                    GIMP_PDB_STRINGARRAY, operations,
+                                    GIMP_PDB_INT32, num_settings,
+                                    GIMP_PDB_STRINGARRAY, settings,
+                                    GIMP_PDB_INT32, use_lut,
+                                    GIMP_PDB_END);
+
+  success = return_vals[0].data.d_status == GIMP_PDB_SUCCESS;
+
+  gimp_destroy_params (return_vals, nreturn_vals);
+
+  return success;
+}
+
 /**
  * gimp_drawable_posterize:
  * @drawable_ID: The drawable.
@@ -82,6 +82,12 @@ gboolean gimp_drawable_levels              (gint32                drawable_ID,
                                             gdouble               low_output,
                                             gdouble               high_output);
 gboolean gimp_drawable_levels_stretch      (gint32                drawable_ID);
+gboolean gimp_drawable_point_filters      (gint32                drawable_ID,
+                                            gint                  num_operations,
+                                            const gchar         **operations,
+                                            gint                  num_settings,
+                                            const gchar         **settings,
+                                            gboolean              use_lut);
 gboolean gimp_drawable_posterize           (gint32                drawable_ID,
                                             gint                  levels);
 gboolean gimp_drawable_threshold           (gint32                drawable_ID,
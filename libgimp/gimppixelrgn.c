@@ -71,6 +71,16 @@ static gpointer gimp_pixel_rgns_configure (GimpPixelRgnIterator *pri);
 static void     gimp_pixel_rgn_configure  (GimpPixelRgnHolder   *prh,
                                            GimpPixelRgnIterator *pri);
 
+static GimpTile ** gimp_pixel_rgn_ref_tiles   (GimpPixelRgn *pr,
+                                               gint          x,
+                                               gint          y,
+                                               gint          width,
+                                               gint          height,
+                                               gint         *n_tiles);
+static void        gimp_pixel_rgn_unref_tiles (GimpTile    **tiles,
+                                               gint          n_tiles,
+                                               gboolean      dirty);
+
 /**
  * gimp_pixel_rgn_init:
  * @pr:        a pointer to a #GimpPixelRgn variable.
@@ -234,7 +244,9 @@ gimp_pixel_rgn_get_row (GimpPixelRgn *pr,
                         gint          y,
                         gint          width)
 {
-  gint end;
+  GimpTile **tiles;
+  gint       n_tiles;
+  gint       end;
 
   g_return_if_fail (pr != NULL && pr->drawable != NULL);
   g_return_if_fail (buf != NULL);
@@ -244,6 +256,8 @@ gimp_pixel_rgn_get_row (GimpPixelRgn *pr,
 
   end = x + width;
 
+  tiles = gimp_pixel_rgn_ref_tiles (pr, x, y, width, 1, &n_tiles);
+
   while (x < end)
     {
       GimpTile     *tile;
@@ -269,6 +283,8 @@ gimp_pixel_rgn_get_row (GimpPixelRgn *pr,
 
       gimp_tile_unref (tile, FALSE);
     }
+
+  gimp_pixel_rgn_unref_tiles (tiles, n_tiles, FALSE);
 }
 
 /**
@@ -291,7 +307,9 @@ gimp_pixel_rgn_get_col (GimpPixelRgn *pr,
                         gint          y,
                         gint          height)
 {
-  gint end;
+  GimpTile **tiles;
+  gint       n_tiles;
+  gint       end;
 
   g_return_if_fail (pr != NULL && pr->drawable != NULL);
   g_return_if_fail (buf != NULL);
@@ -301,6 +319,8 @@ gimp_pixel_rgn_get_col (GimpPixelRgn *pr,
 
   end = y + height;
 
+  tiles = gimp_pixel_rgn_ref_tiles (pr, x, y, 1, height, &n_tiles);
+
   while (y < end)
     {
       GimpTile     *tile;
@@ -328,6 +348,8 @@ gimp_pixel_rgn_get_col (GimpPixelRgn *pr,
 
       gimp_tile_unref (tile, FALSE);
     }
+
+  gimp_pixel_rgn_unref_tiles (tiles, n_tiles, FALSE);
 }
 
 /**
@@ -359,6 +381,8 @@ gimp_pixel_rgn_get_rect (GimpPixelRgn *pr,
   gint    yboundary;
   gint    xstep, ystep;
   gint    ty, bpp;
+  GimpTile **tiles;
+  gint       n_tiles;
 
   g_return_if_fail (pr != NULL && pr->drawable != NULL);
   g_return_if_fail (buf != NULL);
@@ -380,6 +404,8 @@ gimp_pixel_rgn_get_rect (GimpPixelRgn *pr,
     {
       x = xstart;
 
+      tiles = gimp_pixel_rgn_ref_tiles (pr, xstart, y, width, 1, &n_tiles);
+
       while (x < xend)
         {
           GimpTile *tile;
@@ -410,6 +436,8 @@ gimp_pixel_rgn_get_rect (GimpPixelRgn *pr,
           x += xstep;
         }
 
+      gimp_pixel_rgn_unref_tiles (tiles, n_tiles, FALSE);
+
       y += ystep;
     }
 }
@@ -469,11 +497,13 @@ gimp_pixel_rgn_set_row (GimpPixelRgn *pr,
                         gint          y,
                         gint          width)
 {
-  GimpTile *tile;
-  guchar   *tile_data;
-  gint      inc, min;
-  gint      end;
-  gint      boundary;
+  GimpTile **tiles;
+  gint       n_tiles;
+  GimpTile  *tile;
+  guchar    *tile_data;
+  gint       inc, min;
+  gint       end;
+  gint       boundary;
 
   g_return_if_fail (pr != NULL && pr->drawable != NULL);
   g_return_if_fail (buf != NULL);
@@ -483,6 +513,8 @@ gimp_pixel_rgn_set_row (GimpPixelRgn *pr,
 
   end = x + width;
 
+  tiles = gimp_pixel_rgn_ref_tiles (pr, x, y, width, 1, &n_tiles);
+
   while (x < end)
     {
       tile = gimp_drawable_get_tile2 (pr->drawable, pr->shadow, x, y);
@@ -503,6 +535,8 @@ gimp_pixel_rgn_set_row (GimpPixelRgn *pr,
 
       gimp_tile_unref (tile, TRUE);
     }
+
+  gimp_pixel_rgn_unref_tiles (tiles, n_tiles, TRUE);
 }
 
 /**
@@ -524,7 +558,9 @@ gimp_pixel_rgn_set_col (GimpPixelRgn *pr,
                         gint          y,
                         gint          height)
 {
-  gint      end;
+  GimpTile **tiles;
+  gint       n_tiles;
+  gint       end;
 
   g_return_if_fail (pr != NULL && pr->drawable != NULL);
   g_return_if_fail (buf != NULL);
@@ -534,6 +570,8 @@ gimp_pixel_rgn_set_col (GimpPixelRgn *pr,
 
   end = y + height;
 
+  tiles = gimp_pixel_rgn_ref_tiles (pr, x, y, 1, height, &n_tiles);
+
   while (y < end)
     {
       GimpTile *tile;
@@ -562,6 +600,8 @@ gimp_pixel_rgn_set_col (GimpPixelRgn *pr,
 
       gimp_tile_unref (tile, TRUE);
     }
+
+  gimp_pixel_rgn_unref_tiles (tiles, n_tiles, TRUE);
 }
 
 /**
@@ -593,6 +633,8 @@ gimp_pixel_rgn_set_rect (GimpPixelRgn *pr,
   gint    yboundary;
   gint    xstep, ystep;
   gint    ty, bpp;
+  GimpTile **tiles;
+  gint       n_tiles;
 
   g_return_if_fail (pr != NULL && pr->drawable != NULL);
   g_return_if_fail (buf != NULL);
@@ -614,6 +656,8 @@ gimp_pixel_rgn_set_rect (GimpPixelRgn *pr,
     {
       x = xstart;
 
+      tiles = gimp_pixel_rgn_ref_tiles (pr, xstart, y, width, 1, &n_tiles);
+
       while (x < xend)
         {
           GimpTile *tile;
@@ -644,6 +688,8 @@ gimp_pixel_rgn_set_rect (GimpPixelRgn *pr,
           x += xstep;
         }
 
+      gimp_pixel_rgn_unref_tiles (tiles, n_tiles, TRUE);
+
       y += ystep;
     }
 }
@@ -963,3 +1009,57 @@ gimp_pixel_rgn_configure (GimpPixelRgnHolder   *prh,
   prh->pr->w = pri->portion_width;
   prh->pr->h = pri->portion_height;
 }
+
+/*  Reference all tiles touched by the given rectangle at once, so that
+ *  the ones which have to be fetched from the core are transferred in
+ *  a single request instead of one round-trip per tile.
+ */
+static GimpTile **
+gimp_pixel_rgn_ref_tiles (GimpPixelRgn *pr,
+                          gint          x,
+                          gint          y,
+                          gint          width,
+                          gint          height,
+                          gint         *n_tiles)
+{
+  GimpTile **tiles;
+  gint       tx1, ty1;
+  gint       tx2, ty2;
+  gint       tx, ty;
+  gint       i = 0;
+
+  if (width <= 0 || height <= 0)
+    {
+      *n_tiles = 0;
+
+      return NULL;
+    }
+
+  tx1 = x / TILE_WIDTH;
+  ty1 = y / TILE_HEIGHT;
+  tx2 = (x + width  - 1) / TILE_WIDTH;
+  ty2 = (y + height - 1) / TILE_HEIGHT;
+
+  *n_tiles = (tx2 - tx1 + 1) * (ty2 - ty1 + 1);
+
+  tiles = g_new (GimpTile *, *n_tiles);
+
+  for (ty = ty1; ty <= ty2; ty++)
+    for (tx = tx1; tx <= tx2; tx++)
+      tiles[i++] = gimp_drawable_get_tile2 (pr->drawable, pr->shadow,
+                                            tx * TILE_WIDTH, ty * TILE_HEIGHT);
+
+  _gimp_tiles_ref (tiles, *n_tiles);
+
+  return tiles;
+}
+
+static void
+gimp_pixel_rgn_unref_tiles (GimpTile **tiles,
+                            gint       n_tiles,
+                            gboolean   dirty)
+{
+  _gimp_tiles_unref (tiles, n_tiles, dirty);
+
+  g_free (tiles);
+}
@@ -49,11 +49,33 @@
 #define FREE_QUANTUM 0.1
 
 
+typedef struct _GimpTileBatch GimpTileBatch;
+
+struct _GimpTileBatch
+{
+  GimpTile *tiles[GP_TILE_BATCH_MAX_TILES];
+  gint      n_tiles;
+  gsize     data_length;
+};
+
+
 void         gimp_read_expect_msg   (GimpWireMessage *msg,
                                      gint             type);
+gboolean     _gimp_batch_flush      (void);
 
 static void  gimp_tile_get          (GimpTile        *tile);
 static void  gimp_tile_put          (GimpTile        *tile);
+
+static gsize gimp_tile_get_data_length (GimpTile     *tile);
+
+static void  gimp_tile_batch_add    (GimpTileBatch   *batch,
+                                     GimpTile        *tile,
+                                     gboolean         put);
+static void  gimp_tile_batch_flush  (GimpTileBatch   *batch,
+                                     gboolean         put);
+static void  gimp_tile_batch_get    (GimpTileBatch   *batch);
+static void  gimp_tile_batch_put    (GimpTileBatch   *batch);
+
 static void  gimp_tile_cache_insert (GimpTile        *tile);
 static void  gimp_tile_cache_flush  (GimpTile        *tile);
 
@@ -184,6 +206,73 @@ _gimp_tile_cache_flush_drawable (GimpDrawable *drawable)
     }
 }
 
+/*  Reference several tiles at once, fetching the pixels of all tiles
+ *  that aren't in memory yet with as few requests as possible.
+ *  @tiles must not contain duplicates.
+ */
+void
+_gimp_tiles_ref (GimpTile **tiles,
+                 gint       n_tiles)
+{
+  GimpTileBatch batch = { { NULL, }, 0, 0 };
+  gint          i;
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      GimpTile *tile = tiles[i];
+
+      tile->ref_count++;
+
+      if (tile->ref_count == 1)
+        {
+          gimp_tile_batch_add (&batch, tile, FALSE);
+          tile->dirty = FALSE;
+        }
+    }
+
+  gimp_tile_batch_flush (&batch, FALSE);
+
+  for (i = 0; i < n_tiles; i++)
+    gimp_tile_cache_insert (tiles[i]);
+}
+
+/*  Counterpart of _gimp_tiles_ref(), sends all dirty tiles that are
+ *  no longer referenced back with as few requests as possible.
+ */
+void
+_gimp_tiles_unref (GimpTile **tiles,
+                   gint       n_tiles,
+                   gboolean   dirty)
+{
+  GimpTileBatch batch = { { NULL, }, 0, 0 };
+  gint          i;
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      GimpTile *tile = tiles[i];
+
+      g_return_if_fail (tile->ref_count > 0);
+
+      tile->ref_count--;
+      tile->dirty |= dirty;
+
+      if (tile->ref_count == 0)
+        {
+          if (tile->data && tile->dirty)
+            {
+              gimp_tile_batch_add (&batch, tile, TRUE);
+            }
+          else
+            {
+              g_free (tile->data);
+              tile->data = NULL;
+            }
+        }
+    }
+
+  gimp_tile_batch_flush (&batch, TRUE);
+}
+
 
 /*  private functions  */
 
@@ -200,6 +289,9 @@ gimp_tile_get (GimpTile *tile)
   tile_req.tile_num    = tile->tile_num;
   tile_req.shadow      = tile->shadow;
 
+  /*  queued procedure calls may change the drawable  */
+  _gimp_batch_flush ();
+
   if (! gp_tile_req_write (_writechannel, &tile_req, NULL))
     gimp_quit ();
 
@@ -248,6 +340,8 @@ gimp_tile_put (GimpTile *tile)
   tile_req.tile_num    = 0;
   tile_req.shadow      = 0;
 
+  _gimp_batch_flush ();
+
   if (! gp_tile_req_write (_writechannel, &tile_req, NULL))
     gimp_quit ();
 
@@ -408,3 +502,201 @@ gimp_tile_cache_flush (GimpTile *tile)
       gimp_tile_unref (tile, FALSE);
     }
 }
+
+static gsize
+gimp_tile_get_data_length (GimpTile *tile)
+{
+  return tile->ewidth * tile->eheight * tile->bpp;
+}
+
+static void
+gimp_tile_batch_add (GimpTileBatch *batch,
+                     GimpTile      *tile,
+                     gboolean       put)
+{
+  /*  the shared memory segment holds GP_TILE_BATCH_MAX_TILES tiles of
+   *  up to 16 bytes per pixel
+   */
+  gsize max_length = (gimp_tile_width () * gimp_tile_height () * 16 *
+                      GP_TILE_BATCH_MAX_TILES);
+  gsize length     = gimp_tile_get_data_length (tile);
+
+  if (batch->n_tiles > 0                                        &&
+      (batch->n_tiles == GP_TILE_BATCH_MAX_TILES                ||
+       batch->data_length + length > max_length                 ||
+       batch->tiles[0]->drawable != tile->drawable              ||
+       batch->tiles[0]->shadow   != tile->shadow))
+    {
+      gimp_tile_batch_flush (batch, put);
+    }
+
+  batch->tiles[batch->n_tiles++] = tile;
+  batch->data_length += length;
+}
+
+static void
+gimp_tile_batch_flush (GimpTileBatch *batch,
+                       gboolean       put)
+{
+  if (batch->n_tiles == 1)
+    {
+      /*  a single tile goes through the plain tile protocol  */
+      if (put)
+        gimp_tile_put (batch->tiles[0]);
+      else
+        gimp_tile_get (batch->tiles[0]);
+    }
+  else if (batch->n_tiles > 1)
+    {
+      if (put)
+        gimp_tile_batch_put (batch);
+      else
+        gimp_tile_batch_get (batch);
+    }
+
+  if (put)
+    {
+      gint i;
+
+      for (i = 0; i < batch->n_tiles; i++)
+        {
+          GimpTile *tile = batch->tiles[i];
+
+          tile->dirty = FALSE;
+
+          g_free (tile->data);
+          tile->data = NULL;
+        }
+    }
+
+  batch->n_tiles     = 0;
+  batch->data_length = 0;
+}
+
+static void
+gimp_tile_batch_get (GimpTileBatch *batch)
+{
+  extern GIOChannel *_writechannel;
+
+  GPTileBatchReq   tile_req;
+  GPTileBatchData *tile_data;
+  GimpWireMessage  msg;
+  guint32          tile_nums[GP_TILE_BATCH_MAX_TILES];
+  const guchar    *src;
+  gint             i;
+
+  for (i = 0; i < batch->n_tiles; i++)
+    tile_nums[i] = batch->tiles[i]->tile_num;
+
+  tile_req.drawable_ID = batch->tiles[0]->drawable->drawable_id;
+  tile_req.shadow      = batch->tiles[0]->shadow;
+  tile_req.put         = FALSE;
+  tile_req.n_tiles     = batch->n_tiles;
+  tile_req.tile_nums   = tile_nums;
+
+  _gimp_batch_flush ();
+
+  if (! gp_tile_batch_req_write (_writechannel, &tile_req, NULL))
+    gimp_quit ();
+
+  gimp_read_expect_msg (&msg, GP_TILE_BATCH_DATA);
+
+  tile_data = msg.data;
+  if (tile_data->drawable_ID != tile_req.drawable_ID    ||
+      tile_data->shadow      != tile_req.shadow         ||
+      tile_data->bpp         != batch->tiles[0]->bpp    ||
+      tile_data->n_tiles     != batch->n_tiles          ||
+      tile_data->data_length != batch->data_length      ||
+      memcmp (tile_data->tile_nums, tile_nums,
+              batch->n_tiles * sizeof (guint32)))
+    {
+      g_message ("received tile info did not match computed tile info");
+      gimp_quit ();
+    }
+
+  if (tile_data->use_shm)
+    src = gimp_shm_addr ();
+  else
+    src = tile_data->data;
+
+  for (i = 0; i < batch->n_tiles; i++)
+    {
+      GimpTile *tile   = batch->tiles[i];
+      gsize     length = gimp_tile_get_data_length (tile);
+
+      tile->data = g_memdup (src, length);
+
+      src += length;
+    }
+
+  if (! gp_tile_ack_write (_writechannel, NULL))
+    gimp_quit ();
+
+  gimp_wire_destroy (&msg);
+}
+
+static void
+gimp_tile_batch_put (GimpTileBatch *batch)
+{
+  extern GIOChannel *_writechannel;
+
+  GPTileBatchReq   tile_req;
+  GPTileBatchData  tile_data;
+  GPTileBatchData *tile_info;
+  GimpWireMessage  msg;
+  guint32          tile_nums[GP_TILE_BATCH_MAX_TILES];
+  guchar          *dest;
+  gint             i;
+
+  tile_req.drawable_ID = batch->tiles[0]->drawable->drawable_id;
+  tile_req.shadow      = batch->tiles[0]->shadow;
+  tile_req.put         = TRUE;
+  tile_req.n_tiles     = 0;
+  tile_req.tile_nums   = NULL;
+
+  _gimp_batch_flush ();
+
+  if (! gp_tile_batch_req_write (_writechannel, &tile_req, NULL))
+    gimp_quit ();
+
+  gimp_read_expect_msg (&msg, GP_TILE_BATCH_DATA);
+
+  tile_info = msg.data;
+
+  for (i = 0; i < batch->n_tiles; i++)
+    tile_nums[i] = batch->tiles[i]->tile_num;
+
+  tile_data.drawable_ID = tile_req.drawable_ID;
+  tile_data.shadow      = tile_req.shadow;
+  tile_data.bpp         = batch->tiles[0]->bpp;
+  tile_data.use_shm     = tile_info->use_shm && gimp_shm_addr () != NULL;
+  tile_data.n_tiles     = batch->n_tiles;
+  tile_data.tile_nums   = tile_nums;
+  tile_data.data_length = batch->data_length;
+  tile_data.data        = NULL;
+
+  if (tile_data.use_shm)
+    dest = gimp_shm_addr ();
+  else
+    dest = tile_data.data = g_malloc (batch->data_length);
+
+  for (i = 0; i < batch->n_tiles; i++)
+    {
+      GimpTile *tile   = batch->tiles[i];
+      gsize     length = gimp_tile_get_data_length (tile);
+
+      memcpy (dest, tile->data, length);
+
+      dest += length;
+    }
+
+  if (! gp_tile_batch_data_write (_writechannel, &tile_data, NULL))
+    gimp_quit ();
+
+  g_free (tile_data.data);
+
+  gimp_wire_destroy (&msg);
+
+  gimp_read_expect_msg (&msg, GP_TILE_ACK);
+  gimp_wire_destroy (&msg);
+}
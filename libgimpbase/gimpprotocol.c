@@ -67,6 +67,22 @@ static void _gp_tile_data_write          (GIOChannel       *channel,
                                           gpointer          user_data);
 static void _gp_tile_data_destroy        (GimpWireMessage  *msg);
 
+static void _gp_tile_batch_req_read      (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tile_batch_req_write     (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tile_batch_req_destroy   (GimpWireMessage  *msg);
+
+static void _gp_tile_batch_data_read     (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tile_batch_data_write    (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tile_batch_data_destroy  (GimpWireMessage  *msg);
+
 static void _gp_proc_run_read            (GIOChannel       *channel,
                                           GimpWireMessage  *msg,
                                           gpointer          user_data);
@@ -99,6 +115,22 @@ static void _gp_temp_proc_return_write   (GIOChannel       *channel,
                                           gpointer          user_data);
 static void _gp_temp_proc_return_destroy (GimpWireMessage  *msg);
 
+static void _gp_proc_batch_run_read      (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_batch_run_write     (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_batch_run_destroy   (GimpWireMessage  *msg);
+
+static void _gp_proc_batch_return_read   (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_batch_return_write  (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_batch_return_destroy (GimpWireMessage *msg);
+
 static void _gp_proc_install_read        (GIOChannel       *channel,
                                           GimpWireMessage  *msg,
                                           gpointer          user_data);
@@ -197,6 +229,22 @@ gp_init (void)
                       _gp_has_init_read,
                       _gp_has_init_write,
                       _gp_has_init_destroy);
+  gimp_wire_register (GP_TILE_BATCH_REQ,
+                      _gp_tile_batch_req_read,
+                      _gp_tile_batch_req_write,
+                      _gp_tile_batch_req_destroy);
+  gimp_wire_register (GP_TILE_BATCH_DATA,
+                      _gp_tile_batch_data_read,
+                      _gp_tile_batch_data_write,
+                      _gp_tile_batch_data_destroy);
+  gimp_wire_register (GP_PROC_BATCH_RUN,
+                      _gp_proc_batch_run_read,
+                      _gp_proc_batch_run_write,
+                      _gp_proc_batch_run_destroy);
+  gimp_wire_register (GP_PROC_BATCH_RETURN,
+                      _gp_proc_batch_return_read,
+                      _gp_proc_batch_return_write,
+                      _gp_proc_batch_return_destroy);
 }
 
 gboolean
@@ -292,6 +340,44 @@ gp_tile_data_write (GIOChannel *channel,
   return TRUE;
 }
 
+gboolean
+gp_tile_batch_req_write (GIOChannel     *channel,
+                         GPTileBatchReq *tile_batch_req,
+                         gpointer        user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_TILE_BATCH_REQ;
+  msg.data = tile_batch_req;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
+gboolean
+gp_tile_batch_data_write (GIOChannel      *channel,
+                          GPTileBatchData *tile_batch_data,
+                          gpointer         user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_TILE_BATCH_DATA;
+  msg.data = tile_batch_data;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
 gboolean
 gp_proc_run_write (GIOChannel *channel,
                    GPProcRun  *proc_run,
@@ -368,6 +454,44 @@ gp_temp_proc_return_write (GIOChannel   *channel,
   return TRUE;
 }
 
+gboolean
+gp_proc_batch_run_write (GIOChannel     *channel,
+                         GPProcBatchRun *proc_batch_run,
+                         gpointer        user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_PROC_BATCH_RUN;
+  msg.data = proc_batch_run;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
+gboolean
+gp_proc_batch_return_write (GIOChannel        *channel,
+                            GPProcBatchReturn *proc_batch_return,
+                            gpointer           user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_PROC_BATCH_RETURN;
+  msg.data = proc_batch_return;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
 gboolean
 gp_proc_install_write (GIOChannel    *channel,
                        GPProcInstall *proc_install,
@@ -843,6 +967,219 @@ _gp_tile_data_destroy (GimpWireMessage *msg)
     }
 }
 
+/*  tile_batch_req  */
+
+static void
+_gp_tile_batch_req_read (GIOChannel      *channel,
+                         GimpWireMessage *msg,
+                         gpointer         user_data)
+{
+  GPTileBatchReq *tile_batch_req = g_slice_new0 (GPTileBatchReq);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &tile_batch_req->drawable_ID, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_batch_req->shadow, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_batch_req->put, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_batch_req->n_tiles, 1, user_data))
+    goto cleanup;
+
+  if (tile_batch_req->n_tiles > GP_TILE_BATCH_MAX_TILES)
+    goto cleanup;
+
+  if (tile_batch_req->n_tiles > 0)
+    {
+      tile_batch_req->tile_nums = g_new (guint32, tile_batch_req->n_tiles);
+
+      if (! _gimp_wire_read_int32 (channel,
+                                   tile_batch_req->tile_nums,
+                                   tile_batch_req->n_tiles, user_data))
+        goto cleanup;
+    }
+
+  msg->data = tile_batch_req;
+  return;
+
+ cleanup:
+  g_free (tile_batch_req->tile_nums);
+  g_slice_free (GPTileBatchReq, tile_batch_req);
+  msg->data = NULL;
+}
+
+static void
+_gp_tile_batch_req_write (GIOChannel      *channel,
+                          GimpWireMessage *msg,
+                          gpointer         user_data)
+{
+  GPTileBatchReq *tile_batch_req = msg->data;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &tile_batch_req->drawable_ID, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_batch_req->shadow, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_batch_req->put, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_batch_req->n_tiles, 1, user_data))
+    return;
+
+  if (tile_batch_req->n_tiles > 0)
+    {
+      if (! _gimp_wire_write_int32 (channel,
+                                    tile_batch_req->tile_nums,
+                                    tile_batch_req->n_tiles, user_data))
+        return;
+    }
+}
+
+static void
+_gp_tile_batch_req_destroy (GimpWireMessage *msg)
+{
+  GPTileBatchReq *tile_batch_req = msg->data;
+
+  if (tile_batch_req)
+    {
+      g_free (tile_batch_req->tile_nums);
+      g_slice_free (GPTileBatchReq, tile_batch_req);
+    }
+}
+
+/*  tile_batch_data  */
+
+static void
+_gp_tile_batch_data_read (GIOChannel      *channel,
+                          GimpWireMessage *msg,
+                          gpointer         user_data)
+{
+  GPTileBatchData *tile_batch_data = g_slice_new0 (GPTileBatchData);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &tile_batch_data->drawable_ID, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_batch_data->shadow, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_batch_data->bpp, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_batch_data->use_shm, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_batch_data->n_tiles, 1, user_data))
+    goto cleanup;
+
+  if (tile_batch_data->n_tiles > GP_TILE_BATCH_MAX_TILES)
+    goto cleanup;
+
+  if (tile_batch_data->n_tiles > 0)
+    {
+      tile_batch_data->tile_nums = g_new (guint32, tile_batch_data->n_tiles);
+
+      if (! _gimp_wire_read_int32 (channel,
+                                   tile_batch_data->tile_nums,
+                                   tile_batch_data->n_tiles, user_data))
+        goto cleanup;
+    }
+
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_batch_data->data_length, 1, user_data))
+    goto cleanup;
+
+  if (! tile_batch_data->use_shm && tile_batch_data->data_length > 0)
+    {
+      tile_batch_data->data = g_try_malloc (tile_batch_data->data_length);
+
+      if (! tile_batch_data->data)
+        goto cleanup;
+
+      if (! _gimp_wire_read_int8 (channel,
+                                  (guint8 *) tile_batch_data->data,
+                                  tile_batch_data->data_length,
+                                  user_data))
+        goto cleanup;
+    }
+
+  msg->data = tile_batch_data;
+  return;
+
+ cleanup:
+  g_free (tile_batch_data->tile_nums);
+  g_free (tile_batch_data->data);
+  g_slice_free (GPTileBatchData, tile_batch_data);
+  msg->data = NULL;
+}
+
+static void
+_gp_tile_batch_data_write (GIOChannel      *channel,
+                           GimpWireMessage *msg,
+                           gpointer         user_data)
+{
+  GPTileBatchData *tile_batch_data = msg->data;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &tile_batch_data->drawable_ID, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_batch_data->shadow, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_batch_data->bpp, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_batch_data->use_shm, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_batch_data->n_tiles, 1, user_data))
+    return;
+
+  if (tile_batch_data->n_tiles > 0)
+    {
+      if (! _gimp_wire_write_int32 (channel,
+                                    tile_batch_data->tile_nums,
+                                    tile_batch_data->n_tiles, user_data))
+        return;
+    }
+
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_batch_data->data_length, 1, user_data))
+    return;
+
+  if (! tile_batch_data->use_shm && tile_batch_data->data_length > 0)
+    {
+      if (! _gimp_wire_write_int8 (channel,
+                                   (const guint8 *) tile_batch_data->data,
+                                   tile_batch_data->data_length,
+                                   user_data))
+        return;
+    }
+}
+
+static void
+_gp_tile_batch_data_destroy (GimpWireMessage *msg)
+{
+  GPTileBatchData *tile_batch_data = msg->data;
+
+  if (tile_batch_data)
+    {
+      g_free (tile_batch_data->tile_nums);
+      g_free (tile_batch_data->data);
+      g_slice_free (GPTileBatchData, tile_batch_data);
+    }
+}
+
 /*  proc_run  */
 
 static void
@@ -994,6 +1331,184 @@ _gp_temp_proc_return_destroy (GimpWireMessage *msg)
   _gp_proc_return_destroy (msg);
 }
 
+/*  proc_batch_run  */
+
+static void
+_gp_proc_batch_run_read (GIOChannel      *channel,
+                         GimpWireMessage *msg,
+                         gpointer         user_data)
+{
+  GPProcBatchRun *proc_batch_run = g_slice_new0 (GPProcBatchRun);
+  guint32         n_procs;
+  gint            i;
+
+  if (! _gimp_wire_read_int32 (channel, &n_procs, 1, user_data))
+    goto cleanup;
+
+  if (n_procs > GP_PROC_BATCH_MAX_PROCS)
+    goto cleanup;
+
+  proc_batch_run->procs = g_new0 (GPProcRun, n_procs);
+
+  for (i = 0; i < n_procs; i++)
+    {
+      GPProcRun *proc_run = &proc_batch_run->procs[i];
+
+      if (! _gimp_wire_read_string (channel, &proc_run->name, 1, user_data))
+        goto cleanup;
+
+      proc_batch_run->n_procs++;
+
+      _gp_params_read (channel,
+                       &proc_run->params, (guint *) &proc_run->nparams,
+                       user_data);
+    }
+
+  msg->data = proc_batch_run;
+  return;
+
+ cleanup:
+  msg->data = proc_batch_run;
+  _gp_proc_batch_run_destroy (msg);
+  msg->data = NULL;
+}
+
+static void
+_gp_proc_batch_run_write (GIOChannel      *channel,
+                          GimpWireMessage *msg,
+                          gpointer         user_data)
+{
+  GPProcBatchRun *proc_batch_run = msg->data;
+  gint            i;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                &proc_batch_run->n_procs, 1, user_data))
+    return;
+
+  for (i = 0; i < proc_batch_run->n_procs; i++)
+    {
+      GPProcRun *proc_run = &proc_batch_run->procs[i];
+
+      if (! _gimp_wire_write_string (channel, &proc_run->name, 1, user_data))
+        return;
+
+      _gp_params_write (channel,
+                        proc_run->params, proc_run->nparams, user_data);
+    }
+}
+
+static void
+_gp_proc_batch_run_destroy (GimpWireMessage *msg)
+{
+  GPProcBatchRun *proc_batch_run = msg->data;
+
+  if (proc_batch_run)
+    {
+      gint i;
+
+      for (i = 0; i < proc_batch_run->n_procs; i++)
+        {
+          GPProcRun *proc_run = &proc_batch_run->procs[i];
+
+          gp_params_destroy (proc_run->params, proc_run->nparams);
+          g_free (proc_run->name);
+        }
+
+      g_free (proc_batch_run->procs);
+      g_slice_free (GPProcBatchRun, proc_batch_run);
+    }
+}
+
+/*  proc_batch_return  */
+
+static void
+_gp_proc_batch_return_read (GIOChannel      *channel,
+                            GimpWireMessage *msg,
+                            gpointer         user_data)
+{
+  GPProcBatchReturn *proc_batch_return = g_slice_new0 (GPProcBatchReturn);
+  guint32            n_procs;
+  gint               i;
+
+  if (! _gimp_wire_read_int32 (channel, &n_procs, 1, user_data))
+    goto cleanup;
+
+  if (n_procs > GP_PROC_BATCH_MAX_PROCS)
+    goto cleanup;
+
+  proc_batch_return->procs = g_new0 (GPProcReturn, n_procs);
+
+  for (i = 0; i < n_procs; i++)
+    {
+      GPProcReturn *proc_return = &proc_batch_return->procs[i];
+
+      if (! _gimp_wire_read_string (channel,
+                                    &proc_return->name, 1, user_data))
+        goto cleanup;
+
+      proc_batch_return->n_procs++;
+
+      _gp_params_read (channel,
+                       &proc_return->params, (guint *) &proc_return->nparams,
+                       user_data);
+    }
+
+  msg->data = proc_batch_return;
+  return;
+
+ cleanup:
+  msg->data = proc_batch_return;
+  _gp_proc_batch_return_destroy (msg);
+  msg->data = NULL;
+}
+
+static void
+_gp_proc_batch_return_write (GIOChannel      *channel,
+                             GimpWireMessage *msg,
+                             gpointer         user_data)
+{
+  GPProcBatchReturn *proc_batch_return = msg->data;
+  gint               i;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                &proc_batch_return->n_procs, 1, user_data))
+    return;
+
+  for (i = 0; i < proc_batch_return->n_procs; i++)
+    {
+      GPProcReturn *proc_return = &proc_batch_return->procs[i];
+
+      if (! _gimp_wire_write_string (channel,
+                                     &proc_return->name, 1, user_data))
+        return;
+
+      _gp_params_write (channel,
+                        proc_return->params, proc_return->nparams, user_data);
+    }
+}
+
+static void
+_gp_proc_batch_return_destroy (GimpWireMessage *msg)
+{
+  GPProcBatchReturn *proc_batch_return = msg->data;
+
+  if (proc_batch_return)
+    {
+      gint i;
+
+      for (i = 0; i < proc_batch_return->n_procs; i++)
+        {
+          GPProcReturn *proc_return = &proc_batch_return->procs[i];
+
+          gp_params_destroy (proc_return->params, proc_return->nparams);
+          g_free (proc_return->name);
+        }
+
+      g_free (proc_batch_return->procs);
+      g_slice_free (GPProcBatchReturn, proc_batch_return);
+    }
+}
+
 /*  proc_install  */
 
 static void
@@ -1770,6 +2285,86 @@ _gp_params_write (GIOChannel *channel,
     }
 }
 
+GPParam *
+gp_params_copy (const GPParam *params,
+                gint           nparams)
+{
+  GPParam *copy;
+  gint     i;
+
+  if (nparams <= 0)
+    return NULL;
+
+  copy = g_memdup (params, nparams * sizeof (GPParam));
+
+  for (i = 0; i < nparams; i++)
+    {
+      /*  arrays are preceded by their length, see _gp_params_write()  */
+      gint count = 0;
+
+      if (i > 0 && params[i-1].type == GIMP_PDB_INT32)
+        count = MAX (params[i-1].data.d_int32, 0);
+
+      switch (params[i].type)
+        {
+        case GIMP_PDB_STRING:
+          copy[i].data.d_string = g_strdup (params[i].data.d_string);
+          break;
+
+        case GIMP_PDB_INT32ARRAY:
+          copy[i].data.d_int32array =
+            g_memdup (params[i].data.d_int32array, count * sizeof (gint32));
+          break;
+
+        case GIMP_PDB_INT16ARRAY:
+          copy[i].data.d_int16array =
+            g_memdup (params[i].data.d_int16array, count * sizeof (gint16));
+          break;
+
+        case GIMP_PDB_INT8ARRAY:
+          copy[i].data.d_int8array =
+            g_memdup (params[i].data.d_int8array, count * sizeof (guint8));
+          break;
+
+        case GIMP_PDB_FLOATARRAY:
+          copy[i].data.d_floatarray =
+            g_memdup (params[i].data.d_floatarray, count * sizeof (gdouble));
+          break;
+
+        case GIMP_PDB_STRINGARRAY:
+          if (params[i].data.d_stringarray)
+            {
+              gint j;
+
+              copy[i].data.d_stringarray = g_new0 (gchar *, count);
+
+              for (j = 0; j < count; j++)
+                copy[i].data.d_stringarray[j] =
+                  g_strdup (params[i].data.d_stringarray[j]);
+            }
+          break;
+
+        case GIMP_PDB_COLORARRAY:
+          copy[i].data.d_colorarray =
+            g_memdup (params[i].data.d_colorarray, count * sizeof (GimpRGB));
+          break;
+
+        case GIMP_PDB_PARASITE:
+          copy[i].data.d_parasite.name =
+            g_strdup (params[i].data.d_parasite.name);
+          copy[i].data.d_parasite.data =
+            g_memdup (params[i].data.d_parasite.data,
+                      params[i].data.d_parasite.size);
+          break;
+
+        default:
+          break;
+        }
+    }
+
+  return copy;
+}
+
 void
 gp_params_destroy (GPParam *params,
                    gint     nparams)
@@ -26,7 +26,18 @@ G_BEGIN_DECLS
 
 /* Increment every time the protocol changes
  */
-#define GIMP_PROTOCOL_VERSION  0x0014
+#define GIMP_PROTOCOL_VERSION  0x0016
+
+
+/* The maximum number of tiles exchanged in one GP_TILE_BATCH_DATA
+ * message, the shared memory segment is large enough to hold them all
+ */
+#define GP_TILE_BATCH_MAX_TILES  64
+
+/* The maximum number of procedure calls in one GP_PROC_BATCH_RUN
+ * message
+ */
+#define GP_PROC_BATCH_MAX_PROCS  256
 
 
 enum
@@ -43,20 +54,28 @@ enum
   GP_PROC_INSTALL,
   GP_PROC_UNINSTALL,
   GP_EXTENSION_ACK,
-  GP_HAS_INIT
+  GP_HAS_INIT,
+  GP_TILE_BATCH_REQ,
+  GP_TILE_BATCH_DATA,
+  GP_PROC_BATCH_RUN,
+  GP_PROC_BATCH_RETURN
 };
 
 
-typedef struct _GPConfig        GPConfig;
-typedef struct _GPTileReq       GPTileReq;
-typedef struct _GPTileAck       GPTileAck;
-typedef struct _GPTileData      GPTileData;
-typedef struct _GPParam         GPParam;
-typedef struct _GPParamDef      GPParamDef;
-typedef struct _GPProcRun       GPProcRun;
-typedef struct _GPProcReturn    GPProcReturn;
-typedef struct _GPProcInstall   GPProcInstall;
-typedef struct _GPProcUninstall GPProcUninstall;
+typedef struct _GPConfig          GPConfig;
+typedef struct _GPTileReq         GPTileReq;
+typedef struct _GPTileAck         GPTileAck;
+typedef struct _GPTileData        GPTileData;
+typedef struct _GPTileBatchReq    GPTileBatchReq;
+typedef struct _GPTileBatchData   GPTileBatchData;
+typedef struct _GPParam           GPParam;
+typedef struct _GPParamDef        GPParamDef;
+typedef struct _GPProcRun         GPProcRun;
+typedef struct _GPProcReturn      GPProcReturn;
+typedef struct _GPProcBatchRun    GPProcBatchRun;
+typedef struct _GPProcBatchReturn GPProcBatchReturn;
+typedef struct _GPProcInstall     GPProcInstall;
+typedef struct _GPProcUninstall   GPProcUninstall;
 
 
 struct _GPConfig
@@ -103,6 +122,27 @@ struct _GPTileData
   guchar  *data;
 };
 
+struct _GPTileBatchReq
+{
+  gint32   drawable_ID;
+  guint32  shadow;
+  guint32  put;
+  guint32  n_tiles;
+  guint32 *tile_nums;
+};
+
+struct _GPTileBatchData
+{
+  gint32   drawable_ID;
+  guint32  shadow;
+  guint32  bpp;
+  guint32  use_shm;
+  guint32  n_tiles;
+  guint32 *tile_nums;
+  guint32  data_length;  /* the tiles' pixels, stored back to back */
+  guchar  *data;
+};
+
 struct _GPParam
 {
   guint32 type;
@@ -164,6 +204,20 @@ struct _GPProcReturn
   GPParam *params;
 };
 
+struct _GPProcBatchRun
+{
+  guint32    n_procs;
+  GPProcRun *procs;
+};
+
+struct _GPProcBatchReturn
+{
+  guint32       n_procs;  /* may be less than the run's n_procs, see
+                           * gimp_batch_commit()
+                           */
+  GPProcReturn *procs;
+};
+
 struct _GPProcInstall
 {
   gchar      *name;
@@ -187,46 +241,60 @@ struct _GPProcUninstall
 };
 
 
-void      gp_init                   (void);
-
-gboolean  gp_quit_write             (GIOChannel      *channel,
-                                     gpointer         user_data);
-gboolean  gp_config_write           (GIOChannel      *channel,
-                                     GPConfig        *config,
-                                     gpointer         user_data);
-gboolean  gp_tile_req_write         (GIOChannel      *channel,
-                                     GPTileReq       *tile_req,
-                                     gpointer         user_data);
-gboolean  gp_tile_ack_write         (GIOChannel      *channel,
-                                     gpointer         user_data);
-gboolean  gp_tile_data_write        (GIOChannel      *channel,
-                                     GPTileData      *tile_data,
-                                     gpointer         user_data);
-gboolean  gp_proc_run_write         (GIOChannel      *channel,
-                                     GPProcRun       *proc_run,
-                                     gpointer         user_data);
-gboolean  gp_proc_return_write      (GIOChannel      *channel,
-                                     GPProcReturn    *proc_return,
-                                     gpointer         user_data);
-gboolean  gp_temp_proc_run_write    (GIOChannel      *channel,
-                                     GPProcRun       *proc_run,
-                                     gpointer         user_data);
-gboolean  gp_temp_proc_return_write (GIOChannel      *channel,
-                                     GPProcReturn    *proc_return,
-                                     gpointer         user_data);
-gboolean  gp_proc_install_write     (GIOChannel      *channel,
-                                     GPProcInstall   *proc_install,
-                                     gpointer         user_data);
-gboolean  gp_proc_uninstall_write   (GIOChannel      *channel,
-                                     GPProcUninstall *proc_uninstall,
-                                     gpointer         user_data);
-gboolean  gp_extension_ack_write    (GIOChannel      *channel,
-                                     gpointer         user_data);
-gboolean  gp_has_init_write         (GIOChannel      *channel,
-                                     gpointer         user_data);
-
-void      gp_params_destroy         (GPParam         *params,
-                                     gint             nparams);
+void      gp_init                    (void);
+
+gboolean  gp_quit_write              (GIOChannel        *channel,
+                                      gpointer           user_data);
+gboolean  gp_config_write            (GIOChannel        *channel,
+                                      GPConfig          *config,
+                                      gpointer           user_data);
+gboolean  gp_tile_req_write          (GIOChannel        *channel,
+                                      GPTileReq         *tile_req,
+                                      gpointer           user_data);
+gboolean  gp_tile_ack_write          (GIOChannel        *channel,
+                                      gpointer           user_data);
+gboolean  gp_tile_data_write         (GIOChannel        *channel,
+                                      GPTileData        *tile_data,
+                                      gpointer           user_data);
+gboolean  gp_tile_batch_req_write    (GIOChannel        *channel,
+                                      GPTileBatchReq    *tile_batch_req,
+                                      gpointer           user_data);
+gboolean  gp_tile_batch_data_write   (GIOChannel        *channel,
+                                      GPTileBatchData   *tile_batch_data,
+                                      gpointer           user_data);
+gboolean  gp_proc_run_write          (GIOChannel        *channel,
+                                      GPProcRun         *proc_run,
+                                      gpointer           user_data);
+gboolean  gp_proc_return_write       (GIOChannel        *channel,
+                                      GPProcReturn      *proc_return,
+                                      gpointer           user_data);
+gboolean  gp_temp_proc_run_write     (GIOChannel        *channel,
+                                      GPProcRun         *proc_run,
+                                      gpointer           user_data);
+gboolean  gp_temp_proc_return_write  (GIOChannel        *channel,
+                                      GPProcReturn      *proc_return,
+                                      gpointer           user_data);
+gboolean  gp_proc_batch_run_write    (GIOChannel        *channel,
+                                      GPProcBatchRun    *proc_batch_run,
+                                      gpointer           user_data);
+gboolean  gp_proc_batch_return_write (GIOChannel        *channel,
+                                      GPProcBatchReturn *proc_batch_return,
+                                      gpointer           user_data);
+gboolean  gp_proc_install_write      (GIOChannel        *channel,
+                                      GPProcInstall     *proc_install,
+                                      gpointer           user_data);
+gboolean  gp_proc_uninstall_write    (GIOChannel        *channel,
+                                      GPProcUninstall   *proc_uninstall,
+                                      gpointer           user_data);
+gboolean  gp_extension_ack_write     (GIOChannel        *channel,
+                                      gpointer           user_data);
+gboolean  gp_has_init_write          (GIOChannel        *channel,
+                                      gpointer           user_data);
+
+GPParam * gp_params_copy             (const GPParam     *params,
+                                      gint               nparams);
+void      gp_params_destroy          (GPParam           *params,
+                                      gint               nparams);
 
 
 G_END_DECLS
@@ -1101,3 +1101,199 @@ gimp_hsv_to_rgb4 (guchar  *rgb,
   rgb[1] = ROUND (saturation * 255.0);
   rgb[2] = ROUND (value      * 255.0);
 }
+
+
+/*  gfloat array functions  */
+
+/*  The array functions below work on whole rows of "R'G'B'A float"
+ *  pixels at once. They give the same results as their GimpRGB
+ *  counterparts, but in single precision and with the per-pixel
+ *  branches written as selects, so the loops can be vectorized.
+ *  The alpha component is copied, and @src and @dest may be the
+ *  same array.
+ */
+
+/**
+ * gimp_rgb_to_hsv_array:
+ * @rgba:     @n_pixels RGBA pixels
+ * @hsva:     returns @n_pixels HSVA pixels
+ * @n_pixels: the number of pixels
+ *
+ * Converts an array of RGBA float pixels to HSVA, like
+ * gimp_rgb_to_hsv() does for a single #GimpRGB.
+ **/
+void
+gimp_rgb_to_hsv_array (const gfloat *rgba,
+                       gfloat       *hsva,
+                       gint          n_pixels)
+{
+  gint i;
+
+  g_return_if_fail (rgba != NULL || n_pixels == 0);
+  g_return_if_fail (hsva != NULL || n_pixels == 0);
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      const gfloat r     = rgba[4 * i + 0];
+      const gfloat g     = rgba[4 * i + 1];
+      const gfloat b     = rgba[4 * i + 2];
+      const gfloat a     = rgba[4 * i + 3];
+      const gfloat max   = MAX (MAX (r, g), b);
+      const gfloat min   = MIN (MIN (r, g), b);
+      const gfloat delta = max - min;
+      const gint   color = delta > 0.0001f;
+      const gfloat d     = color ? delta : 1.0f;
+      gfloat       h;
+
+      h = (r == max ? (g - b) / d + (g < b ? 6.0f : 0.0f) :
+           g == max ? 2.0f + (b - r) / d :
+                      4.0f + (r - g) / d);
+
+      hsva[4 * i + 0] = color ? h / 6.0f  : 0.0f;
+      hsva[4 * i + 1] = color ? delta / max : 0.0f;
+      hsva[4 * i + 2] = max;
+      hsva[4 * i + 3] = a;
+    }
+}
+
+/**
+ * gimp_hsv_to_rgb_array:
+ * @hsva:     @n_pixels HSVA pixels
+ * @rgba:     returns @n_pixels RGBA pixels
+ * @n_pixels: the number of pixels
+ *
+ * Converts an array of HSVA float pixels to RGBA, like
+ * gimp_hsv_to_rgb() does for a single #GimpHSV.
+ **/
+void
+gimp_hsv_to_rgb_array (const gfloat *hsva,
+                       gfloat       *rgba,
+                       gint          n_pixels)
+{
+  gint i;
+
+  g_return_if_fail (hsva != NULL || n_pixels == 0);
+  g_return_if_fail (rgba != NULL || n_pixels == 0);
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      const gfloat h  = hsva[4 * i + 0] * 6.0f;
+      const gfloat s  = hsva[4 * i + 1];
+      const gfloat v  = hsva[4 * i + 2];
+      const gfloat a  = hsva[4 * i + 3];
+      const gfloat vs = v * s;
+      gfloat       k;
+
+      /*  each component is v, minus v * s where the hue is away from
+       *  it, rising and falling linearly over one sixth
+       */
+      k = 5.0f + h;
+      k = k >= 6.0f ? k - 6.0f : k;
+      rgba[4 * i + 0] = v - vs * CLAMP (MIN (k, 4.0f - k), 0.0f, 1.0f);
+
+      k = 3.0f + h;
+      k = k >= 6.0f ? k - 6.0f : k;
+      rgba[4 * i + 1] = v - vs * CLAMP (MIN (k, 4.0f - k), 0.0f, 1.0f);
+
+      k = 1.0f + h;
+      k = k >= 6.0f ? k - 6.0f : k;
+      rgba[4 * i + 2] = v - vs * CLAMP (MIN (k, 4.0f - k), 0.0f, 1.0f);
+
+      rgba[4 * i + 3] = a;
+    }
+}
+
+/**
+ * gimp_rgb_to_hsl_array:
+ * @rgba:     @n_pixels RGBA pixels
+ * @hsla:     returns @n_pixels HSLA pixels
+ * @n_pixels: the number of pixels
+ *
+ * Converts an array of RGBA float pixels to HSLA, like
+ * gimp_rgb_to_hsl() does for a single #GimpRGB. As there, the hue
+ * of gray pixels is -1.0.
+ **/
+void
+gimp_rgb_to_hsl_array (const gfloat *rgba,
+                       gfloat       *hsla,
+                       gint          n_pixels)
+{
+  gint i;
+
+  g_return_if_fail (rgba != NULL || n_pixels == 0);
+  g_return_if_fail (hsla != NULL || n_pixels == 0);
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      const gfloat r     = rgba[4 * i + 0];
+      const gfloat g     = rgba[4 * i + 1];
+      const gfloat b     = rgba[4 * i + 2];
+      const gfloat a     = rgba[4 * i + 3];
+      const gfloat max   = MAX (MAX (r, g), b);
+      const gfloat min   = MIN (MIN (r, g), b);
+      const gfloat delta = max - min;
+      const gfloat l     = (max + min) / 2.0f;
+      const gint   color = max != min;
+      const gfloat d     = color ? delta : 1.0f;
+      gfloat       h;
+      gfloat       s;
+
+      s = delta / (l <= 0.5f ? max + min : 2.0f - max - min);
+
+      h = (r == max ? (g - b) / d :
+           g == max ? 2.0f + (b - r) / d :
+                      4.0f + (r - g) / d) / 6.0f;
+      h = h < 0.0f ? h + 1.0f : h;
+
+      hsla[4 * i + 0] = color ? h : GIMP_HSL_UNDEFINED;
+      hsla[4 * i + 1] = color ? s : 0.0f;
+      hsla[4 * i + 2] = l;
+      hsla[4 * i + 3] = a;
+    }
+}
+
+/**
+ * gimp_hsl_to_rgb_array:
+ * @hsla:     @n_pixels HSLA pixels
+ * @rgba:     returns @n_pixels RGBA pixels
+ * @n_pixels: the number of pixels
+ *
+ * Converts an array of HSLA float pixels to RGBA, like
+ * gimp_hsl_to_rgb() does for a single #GimpHSL.
+ **/
+void
+gimp_hsl_to_rgb_array (const gfloat *hsla,
+                       gfloat       *rgba,
+                       gint          n_pixels)
+{
+  gint i;
+
+  g_return_if_fail (hsla != NULL || n_pixels == 0);
+  g_return_if_fail (rgba != NULL || n_pixels == 0);
+
+  for (i = 0; i < n_pixels; i++)
+    {
+      const gfloat h  = hsla[4 * i + 0] * 6.0f;
+      const gfloat s  = hsla[4 * i + 1];
+      const gfloat l  = hsla[4 * i + 2];
+      const gfloat a  = hsla[4 * i + 3];
+      const gfloat m2 = l <= 0.5f ? l * (1.0f + s) : l + s - l * s;
+      const gfloat m1 = 2.0f * l - m2;
+      gfloat       k;
+
+      /*  with s == 0, m1 == m2 == l, so gray needs no special case  */
+      k = h + 2.0f;
+      k = k > 6.0f ? k - 6.0f : (k < 0.0f ? k + 6.0f : k);
+      rgba[4 * i + 0] = m1 + (m2 - m1) * CLAMP (MIN (k, 4.0f - k), 0.0f, 1.0f);
+
+      k = h;
+      k = k > 6.0f ? k - 6.0f : (k < 0.0f ? k + 6.0f : k);
+      rgba[4 * i + 1] = m1 + (m2 - m1) * CLAMP (MIN (k, 4.0f - k), 0.0f, 1.0f);
+
+      k = h - 2.0f;
+      k = k > 6.0f ? k - 6.0f : (k < 0.0f ? k + 6.0f : k);
+      rgba[4 * i + 2] = m1 + (m2 - m1) * CLAMP (MIN (k, 4.0f - k), 0.0f, 1.0f);
+
+      rgba[4 * i + 3] = a;
+    }
+}
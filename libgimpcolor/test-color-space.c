@@ -0,0 +1,223 @@
+/* unit tests for the gfloat array functions in gimpcolorspace.c
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <babl/babl.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include <glib-object.h>
+#include <cairo.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "gimpcolor.h"
+
+
+/*  the number of steps per component of the sample grid  */
+#define STEPS     17
+#define N_PIXELS  (STEPS * STEPS * STEPS)
+
+/*  the array functions work in single precision  */
+#define TOLERANCE 1e-5
+
+
+/*  fills @pixels with every combination of STEPS values of the
+ *  first three components, and a varying alpha
+ */
+static void
+fill_grid (gfloat *pixels)
+{
+  gint i, j, k;
+
+  for (i = 0; i < STEPS; i++)
+    for (j = 0; j < STEPS; j++)
+      for (k = 0; k < STEPS; k++, pixels += 4)
+        {
+          pixels[0] = (gfloat) i / (STEPS - 1);
+          pixels[1] = (gfloat) j / (STEPS - 1);
+          pixels[2] = (gfloat) k / (STEPS - 1);
+          pixels[3] = (gfloat) (i + j + k) / (3 * (STEPS - 1));
+        }
+}
+
+/*  hue is circular, 0.0 and 1.0 are the same  */
+static gdouble
+hue_diff (gdouble a,
+          gdouble b)
+{
+  gdouble diff = fabs (a - b);
+
+  return MIN (diff, fabs (1.0 - diff));
+}
+
+static gint
+check_pixel (const gchar  *name,
+             const gfloat *src,
+             const gfloat *pixel,
+             gdouble       c0,
+             gdouble       c1,
+             gdouble       c2,
+             gdouble       c3,
+             gboolean      hue)
+{
+  gdouble diff0 = hue ? hue_diff (pixel[0], c0) : fabs (pixel[0] - c0);
+
+  if (diff0                > TOLERANCE ||
+      fabs (pixel[1] - c1) > TOLERANCE ||
+      fabs (pixel[2] - c2) > TOLERANCE ||
+      fabs (pixel[3] - c3) > TOLERANCE)
+    {
+      g_print ("%s differs for (%g, %g, %g, %g):\n"
+               "  array: (%g, %g, %g, %g)\n"
+               "  pixel: (%g, %g, %g, %g)\n",
+               name,
+               src[0], src[1], src[2], src[3],
+               pixel[0], pixel[1], pixel[2], pixel[3],
+               c0, c1, c2, c3);
+      return 1;
+    }
+
+  return 0;
+}
+
+static gint
+test_rgb_to_hsv (const gfloat *src,
+                 gfloat       *dest)
+{
+  gint failures = 0;
+  gint i;
+
+  gimp_rgb_to_hsv_array (src, dest, N_PIXELS);
+
+  for (i = 0; i < N_PIXELS; i++)
+    {
+      const gfloat *s = src + 4 * i;
+      GimpRGB       rgb;
+      GimpHSV       hsv;
+
+      gimp_rgba_set (&rgb, s[0], s[1], s[2], s[3]);
+      gimp_rgb_to_hsv (&rgb, &hsv);
+
+      failures += check_pixel ("gimp_rgb_to_hsv_array()", s, dest + 4 * i,
+                               hsv.h, hsv.s, hsv.v, hsv.a, TRUE);
+    }
+
+  return failures;
+}
+
+static gint
+test_hsv_to_rgb (const gfloat *src,
+                 gfloat       *dest)
+{
+  gint failures = 0;
+  gint i;
+
+  gimp_hsv_to_rgb_array (src, dest, N_PIXELS);
+
+  for (i = 0; i < N_PIXELS; i++)
+    {
+      const gfloat *s = src + 4 * i;
+      GimpHSV       hsv;
+      GimpRGB       rgb;
+
+      gimp_hsva_set (&hsv, s[0], s[1], s[2], s[3]);
+      gimp_hsv_to_rgb (&hsv, &rgb);
+
+      failures += check_pixel ("gimp_hsv_to_rgb_array()", s, dest + 4 * i,
+                               rgb.r, rgb.g, rgb.b, rgb.a, FALSE);
+    }
+
+  return failures;
+}
+
+static gint
+test_rgb_to_hsl (const gfloat *src,
+                 gfloat       *dest)
+{
+  gint failures = 0;
+  gint i;
+
+  gimp_rgb_to_hsl_array (src, dest, N_PIXELS);
+
+  for (i = 0; i < N_PIXELS; i++)
+    {
+      const gfloat *s = src + 4 * i;
+      GimpRGB       rgb;
+      GimpHSL       hsl;
+
+      gimp_rgba_set (&rgb, s[0], s[1], s[2], s[3]);
+      gimp_rgb_to_hsl (&rgb, &hsl);
+
+      /*  gray has an undefined hue of -1.0 in both  */
+      failures += check_pixel ("gimp_rgb_to_hsl_array()", s, dest + 4 * i,
+                               hsl.h, hsl.s, hsl.l, hsl.a,
+                               hsl.h != GIMP_HSL_UNDEFINED);
+    }
+
+  return failures;
+}
+
+static gint
+test_hsl_to_rgb (const gfloat *src,
+                 gfloat       *dest)
+{
+  gint failures = 0;
+  gint i;
+
+  gimp_hsl_to_rgb_array (src, dest, N_PIXELS);
+
+  for (i = 0; i < N_PIXELS; i++)
+    {
+      const gfloat *s = src + 4 * i;
+      GimpHSL       hsl;
+      GimpRGB       rgb;
+
+      gimp_hsl_set (&hsl, s[0], s[1], s[2]);
+      gimp_hsl_set_alpha (&hsl, s[3]);
+      gimp_hsl_to_rgb (&hsl, &rgb);
+
+      failures += check_pixel ("gimp_hsl_to_rgb_array()", s, dest + 4 * i,
+                               rgb.r, rgb.g, rgb.b, rgb.a, FALSE);
+    }
+
+  return failures;
+}
+
+int
+main (void)
+{
+  gfloat *src;
+  gfloat *dest;
+  gint    failures = 0;
+
+  g_print ("\nTesting the GIMP color space array functions ...\n");
+
+  src  = g_new (gfloat, N_PIXELS * 4);
+  dest = g_new (gfloat, N_PIXELS * 4);
+
+  fill_grid (src);
+
+  failures += test_rgb_to_hsv (src, dest);
+  failures += test_hsv_to_rgb (src, dest);
+  failures += test_rgb_to_hsl (src, dest);
+  failures += test_hsl_to_rgb (src, dest);
+
+  g_free (src);
+  g_free (dest);
+
+  if (failures)
+    {
+      g_print ("%d out of %d samples failed!\n\n",
+               failures, 4 * N_PIXELS);
+      return EXIT_FAILURE;
+    }
+  else
+    {
+      g_print ("All %d samples passed.\n\n", 4 * N_PIXELS);
+      return EXIT_SUCCESS;
+    }
+}
@@ -871,6 +871,11 @@ img_duplicate(PyGimpImage *self)
 static PyObject *
 img_undo_group_start(PyGimpImage *self)
 {
+    /* queue the calls inside the group, see gimp_batch_begin(); the
+     * batch is opened even if the group fails to start, so that
+     * undo_group_end() always has one to commit */
+    gimp_batch_begin();
+
     if (!gimp_image_undo_group_start(self->ID)) {
 	PyErr_Format(pygimp_error,
 		     "could not start undo group on image (ID %d)",
@@ -885,13 +890,23 @@ img_undo_group_start(PyGimpImage *self)
 static PyObject *
 img_undo_group_end(PyGimpImage *self)
 {
-    if (!gimp_image_undo_group_end(self->ID)) {
+    gboolean ended = gimp_image_undo_group_end(self->ID);
+    gboolean committed = gimp_batch_commit();
+
+    if (!ended) {
 	PyErr_Format(pygimp_error,
 		     "could not end undo group on image (ID %d)",
 		     self->ID);
 	return NULL;
     }
 
+    if (!committed) {
+	PyErr_Format(pygimp_error,
+		     "procedure call in undo group on image (ID %d) failed: %s",
+		     self->ID, gimp_get_pdb_error());
+	return NULL;
+    }
+
     Py_INCREF(Py_None);
     return Py_None;
 }
@@ -1305,6 +1305,27 @@ script_fu_marshal_procedure_call (scheme  *sc,
   }
 #endif
 
+  /*  queue the calls inside an undo group instead of waiting for
+   *  each of them, failures are reported when the group ends. The
+   *  batch is opened and committed whatever the status of the group
+   *  calls, so that it is always balanced
+   */
+  if (! strcmp (proc_name, "gimp-image-undo-group-start"))
+    {
+      gimp_batch_begin ();
+    }
+  else if (! strcmp (proc_name, "gimp-image-undo-group-end"))
+    {
+      if (! gimp_batch_commit () &&
+          values[0].data.d_status == GIMP_PDB_SUCCESS)
+        {
+          g_snprintf (error_str, sizeof (error_str),
+                      "Batched procedure call failed: %s",
+                      gimp_get_pdb_error ());
+          return foreign_error (sc, error_str, 0);
+        }
+    }
+
   switch (values[0].data.d_status)
     {
     case GIMP_PDB_EXECUTION_ERROR: